@@ -5,13 +5,33 @@
 //
 // Text is represented as a NUL-terminated `char*` (same as `i8*` in LLVM).
 
+// `kooixc native` compiles this file with -std=c99, which hides POSIX-2008 names such as
+// `clock_gettime`/`CLOCK_MONOTONIC` in glibc headers unless a feature macro asks for them.
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
 #include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+#define KX_PROF_SUPPORTED 1
+#include <elf.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
 #endif
 
 typedef struct KxEnum {
@@ -29,6 +49,9 @@ static char** kx_argv = NULL;
 
 // Forward declarations for helpers used before their definitions.
 static char* kx_prefix_up(const char* path, int up_levels);
+static size_t kx_search_roots(char*** roots_out);
+static void kx_prof_init(void);
+static void kx_prof_after_fork_child(void);
 
 // Best-effort: increase stack limit for deeply recursive Stage1 tooling when running as a native
 // executable. No-op if unsupported or if raising the limit fails.
@@ -151,18 +174,17 @@ static char* kx_find_runtime_c_path(void) {
       "native_runtime/runtime.c",
       "crates/kooixc/native_runtime/runtime.c",
   };
+  char** roots = NULL;
+  size_t root_count = kx_search_roots(&roots);
   for (size_t idx = 0; idx < sizeof(rels) / sizeof(rels[0]); idx++) {
     const char* rel = rels[idx];
     if (kx_file_exists(rel)) {
       return kx_strdup(rel);
     }
-    for (int up = 1; up <= 8; up++) {
-      char* candidate = kx_prefix_up(rel, up);
-      if (!candidate) {
-        break;
-      }
-      if (kx_file_exists(candidate)) {
-        return candidate; // already allocated
+    for (size_t r = 0; r < root_count; r++) {
+      char* candidate = kx_strcat2(roots[r], rel);
+      if (candidate && kx_file_exists(candidate)) {
+        return candidate;
       }
       free(candidate);
     }
@@ -300,6 +322,128 @@ static char* kx_read_file_exact(const char* path, char** err_out) {
   return buf;
 }
 
+// Module search roots, discovered once per process: each `KOOIX_PATH` entry (`:` separated), then
+// the stdlib root, i.e. the nearest of the working directory and its ancestors (up to 8 levels)
+// holding `stdlib/prelude.kooix`, else the checkout this runtime was compiled from. Every entry
+// ends with '/'. The working directory itself is not listed: paths are always tried as given first.
+static char** kx_roots = NULL;
+static size_t kx_root_count = 0;
+static int kx_roots_ready = 0;
+
+static void kx_roots_push(const char* dir, size_t len) {
+  if (len == 0) {
+    return;
+  }
+  char* root = (char*)malloc(len + 2);
+  if (!root) {
+    return;
+  }
+  memcpy(root, dir, len);
+  if (root[len - 1] != '/') {
+    root[len++] = '/';
+  }
+  root[len] = '\0';
+  for (size_t i = 0; i < kx_root_count; i++) {
+    if (strcmp(kx_roots[i], root) == 0) {
+      free(root);
+      return;
+    }
+  }
+  char** grown = (char**)realloc(kx_roots, (kx_root_count + 1) * sizeof(char*));
+  if (!grown) {
+    free(root);
+    return;
+  }
+  kx_roots = grown;
+  kx_roots[kx_root_count++] = root;
+}
+
+static size_t kx_search_roots(char*** roots_out) {
+  if (!kx_roots_ready) {
+    kx_roots_ready = 1;
+    const char* env = getenv("KOOIX_PATH");
+    while (env && *env) {
+      const char* colon = strchr(env, ':');
+      size_t len = colon ? (size_t)(colon - env) : strlen(env);
+      kx_roots_push(env, len);
+      env = colon ? colon + 1 : NULL;
+    }
+
+    const char* marker = "stdlib/prelude.kooix";
+    int found = kx_file_exists(marker);
+    for (int up = 1; up <= 8 && !found; up++) {
+      char* candidate = kx_prefix_up(marker, up);
+      if (candidate && kx_file_exists(candidate)) {
+        kx_roots_push(candidate, (size_t)up * 3);
+        found = 1;
+      }
+      free(candidate);
+    }
+    const char* suffix = "crates/kooixc/native_runtime/runtime.c";
+    size_t file_len = strlen(__FILE__);
+    size_t suffix_len = strlen(suffix);
+    if (!found && file_len > suffix_len && strcmp(__FILE__ + file_len - suffix_len, suffix) == 0) {
+      kx_roots_push(__FILE__, file_len - suffix_len);
+    }
+  }
+  *roots_out = kx_roots;
+  return kx_root_count;
+}
+
+// Requested module path -> the location that opened, so each module costs one successful open
+// after its first resolution. Misses are not cached (the file may be created later).
+typedef struct KxPathEntry {
+  char* key;
+  char* path;
+  struct KxPathEntry* next;
+} KxPathEntry;
+
+#define KX_PATH_CACHE_BUCKETS 256
+static KxPathEntry* kx_path_cache[KX_PATH_CACHE_BUCKETS];
+
+static size_t kx_path_bucket(const char* s) {
+  uint64_t h = 1469598103934665603ULL;
+  for (const unsigned char* p = (const unsigned char*)s; *p; p++) {
+    h = (h ^ *p) * 1099511628211ULL;
+  }
+  return (size_t)(h & (KX_PATH_CACHE_BUCKETS - 1));
+}
+
+static KxPathEntry* kx_path_cache_find(const char* key) {
+  for (KxPathEntry* e = kx_path_cache[kx_path_bucket(key)]; e; e = e->next) {
+    if (strcmp(e->key, key) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+static void kx_path_cache_put(const char* key, const char* path) {
+  KxPathEntry* e = kx_path_cache_find(key);
+  if (e) {
+    char* copy = kx_strdup(path);
+    if (copy) {
+      e->path = copy;
+    }
+    return;
+  }
+  e = (KxPathEntry*)malloc(sizeof(KxPathEntry));
+  if (!e) {
+    return;
+  }
+  e->key = kx_strdup(key);
+  e->path = kx_strdup(path);
+  if (!e->key || !e->path) {
+    free(e->key);
+    free(e->path);
+    free(e);
+    return;
+  }
+  size_t b = kx_path_bucket(key);
+  e->next = kx_path_cache[b];
+  kx_path_cache[b] = e;
+}
+
 static char* kx_read_file_with_search(const char* raw, char** err_out) {
   char* err = NULL;
   char* path0 = kx_add_extension(raw, ".kooix");
@@ -309,29 +453,44 @@ static char* kx_read_file_with_search(const char* raw, char** err_out) {
     }
     return NULL;
   }
+  if (err_out) {
+    *err_out = NULL;
+  }
+
+  if (path0[0] != '/') {
+    KxPathEntry* hit = kx_path_cache_find(path0);
+    if (hit) {
+      char* cached = kx_read_file_exact(hit->path, NULL);
+      if (cached) {
+        return cached;
+      }
+    }
+  }
 
   char* out = kx_read_file_exact(path0, &err);
-  if (out) {
-    if (err_out) {
-      *err_out = NULL;
+  if (out || path0[0] == '/') {
+    if (out) {
+      kx_path_cache_put(path0, path0);
+    } else if (err_out) {
+      *err_out = err ? err : kx_strdup("failed to read file");
     }
     return out;
   }
 
-  // Search parent directories (mirrors Stage0 intrinsic behavior for tests).
-  for (int up = 1; up <= 8; up++) {
-    char* candidate = kx_prefix_up(path0, up);
+  char** roots = NULL;
+  size_t root_count = kx_search_roots(&roots);
+  for (size_t r = 0; r < root_count; r++) {
+    char* candidate = kx_strcat2(roots[r], path0);
     if (!candidate) {
       break;
     }
-    char* err2 = NULL;
-    out = kx_read_file_exact(candidate, &err2);
+    out = kx_read_file_exact(candidate, NULL);
     if (out) {
-      if (err_out) {
-        *err_out = NULL;
-      }
+      kx_path_cache_put(path0, candidate);
+      free(candidate);
       return out;
     }
+    free(candidate);
   }
 
   if (err_out) {
@@ -392,6 +551,54 @@ static char* kx_file_marker(const char* path) {
   return kx_strcat3("// --- file: ", path ? path : "(null)", " ---\n");
 }
 
+// Location of `import "<raw>"` in a file under `base_dir` ("" or ending in '/'): next to the
+// importer, else `raw` under the search roots, else the importer-relative path (whose read then
+// reports the error). Mirrors `module_path::resolve_import`; hits are cached under the
+// importer-relative path. The entry is located with `base_dir == ""`.
+static char* kx_locate_import(const char* base_dir, const char* raw) {
+  char* joined = kx_resolve_import_path(base_dir, raw);
+  if (!joined || raw[0] == '/') {
+    return joined;
+  }
+  KxPathEntry* hit = kx_path_cache_find(joined);
+  if (hit) {
+    free(joined);
+    return kx_strdup(hit->path);
+  }
+  if (kx_file_exists(joined)) {
+    kx_path_cache_put(joined, joined);
+    return joined;
+  }
+  char* rel = kx_add_extension(raw, ".kooix");
+  char** roots = NULL;
+  size_t root_count = kx_search_roots(&roots);
+  for (size_t r = 0; rel && r < root_count; r++) {
+    char* candidate = kx_strcat2(roots[r], rel);
+    if (candidate && kx_file_exists(candidate)) {
+      kx_path_cache_put(joined, candidate);
+      free(rel);
+      free(joined);
+      return candidate;
+    }
+    free(candidate);
+  }
+  free(rel);
+  return joined;
+}
+
+// Visited-set key for a located module, so one file reached through two spellings (or two
+// importers) is spliced once.
+static char* kx_canonical_path(const char* path) {
+#if defined(__unix__) || defined(__APPLE__)
+  char* real = realpath(path, NULL);
+  if (real) {
+    return real;
+  }
+#endif
+  return kx_strdup(path);
+}
+
+// `path` is already located (see `kx_locate_import`); its directory is the base for its imports.
 static void kx_load_file(const char* path, KxStrNode** visited, char** combined, char** err_out) {
   if (err_out && *err_out) {
     return;
@@ -403,15 +610,24 @@ static void kx_load_file(const char* path, KxStrNode** visited, char** combined,
     return;
   }
 
-  if (kx_visited_contains(visited ? *visited : NULL, path)) {
+  char* key = kx_canonical_path(path);
+  if (!key) {
+    if (err_out) {
+      *err_out = kx_strdup("out of memory");
+    }
+    return;
+  }
+  if (kx_visited_contains(visited ? *visited : NULL, key)) {
+    free(key);
     return;
   }
   if (visited) {
-    kx_visited_push(visited, path);
+    kx_visited_push(visited, key);
   }
+  free(key);
 
   char* err = NULL;
-  char* src = kx_read_file_with_search(path, &err);
+  char* src = kx_read_file_exact(path, &err);
   if (!src) {
     if (err_out) {
       *err_out = err ? err : kx_strdup("failed to read file");
@@ -475,7 +691,7 @@ static void kx_load_file(const char* path, KxStrNode** visited, char** combined,
             kx_skip_ws_and_line_comments(src, &i);
             if (src[i] == ';' && raw_import) {
               i++;
-              char* resolved = kx_resolve_import_path(base_dir, raw_import);
+              char* resolved = kx_locate_import(base_dir, raw_import);
               if (resolved) {
                 kx_load_file(resolved, visited, combined, err_out);
               }
@@ -515,7 +731,8 @@ KxEnum* kx_host_load_source_map(const char* entry_path) {
   char* err = NULL;
   KxStrNode* visited = NULL;
 
-  kx_load_file(entry_path, &visited, &combined, &err);
+  char* entry = entry_path ? kx_locate_import("", entry_path) : NULL;
+  kx_load_file(entry, &visited, &combined, &err);
 
   KxEnum* out = (KxEnum*)malloc(sizeof(KxEnum));
   if (!out) {
@@ -605,6 +822,13 @@ KxEnum* kx_host_read_file(const char* path) {
   return out;
 }
 
+// Where `import "<raw>"` in a file under `base_dir` lives (see `kx_locate_import`), so the Stage1
+// source map keys dedup and import bases on the same location this loader does.
+char* kx_host_resolve_import(const char* base_dir, const char* raw) {
+  char* out = raw ? kx_locate_import(base_dir ? base_dir : "", raw) : NULL;
+  return out ? out : kx_strdup("");
+}
+
 KxEnum* kx_host_link_llvm_ir_file(const char* ir_path, const char* out_path) {
   KxEnum* out = (KxEnum*)malloc(sizeof(KxEnum));
   if (!out) {
@@ -647,7 +871,7 @@ KxEnum* kx_host_link_llvm_ir_file(const char* ir_path, const char* out_path) {
     return out;
   }
 
-  size_t cmd1_len = strlen("llc -filetype=obj -relocation-model=pic ") + strlen(q_ir) +
+  size_t cmd1_len = strlen("llc -filetype=obj -relocation-model=pic -frame-pointer=all ") + strlen(q_ir) +
                     strlen(" -o ") + strlen(q_obj) + 1;
   char* cmd1 = (char*)malloc(cmd1_len);
   if (!cmd1) {
@@ -655,17 +879,24 @@ KxEnum* kx_host_link_llvm_ir_file(const char* ir_path, const char* out_path) {
     out->payload = (uint64_t)(uintptr_t)kx_strdup("host_link_llvm_ir_file: out of memory");
     return out;
   }
-  snprintf(cmd1, cmd1_len, "llc -filetype=obj -relocation-model=pic %s -o %s", q_ir, q_obj);
+  snprintf(cmd1, cmd1_len, "llc -filetype=obj -relocation-model=pic -frame-pointer=all %s -o %s", q_ir, q_obj);
 
-  size_t cmd2_len = strlen("clang ") + strlen(q_obj) + 1 + strlen(q_runtime) + strlen(" -o ") +
-                    strlen(q_out) + 1;
+  // Same shape as `kooixc native`: one section per runtime function, unreachable ones dropped.
+#if defined(__APPLE__)
+  const char* gc_flag = "-Wl,-dead_strip";
+#else
+  const char* gc_flag = "-Wl,--gc-sections";
+#endif
+  size_t cmd2_len = strlen("clang -ffunction-sections -fdata-sections ") + strlen(q_obj) + 1 +
+                    strlen(q_runtime) + 1 + strlen(gc_flag) + strlen(" -o ") + strlen(q_out) + 1;
   char* cmd2 = (char*)malloc(cmd2_len);
   if (!cmd2) {
     out->tag = 1; // Err
     out->payload = (uint64_t)(uintptr_t)kx_strdup("host_link_llvm_ir_file: out of memory");
     return out;
   }
-  snprintf(cmd2, cmd2_len, "clang %s %s -o %s", q_obj, q_runtime, q_out);
+  snprintf(cmd2, cmd2_len, "clang -ffunction-sections -fdata-sections %s %s %s -o %s", q_obj,
+           q_runtime, gc_flag, q_out);
 
   int rc1 = system(cmd1);
   if (rc1 != 0) {
@@ -724,12 +955,654 @@ char* kx_host_argv(int64_t index) {
   return (char*)(s ? s : "");
 }
 
+// Cursor-style text access for lexers. Unlike `text_byte_at`/`text_slice` these never call
+// strlen and never box an Option: callers keep `0 <= index <= len` (the NUL terminator reads
+// as 0) and `start <= end <= len` themselves.
+
+int64_t kx_text_byte(const char* s, int64_t index) {
+  if (!s || index < 0) {
+    return 0;
+  }
+  return (int64_t)(unsigned char)s[index];
+}
+
+char* kx_text_sub(const char* s, int64_t start, int64_t end) {
+  if (!s || start < 0 || end < start) {
+    return kx_strdup("");
+  }
+  size_t n = (size_t)(end - start);
+  char* out = (char*)malloc(n + 1);
+  if (!out) {
+    return NULL;
+  }
+  memcpy(out, s + start, n);
+  out[n] = '\0';
+  return out;
+}
+
+int64_t kx_text_scan_ident(const char* s, int64_t start) {
+  if (!s || start < 0) {
+    return start;
+  }
+  size_t idx = (size_t)start;
+  while (s[idx] && kx_is_ident_continue(s[idx])) {
+    idx++;
+  }
+  return (int64_t)idx;
+}
+
+int64_t kx_text_skip_trivia(const char* s, int64_t start) {
+  if (!s || start < 0) {
+    return start;
+  }
+  size_t idx = (size_t)start;
+  kx_skip_ws_and_line_comments(s, &idx);
+  return (int64_t)idx;
+}
+
+// Growable int64 buffers behind the `int_buf_*` intrinsics. The handle is the buffer pointer;
+// buffers are never freed (same lifetime model as every other native allocation).
+
+typedef struct KxIntBuf {
+  int64_t len;
+  int64_t cap;
+  int64_t* data;
+} KxIntBuf;
+
+int64_t kx_int_buf_new(void) {
+  KxIntBuf* buf = (KxIntBuf*)calloc(1, sizeof(KxIntBuf));
+  return (int64_t)(intptr_t)buf;
+}
+
+int64_t kx_int_buf_push(int64_t handle, int64_t value) {
+  KxIntBuf* buf = (KxIntBuf*)(intptr_t)handle;
+  if (!buf) {
+    return 0;
+  }
+  if (buf->len == buf->cap) {
+    int64_t cap = buf->cap ? buf->cap * 2 : 64;
+    int64_t* data = (int64_t*)realloc(buf->data, (size_t)cap * sizeof(int64_t));
+    if (!data) {
+      fprintf(stderr, "kx_int_buf_push: out of memory\n");
+      exit(1);
+    }
+    buf->data = data;
+    buf->cap = cap;
+  }
+  buf->data[buf->len++] = value;
+  return buf->len;
+}
+
+int64_t kx_int_buf_get(int64_t handle, int64_t index) {
+  KxIntBuf* buf = (KxIntBuf*)(intptr_t)handle;
+  if (!buf || index < 0 || index >= buf->len) {
+    return 0;
+  }
+  return buf->data[index];
+}
+
+int64_t kx_int_buf_pop(int64_t handle) {
+  KxIntBuf* buf = (KxIntBuf*)(intptr_t)handle;
+  if (!buf || buf->len == 0) {
+    return 0;
+  }
+  return buf->data[--buf->len];
+}
+
+int64_t kx_int_buf_len(int64_t handle) {
+  KxIntBuf* buf = (KxIntBuf*)(intptr_t)handle;
+  return buf ? buf->len : 0;
+}
+
+// Interning tables behind the `text_intern*` intrinsics: open addressing keyed by FNV-1a, ids
+// dense from 1 in insertion order. Keys are copied; tables are never freed.
+
+typedef struct KxInternTable {
+  int64_t len;
+  int64_t cap;
+  char** keys;
+  uint64_t* hashes;
+  int64_t* ids;
+} KxInternTable;
+
+static uint64_t kx_intern_hash(const char* s) {
+  uint64_t h = 1469598103934665603ULL;
+  for (const unsigned char* p = (const unsigned char*)s; *p; p++) {
+    h ^= (uint64_t)*p;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static void kx_intern_alloc(KxInternTable* table, int64_t cap) {
+  table->cap = cap;
+  table->keys = (char**)calloc((size_t)cap, sizeof(char*));
+  table->hashes = (uint64_t*)calloc((size_t)cap, sizeof(uint64_t));
+  table->ids = (int64_t*)calloc((size_t)cap, sizeof(int64_t));
+  if (!table->keys || !table->hashes || !table->ids) {
+    fprintf(stderr, "kx_text_intern: out of memory\n");
+    exit(1);
+  }
+}
+
+int64_t kx_text_intern_new(void) {
+  KxInternTable* table = (KxInternTable*)calloc(1, sizeof(KxInternTable));
+  if (table) {
+    kx_intern_alloc(table, 64);
+  }
+  return (int64_t)(intptr_t)table;
+}
+
+int64_t kx_text_intern(int64_t handle, const char* key) {
+  KxInternTable* table = (KxInternTable*)(intptr_t)handle;
+  if (!table) {
+    return 0;
+  }
+  if (!key) {
+    key = "";
+  }
+  uint64_t h = kx_intern_hash(key);
+  uint64_t mask = (uint64_t)table->cap - 1;
+  uint64_t slot = h & mask;
+  while (table->keys[slot]) {
+    if (table->hashes[slot] == h && strcmp(table->keys[slot], key) == 0) {
+      return table->ids[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  int64_t id = ++table->len;
+  table->keys[slot] = kx_strdup(key);
+  table->hashes[slot] = h;
+  table->ids[slot] = id;
+
+  // Keep the load factor under 1/2.
+  if (table->len * 2 > table->cap) {
+    int64_t old_cap = table->cap;
+    char** old_keys = table->keys;
+    uint64_t* old_hashes = table->hashes;
+    int64_t* old_ids = table->ids;
+    kx_intern_alloc(table, old_cap * 2);
+    uint64_t new_mask = (uint64_t)table->cap - 1;
+    for (int64_t i = 0; i < old_cap; i++) {
+      if (!old_keys[i]) {
+        continue;
+      }
+      uint64_t s = old_hashes[i] & new_mask;
+      while (table->keys[s]) {
+        s = (s + 1) & new_mask;
+      }
+      table->keys[s] = old_keys[i];
+      table->hashes[s] = old_hashes[i];
+      table->ids[s] = old_ids[i];
+    }
+    free(old_keys);
+    free(old_hashes);
+    free(old_ids);
+  }
+  return id;
+}
+
+// Process isolation behind `host_fork`/`host_wait`/`host_exit`. Native allocations are never
+// freed, so a long-lived driver forks per job and lets the child's exit reclaim its heap.
+
+int64_t kx_host_fork(void) {
+#if defined(__unix__) || defined(__APPLE__)
+  fflush(NULL);
+  pid_t pid = fork();
+  if (pid == 0) {
+    kx_prof_after_fork_child();
+  }
+  return pid < 0 ? -1 : (int64_t)pid;
+#else
+  return -1;
+#endif
+}
+
+int64_t kx_host_wait(int64_t pid) {
+#if defined(__unix__) || defined(__APPLE__)
+  int status = 0;
+  pid_t r;
+  do {
+    r = waitpid((pid_t)pid, &status, 0);
+  } while (r < 0 && errno == EINTR);
+  if (r < 0 || !WIFEXITED(status)) {
+    return -1;
+  }
+  return (int64_t)WEXITSTATUS(status);
+#else
+  (void)pid;
+  return -1;
+#endif
+}
+
+int64_t kx_host_exit(int64_t code) {
+  fflush(NULL);
+  exit((int)code);
+}
+
+// Phase instrumentation behind `host_now_ns`/`host_heap_bytes` (Stage1 `--timings`).
+
+int64_t kx_host_now_ns(void) {
+#if defined(__unix__) || defined(__APPLE__)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 0;
+  }
+  return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
+// Bytes currently allocated from the C heap. Native code never frees, so deltas between two
+// calls are the allocation volume of the work in between.
+int64_t kx_host_heap_bytes(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 mi = mallinfo2();
+  return (int64_t)(mi.uordblks + mi.hblkhd);
+#elif defined(__unix__) || defined(__APPLE__)
+  // Fallback: peak RSS (KiB on Linux/BSD, bytes on macOS).
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return (int64_t)ru.ru_maxrss;
+#else
+  return (int64_t)ru.ru_maxrss * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+// Sampling profiler behind `KX_PROFILE=out.folded`.
+//
+// `setitimer(ITIMER_PROF)` delivers SIGPROF every ~1ms of CPU time; the handler walks the frame
+// pointer chain from the interrupted context into a buffer preallocated at startup (no allocation
+// or syscalls in signal context). At exit the recorded pcs are symbolized through the ELF
+// `.symtab` of /proc/self/exe and written as folded stacks (`root;...;leaf count`), the input
+// format of flamegraph.pl / inferno / speedscope. `kooixc native` keeps frame pointers in both
+// the emitted code and this file for the walk. Linux x86_64/aarch64 only; elsewhere it warns.
+
+#define KX_PROF_MAX_DEPTH 128
+#define KX_PROF_TRUNCATED ((uint64_t)1 << 63)
+
+#if defined(KX_PROF_SUPPORTED)
+static char* kx_prof_path = NULL;
+// Sample records: a header word (depth, high bit set when the walk hit KX_PROF_MAX_DEPTH), then
+// `depth` pcs leaf first. Only the main thread runs Kooix code, so a plain cursor suffices.
+static uint64_t* kx_prof_buf = NULL;
+static size_t kx_prof_cap = 0;
+static size_t kx_prof_len = 0;
+static uint64_t kx_prof_samples = 0;
+static uint64_t kx_prof_dropped = 0;
+static uintptr_t kx_prof_stack_hi = 0;
+static long kx_prof_hz = 997;
+static pid_t kx_prof_owner = 0;
+
+static void kx_prof_handler(int sig, siginfo_t* info, void* ucv) {
+  (void)sig;
+  (void)info;
+  ucontext_t* uc = (ucontext_t*)ucv;
+#if defined(__x86_64__)
+  // REG_RIP/REG_RSP/REG_RBP need _GNU_SOURCE; the gregs layout itself is fixed by the ABI.
+  uintptr_t pc = (uintptr_t)uc->uc_mcontext.gregs[16];
+  uintptr_t sp = (uintptr_t)uc->uc_mcontext.gregs[15];
+  uintptr_t fp = (uintptr_t)uc->uc_mcontext.gregs[10];
+#else
+  uintptr_t pc = (uintptr_t)uc->uc_mcontext.pc;
+  uintptr_t sp = (uintptr_t)uc->uc_mcontext.sp;
+  uintptr_t fp = (uintptr_t)uc->uc_mcontext.regs[29];
+#endif
+  if (kx_prof_len + 2 + KX_PROF_MAX_DEPTH > kx_prof_cap) {
+    kx_prof_dropped++;
+    return;
+  }
+  uint64_t* rec = kx_prof_buf + kx_prof_len;
+  uint64_t depth = 0;
+  rec[1 + depth++] = (uint64_t)pc;
+  // Every frame must lie between the interrupted sp and the stack top and strictly grow towards
+  // it; anything else (code built without frame pointers, prologues) ends the walk.
+  while (fp != 0 && (fp & 7) == 0 && fp >= sp && fp + 16 <= kx_prof_stack_hi) {
+    if (depth == KX_PROF_MAX_DEPTH) {
+      depth |= KX_PROF_TRUNCATED;
+      break;
+    }
+    uintptr_t next = ((uintptr_t*)fp)[0];
+    uintptr_t ret = ((uintptr_t*)fp)[1];
+    if (ret == 0) {
+      break;
+    }
+    rec[1 + depth++] = (uint64_t)ret;
+    if (next <= fp) {
+      break;
+    }
+    fp = next;
+  }
+  rec[0] = depth;
+  kx_prof_len += 1 + (size_t)(depth & ~KX_PROF_TRUNCATED);
+  kx_prof_samples++;
+}
+
+static uintptr_t kx_prof_find_stack_hi(void) {
+  FILE* f = fopen("/proc/self/maps", "r");
+  if (!f) {
+    return 0;
+  }
+  char line[512];
+  uintptr_t hi = 0;
+  while (fgets(line, sizeof(line), f)) {
+    if (strstr(line, "[stack]")) {
+      unsigned long lo_v = 0;
+      unsigned long hi_v = 0;
+      if (sscanf(line, "%lx-%lx", &lo_v, &hi_v) == 2) {
+        hi = (uintptr_t)hi_v;
+      }
+      break;
+    }
+  }
+  fclose(f);
+  return hi;
+}
+
+static int kx_prof_arm(void) {
+  struct itimerval it;
+  memset(&it, 0, sizeof(it));
+  it.it_interval.tv_usec = 1000000L / kx_prof_hz;
+  it.it_value = it.it_interval;
+  return setitimer(ITIMER_PROF, &it, NULL);
+}
+
+typedef struct KxProfSym {
+  uint64_t addr;
+  uint64_t size;
+  const char* name;
+} KxProfSym;
+
+static int kx_prof_sym_cmp(const void* a, const void* b) {
+  uint64_t x = ((const KxProfSym*)a)->addr;
+  uint64_t y = ((const KxProfSym*)b)->addr;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// Function symbols of the running executable, rebased by the PIE load bias (derived from where
+// `kx_runtime_init` actually lives). The image stays allocated: names point into its strtab.
+static KxProfSym* kx_prof_load_syms(size_t* count_out) {
+  *count_out = 0;
+  FILE* f = fopen("/proc/self/exe", "rb");
+  if (!f) {
+    return NULL;
+  }
+  char* img = NULL;
+  size_t len = 0;
+  size_t cap = 0;
+  for (;;) {
+    if (len == cap) {
+      size_t next_cap = cap ? cap * 2 : (size_t)1 << 20;
+      char* grown = (char*)realloc(img, next_cap);
+      if (!grown) {
+        free(img);
+        fclose(f);
+        return NULL;
+      }
+      img = grown;
+      cap = next_cap;
+    }
+    size_t n = fread(img + len, 1, cap - len, f);
+    if (n == 0) {
+      break;
+    }
+    len += n;
+  }
+  fclose(f);
+
+  Elf64_Ehdr* eh = (Elf64_Ehdr*)img;
+  if (len < sizeof(Elf64_Ehdr) || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+      eh->e_ident[EI_CLASS] != ELFCLASS64 || eh->e_shoff == 0 ||
+      eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr) > len) {
+    free(img);
+    return NULL;
+  }
+  Elf64_Shdr* sh = (Elf64_Shdr*)(img + eh->e_shoff);
+  Elf64_Shdr* symtab = NULL;
+  for (size_t i = 0; i < eh->e_shnum; i++) {
+    if (sh[i].sh_type == SHT_SYMTAB) {
+      symtab = &sh[i];
+      break;
+    }
+  }
+  if (!symtab || symtab->sh_link >= eh->e_shnum || symtab->sh_offset + symtab->sh_size > len) {
+    free(img);
+    return NULL;
+  }
+  Elf64_Shdr* strtab = &sh[symtab->sh_link];
+  if (strtab->sh_offset + strtab->sh_size > len) {
+    free(img);
+    return NULL;
+  }
+  Elf64_Sym* syms = (Elf64_Sym*)(img + symtab->sh_offset);
+  size_t nsyms = symtab->sh_size / sizeof(Elf64_Sym);
+  const char* names = img + strtab->sh_offset;
+
+  KxProfSym* out = (KxProfSym*)malloc(nsyms * sizeof(KxProfSym) + 1);
+  if (!out) {
+    free(img);
+    return NULL;
+  }
+  size_t n = 0;
+  uint64_t anchor = 0;
+  for (size_t i = 0; i < nsyms; i++) {
+    // Sizeless entries (`_init`, `_fini`) would swallow every address above them, libc included.
+    if (ELF64_ST_TYPE(syms[i].st_info) != STT_FUNC || syms[i].st_value == 0 ||
+        syms[i].st_size == 0 || syms[i].st_name >= strtab->sh_size) {
+      continue;
+    }
+    const char* name = names + syms[i].st_name;
+    if (strcmp(name, "kx_runtime_init") == 0) {
+      anchor = syms[i].st_value;
+    }
+    out[n].addr = syms[i].st_value;
+    out[n].size = syms[i].st_size;
+    out[n].name = name;
+    n++;
+  }
+  uint64_t bias = anchor ? (uint64_t)(uintptr_t)&kx_runtime_init - anchor : 0;
+  for (size_t i = 0; i < n; i++) {
+    out[i].addr += bias;
+  }
+  qsort(out, n, sizeof(KxProfSym), kx_prof_sym_cmp);
+  *count_out = n;
+  return out;
+}
+
+// Index of the function containing `pc`, or `count` when it is outside every symbol (shared
+// libraries, stripped code).
+static size_t kx_prof_lookup(const KxProfSym* syms, size_t count, uint64_t pc) {
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (syms[mid].addr <= pc) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0) {
+    return count;
+  }
+  const KxProfSym* s = &syms[lo - 1];
+  if (pc >= s->addr + s->size) {
+    return count;
+  }
+  return lo - 1;
+}
+
+static uint64_t kx_prof_rec_hash(const uint64_t* rec) {
+  uint64_t n = rec[0] & ~KX_PROF_TRUNCATED;
+  uint64_t h = 1469598103934665603ULL ^ rec[0];
+  for (uint64_t i = 0; i < n; i++) {
+    h = (h ^ rec[1 + i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+static int kx_prof_rec_eq(const uint64_t* a, const uint64_t* b) {
+  uint64_t n = a[0] & ~KX_PROF_TRUNCATED;
+  return a[0] == b[0] && memcmp(a + 1, b + 1, (size_t)n * sizeof(uint64_t)) == 0;
+}
+
+static void kx_prof_finish(void) {
+  if (!kx_prof_buf || getpid() != kx_prof_owner) {
+    return;
+  }
+  struct itimerval off;
+  memset(&off, 0, sizeof(off));
+  (void)setitimer(ITIMER_PROF, &off, NULL);
+  signal(SIGPROF, SIG_IGN);
+
+  size_t nsyms = 0;
+  KxProfSym* syms = kx_prof_load_syms(&nsyms);
+  if (!syms) {
+    fprintf(stderr, "kooix profile: no symbol table in /proc/self/exe; frames are [unknown]\n");
+  }
+
+  // Map pcs to symbol indices in place (return addresses minus one, so a call at the very end of
+  // a function is not charged to the next one), then fold identical stacks through an open
+  // addressing table of record offsets.
+  size_t slots = 16;
+  while (slots < kx_prof_samples * 2) {
+    slots *= 2;
+  }
+  size_t* table = (size_t*)malloc(slots * sizeof(size_t));
+  uint64_t* counts = (uint64_t*)calloc(slots, sizeof(uint64_t));
+  if (!table || !counts) {
+    fprintf(stderr, "kooix profile: out of memory\n");
+    return;
+  }
+  for (size_t off_i = 0; off_i < kx_prof_len;) {
+    uint64_t* rec = kx_prof_buf + off_i;
+    uint64_t n = rec[0] & ~KX_PROF_TRUNCATED;
+    for (uint64_t i = 0; i < n; i++) {
+      uint64_t pc = i == 0 ? rec[1] : rec[1 + i] - 1;
+      rec[1 + i] = syms ? kx_prof_lookup(syms, nsyms, pc) : 0;
+    }
+    size_t slot = (size_t)kx_prof_rec_hash(rec) & (slots - 1);
+    while (counts[slot] != 0 && !kx_prof_rec_eq(kx_prof_buf + table[slot], rec)) {
+      slot = (slot + 1) & (slots - 1);
+    }
+    if (counts[slot] == 0) {
+      table[slot] = off_i;
+    }
+    counts[slot]++;
+    off_i += 1 + (size_t)n;
+  }
+
+  FILE* out = fopen(kx_prof_path, "w");
+  if (!out) {
+    fprintf(stderr, "kooix profile: cannot write %s\n", kx_prof_path);
+    return;
+  }
+  for (size_t slot = 0; slot < slots; slot++) {
+    if (counts[slot] == 0) {
+      continue;
+    }
+    const uint64_t* rec = kx_prof_buf + table[slot];
+    uint64_t n = rec[0] & ~KX_PROF_TRUNCATED;
+    // libc frames above `main` (`__libc_start_main`) are unnamed; leave them off the root.
+    while (n > 1 && !(rec[0] & KX_PROF_TRUNCATED) && (!syms || rec[n] >= nsyms)) {
+      n--;
+    }
+    if (rec[0] & KX_PROF_TRUNCATED) {
+      fputs("[truncated];", out);
+    }
+    for (uint64_t i = n; i > 0; i--) {
+      uint64_t sym = rec[i];
+      fputs(syms && sym < nsyms ? syms[sym].name : "[unknown]", out);
+      fputc(i == 1 ? ' ' : ';', out);
+    }
+    fprintf(out, "%llu\n", (unsigned long long)counts[slot]);
+  }
+  fclose(out);
+  if (kx_prof_dropped != 0) {
+    fprintf(stderr, "kooix profile: buffer full, dropped %llu samples\n",
+            (unsigned long long)kx_prof_dropped);
+  }
+}
+#endif
+
+static void kx_prof_init(void) {
+  const char* path = getenv("KX_PROFILE");
+  if (!path || !*path) {
+    return;
+  }
+#if defined(KX_PROF_SUPPORTED)
+  const char* hz = getenv("KX_PROFILE_HZ");
+  if (hz && atol(hz) > 0 && atol(hz) <= 100000) {
+    kx_prof_hz = atol(hz);
+  }
+  kx_prof_path = kx_strdup(path);
+  // 4M words = 32 MiB of address space; untouched pages never become resident.
+  kx_prof_cap = (size_t)1 << 22;
+  kx_prof_buf = (uint64_t*)malloc(kx_prof_cap * sizeof(uint64_t));
+  kx_prof_stack_hi = kx_prof_find_stack_hi();
+  if (!kx_prof_path || !kx_prof_buf || kx_prof_stack_hi == 0) {
+    fprintf(stderr, "kooix profile: setup failed; profiling disabled\n");
+    kx_prof_buf = NULL;
+    return;
+  }
+  // Spawned tools (llc, clang, child Kooix binaries) must not overwrite this process's profile.
+  (void)unsetenv("KX_PROFILE");
+  kx_prof_owner = getpid();
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = kx_prof_handler;
+  sa.sa_flags = SA_RESTART | SA_SIGINFO;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGPROF, &sa, NULL) != 0 || kx_prof_arm() != 0) {
+    fprintf(stderr, "kooix profile: could not arm SIGPROF; profiling disabled\n");
+    kx_prof_buf = NULL;
+    return;
+  }
+  atexit(kx_prof_finish);
+#else
+  (void)path;
+  fprintf(stderr, "kooix profile: KX_PROFILE is only supported on Linux x86_64/aarch64\n");
+#endif
+}
+
+// `host_fork` children start with fresh samples (interval timers are not inherited) and write
+// `<path>.<pid>`, so a forking driver yields one profile per job.
+static void kx_prof_after_fork_child(void) {
+#if defined(KX_PROF_SUPPORTED)
+  if (!kx_prof_buf) {
+    return;
+  }
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%ld", (long)getpid());
+  char* child_path = kx_strcat2(kx_prof_path, suffix);
+  if (!child_path || kx_prof_arm() != 0) {
+    kx_prof_buf = NULL;
+    return;
+  }
+  kx_prof_path = child_path;
+  kx_prof_owner = getpid();
+  kx_prof_len = 0;
+  kx_prof_samples = 0;
+  kx_prof_dropped = 0;
+#endif
+}
+
 // The Kooix program entry point emitted by the compiler. It corresponds to `fn main() -> Int`,
 // but we keep the host-visible `main(argc, argv)` in C so we can expose argv to intrinsics.
 extern int64_t kx_program_main(void);
 
 int main(int argc, char** argv) {
   kx_runtime_init();
+  kx_prof_init();
   kx_argc = argc;
   kx_argv = argv;
   int64_t code = kx_program_main();
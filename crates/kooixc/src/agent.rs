@@ -0,0 +1,358 @@
+use std::collections::HashMap;
+
+use crate::error::Diagnostic;
+use crate::hir::{HirAgent, HirProgram};
+use crate::sema::extract_state_equality_target;
+
+/// Dense state id assigned in declaration order.
+pub type StateId = u32;
+
+/// Dense tool id shared by every agent of a program.
+pub type ToolId = u32;
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct AgentProgram {
+    pub tools: ToolTable,
+    pub agents: Vec<AgentMachine>,
+}
+
+/// Interner for tool names referenced by agent policies.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct ToolTable {
+    names: Vec<String>,
+    ids: HashMap<String, ToolId>,
+}
+
+impl ToolTable {
+    pub fn intern(&mut self, name: &str) -> ToolId {
+        if let Some(id) = self.ids.get(name) {
+            return *id;
+        }
+        let id = self.names.len() as ToolId;
+        self.names.push(name.to_string());
+        self.ids.insert(name.to_string(), id);
+        id
+    }
+
+    pub fn id(&self, name: &str) -> Option<ToolId> {
+        self.ids.get(name).copied()
+    }
+
+    pub fn name(&self, id: ToolId) -> &str {
+        &self.names[id as usize]
+    }
+
+    pub fn len(&self) -> usize {
+        self.names.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.names.is_empty()
+    }
+}
+
+/// Resolved tool policy: one bit per interned tool, set when the call is permitted.
+///
+/// Deny precedence is applied while compiling (`allow \ deny`), so enforcement is a single bit
+/// test. Tools outside `allow_tools` (including ids beyond the bitset) are denied.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct ToolPolicy {
+    allowed: Vec<u64>,
+}
+
+impl ToolPolicy {
+    pub fn compile(allow_tools: &[String], deny_tools: &[String], tools: &mut ToolTable) -> Self {
+        let allow: Vec<ToolId> = allow_tools.iter().map(|tool| tools.intern(tool)).collect();
+        let deny: Vec<ToolId> = deny_tools.iter().map(|tool| tools.intern(tool)).collect();
+
+        let words = allow
+            .iter()
+            .map(|id| *id as usize / 64 + 1)
+            .max()
+            .unwrap_or(0);
+        let mut allowed = vec![0u64; words];
+        for id in allow {
+            allowed[id as usize / 64] |= 1u64 << (id % 64);
+        }
+        for id in deny {
+            if let Some(word) = allowed.get_mut(id as usize / 64) {
+                *word &= !(1u64 << (id % 64));
+            }
+        }
+
+        Self { allowed }
+    }
+
+    pub fn permits(&self, tool: ToolId) -> bool {
+        match self.allowed.get(tool as usize / 64) {
+            Some(word) => word & (1u64 << (tool % 64)) != 0,
+            None => false,
+        }
+    }
+}
+
+/// Executable form of an `agent` declaration.
+///
+/// State names are interned to dense ids; transitions are stored as a row-major bitset so that
+/// `can_transition` is a single word load + bit test. `any -> X` rules are expanded into every
+/// row at compile time, mirroring sema's reachability model.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct AgentMachine {
+    pub name: String,
+    pub states: Vec<String>,
+    pub initial: StateId,
+    pub stop_state: Option<StateId>,
+    pub max_iterations: Option<u64>,
+    pub policy: ToolPolicy,
+    words_per_row: usize,
+    transitions: Vec<u64>,
+    terminal: Vec<bool>,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AgentOutcome {
+    /// The loop reached the `stop when state == X` target.
+    Stopped,
+    /// The loop reached a state without outgoing transitions.
+    Terminal,
+    /// The step callback requested a halt (non-state stop condition evaluated by the host).
+    Halted,
+    /// `max_iterations` was exhausted before any stop condition held.
+    IterationLimit,
+    /// The step callback requested a transition not declared in the `state` block.
+    InvalidTransition { from: StateId, to: StateId },
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct AgentRun {
+    pub outcome: AgentOutcome,
+    pub final_state: StateId,
+    pub iterations: u64,
+}
+
+impl AgentMachine {
+    pub fn state_count(&self) -> usize {
+        self.states.len()
+    }
+
+    pub fn state_id(&self, name: &str) -> Option<StateId> {
+        self.states
+            .iter()
+            .position(|state| state == name)
+            .map(|index| index as StateId)
+    }
+
+    pub fn state_name(&self, id: StateId) -> &str {
+        &self.states[id as usize]
+    }
+
+    pub fn can_transition(&self, from: StateId, to: StateId) -> bool {
+        let to = to as usize;
+        if to >= self.states.len() {
+            return false;
+        }
+        let word = self.transitions[from as usize * self.words_per_row + to / 64];
+        word & (1u64 << (to % 64)) != 0
+    }
+
+    pub fn permits_tool(&self, tool: ToolId) -> bool {
+        self.policy.permits(tool)
+    }
+
+    pub fn is_terminal(&self, state: StateId) -> bool {
+        self.terminal[state as usize]
+    }
+
+    pub fn successors(&self, from: StateId) -> impl Iterator<Item = StateId> + '_ {
+        let row_start = from as usize * self.words_per_row;
+        let row = &self.transitions[row_start..row_start + self.words_per_row];
+        row.iter().enumerate().flat_map(|(word_index, word)| {
+            let mut bits = *word;
+            std::iter::from_fn(move || {
+                if bits == 0 {
+                    return None;
+                }
+                let bit = bits.trailing_zeros();
+                bits &= bits - 1;
+                Some((word_index * 64) as StateId + bit)
+            })
+        })
+    }
+
+    /// Drive the agent loop from the initial state.
+    ///
+    /// `step` receives the current state and the zero-based iteration index and returns the next
+    /// state, or `None` to halt. Every requested transition is checked against the compiled table;
+    /// the loop ends at the stop state, a terminal state, or after `max_iterations` steps.
+    pub fn run<F>(&self, mut step: F) -> AgentRun
+    where
+        F: FnMut(StateId, u64) -> Option<StateId>,
+    {
+        let limit = self.max_iterations.unwrap_or(u64::MAX);
+        let mut state = self.initial;
+        let mut iterations = 0u64;
+
+        loop {
+            if self.stop_state == Some(state) {
+                return self.finish(AgentOutcome::Stopped, state, iterations);
+            }
+            if self.terminal[state as usize] {
+                return self.finish(AgentOutcome::Terminal, state, iterations);
+            }
+            if iterations >= limit {
+                return self.finish(AgentOutcome::IterationLimit, state, iterations);
+            }
+
+            let Some(next) = step(state, iterations) else {
+                return self.finish(AgentOutcome::Halted, state, iterations);
+            };
+            iterations += 1;
+
+            if !self.can_transition(state, next) {
+                return self.finish(
+                    AgentOutcome::InvalidTransition {
+                        from: state,
+                        to: next,
+                    },
+                    state,
+                    iterations,
+                );
+            }
+            state = next;
+        }
+    }
+
+    fn finish(&self, outcome: AgentOutcome, final_state: StateId, iterations: u64) -> AgentRun {
+        AgentRun {
+            outcome,
+            final_state,
+            iterations,
+        }
+    }
+}
+
+pub fn compile_agents(program: &HirProgram) -> Result<AgentProgram, Vec<Diagnostic>> {
+    let mut diagnostics = Vec::new();
+    let mut tools = ToolTable::default();
+    let mut agents = Vec::new();
+
+    for agent in &program.agents {
+        match compile_agent(agent, &mut tools) {
+            Ok(machine) => agents.push(machine),
+            Err(error) => diagnostics.push(error),
+        }
+    }
+
+    if diagnostics.is_empty() {
+        Ok(AgentProgram { tools, agents })
+    } else {
+        Err(diagnostics)
+    }
+}
+
+pub fn compile_agent(agent: &HirAgent, tools: &mut ToolTable) -> Result<AgentMachine, Diagnostic> {
+    let mut states: Vec<String> = Vec::new();
+    let mut ids: HashMap<String, StateId> = HashMap::new();
+    let mut intern = |name: &str, states: &mut Vec<String>| -> StateId {
+        if let Some(id) = ids.get(name) {
+            return *id;
+        }
+        let id = states.len() as StateId;
+        states.push(name.to_string());
+        ids.insert(name.to_string(), id);
+        id
+    };
+
+    let mut edges: Vec<(StateId, StateId)> = Vec::new();
+    let mut any_targets: Vec<StateId> = Vec::new();
+    for rule in &agent.state_rules {
+        let from = if rule.from == "any" {
+            None
+        } else {
+            Some(intern(&rule.from, &mut states))
+        };
+        for target in &rule.to {
+            let to = intern(target, &mut states);
+            match from {
+                Some(from) => edges.push((from, to)),
+                None => any_targets.push(to),
+            }
+        }
+    }
+
+    if states.is_empty() {
+        return Err(Diagnostic::error(
+            format!("agent '{}' has no states to compile", agent.name),
+            agent.span,
+        ));
+    }
+
+    let initial = if let Some(id) = states.iter().position(|state| state == "INIT") {
+        id as StateId
+    } else if let Some(rule) = agent.state_rules.iter().find(|rule| rule.from != "any") {
+        intern(&rule.from, &mut states)
+    } else {
+        return Err(Diagnostic::error(
+            format!("agent '{}' has no concrete initial state", agent.name),
+            agent.span,
+        ));
+    };
+
+    // Unknown stop targets are already reported by sema as warnings; such a loop can only end at
+    // a terminal state or via the iteration guard.
+    let stop_state = extract_state_equality_target(&agent.loop_spec.stop_when)
+        .and_then(|name| states.iter().position(|state| *state == name))
+        .map(|id| id as StateId);
+
+    let max_iterations = match &agent.policy.max_iterations {
+        Some(raw) => match raw.parse::<u64>() {
+            Ok(value) if value > 0 => Some(value),
+            _ => {
+                return Err(Diagnostic::error(
+                    format!(
+                        "agent '{}' has invalid max_iterations '{}'",
+                        agent.name, raw
+                    ),
+                    agent.span,
+                ))
+            }
+        },
+        None => None,
+    };
+
+    let state_count = states.len();
+    let words_per_row = state_count.div_ceil(64);
+    let mut transitions = vec![0u64; state_count * words_per_row];
+    let mut set = |from: StateId, to: StateId| {
+        let to = to as usize;
+        transitions[from as usize * words_per_row + to / 64] |= 1u64 << (to % 64);
+    };
+    for (from, to) in edges {
+        set(from, to);
+    }
+    for from in 0..state_count as StateId {
+        for to in &any_targets {
+            set(from, *to);
+        }
+    }
+
+    let terminal = (0..state_count)
+        .map(|state| {
+            transitions[state * words_per_row..(state + 1) * words_per_row]
+                .iter()
+                .all(|word| *word == 0)
+        })
+        .collect();
+
+    Ok(AgentMachine {
+        name: agent.name.clone(),
+        states,
+        initial,
+        stop_state,
+        max_iterations,
+        policy: ToolPolicy::compile(&agent.policy.allow_tools, &agent.policy.deny_tools, tools),
+        words_per_row,
+        transitions,
+        terminal,
+    })
+}
@@ -261,6 +261,7 @@ pub struct WorkflowDecl {
     pub params: Vec<Param>,
     pub return_type: TypeRef,
     pub intent: Option<String>,
+    pub priority: Option<PriorityClass>,
     pub requires: Vec<TypeRef>,
     pub steps: Vec<WorkflowStep>,
     pub output: Vec<OutputField>,
@@ -268,14 +269,49 @@ pub struct WorkflowDecl {
     pub span: Span,
 }
 
+/// `priority <class>` on a workflow: how the runtime scheduler orders its instances against
+/// others competing for the same capability budgets. Ordered from most to least urgent.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub enum PriorityClass {
+    Interactive,
+    #[default]
+    Standard,
+    Batch,
+}
+
+impl PriorityClass {
+    pub const ALL: [PriorityClass; 3] = [Self::Interactive, Self::Standard, Self::Batch];
+
+    pub fn parse(name: &str) -> Option<Self> {
+        Self::ALL.into_iter().find(|class| class.as_str() == name)
+    }
+
+    pub fn as_str(self) -> &'static str {
+        match self {
+            Self::Interactive => "interactive",
+            Self::Standard => "standard",
+            Self::Batch => "batch",
+        }
+    }
+}
+
 #[derive(Debug, Clone, PartialEq, Eq)]
 pub struct WorkflowStep {
     pub id: String,
     pub call: WorkflowCall,
+    pub stream: Option<StreamSpec>,
     pub ensures: Vec<EnsureClause>,
     pub on_fail: Option<FailureAction>,
 }
 
+/// `stream` / `stream(buffer=N)` after a step call: its `Text` output reaches consumers in chunks
+/// while the step is still running.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct StreamSpec {
+    /// Chunks a consumer may fall behind before the producer blocks (runtime default if unset).
+    pub buffer: Option<u64>,
+}
+
 #[derive(Debug, Clone, PartialEq, Eq)]
 pub struct WorkflowCall {
     pub target: String,
@@ -0,0 +1,552 @@
+//! Batched file reads for walking an import graph.
+//!
+//! `read_streaming` reads an initial set of files and hands each one to a callback as soon as it
+//! arrives; the callback returns newly discovered files, which join the reads already in flight.
+//! On Linux the reads go through one io_uring (`openat` + `statx` per file, then `read`s), so a
+//! whole frontier is a single submission and a cold page cache is hit in parallel. Elsewhere, or
+//! when io_uring is unavailable (old kernel, seccomp), a scoped thread pool reads each frontier.
+
+use std::collections::VecDeque;
+use std::fs;
+use std::io;
+use std::path::{Path, PathBuf};
+use std::sync::mpsc;
+use std::thread;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ReadBackend {
+    /// io_uring where the kernel allows it, otherwise `Threads`.
+    Auto,
+    IoUring,
+    Threads,
+}
+
+/// Reads `initial` and everything `on_read` asks for, returning the backend that did the work.
+/// Every requested path is delivered exactly once (callers dedupe what they request).
+pub fn read_streaming<F>(backend: ReadBackend, initial: Vec<PathBuf>, mut on_read: F) -> ReadBackend
+where
+    F: FnMut(&Path, io::Result<String>) -> Vec<PathBuf>,
+{
+    if matches!(backend, ReadBackend::Auto | ReadBackend::IoUring) {
+        #[cfg(target_os = "linux")]
+        if let Ok(ring) = uring::Ring::new(64) {
+            ring.read_streaming(initial, &mut on_read);
+            return ReadBackend::IoUring;
+        }
+    }
+    read_with_threads(initial, &mut on_read);
+    ReadBackend::Threads
+}
+
+fn read_with_threads<F>(initial: Vec<PathBuf>, on_read: &mut F)
+where
+    F: FnMut(&Path, io::Result<String>) -> Vec<PathBuf>,
+{
+    let workers = thread::available_parallelism()
+        .map(|count| count.get())
+        .unwrap_or(4)
+        .clamp(2, 16);
+    let mut frontier = initial;
+    while !frontier.is_empty() {
+        let mut next = Vec::new();
+        let chunk_len = frontier.len().div_ceil(workers);
+        thread::scope(|scope| {
+            let (sender, receiver) = mpsc::channel();
+            for chunk in frontier.chunks(chunk_len) {
+                let sender = sender.clone();
+                scope.spawn(move || {
+                    for path in chunk {
+                        let _ = sender.send((path, fs::read_to_string(path)));
+                    }
+                });
+            }
+            drop(sender);
+            for (path, result) in receiver {
+                next.extend(on_read(path, result));
+            }
+        });
+        frontier = next;
+    }
+}
+
+#[cfg(target_os = "linux")]
+mod uring {
+    use super::*;
+    use std::ffi::CString;
+    use std::os::raw::{c_int, c_long, c_uint, c_void};
+    use std::os::unix::ffi::OsStrExt;
+    use std::ptr;
+    use std::sync::atomic::{AtomicU32, Ordering};
+
+    use crate::util::mman::{mmap, munmap, MAP_FAILED, MAP_SHARED, PROT_READ, PROT_WRITE};
+
+    extern "C" {
+        fn syscall(number: c_long, ...) -> c_long;
+        fn close(fd: c_int) -> c_int;
+    }
+
+    // Generic syscall table numbers, shared by x86_64 and aarch64.
+    const SYS_IO_URING_SETUP: c_long = 425;
+    const SYS_IO_URING_ENTER: c_long = 426;
+    const IORING_ENTER_GETEVENTS: c_uint = 1;
+    const IORING_OFF_SQ_RING: i64 = 0;
+    const IORING_OFF_CQ_RING: i64 = 0x8000000;
+    const IORING_OFF_SQES: i64 = 0x10000000;
+    const IORING_OP_OPENAT: u8 = 18;
+    const IORING_OP_STATX: u8 = 21;
+    const IORING_OP_READ: u8 = 22;
+
+    const MAP_POPULATE: c_int = 0x8000;
+    const AT_FDCWD: i32 = -100;
+    const O_CLOEXEC: u32 = 0o2000000;
+    const STATX_SIZE: u32 = 0x200;
+    const EINTR: i32 = 4;
+
+    #[repr(C)]
+    #[derive(Default)]
+    struct SqRingOffsets {
+        head: u32,
+        tail: u32,
+        ring_mask: u32,
+        ring_entries: u32,
+        flags: u32,
+        dropped: u32,
+        array: u32,
+        resv1: u32,
+        user_addr: u64,
+    }
+
+    #[repr(C)]
+    #[derive(Default)]
+    struct CqRingOffsets {
+        head: u32,
+        tail: u32,
+        ring_mask: u32,
+        ring_entries: u32,
+        overflow: u32,
+        cqes: u32,
+        flags: u32,
+        resv1: u32,
+        user_addr: u64,
+    }
+
+    #[repr(C)]
+    #[derive(Default)]
+    struct Params {
+        sq_entries: u32,
+        cq_entries: u32,
+        flags: u32,
+        sq_thread_cpu: u32,
+        sq_thread_idle: u32,
+        features: u32,
+        wq_fd: u32,
+        resv: [u32; 3],
+        sq_off: SqRingOffsets,
+        cq_off: CqRingOffsets,
+    }
+
+    #[repr(C)]
+    #[derive(Clone, Copy, Default)]
+    struct Sqe {
+        opcode: u8,
+        flags: u8,
+        ioprio: u16,
+        fd: i32,
+        off: u64,
+        addr: u64,
+        len: u32,
+        op_flags: u32,
+        user_data: u64,
+        buf_index: u16,
+        personality: u16,
+        file_index: u32,
+        addr3: u64,
+        pad: u64,
+    }
+
+    #[repr(C)]
+    struct Cqe {
+        user_data: u64,
+        res: i32,
+        flags: u32,
+    }
+
+    struct Mapping {
+        ptr: *mut c_void,
+        len: usize,
+    }
+
+    impl Mapping {
+        fn new(fd: c_int, len: usize, offset: i64) -> io::Result<Self> {
+            let ptr = unsafe {
+                mmap(
+                    ptr::null_mut(),
+                    len,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE,
+                    fd,
+                    offset,
+                )
+            };
+            if ptr == MAP_FAILED {
+                return Err(io::Error::last_os_error());
+            }
+            Ok(Self { ptr, len })
+        }
+
+        fn at<T>(&self, offset: u32) -> *mut T {
+            unsafe { (self.ptr as *mut u8).add(offset as usize) as *mut T }
+        }
+    }
+
+    impl Drop for Mapping {
+        fn drop(&mut self) {
+            unsafe {
+                munmap(self.ptr, self.len);
+            }
+        }
+    }
+
+    pub(super) struct Ring {
+        fd: c_int,
+        sq: Mapping,
+        cq: Mapping,
+        sqes: Mapping,
+        params: Params,
+    }
+
+    impl Drop for Ring {
+        fn drop(&mut self) {
+            unsafe {
+                close(self.fd);
+            }
+        }
+    }
+
+    /// One file moving through open/statx -> read(s).
+    struct FileRead {
+        path: PathBuf,
+        c_path: CString,
+        statx: Box<[u8; 256]>,
+        fd: i32,
+        size: Option<u64>,
+        error: Option<io::Error>,
+        pending: u32,
+        delivered: bool,
+        buf: Vec<u8>,
+    }
+
+    // user_data = file index << 2 | op.
+    const OP_OPEN: u64 = 0;
+    const OP_STATX: u64 = 1;
+    const OP_READ: u64 = 2;
+
+    impl Ring {
+        pub(super) fn new(entries: u32) -> io::Result<Self> {
+            let mut params = Params::default();
+            let fd = unsafe {
+                syscall(
+                    SYS_IO_URING_SETUP,
+                    entries as c_uint,
+                    &mut params as *mut Params,
+                )
+            };
+            if fd < 0 {
+                return Err(io::Error::last_os_error());
+            }
+            let fd = fd as c_int;
+            let sq_len = params.sq_off.array as usize
+                + params.sq_entries as usize * std::mem::size_of::<u32>();
+            let cq_len = params.cq_off.cqes as usize
+                + params.cq_entries as usize * std::mem::size_of::<Cqe>();
+            let sqes_len = params.sq_entries as usize * std::mem::size_of::<Sqe>();
+            let maps = Mapping::new(fd, sq_len, IORING_OFF_SQ_RING).and_then(|sq| {
+                let cq = Mapping::new(fd, cq_len, IORING_OFF_CQ_RING)?;
+                let sqes = Mapping::new(fd, sqes_len, IORING_OFF_SQES)?;
+                Ok((sq, cq, sqes))
+            });
+            match maps {
+                Ok((sq, cq, sqes)) => Ok(Self {
+                    fd,
+                    sq,
+                    cq,
+                    sqes,
+                    params,
+                }),
+                Err(error) => {
+                    unsafe {
+                        close(fd);
+                    }
+                    Err(error)
+                }
+            }
+        }
+
+        pub(super) fn read_streaming<F>(&self, initial: Vec<PathBuf>, on_read: &mut F)
+        where
+            F: FnMut(&Path, io::Result<String>) -> Vec<PathBuf>,
+        {
+            let mut files: Vec<FileRead> = Vec::new();
+            let mut queue: VecDeque<Sqe> = VecDeque::new();
+            let mut in_flight = 0usize;
+            for path in initial {
+                Self::start(&mut files, &mut queue, path);
+            }
+
+            while !queue.is_empty() || in_flight > 0 {
+                // At most `sq_entries` operations in flight keeps the CQ ring (twice as large)
+                // from overflowing.
+                let budget = self.params.sq_entries as usize - in_flight;
+                let submitted = self.push_sqes(&mut queue, budget);
+                if self.enter(submitted as c_uint).is_err() {
+                    // The ring is unusable. A failed enter consumes none of the new entries, but
+                    // the earlier `in_flight` operations still target `files`' paths and buffers:
+                    // wait them out (or leak the buffers) before finishing synchronously.
+                    if !self.drain(in_flight) {
+                        Self::leak_undelivered(&mut files);
+                    }
+                    self.finish_synchronously(&mut files, on_read);
+                    return;
+                }
+                in_flight += submitted;
+                while let Some((user_data, res)) = self.pop_cqe() {
+                    in_flight -= 1;
+                    let index = (user_data >> 2) as usize;
+                    let done =
+                        self.complete(&mut files[index], user_data & 3, res, &mut queue, index);
+                    if done {
+                        let file = &mut files[index];
+                        if file.fd >= 0 {
+                            unsafe {
+                                close(file.fd);
+                            }
+                            file.fd = -1;
+                        }
+                        let result = match file.error.take() {
+                            Some(error) => Err(error),
+                            None => {
+                                String::from_utf8(std::mem::take(&mut file.buf)).map_err(|_| {
+                                    io::Error::new(
+                                        io::ErrorKind::InvalidData,
+                                        "stream did not contain valid UTF-8",
+                                    )
+                                })
+                            }
+                        };
+                        file.delivered = true;
+                        let path = file.path.clone();
+                        for next in on_read(&path, result) {
+                            Self::start(&mut files, &mut queue, next);
+                        }
+                    }
+                }
+            }
+        }
+
+        fn start(files: &mut Vec<FileRead>, queue: &mut VecDeque<Sqe>, path: PathBuf) {
+            let index = files.len() as u64;
+            let c_path = CString::new(path.as_os_str().as_bytes()).unwrap_or_default();
+            let mut file = FileRead {
+                path,
+                c_path,
+                statx: Box::new([0u8; 256]),
+                fd: -1,
+                size: None,
+                error: None,
+                pending: 2,
+                delivered: false,
+                buf: Vec::new(),
+            };
+            queue.push_back(Sqe {
+                opcode: IORING_OP_OPENAT,
+                fd: AT_FDCWD,
+                addr: file.c_path.as_ptr() as u64,
+                op_flags: O_CLOEXEC,
+                user_data: index << 2 | OP_OPEN,
+                ..Sqe::default()
+            });
+            queue.push_back(Sqe {
+                opcode: IORING_OP_STATX,
+                fd: AT_FDCWD,
+                addr: file.c_path.as_ptr() as u64,
+                len: STATX_SIZE,
+                off: file.statx.as_mut_ptr() as u64,
+                user_data: index << 2 | OP_STATX,
+                ..Sqe::default()
+            });
+            files.push(file);
+        }
+
+        /// Applies one completion; true once the file needs nothing more from the ring.
+        fn complete(
+            &self,
+            file: &mut FileRead,
+            op: u64,
+            res: i32,
+            queue: &mut VecDeque<Sqe>,
+            index: usize,
+        ) -> bool {
+            file.pending -= 1;
+            if res < 0 && file.error.is_none() {
+                file.error = Some(io::Error::from_raw_os_error(-res));
+            }
+            match op {
+                OP_OPEN if res >= 0 => file.fd = res,
+                OP_STATX if res >= 0 => {
+                    let size_bytes: [u8; 8] = file.statx[40..48].try_into().unwrap_or([0; 8]);
+                    file.size = Some(u64::from_ne_bytes(size_bytes));
+                }
+                OP_READ if res > 0 => {
+                    let len = file.buf.len() + res as usize;
+                    unsafe {
+                        file.buf.set_len(len);
+                    }
+                }
+                _ => {}
+            }
+            if file.pending > 0 || file.error.is_some() {
+                return file.pending == 0;
+            }
+
+            // Open and statx both landed (or a read came back): read the rest, if any. The statx
+            // size is trusted (sources do not change mid-load); a read returning 0 means the file
+            // ended early.
+            let size = file.size.unwrap_or(0) as usize;
+            if op == OP_READ && (res == 0 || file.buf.len() >= size) {
+                return true;
+            }
+            if file.buf.capacity() == 0 {
+                file.buf.reserve_exact(size.max(1));
+            } else if file.buf.len() == file.buf.capacity() {
+                file.buf.reserve(4096);
+            }
+            let remaining = file.buf.capacity() - file.buf.len();
+            file.pending += 1;
+            queue.push_back(Sqe {
+                opcode: IORING_OP_READ,
+                fd: file.fd,
+                addr: unsafe { file.buf.as_mut_ptr().add(file.buf.len()) } as u64,
+                len: remaining.min(u32::MAX as usize) as u32,
+                off: file.buf.len() as u64,
+                user_data: (index as u64) << 2 | OP_READ,
+                ..Sqe::default()
+            });
+            false
+        }
+
+        fn finish_synchronously<F>(&self, files: &mut [FileRead], on_read: &mut F)
+        where
+            F: FnMut(&Path, io::Result<String>) -> Vec<PathBuf>,
+        {
+            let mut pending: Vec<PathBuf> = files
+                .iter()
+                .filter(|file| !file.delivered)
+                .map(|file| file.path.clone())
+                .collect();
+            for file in files.iter_mut() {
+                if file.fd >= 0 {
+                    unsafe {
+                        close(file.fd);
+                    }
+                    file.fd = -1;
+                }
+            }
+            while let Some(path) = pending.pop() {
+                let result = fs::read_to_string(&path);
+                pending.extend(on_read(&path, result));
+            }
+        }
+
+        /// Reaps the completions of `in_flight` submitted operations, discarding their results
+        /// (the files are re-read synchronously). False if the ring fails before they all land.
+        fn drain(&self, mut in_flight: usize) -> bool {
+            while in_flight > 0 {
+                while in_flight > 0 && self.pop_cqe().is_some() {
+                    in_flight -= 1;
+                }
+                if in_flight > 0 && self.enter(0).is_err() {
+                    return false;
+                }
+            }
+            true
+        }
+
+        /// Last resort when in-flight operations cannot be reaped: the kernel may still write
+        /// into these buffers or read these paths, so they are never freed. Closing the ring fd
+        /// afterwards makes the kernel cancel what is left; unmapping the rings only drops this
+        /// process's view of kernel-owned memory.
+        fn leak_undelivered(files: &mut [FileRead]) {
+            for file in files.iter_mut().filter(|file| !file.delivered) {
+                std::mem::forget(std::mem::take(&mut file.buf));
+                std::mem::forget(std::mem::take(&mut file.c_path));
+                std::mem::forget(std::mem::replace(&mut file.statx, Box::new([0u8; 256])));
+            }
+        }
+
+        fn push_sqes(&self, queue: &mut VecDeque<Sqe>, budget: usize) -> usize {
+            let off = &self.params.sq_off;
+            let head = unsafe { &*self.sq.at::<AtomicU32>(off.head) };
+            let tail_ptr = unsafe { &*self.sq.at::<AtomicU32>(off.tail) };
+            let mask = unsafe { *self.sq.at::<u32>(off.ring_mask) };
+            let array = self.sq.at::<u32>(off.array);
+            let sqes = self.sqes.ptr as *mut Sqe;
+            let mut tail = tail_ptr.load(Ordering::Relaxed);
+            let mut pushed = 0usize;
+            while let Some(sqe) = queue.front() {
+                if pushed == budget
+                    || tail.wrapping_sub(head.load(Ordering::Acquire)) >= self.params.sq_entries
+                {
+                    break;
+                }
+                let slot = tail & mask;
+                unsafe {
+                    *sqes.add(slot as usize) = *sqe;
+                    *array.add(slot as usize) = slot;
+                }
+                queue.pop_front();
+                tail = tail.wrapping_add(1);
+                pushed += 1;
+            }
+            tail_ptr.store(tail, Ordering::Release);
+            pushed
+        }
+
+        fn enter(&self, to_submit: c_uint) -> io::Result<()> {
+            loop {
+                let rc = unsafe {
+                    syscall(
+                        SYS_IO_URING_ENTER,
+                        self.fd,
+                        to_submit,
+                        1 as c_uint,
+                        IORING_ENTER_GETEVENTS,
+                        ptr::null::<c_void>(),
+                        0usize,
+                    )
+                };
+                if rc >= 0 {
+                    return Ok(());
+                }
+                let error = io::Error::last_os_error();
+                if error.raw_os_error() != Some(EINTR) {
+                    return Err(error);
+                }
+            }
+        }
+
+        fn pop_cqe(&self) -> Option<(u64, i32)> {
+            let off = &self.params.cq_off;
+            let head_ptr = unsafe { &*self.cq.at::<AtomicU32>(off.head) };
+            let tail = unsafe { &*self.cq.at::<AtomicU32>(off.tail) };
+            let head = head_ptr.load(Ordering::Relaxed);
+            if head == tail.load(Ordering::Acquire) {
+                return None;
+            }
+            let mask = unsafe { *self.cq.at::<u32>(off.ring_mask) };
+            let cqe = unsafe { &*self.cq.at::<Cqe>(off.cqes).add((head & mask) as usize) };
+            let out = (cqe.user_data, cqe.res);
+            head_ptr.store(head.wrapping_add(1), Ordering::Release);
+            Some(out)
+        }
+    }
+}
@@ -0,0 +1,800 @@
+use std::collections::BTreeMap;
+use std::fmt;
+
+use crate::util::escape_json;
+
+/// Schema tag of a benchmark store: `{"schema":"kooix-bench-v1","metrics":{"<name>":[samples]}}`.
+///
+/// Metric names are `<source>.<subject>.<unit>`; the unit suffix decides the kind:
+/// `.seconds` is wall time, `_kb` is memory (peak RSS or heap growth).
+pub const BENCH_SCHEMA: &str = "kooix-bench-v1";
+
+/// Time deltas below this are noise regardless of the relative threshold.
+pub const MIN_TIME_DELTA_SECONDS: f64 = 0.01;
+/// Memory deltas below this are noise regardless of the relative threshold.
+pub const MIN_MEMORY_DELTA_KB: f64 = 1024.0;
+/// Smallest per-side sample count at which the U test can reach the default `alpha`: with three
+/// samples per side the exact two-sided p never drops below 0.1.
+pub const MIN_U_TEST_SAMPLES: usize = 4;
+
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct BenchSet {
+    pub metrics: BTreeMap<String, Vec<f64>>,
+}
+
+impl BenchSet {
+    pub fn push(&mut self, name: impl Into<String>, value: f64) {
+        self.metrics.entry(name.into()).or_default().push(value);
+    }
+
+    /// Appends every sample of `other` (a store accumulates one sample per recorded run).
+    pub fn merge(&mut self, other: &BenchSet) {
+        for (name, samples) in &other.metrics {
+            self.metrics
+                .entry(name.clone())
+                .or_default()
+                .extend(samples);
+        }
+    }
+
+    pub fn to_json(&self) -> String {
+        let metrics = self
+            .metrics
+            .iter()
+            .map(|(name, samples)| {
+                let samples = samples
+                    .iter()
+                    .map(|value| format_number(*value))
+                    .collect::<Vec<_>>()
+                    .join(",");
+                format!("\"{}\":[{}]", escape_json(name), samples)
+            })
+            .collect::<Vec<_>>()
+            .join(",");
+        format!("{{\"schema\":\"{BENCH_SCHEMA}\",\"metrics\":{{{metrics}}}}}")
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum MetricKind {
+    Time,
+    Memory,
+}
+
+impl MetricKind {
+    pub fn of(name: &str) -> Option<MetricKind> {
+        if name.ends_with(".seconds") {
+            Some(MetricKind::Time)
+        } else if name.ends_with("_kb") {
+            Some(MetricKind::Memory)
+        } else {
+            None
+        }
+    }
+
+    pub fn label(self) -> &'static str {
+        match self {
+            MetricKind::Time => "time",
+            MetricKind::Memory => "memory",
+        }
+    }
+}
+
+/// Reads one benchmark input. Accepted formats:
+/// - a `kooix-bench-v1` store;
+/// - a `kooixc bootstrap --json` report (built nodes -> `bootstrap.<id>.seconds|maxrss_kb`);
+/// - a bootstrap resource log (`<key>_seconds=`/`<key>_maxrss_kb=` -> `resource.<key>.*`);
+/// - Stage1 `--timings` stderr (`timings: <phase> <ms> ms heap +<MB> MB` ->
+///   `timings.<phase>.seconds|heap_kb`).
+pub fn parse_bench_input(text: &str) -> Result<BenchSet, String> {
+    let trimmed = text.trim_start();
+    if trimmed.starts_with('{') {
+        let value = Json::parse(trimmed)?;
+        if let Some(schema) = value.get("schema").and_then(Json::as_str) {
+            if schema != BENCH_SCHEMA {
+                return Err(format!("unsupported bench schema '{schema}'"));
+            }
+            return bench_set_from_store(&value);
+        }
+        if value.get("nodes").is_some() {
+            return bench_set_from_bootstrap(&value);
+        }
+        return Err("unrecognized bench JSON (expected a bench store or bootstrap report)".into());
+    }
+    if text.lines().any(|line| line.starts_with("timings: ")) {
+        return bench_set_from_timings(text);
+    }
+    bench_set_from_resource_log(text)
+}
+
+fn bench_set_from_store(value: &Json) -> Result<BenchSet, String> {
+    let Some(Json::Object(metrics)) = value.get("metrics") else {
+        return Err("bench store is missing 'metrics'".to_string());
+    };
+    let mut set = BenchSet::default();
+    for (name, samples) in metrics {
+        let Json::Array(samples) = samples else {
+            return Err(format!("metric '{name}' must be an array of numbers"));
+        };
+        for sample in samples {
+            let Json::Number(value) = sample else {
+                return Err(format!("metric '{name}' must be an array of numbers"));
+            };
+            set.push(name.clone(), *value);
+        }
+    }
+    Ok(set)
+}
+
+fn bench_set_from_bootstrap(value: &Json) -> Result<BenchSet, String> {
+    let Some(Json::Array(nodes)) = value.get("nodes") else {
+        return Err("bootstrap report 'nodes' must be an array".to_string());
+    };
+    let mut set = BenchSet::default();
+    for node in nodes {
+        // Cached nodes did no work in this run; their time would only dilute the samples.
+        if node.get("status").and_then(Json::as_str) != Some("built") {
+            continue;
+        }
+        let Some(id) = node.get("id").and_then(Json::as_str) else {
+            continue;
+        };
+        if let Some(seconds) = node.get("seconds").and_then(Json::as_number) {
+            set.push(format!("bootstrap.{id}.seconds"), seconds);
+        }
+        if let Some(kb) = node.get("maxrss_kb").and_then(Json::as_number) {
+            set.push(format!("bootstrap.{id}.maxrss_kb"), kb);
+        }
+    }
+    Ok(set)
+}
+
+fn bench_set_from_resource_log(text: &str) -> Result<BenchSet, String> {
+    let mut set = BenchSet::default();
+    for line in text.lines() {
+        let Some((key, value)) = line.split_once('=') else {
+            continue;
+        };
+        let Ok(value) = value.trim().parse::<f64>() else {
+            continue;
+        };
+        if let Some(step) = key.strip_suffix("_seconds") {
+            set.push(format!("resource.{step}.seconds"), value);
+        } else if let Some(step) = key.strip_suffix("_maxrss_kb") {
+            set.push(format!("resource.{step}.maxrss_kb"), value);
+        }
+    }
+    if set.metrics.is_empty() {
+        return Err("no bench metrics found in input".to_string());
+    }
+    Ok(set)
+}
+
+fn bench_set_from_timings(text: &str) -> Result<BenchSet, String> {
+    let mut set = BenchSet::default();
+    for line in text.lines() {
+        let Some(rest) = line.strip_prefix("timings: ") else {
+            continue;
+        };
+        let fields = rest.split_whitespace().collect::<Vec<_>>();
+        // <phase> <ms> ms heap <+MB> MB
+        let [phase, ms, "ms", "heap", heap, "MB"] = fields.as_slice() else {
+            return Err(format!("malformed timings line '{line}'"));
+        };
+        let ms = ms
+            .parse::<f64>()
+            .map_err(|_| format!("malformed timings line '{line}'"))?;
+        let heap = heap
+            .trim_start_matches('+')
+            .parse::<f64>()
+            .map_err(|_| format!("malformed timings line '{line}'"))?;
+        set.push(format!("timings.{phase}.seconds"), ms / 1000.0);
+        set.push(format!("timings.{phase}.heap_kb"), heap * 1024.0);
+    }
+    Ok(set)
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct CompareOptions {
+    /// Allowed median growth (percent) for `.seconds` metrics.
+    pub time_threshold_pct: f64,
+    /// Allowed median growth (percent) for `_kb` metrics.
+    pub memory_threshold_pct: f64,
+    /// Per-metric overrides `(pattern, pct)`; `*` matches any run of characters, last match wins.
+    pub thresholds: Vec<(String, f64)>,
+    /// Significance level of the Mann-Whitney U test.
+    pub alpha: f64,
+}
+
+impl Default for CompareOptions {
+    fn default() -> Self {
+        Self {
+            time_threshold_pct: 5.0,
+            memory_threshold_pct: 3.0,
+            thresholds: Vec::new(),
+            alpha: 0.05,
+        }
+    }
+}
+
+impl CompareOptions {
+    pub fn threshold_for(&self, name: &str, kind: MetricKind) -> f64 {
+        self.thresholds
+            .iter()
+            .rev()
+            .find(|(pattern, _)| glob_match(pattern, name))
+            .map(|(_, pct)| *pct)
+            .unwrap_or(match kind {
+                MetricKind::Time => self.time_threshold_pct,
+                MetricKind::Memory => self.memory_threshold_pct,
+            })
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Verdict {
+    Regressed,
+    Improved,
+    Unchanged,
+    /// Only in the current run.
+    Added,
+    /// Only in the baseline.
+    Removed,
+}
+
+impl Verdict {
+    pub fn label(self) -> &'static str {
+        match self {
+            Verdict::Regressed => "regressed",
+            Verdict::Improved => "improved",
+            Verdict::Unchanged => "unchanged",
+            Verdict::Added => "added",
+            Verdict::Removed => "removed",
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct MetricComparison {
+    pub name: String,
+    pub kind: MetricKind,
+    pub baseline_median: Option<f64>,
+    pub current_median: Option<f64>,
+    pub baseline_samples: usize,
+    pub current_samples: usize,
+    pub delta_pct: Option<f64>,
+    pub threshold_pct: f64,
+    /// Two-sided Mann-Whitney p-value; `None` when either side has fewer than
+    /// [`MIN_U_TEST_SAMPLES`] samples, in which case the verdict rests on the threshold alone.
+    pub p_value: Option<f64>,
+    pub verdict: Verdict,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct CompareReport {
+    pub alpha: f64,
+    pub metrics: Vec<MetricComparison>,
+}
+
+impl CompareReport {
+    pub fn regressions(&self) -> impl Iterator<Item = &MetricComparison> {
+        self.metrics
+            .iter()
+            .filter(|metric| metric.verdict == Verdict::Regressed)
+    }
+
+    pub fn to_json(&self) -> String {
+        let metrics = self
+            .metrics
+            .iter()
+            .map(|metric| {
+                format!(
+                    "{{\"name\":\"{}\",\"kind\":\"{}\",\"verdict\":\"{}\",\"baseline_median\":{},\"current_median\":{},\"baseline_samples\":{},\"current_samples\":{},\"delta_pct\":{},\"threshold_pct\":{},\"p_value\":{},\"test\":\"{}\"}}",
+                    escape_json(&metric.name),
+                    metric.kind.label(),
+                    metric.verdict.label(),
+                    json_number(metric.baseline_median),
+                    json_number(metric.current_median),
+                    metric.baseline_samples,
+                    metric.current_samples,
+                    json_number(metric.delta_pct),
+                    format_number(metric.threshold_pct),
+                    json_number(metric.p_value),
+                    if metric.p_value.is_some() {
+                        "mann-whitney"
+                    } else {
+                        "threshold-only"
+                    },
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(",");
+        let regressed = self
+            .regressions()
+            .map(|metric| format!("\"{}\"", escape_json(&metric.name)))
+            .collect::<Vec<_>>()
+            .join(",");
+        format!(
+            "{{\"ok\":{},\"alpha\":{},\"regressed\":[{}],\"metrics\":[{}]}}",
+            self.regressions().next().is_none(),
+            format_number(self.alpha),
+            regressed,
+            metrics
+        )
+    }
+}
+
+impl fmt::Display for CompareReport {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        for metric in &self.metrics {
+            write!(f, "{:<10} {}", metric.verdict.label(), metric.name)?;
+            match (metric.baseline_median, metric.current_median) {
+                (Some(base), Some(current)) => {
+                    write!(
+                        f,
+                        " median {} -> {} ({:+.1}%, threshold {}%",
+                        format_number(base),
+                        format_number(current),
+                        metric.delta_pct.unwrap_or(0.0),
+                        format_number(metric.threshold_pct)
+                    )?;
+                    match metric.p_value {
+                        Some(p) => write!(f, ", p={p:.3})")?,
+                        None => write!(f, ", n<{MIN_U_TEST_SAMPLES}, threshold only)")?,
+                    }
+                }
+                (Some(base), None) => write!(f, " baseline {}", format_number(base))?,
+                (None, Some(current)) => write!(f, " current {}", format_number(current))?,
+                (None, None) => {}
+            }
+            writeln!(f)?;
+        }
+        let regressed = self
+            .regressions()
+            .map(|metric| metric.name.as_str())
+            .collect::<Vec<_>>();
+        if regressed.is_empty() {
+            writeln!(f, "ok: no regressions")
+        } else {
+            writeln!(f, "fail: regressed: {}", regressed.join(", "))
+        }
+    }
+}
+
+/// Compares every metric known to either side. A metric regresses when its median grew by more
+/// than its threshold and by more than the absolute noise floor, and — when both sides have at
+/// least [`MIN_U_TEST_SAMPLES`] samples — the Mann-Whitney U test rejects equal distributions at
+/// `alpha`. Smaller samples cannot reach significance, so they fall back to the threshold alone.
+pub fn compare(baseline: &BenchSet, current: &BenchSet, options: &CompareOptions) -> CompareReport {
+    let mut names = baseline.metrics.keys().cloned().collect::<Vec<_>>();
+    for name in current.metrics.keys() {
+        if !baseline.metrics.contains_key(name) {
+            names.push(name.clone());
+        }
+    }
+    names.sort();
+
+    let mut metrics = Vec::new();
+    for name in names {
+        let Some(kind) = MetricKind::of(&name) else {
+            continue;
+        };
+        let base = baseline.metrics.get(&name).filter(|s| !s.is_empty());
+        let cur = current.metrics.get(&name).filter(|s| !s.is_empty());
+        let threshold_pct = options.threshold_for(&name, kind);
+        let baseline_median = base.map(|samples| median(samples));
+        let current_median = cur.map(|samples| median(samples));
+        let (delta_pct, p_value, verdict) = match (base, cur) {
+            (Some(base), Some(cur)) => {
+                let (b, c) = (median(base), median(cur));
+                let delta = c - b;
+                let delta_pct = if b == 0.0 {
+                    if delta == 0.0 {
+                        0.0
+                    } else {
+                        f64::INFINITY.copysign(delta)
+                    }
+                } else {
+                    delta / b * 100.0
+                };
+                let floor = match kind {
+                    MetricKind::Time => MIN_TIME_DELTA_SECONDS,
+                    MetricKind::Memory => MIN_MEMORY_DELTA_KB,
+                };
+                let p_value = if base.len().min(cur.len()) >= MIN_U_TEST_SAMPLES {
+                    mann_whitney_p(base, cur)
+                } else {
+                    None
+                };
+                let significant = p_value.is_none_or(|p| p < options.alpha);
+                let verdict =
+                    if delta_pct.abs() > threshold_pct && delta.abs() >= floor && significant {
+                        if delta > 0.0 {
+                            Verdict::Regressed
+                        } else {
+                            Verdict::Improved
+                        }
+                    } else {
+                        Verdict::Unchanged
+                    };
+                (Some(delta_pct), p_value, verdict)
+            }
+            (Some(_), None) => (None, None, Verdict::Removed),
+            (None, Some(_)) => (None, None, Verdict::Added),
+            (None, None) => continue,
+        };
+        metrics.push(MetricComparison {
+            baseline_samples: base.map_or(0, Vec::len),
+            current_samples: cur.map_or(0, Vec::len),
+            name,
+            kind,
+            baseline_median,
+            current_median,
+            delta_pct,
+            threshold_pct,
+            p_value,
+            verdict,
+        });
+    }
+
+    CompareReport {
+        alpha: options.alpha,
+        metrics,
+    }
+}
+
+pub fn median(samples: &[f64]) -> f64 {
+    let mut sorted = samples.to_vec();
+    sorted.sort_by(f64::total_cmp);
+    let mid = sorted.len() / 2;
+    if sorted.len().is_multiple_of(2) {
+        (sorted[mid - 1] + sorted[mid]) / 2.0
+    } else {
+        sorted[mid]
+    }
+}
+
+/// Two-sided Mann-Whitney U p-value. Exact (enumerated U distribution) for small tie-free
+/// samples, otherwise the normal approximation with tie and continuity correction. `None` when a
+/// side has fewer than two samples.
+pub fn mann_whitney_p(a: &[f64], b: &[f64]) -> Option<f64> {
+    let (n1, n2) = (a.len(), b.len());
+    if n1 < 2 || n2 < 2 {
+        return None;
+    }
+
+    // Midranks over the pooled samples.
+    let mut pooled = a
+        .iter()
+        .map(|value| (*value, 0usize))
+        .chain(b.iter().map(|value| (*value, 1usize)))
+        .collect::<Vec<_>>();
+    pooled.sort_by(|x, y| x.0.total_cmp(&y.0));
+    let n = pooled.len();
+    let mut rank_sum_a = 0.0;
+    let mut tie_term = 0.0;
+    let mut has_ties = false;
+    let mut i = 0;
+    while i < n {
+        let mut j = i + 1;
+        while j < n && pooled[j].0 == pooled[i].0 {
+            j += 1;
+        }
+        let rank = (i + j + 1) as f64 / 2.0;
+        let t = (j - i) as f64;
+        if j - i > 1 {
+            has_ties = true;
+            tie_term += t * t * t - t;
+        }
+        for item in &pooled[i..j] {
+            if item.1 == 0 {
+                rank_sum_a += rank;
+            }
+        }
+        i = j;
+    }
+    let u1 = rank_sum_a - (n1 * (n1 + 1)) as f64 / 2.0;
+    let (n1f, n2f) = (n1 as f64, n2 as f64);
+    let u_min = u1.min(n1f * n2f - u1);
+
+    if !has_ties && n1 + n2 <= 24 {
+        let counts = u_distribution(n1, n2);
+        let total: f64 = counts.iter().sum();
+        let tail: f64 = counts.iter().take(u_min as usize + 1).sum();
+        return Some((2.0 * tail / total).min(1.0));
+    }
+
+    let mean = n1f * n2f / 2.0;
+    let nf = n as f64;
+    let variance = n1f * n2f / 12.0 * ((nf + 1.0) - tie_term / (nf * (nf - 1.0)));
+    if variance <= 0.0 {
+        return Some(1.0);
+    }
+    let z = ((mean - u_min) - 0.5).max(0.0) / variance.sqrt();
+    Some((2.0 * (1.0 - standard_normal_cdf(z))).min(1.0))
+}
+
+/// Number of rank arrangements producing each U value for sample sizes `n1`, `n2`.
+fn u_distribution(n1: usize, n2: usize) -> Vec<f64> {
+    // table[i][j][u]: arrangements of i + j items with statistic u, built by the last item.
+    let max_u = n1 * n2;
+    let mut table = vec![vec![Vec::<f64>::new(); n2 + 1]; n1 + 1];
+    for i in 0..=n1 {
+        for j in 0..=n2 {
+            let mut counts = vec![0.0; i * j + 1];
+            if i == 0 || j == 0 {
+                counts[0] = 1.0;
+            } else {
+                // Largest item from sample 1 beats all j items of sample 2.
+                for (u, count) in table[i - 1][j].iter().enumerate() {
+                    counts[u + j] += count;
+                }
+                for (u, count) in table[i][j - 1].iter().enumerate() {
+                    counts[u] += count;
+                }
+            }
+            table[i][j] = counts;
+        }
+    }
+    let mut out = table[n1][n2].clone();
+    out.resize(max_u + 1, 0.0);
+    out
+}
+
+fn standard_normal_cdf(z: f64) -> f64 {
+    0.5 * (1.0 + erf(z / std::f64::consts::SQRT_2))
+}
+
+// Abramowitz-Stegun 7.1.26 (|error| < 1.5e-7).
+fn erf(x: f64) -> f64 {
+    let sign = if x < 0.0 { -1.0 } else { 1.0 };
+    let x = x.abs();
+    let t = 1.0 / (1.0 + 0.3275911 * x);
+    let poly = t
+        * (0.254829592
+            + t * (-0.284496736 + t * (1.421413741 + t * (-1.453152027 + t * 1.061405429))));
+    sign * (1.0 - poly * (-x * x).exp())
+}
+
+fn glob_match(pattern: &str, name: &str) -> bool {
+    let parts = pattern.split('*').collect::<Vec<_>>();
+    if parts.len() == 1 {
+        return pattern == name;
+    }
+    let mut rest = name;
+    for (index, part) in parts.iter().enumerate() {
+        if index == 0 {
+            let Some(stripped) = rest.strip_prefix(part) else {
+                return false;
+            };
+            rest = stripped;
+        } else if index == parts.len() - 1 {
+            return rest.ends_with(part);
+        } else {
+            let Some(found) = rest.find(part) else {
+                return false;
+            };
+            rest = &rest[found + part.len()..];
+        }
+    }
+    true
+}
+
+fn format_number(value: f64) -> String {
+    if value.is_finite() && value.fract() == 0.0 && value.abs() < 1e15 {
+        format!("{}", value as i64)
+    } else if value.is_finite() {
+        let text = format!("{value:.6}");
+        text.trim_end_matches('0').trim_end_matches('.').to_string()
+    } else {
+        // JSON has no infinities; a metric growing from 0 is reported as a huge delta.
+        if value > 0.0 { "1e308" } else { "-1e308" }.to_string()
+    }
+}
+
+fn json_number(value: Option<f64>) -> String {
+    value
+        .map(format_number)
+        .unwrap_or_else(|| "null".to_string())
+}
+
+/// Minimal JSON reader for bench inputs (stores and bootstrap reports).
+#[derive(Debug, Clone, PartialEq)]
+enum Json {
+    Null,
+    Bool(bool),
+    Number(f64),
+    String(String),
+    Array(Vec<Json>),
+    Object(Vec<(String, Json)>),
+}
+
+impl Json {
+    fn parse(text: &str) -> Result<Json, String> {
+        let mut reader = JsonReader {
+            bytes: text.as_bytes(),
+            pos: 0,
+        };
+        let value = reader.value()?;
+        reader.skip_ws();
+        if reader.pos != reader.bytes.len() {
+            return Err(format!("trailing characters at byte {}", reader.pos));
+        }
+        Ok(value)
+    }
+
+    fn get(&self, key: &str) -> Option<&Json> {
+        match self {
+            Json::Object(fields) => fields
+                .iter()
+                .find(|(name, _)| name == key)
+                .map(|(_, value)| value),
+            _ => None,
+        }
+    }
+
+    fn as_str(&self) -> Option<&str> {
+        match self {
+            Json::String(text) => Some(text),
+            _ => None,
+        }
+    }
+
+    fn as_number(&self) -> Option<f64> {
+        match self {
+            Json::Number(value) => Some(*value),
+            _ => None,
+        }
+    }
+}
+
+struct JsonReader<'a> {
+    bytes: &'a [u8],
+    pos: usize,
+}
+
+impl JsonReader<'_> {
+    fn skip_ws(&mut self) {
+        while self.pos < self.bytes.len() && self.bytes[self.pos].is_ascii_whitespace() {
+            self.pos += 1;
+        }
+    }
+
+    fn error(&self, what: &str) -> String {
+        format!("invalid JSON: {what} at byte {}", self.pos)
+    }
+
+    fn expect(&mut self, byte: u8) -> Result<(), String> {
+        self.skip_ws();
+        if self.bytes.get(self.pos) == Some(&byte) {
+            self.pos += 1;
+            Ok(())
+        } else {
+            Err(self.error(&format!("expected '{}'", byte as char)))
+        }
+    }
+
+    fn literal(&mut self, word: &str, value: Json) -> Result<Json, String> {
+        if self.bytes[self.pos..].starts_with(word.as_bytes()) {
+            self.pos += word.len();
+            Ok(value)
+        } else {
+            Err(self.error("unexpected token"))
+        }
+    }
+
+    fn value(&mut self) -> Result<Json, String> {
+        self.skip_ws();
+        match self.bytes.get(self.pos) {
+            Some(b'{') => {
+                self.pos += 1;
+                let mut fields = Vec::new();
+                self.skip_ws();
+                if self.bytes.get(self.pos) == Some(&b'}') {
+                    self.pos += 1;
+                    return Ok(Json::Object(fields));
+                }
+                loop {
+                    self.skip_ws();
+                    let key = self.string()?;
+                    self.expect(b':')?;
+                    fields.push((key, self.value()?));
+                    self.skip_ws();
+                    match self.bytes.get(self.pos) {
+                        Some(b',') => self.pos += 1,
+                        Some(b'}') => {
+                            self.pos += 1;
+                            return Ok(Json::Object(fields));
+                        }
+                        _ => return Err(self.error("expected ',' or '}'")),
+                    }
+                }
+            }
+            Some(b'[') => {
+                self.pos += 1;
+                let mut items = Vec::new();
+                self.skip_ws();
+                if self.bytes.get(self.pos) == Some(&b']') {
+                    self.pos += 1;
+                    return Ok(Json::Array(items));
+                }
+                loop {
+                    items.push(self.value()?);
+                    self.skip_ws();
+                    match self.bytes.get(self.pos) {
+                        Some(b',') => self.pos += 1,
+                        Some(b']') => {
+                            self.pos += 1;
+                            return Ok(Json::Array(items));
+                        }
+                        _ => return Err(self.error("expected ',' or ']'")),
+                    }
+                }
+            }
+            Some(b'"') => Ok(Json::String(self.string()?)),
+            Some(b't') => self.literal("true", Json::Bool(true)),
+            Some(b'f') => self.literal("false", Json::Bool(false)),
+            Some(b'n') => self.literal("null", Json::Null),
+            Some(_) => {
+                let start = self.pos;
+                while self.pos < self.bytes.len()
+                    && matches!(
+                        self.bytes[self.pos],
+                        b'-' | b'+' | b'.' | b'e' | b'E' | b'0'..=b'9'
+                    )
+                {
+                    self.pos += 1;
+                }
+                std::str::from_utf8(&self.bytes[start..self.pos])
+                    .ok()
+                    .and_then(|text| text.parse::<f64>().ok())
+                    .map(Json::Number)
+                    .ok_or_else(|| self.error("invalid number"))
+            }
+            None => Err(self.error("unexpected end of input")),
+        }
+    }
+
+    fn string(&mut self) -> Result<String, String> {
+        if self.bytes.get(self.pos) != Some(&b'"') {
+            return Err(self.error("expected string"));
+        }
+        self.pos += 1;
+        let mut out = Vec::new();
+        loop {
+            let Some(&byte) = self.bytes.get(self.pos) else {
+                return Err(self.error("unterminated string"));
+            };
+            self.pos += 1;
+            match byte {
+                b'"' => break,
+                b'\\' => {
+                    let Some(&escape) = self.bytes.get(self.pos) else {
+                        return Err(self.error("unterminated escape"));
+                    };
+                    self.pos += 1;
+                    match escape {
+                        b'n' => out.push(b'\n'),
+                        b'r' => out.push(b'\r'),
+                        b't' => out.push(b'\t'),
+                        b'u' => {
+                            let code = self
+                                .bytes
+                                .get(self.pos..self.pos + 4)
+                                .and_then(|hex| std::str::from_utf8(hex).ok())
+                                .and_then(|hex| u32::from_str_radix(hex, 16).ok())
+                                .and_then(char::from_u32)
+                                .ok_or_else(|| self.error("invalid \\u escape"))?;
+                            self.pos += 4;
+                            let mut buf = [0u8; 4];
+                            out.extend_from_slice(code.encode_utf8(&mut buf).as_bytes());
+                        }
+                        other => out.push(other),
+                    }
+                }
+                other => out.push(other),
+            }
+        }
+        String::from_utf8(out).map_err(|_| self.error("invalid UTF-8 in string"))
+    }
+}
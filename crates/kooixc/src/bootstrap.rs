@@ -0,0 +1,1145 @@
+use std::collections::HashMap;
+use std::fs;
+#[cfg(unix)]
+use std::os::raw::{c_int, c_long};
+use std::path::{Path, PathBuf};
+use std::process::{Command, Stdio};
+use std::sync::{mpsc, OnceLock};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use crate::loader::load_source_map;
+use crate::util::{escape_json, Fnv1a64};
+
+/// Input that feeds a node's cache key. Keys hash file contents, never timestamps, so a node is
+/// rebuilt exactly when one of its inputs changed byte-for-byte.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum NodeInput {
+    /// A single file (compiler binary, runtime.c, ...).
+    File(PathBuf),
+    /// A Kooix entry file plus every file its imports pull in.
+    Sources(PathBuf),
+    /// Output `output` of node `node` (which must be a dependency).
+    Artifact { node: usize, output: usize },
+    /// `llc --version` and `clang --version`, for steps that link native code.
+    Toolchain,
+}
+
+/// One command-line argument of a node action.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum NodeArg {
+    Text(String),
+    Path(PathBuf),
+    /// Output slot of the node itself (a path inside its artifact directory).
+    Output(usize),
+    /// Output slot of a dependency.
+    Artifact {
+        node: usize,
+        output: usize,
+    },
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum NodeAction {
+    /// Runs `program args...` from the bootstrap root; succeeds when it exits with `expect_exit`
+    /// and every declared output exists.
+    Command {
+        program: NodeArg,
+        args: Vec<NodeArg>,
+        expect_exit: i32,
+    },
+    /// Succeeds when the two artifacts are byte-identical (self-host fixpoint).
+    SameContent { a: NodeArg, b: NodeArg },
+    /// Writes a `--batch` manifest into the artifact directory (entry `i` compiles to outputs
+    /// `2i` (IR) and `2i + 1` (binary)) and runs `program --batch <manifest>`.
+    Batch {
+        program: NodeArg,
+        entries: Vec<PathBuf>,
+    },
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct BootstrapNode {
+    pub id: String,
+    pub deps: Vec<usize>,
+    pub inputs: Vec<NodeInput>,
+    pub action: NodeAction,
+    /// File names created inside the node's artifact directory.
+    pub outputs: Vec<String>,
+    /// Peak RSS estimate used by the scheduler until a measured value is cached.
+    pub mem_kb: u64,
+    pub timeout_ms: Option<u64>,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct BootstrapPlan {
+    pub root: PathBuf,
+    pub nodes: Vec<BootstrapNode>,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct BootstrapOptions {
+    pub root: PathBuf,
+    pub out_dir: PathBuf,
+    pub cache_dir: PathBuf,
+    /// Stage0 compiler binary (normally the running `kooixc`).
+    pub compiler: PathBuf,
+    pub jobs: usize,
+    /// Sum of node RSS estimates allowed to run at once; 0 disables the budget.
+    pub mem_budget_kb: u64,
+    pub smokes: Vec<String>,
+    pub stage_timeout_ms: Option<u64>,
+    pub smoke_timeout_ms: Option<u64>,
+}
+
+impl BootstrapOptions {
+    pub fn new(root: impl Into<PathBuf>, compiler: impl Into<PathBuf>) -> Self {
+        let root = root.into();
+        let out_dir = root.join("dist");
+        Self {
+            cache_dir: out_dir.join(".bootstrap-cache"),
+            out_dir,
+            root,
+            compiler: compiler.into(),
+            jobs: thread::available_parallelism()
+                .map(|jobs| jobs.get())
+                .unwrap_or(1),
+            mem_budget_kb: default_mem_budget_kb(),
+            smokes: vec!["stage2-min".to_string()],
+            stage_timeout_ms: Some(900_000),
+            smoke_timeout_ms: Some(300_000),
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum NodeStatus {
+    Built,
+    Cached,
+    Failed,
+    Skipped,
+}
+
+impl NodeStatus {
+    pub fn label(self) -> &'static str {
+        match self {
+            NodeStatus::Built => "built",
+            NodeStatus::Cached => "cached",
+            NodeStatus::Failed => "failed",
+            NodeStatus::Skipped => "skipped",
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct NodeReport {
+    pub id: String,
+    pub status: NodeStatus,
+    pub key: Option<u64>,
+    pub seconds: f64,
+    pub maxrss_kb: Option<u64>,
+    pub exit_code: Option<i32>,
+    pub artifact_dir: Option<PathBuf>,
+    pub outputs: Vec<PathBuf>,
+    pub error: Option<String>,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct BootstrapReport {
+    pub jobs: usize,
+    pub mem_budget_kb: u64,
+    pub seconds: f64,
+    pub nodes: Vec<NodeReport>,
+}
+
+impl BootstrapReport {
+    pub fn ok(&self) -> bool {
+        self.nodes
+            .iter()
+            .all(|node| matches!(node.status, NodeStatus::Built | NodeStatus::Cached))
+    }
+
+    pub fn node(&self, id: &str) -> Option<&NodeReport> {
+        self.nodes.iter().find(|node| node.id == id)
+    }
+
+    pub fn to_json(&self) -> String {
+        let nodes = self
+            .nodes
+            .iter()
+            .map(|node| {
+                format!(
+                    "{{\"id\":\"{}\",\"status\":\"{}\",\"key\":{},\"seconds\":{:.3},\"maxrss_kb\":{},\"exit_code\":{},\"error\":{}}}",
+                    escape_json(&node.id),
+                    node.status.label(),
+                    json_opt(node.key.map(|key| format!("\"{key:016x}\""))),
+                    node.seconds,
+                    json_opt(node.maxrss_kb.map(|kb| kb.to_string())),
+                    json_opt(node.exit_code.map(|code| code.to_string())),
+                    json_opt(
+                        node.error
+                            .as_ref()
+                            .map(|error| format!("\"{}\"", escape_json(error)))
+                    ),
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(",");
+        format!(
+            "{{\"ok\":{},\"jobs\":{},\"mem_budget_kb\":{},\"seconds\":{:.3},\"nodes\":[{}]}}",
+            self.ok(),
+            self.jobs,
+            self.mem_budget_kb,
+            self.seconds,
+            nodes
+        )
+    }
+}
+
+/// Smoke targets of the v0.13 matrix: (name, entry, expected exit code).
+pub const SMOKES: &[(&str, &str, i32)] = &[
+    ("stage2-min", "stage1/stage2_min.kooix", 0),
+    ("import-main", "examples/import_main.kooix", 42),
+    ("import-alias-main", "examples/import_alias_main.kooix", 42),
+    (
+        "s1-import-alias",
+        "stage1/stage2_import_alias_smoke.kooix",
+        0,
+    ),
+    (
+        "import-variant-main",
+        "examples/import_variant_main.kooix",
+        42,
+    ),
+    (
+        "s1-import-variant",
+        "stage1/stage2_import_variant_smoke.kooix",
+        0,
+    ),
+    ("stdlib", "examples/stdlib_smoke.kooix", 11),
+    ("host-read", "stage1/stage2_host_read_file_smoke.kooix", 0),
+    ("s1-lexer", "stage1/stage2_s1_lexer_module_smoke.kooix", 0),
+    ("s1-parser", "stage1/stage2_s1_parser_module_smoke.kooix", 0),
+    (
+        "s1-typecheck",
+        "stage1/stage2_s1_typecheck_module_smoke.kooix",
+        0,
+    ),
+    (
+        "s1-resolver",
+        "stage1/stage2_s1_resolver_module_smoke.kooix",
+        0,
+    ),
+    (
+        "s1-compiler",
+        "stage1/stage2_s1_compiler_module_smoke.kooix",
+        0,
+    ),
+];
+
+/// Expands a smoke selector list: smoke names, `core` (the four Stage1 module smokes), `import`,
+/// `compiler-main` (stage4 compiles and runs `stage2_min`), `all`, or `none`. `batch` selects no
+/// smoke; it makes `plan_v0_13` compile the stage3 smokes in one `--batch` node.
+pub fn expand_smokes(selectors: &[String]) -> Result<Vec<String>, String> {
+    let mut out: Vec<String> = Vec::new();
+    let mut push = |name: &str| {
+        if !out.iter().any(|existing| existing == name) {
+            out.push(name.to_string());
+        }
+    };
+    for selector in selectors {
+        match selector.as_str() {
+            "none" => {}
+            "all" => {
+                for (name, _, _) in SMOKES {
+                    push(name);
+                }
+                push("compiler-main");
+            }
+            "core" => {
+                for name in ["s1-lexer", "s1-parser", "s1-typecheck", "s1-resolver"] {
+                    push(name);
+                }
+            }
+            "import" => {
+                for name in [
+                    "import-main",
+                    "import-alias-main",
+                    "s1-import-alias",
+                    "import-variant-main",
+                    "s1-import-variant",
+                ] {
+                    push(name);
+                }
+            }
+            "compiler-main" => push("compiler-main"),
+            "batch" => {}
+            name if SMOKES.iter().any(|(known, _, _)| *known == name) => push(name),
+            other => return Err(format!("unknown smoke '{other}'")),
+        }
+    }
+    Ok(out)
+}
+
+/// Builds the v0.13 DAG: Stage0 compiles `compiler_main` natively (stage1), each stage binary then
+/// compiles `compiler_main` again (stage2 -> stage3 -> stage4), `fixpoint` asserts stage3/stage4
+/// IR are identical, and every selected smoke is a compile node on stage3 plus a run node.
+pub fn plan_v0_13(options: &BootstrapOptions) -> Result<BootstrapPlan, String> {
+    let root = &options.root.canonicalize().map_err(|error| {
+        format!(
+            "bootstrap root not found: {}: {error}",
+            options.root.display()
+        )
+    })?;
+    let compiler_main = root.join("stage1").join("compiler_main.kooix");
+    let runtime_c = root
+        .join("crates")
+        .join("kooixc")
+        .join("native_runtime")
+        .join("runtime.c");
+    for required in [&compiler_main, &runtime_c, &options.compiler] {
+        if !required.is_file() {
+            return Err(format!("bootstrap input not found: {}", required.display()));
+        }
+    }
+
+    let stage_timeout = options.stage_timeout_ms;
+    let smoke_timeout = options.smoke_timeout_ms;
+    let mut nodes: Vec<BootstrapNode> = Vec::new();
+
+    nodes.push(BootstrapNode {
+        id: "stage1".to_string(),
+        deps: Vec::new(),
+        inputs: vec![
+            NodeInput::File(options.compiler.clone()),
+            NodeInput::Sources(compiler_main.clone()),
+            NodeInput::File(runtime_c.clone()),
+            NodeInput::Toolchain,
+        ],
+        action: NodeAction::Command {
+            program: NodeArg::Path(options.compiler.clone()),
+            args: vec![
+                NodeArg::Text("native".to_string()),
+                NodeArg::Path(compiler_main.clone()),
+                NodeArg::Output(0),
+            ],
+            expect_exit: 0,
+        },
+        outputs: vec!["kooixc-stage1".to_string()],
+        mem_kb: 1024 * 1024,
+        timeout_ms: stage_timeout,
+    });
+
+    // stageN+1 = stageN compiling compiler_main: outputs [IR, binary].
+    let stage_node = |nodes: &mut Vec<BootstrapNode>, n: usize, prev: usize, bin: usize| {
+        nodes.push(BootstrapNode {
+            id: format!("stage{n}"),
+            deps: vec![prev],
+            inputs: vec![
+                NodeInput::Artifact {
+                    node: prev,
+                    output: bin,
+                },
+                NodeInput::Sources(compiler_main.clone()),
+                NodeInput::File(runtime_c.clone()),
+                NodeInput::Toolchain,
+            ],
+            action: NodeAction::Command {
+                program: NodeArg::Artifact {
+                    node: prev,
+                    output: bin,
+                },
+                args: vec![
+                    NodeArg::Path(compiler_main.clone()),
+                    NodeArg::Output(0),
+                    NodeArg::Output(1),
+                ],
+                expect_exit: 0,
+            },
+            outputs: vec![format!("stage{n}.ll"), format!("kooixc-stage{n}")],
+            mem_kb: 1024 * 1024,
+            timeout_ms: stage_timeout,
+        });
+        nodes.len() - 1
+    };
+    let stage2 = stage_node(&mut nodes, 2, 0, 0);
+    let stage3 = stage_node(&mut nodes, 3, stage2, 1);
+    let stage4 = stage_node(&mut nodes, 4, stage3, 1);
+
+    nodes.push(BootstrapNode {
+        id: "fixpoint".to_string(),
+        deps: vec![stage3, stage4],
+        inputs: vec![
+            NodeInput::Artifact {
+                node: stage3,
+                output: 0,
+            },
+            NodeInput::Artifact {
+                node: stage4,
+                output: 0,
+            },
+        ],
+        action: NodeAction::SameContent {
+            a: NodeArg::Artifact {
+                node: stage3,
+                output: 0,
+            },
+            b: NodeArg::Artifact {
+                node: stage4,
+                output: 0,
+            },
+        },
+        outputs: Vec::new(),
+        mem_kb: 16 * 1024,
+        timeout_ms: None,
+    });
+
+    let smokes = expand_smokes(&options.smokes)?;
+    // With `batch`, one stage3 `--batch` node compiles every stage3 smoke (shared modules are
+    // parsed once) and each run node takes its binary from there.
+    let batched: Vec<(&str, &str, i32)> = if options.smokes.iter().any(|smoke| smoke == "batch") {
+        SMOKES
+            .iter()
+            .filter(|(name, _, _)| smokes.iter().any(|smoke| smoke == name))
+            .copied()
+            .collect()
+    } else {
+        Vec::new()
+    };
+    if !batched.is_empty() {
+        let entries: Vec<PathBuf> = batched
+            .iter()
+            .map(|(_, entry, _)| root.join(entry))
+            .collect();
+        let mut inputs = vec![
+            NodeInput::Artifact {
+                node: stage3,
+                output: 1,
+            },
+            NodeInput::File(runtime_c.clone()),
+            NodeInput::Toolchain,
+        ];
+        inputs.extend(entries.iter().cloned().map(NodeInput::Sources));
+        nodes.push(BootstrapNode {
+            id: "smoke:batch:compile".to_string(),
+            deps: vec![stage3],
+            inputs,
+            action: NodeAction::Batch {
+                program: NodeArg::Artifact {
+                    node: stage3,
+                    output: 1,
+                },
+                entries,
+            },
+            outputs: batched
+                .iter()
+                .flat_map(|(name, _, _)| [format!("{name}.ll"), name.to_string()])
+                .collect(),
+            mem_kb: 512 * 1024,
+            timeout_ms: smoke_timeout.map(|timeout| timeout * batched.len() as u64),
+        });
+        let batch = nodes.len() - 1;
+        for (index, (name, _, expect_exit)) in batched.iter().enumerate() {
+            let binary = NodeArg::Artifact {
+                node: batch,
+                output: 2 * index + 1,
+            };
+            nodes.push(BootstrapNode {
+                id: format!("smoke:{name}:run"),
+                deps: vec![batch],
+                inputs: vec![NodeInput::Artifact {
+                    node: batch,
+                    output: 2 * index + 1,
+                }],
+                action: NodeAction::Command {
+                    program: binary,
+                    args: Vec::new(),
+                    expect_exit: *expect_exit,
+                },
+                outputs: Vec::new(),
+                mem_kb: 64 * 1024,
+                timeout_ms: smoke_timeout,
+            });
+        }
+    }
+
+    for name in smokes {
+        if batched.iter().any(|(batched, _, _)| *batched == name) {
+            continue;
+        }
+        let (compiler_node, entry, expect_exit) = if name == "compiler-main" {
+            (stage4, "stage1/stage2_min.kooix", 0)
+        } else {
+            let (_, entry, expect_exit) = SMOKES
+                .iter()
+                .find(|(known, _, _)| *known == name)
+                .copied()
+                .ok_or_else(|| format!("unknown smoke '{name}'"))?;
+            (stage3, entry, expect_exit)
+        };
+        let entry_path = root.join(entry);
+        nodes.push(BootstrapNode {
+            id: format!("smoke:{name}:compile"),
+            deps: vec![compiler_node],
+            inputs: vec![
+                NodeInput::Artifact {
+                    node: compiler_node,
+                    output: 1,
+                },
+                NodeInput::Sources(entry_path.clone()),
+                NodeInput::File(runtime_c.clone()),
+                NodeInput::Toolchain,
+            ],
+            action: NodeAction::Command {
+                program: NodeArg::Artifact {
+                    node: compiler_node,
+                    output: 1,
+                },
+                args: vec![
+                    NodeArg::Path(entry_path),
+                    NodeArg::Output(0),
+                    NodeArg::Output(1),
+                ],
+                expect_exit: 0,
+            },
+            outputs: vec![format!("{name}.ll"), name.clone()],
+            mem_kb: 256 * 1024,
+            timeout_ms: smoke_timeout,
+        });
+        let compile = nodes.len() - 1;
+        nodes.push(BootstrapNode {
+            id: format!("smoke:{name}:run"),
+            deps: vec![compile],
+            inputs: vec![NodeInput::Artifact {
+                node: compile,
+                output: 1,
+            }],
+            action: NodeAction::Command {
+                program: NodeArg::Artifact {
+                    node: compile,
+                    output: 1,
+                },
+                args: Vec::new(),
+                expect_exit,
+            },
+            outputs: Vec::new(),
+            mem_kb: 64 * 1024,
+            timeout_ms: smoke_timeout,
+        });
+    }
+
+    Ok(BootstrapPlan {
+        root: root.clone(),
+        nodes,
+    })
+}
+
+/// Copies the stage binaries of a successful run to `out_dir` (`kooixc1` is the stage3 alias).
+pub fn publish_v0_13(report: &BootstrapReport, out_dir: &Path) -> Result<(), String> {
+    fs::create_dir_all(out_dir)
+        .map_err(|error| format!("failed to create {}: {error}", out_dir.display()))?;
+    let copies = [
+        ("stage2", "kooixc-stage2", "kooixc-stage2"),
+        ("stage3", "kooixc-stage3", "kooixc-stage3"),
+        ("stage3", "kooixc-stage3", "kooixc1"),
+        ("stage4", "kooixc-stage4", "kooixc-stage4"),
+    ];
+    for (id, file, target) in copies {
+        let Some(dir) = report.node(id).and_then(|node| node.artifact_dir.as_ref()) else {
+            continue;
+        };
+        let from = dir.join(file);
+        let to = out_dir.join(target);
+        fs::copy(&from, &to).map_err(|error| {
+            format!(
+                "failed to copy {} to {}: {error}",
+                from.display(),
+                to.display()
+            )
+        })?;
+    }
+    Ok(())
+}
+
+/// Runs `plan` with at most `jobs` nodes in flight and the sum of their RSS estimates within
+/// `mem_budget_kb` (a node larger than the budget runs alone). Up-to-date nodes are skipped; the
+/// dependents of a failed node are reported as skipped.
+pub fn run_plan(
+    plan: &BootstrapPlan,
+    cache_dir: &Path,
+    jobs: usize,
+    mem_budget_kb: u64,
+) -> BootstrapReport {
+    let started = Instant::now();
+    let jobs = jobs.max(1);
+    // Node commands run from the plan root, so artifact paths handed to them must be absolute.
+    let _ = fs::create_dir_all(cache_dir);
+    let cache_dir = &cache_dir
+        .canonicalize()
+        .unwrap_or_else(|_| cache_dir.to_path_buf());
+    let count = plan.nodes.len();
+    let mut reports: Vec<Option<NodeReport>> = vec![None; count];
+    let mut estimates: Vec<u64> = plan
+        .nodes
+        .iter()
+        .map(|node| read_rss_history(cache_dir, &node.id).unwrap_or(node.mem_kb))
+        .collect();
+    let mut running: HashMap<usize, u64> = HashMap::new();
+    let (sender, receiver) = mpsc::channel::<(usize, NodeReport)>();
+
+    loop {
+        // Propagate failures (transitively) before admitting anything new.
+        let mut changed = true;
+        while changed {
+            changed = false;
+            for index in 0..count {
+                if reports[index].is_some() || running.contains_key(&index) {
+                    continue;
+                }
+                let blocked = plan.nodes[index].deps.iter().find(|dep| {
+                    matches!(
+                        reports[**dep].as_ref().map(|report| report.status),
+                        Some(NodeStatus::Failed | NodeStatus::Skipped)
+                    )
+                });
+                if let Some(dep) = blocked {
+                    reports[index] = Some(NodeReport {
+                        id: plan.nodes[index].id.clone(),
+                        status: NodeStatus::Skipped,
+                        key: None,
+                        seconds: 0.0,
+                        maxrss_kb: None,
+                        exit_code: None,
+                        artifact_dir: None,
+                        outputs: Vec::new(),
+                        error: Some(format!("dependency '{}' failed", plan.nodes[*dep].id)),
+                    });
+                    changed = true;
+                }
+            }
+        }
+
+        for index in 0..count {
+            if running.len() >= jobs {
+                break;
+            }
+            if reports[index].is_some() || running.contains_key(&index) {
+                continue;
+            }
+            let ready = plan.nodes[index]
+                .deps
+                .iter()
+                .all(|dep| reports[*dep].is_some());
+            if !ready {
+                continue;
+            }
+            let in_use: u64 = running.values().sum();
+            let estimate = estimates[index];
+            if mem_budget_kb > 0 && !running.is_empty() && in_use + estimate > mem_budget_kb {
+                continue;
+            }
+
+            let deps = plan.nodes[index]
+                .deps
+                .iter()
+                .map(|dep| (*dep, reports[*dep].clone().expect("dependency finished")))
+                .collect::<HashMap<_, _>>();
+            let node = plan.nodes[index].clone();
+            let root = plan.root.clone();
+            let cache_dir = cache_dir.to_path_buf();
+            let sender = sender.clone();
+            running.insert(index, estimate);
+            thread::spawn(move || {
+                let report = execute_node(&node, &deps, &root, &cache_dir);
+                let _ = sender.send((index, report));
+            });
+        }
+
+        if running.is_empty() {
+            break;
+        }
+        let Ok((index, report)) = receiver.recv() else {
+            break;
+        };
+        running.remove(&index);
+        if report.status == NodeStatus::Built {
+            if let Some(kb) = report.maxrss_kb {
+                write_rss_history(cache_dir, &report.id, kb);
+                estimates[index] = kb;
+            }
+        }
+        reports[index] = Some(report);
+    }
+
+    BootstrapReport {
+        jobs,
+        mem_budget_kb,
+        seconds: started.elapsed().as_secs_f64(),
+        nodes: reports
+            .into_iter()
+            .zip(plan.nodes.iter())
+            .map(|(report, node)| {
+                report.unwrap_or_else(|| NodeReport {
+                    id: node.id.clone(),
+                    status: NodeStatus::Skipped,
+                    key: None,
+                    seconds: 0.0,
+                    maxrss_kb: None,
+                    exit_code: None,
+                    artifact_dir: None,
+                    outputs: Vec::new(),
+                    error: Some("not scheduled".to_string()),
+                })
+            })
+            .collect(),
+    }
+}
+
+fn execute_node(
+    node: &BootstrapNode,
+    deps: &HashMap<usize, NodeReport>,
+    root: &Path,
+    cache_dir: &Path,
+) -> NodeReport {
+    let started = Instant::now();
+    let mut report = NodeReport {
+        id: node.id.clone(),
+        status: NodeStatus::Failed,
+        key: None,
+        seconds: 0.0,
+        maxrss_kb: None,
+        exit_code: None,
+        artifact_dir: None,
+        outputs: Vec::new(),
+        error: None,
+    };
+
+    let key = match node_key(node, deps) {
+        Ok(key) => key,
+        Err(error) => {
+            report.error = Some(error);
+            return report;
+        }
+    };
+    let dir = cache_dir
+        .join(sanitize_id(&node.id))
+        .join(format!("{key:016x}"));
+    report.key = Some(key);
+    report.artifact_dir = Some(dir.clone());
+    report.outputs = node.outputs.iter().map(|output| dir.join(output)).collect();
+
+    let stamp = dir.join("stamp");
+    if let Ok(recorded) = fs::read_to_string(&stamp) {
+        if node.outputs.iter().all(|output| dir.join(output).is_file()) {
+            report.status = NodeStatus::Cached;
+            report.maxrss_kb = recorded
+                .lines()
+                .find_map(|line| line.strip_prefix("maxrss_kb="))
+                .and_then(|kb| kb.parse().ok());
+            report.seconds = started.elapsed().as_secs_f64();
+            return report;
+        }
+    }
+
+    // A partial directory from an interrupted run is never trusted.
+    let _ = fs::remove_dir_all(&dir);
+    if let Err(error) = fs::create_dir_all(&dir) {
+        report.error = Some(format!("failed to create {}: {error}", dir.display()));
+        return report;
+    }
+
+    let resolve = |arg: &NodeArg| -> PathBuf {
+        match arg {
+            NodeArg::Text(text) => PathBuf::from(text),
+            NodeArg::Path(path) => path.clone(),
+            NodeArg::Output(output) => dir.join(&node.outputs[*output]),
+            NodeArg::Artifact { node: dep, output } => artifact_path(deps, *dep, *output),
+        }
+    };
+
+    let outcome = match &node.action {
+        NodeAction::Command {
+            program,
+            args,
+            expect_exit,
+        } => {
+            let args = args.iter().map(&resolve).collect::<Vec<_>>();
+            match run_measured(
+                &resolve(program),
+                &args,
+                root,
+                &dir.join("log.txt"),
+                node.timeout_ms,
+            ) {
+                Ok((code, maxrss_kb)) => {
+                    report.exit_code = code;
+                    report.maxrss_kb = maxrss_kb;
+                    if code != Some(*expect_exit) {
+                        Err(format!(
+                            "expected exit {expect_exit}, got {} (log: {})",
+                            code.map_or("signal".to_string(), |code| code.to_string()),
+                            dir.join("log.txt").display()
+                        ))
+                    } else if let Some(missing) = node
+                        .outputs
+                        .iter()
+                        .find(|output| !dir.join(output).is_file())
+                    {
+                        Err(format!("output '{missing}' was not produced"))
+                    } else {
+                        Ok(())
+                    }
+                }
+                Err(error) => Err(error),
+            }
+        }
+        NodeAction::Batch { program, entries } => {
+            let manifest = dir.join("manifest.txt");
+            let lines: String = entries
+                .iter()
+                .enumerate()
+                .map(|(index, entry)| {
+                    format!(
+                        "{} {} {}\n",
+                        entry.display(),
+                        dir.join(&node.outputs[2 * index]).display(),
+                        dir.join(&node.outputs[2 * index + 1]).display()
+                    )
+                })
+                .collect();
+            match fs::write(&manifest, lines) {
+                Err(error) => Err(format!("failed to write {}: {error}", manifest.display())),
+                Ok(()) => match run_measured(
+                    &resolve(program),
+                    &[PathBuf::from("--batch"), manifest],
+                    root,
+                    &dir.join("log.txt"),
+                    node.timeout_ms,
+                ) {
+                    Ok((code, maxrss_kb)) => {
+                        report.exit_code = code;
+                        report.maxrss_kb = maxrss_kb;
+                        if code != Some(0) {
+                            Err(format!(
+                                "batch exited with {} (log: {})",
+                                code.map_or("signal".to_string(), |code| code.to_string()),
+                                dir.join("log.txt").display()
+                            ))
+                        } else if let Some(missing) = node
+                            .outputs
+                            .iter()
+                            .find(|output| !dir.join(output).is_file())
+                        {
+                            Err(format!("output '{missing}' was not produced"))
+                        } else {
+                            Ok(())
+                        }
+                    }
+                    Err(error) => Err(error),
+                },
+            }
+        }
+        NodeAction::SameContent { a, b } => {
+            let (a, b) = (resolve(a), resolve(b));
+            match (fs::read(&a), fs::read(&b)) {
+                (Ok(left), Ok(right)) if left == right => Ok(()),
+                (Ok(_), Ok(_)) => Err(format!("{} and {} differ", a.display(), b.display())),
+                (Err(error), _) | (_, Err(error)) => Err(format!("read failed: {error}")),
+            }
+        }
+    };
+
+    report.seconds = started.elapsed().as_secs_f64();
+    match outcome {
+        Ok(()) => {
+            let mut recorded = format!("seconds={:.3}\n", report.seconds);
+            if let Some(kb) = report.maxrss_kb {
+                recorded.push_str(&format!("maxrss_kb={kb}\n"));
+            }
+            if let Err(error) = fs::write(&stamp, recorded) {
+                report.error = Some(format!("failed to write {}: {error}", stamp.display()));
+                return report;
+            }
+            report.status = NodeStatus::Built;
+        }
+        Err(error) => report.error = Some(error),
+    }
+    report
+}
+
+fn artifact_path(deps: &HashMap<usize, NodeReport>, node: usize, output: usize) -> PathBuf {
+    deps[&node].outputs[output].clone()
+}
+
+fn node_key(node: &BootstrapNode, deps: &HashMap<usize, NodeReport>) -> Result<u64, String> {
+    let mut hash = Fnv1a64::new();
+    hash.write(node.id.as_bytes());
+    // Dependencies are named by id, not plan index, so selecting a different smoke set (which
+    // renumbers nodes) keeps existing keys valid.
+    let describe = |arg: &NodeArg| match arg {
+        NodeArg::Text(text) => format!("text:{text}"),
+        NodeArg::Path(path) => format!("path:{}", path.display()),
+        NodeArg::Output(output) => format!("out:{}", node.outputs[*output]),
+        NodeArg::Artifact { node: dep, output } => format!("dep:{}:{output}", deps[dep].id),
+    };
+    match &node.action {
+        NodeAction::Command {
+            program,
+            args,
+            expect_exit,
+        } => {
+            hash.write(b"command");
+            hash.write(describe(program).as_bytes());
+            for arg in args {
+                hash.write(describe(arg).as_bytes());
+            }
+            hash.write(&expect_exit.to_le_bytes());
+        }
+        NodeAction::Batch { program, entries } => {
+            hash.write(b"batch");
+            hash.write(describe(program).as_bytes());
+            for entry in entries {
+                hash.write(entry.to_string_lossy().as_bytes());
+            }
+        }
+        NodeAction::SameContent { a, b } => {
+            hash.write(b"same-content");
+            hash.write(describe(a).as_bytes());
+            hash.write(describe(b).as_bytes());
+        }
+    }
+    for output in &node.outputs {
+        hash.write(output.as_bytes());
+    }
+    for input in &node.inputs {
+        match input {
+            NodeInput::File(path) => hash_file(&mut hash, path)?,
+            NodeInput::Sources(entry) => {
+                let map = load_source_map(entry).map_err(|errors| {
+                    format!(
+                        "failed to load {}: {}",
+                        entry.display(),
+                        errors
+                            .first()
+                            .map(|error| error.message.as_str())
+                            .unwrap_or("unknown error")
+                    )
+                })?;
+                for file in &map.files {
+                    hash.write(file.path.to_string_lossy().as_bytes());
+                    hash.write(file.source.as_bytes());
+                }
+            }
+            NodeInput::Artifact { node, output } => {
+                hash_file(&mut hash, &artifact_path(deps, *node, *output))?
+            }
+            NodeInput::Toolchain => hash.write(toolchain_versions().as_bytes()),
+        }
+    }
+    Ok(hash.finish())
+}
+
+fn hash_file(hash: &mut Fnv1a64, path: &Path) -> Result<(), String> {
+    let bytes =
+        fs::read(path).map_err(|error| format!("failed to read {}: {error}", path.display()))?;
+    hash.write(&bytes);
+    Ok(())
+}
+
+/// Queried once per process; a missing tool hashes as missing, and the step then fails.
+fn toolchain_versions() -> &'static str {
+    static VERSIONS: OnceLock<String> = OnceLock::new();
+    VERSIONS.get_or_init(|| {
+        ["llc", "clang"]
+            .iter()
+            .map(|tool| match Command::new(tool).arg("--version").output() {
+                Ok(output) => format!("{tool}:{}", String::from_utf8_lossy(&output.stdout)),
+                Err(_) => format!("{tool}:missing"),
+            })
+            .collect::<Vec<_>>()
+            .join("\n")
+    })
+}
+
+fn sanitize_id(id: &str) -> String {
+    id.chars()
+        .map(|ch| {
+            if ch.is_ascii_alphanumeric() || ch == '-' || ch == '_' || ch == '.' {
+                ch
+            } else {
+                '_'
+            }
+        })
+        .collect()
+}
+
+fn read_rss_history(cache_dir: &Path, id: &str) -> Option<u64> {
+    fs::read_to_string(cache_dir.join(sanitize_id(id)).join("rss_kb"))
+        .ok()?
+        .trim()
+        .parse()
+        .ok()
+}
+
+fn write_rss_history(cache_dir: &Path, id: &str, kb: u64) {
+    let dir = cache_dir.join(sanitize_id(id));
+    let _ = fs::create_dir_all(&dir);
+    let _ = fs::write(dir.join("rss_kb"), format!("{kb}\n"));
+}
+
+/// `MemTotal * 85%` from /proc/meminfo (the same cap `bootstrap_v0_13.sh` applies); 0 when unknown.
+pub fn default_mem_budget_kb() -> u64 {
+    fs::read_to_string("/proc/meminfo")
+        .ok()
+        .and_then(|meminfo| {
+            meminfo.lines().find_map(|line| {
+                line.strip_prefix("MemTotal:")?
+                    .trim()
+                    .trim_end_matches("kB")
+                    .trim()
+                    .parse::<u64>()
+                    .ok()
+            })
+        })
+        .map(|total| total * 85 / 100)
+        .unwrap_or(0)
+}
+
+fn json_opt(value: Option<String>) -> String {
+    value.unwrap_or_else(|| "null".to_string())
+}
+
+/// Runs one node command with stdout/stderr captured in `log`. Returns the exit code (`None` when
+/// killed by a signal) and the peak RSS of the process tree as reported by `wait4`.
+#[cfg(unix)]
+fn run_measured(
+    program: &Path,
+    args: &[PathBuf],
+    cwd: &Path,
+    log: &Path,
+    timeout_ms: Option<u64>,
+) -> Result<(Option<i32>, Option<u64>), String> {
+    use std::os::unix::process::CommandExt;
+
+    let log_file = fs::File::create(log)
+        .map_err(|error| format!("failed to create {}: {error}", log.display()))?;
+    let log_err = log_file
+        .try_clone()
+        .map_err(|error| format!("failed to open {}: {error}", log.display()))?;
+    let child = Command::new(program)
+        .args(args)
+        .current_dir(cwd)
+        .stdin(Stdio::null())
+        .stdout(log_file)
+        .stderr(log_err)
+        .process_group(0)
+        .spawn()
+        .map_err(|error| format!("failed to spawn {}: {error}", program.display()))?;
+
+    // Reaped with wait4 instead of `Child::wait` so the kernel hands back the child's rusage
+    // (its `ru_maxrss` already folds in the llc/clang processes it waited for).
+    let pid = child.id() as c_int;
+    let deadline = timeout_ms.map(|ms| Instant::now() + Duration::from_millis(ms));
+    let mut status: c_int = 0;
+    let mut usage = RUsage::default();
+    loop {
+        let options = if deadline.is_some() { WNOHANG } else { 0 };
+        let reaped = unsafe { wait4(pid, &mut status, options, &mut usage) };
+        if reaped == pid {
+            break;
+        }
+        if reaped < 0 {
+            let error = std::io::Error::last_os_error();
+            if error.kind() == std::io::ErrorKind::Interrupted {
+                continue;
+            }
+            return Err(format!("wait4 failed: {error}"));
+        }
+        if deadline.is_some_and(|deadline| Instant::now() >= deadline) {
+            let _ = crate::native::kill_process_group(child.id());
+            while unsafe { wait4(pid, &mut status, 0, &mut usage) } < 0 {
+                if std::io::Error::last_os_error().kind() != std::io::ErrorKind::Interrupted {
+                    break;
+                }
+            }
+            return Err(format!(
+                "timed out after {} ms",
+                timeout_ms.unwrap_or_default()
+            ));
+        }
+        thread::sleep(Duration::from_millis(20));
+    }
+
+    let code = if status & 0x7f == 0 {
+        Some((status >> 8) & 0xff)
+    } else {
+        None
+    };
+    let maxrss = usage.ru_maxrss.max(0) as u64;
+    // macOS reports bytes, Linux and the BSDs kilobytes.
+    let maxrss_kb = if cfg!(target_os = "macos") {
+        maxrss / 1024
+    } else {
+        maxrss
+    };
+    Ok((code, Some(maxrss_kb)))
+}
+
+#[cfg(not(unix))]
+fn run_measured(
+    program: &Path,
+    args: &[PathBuf],
+    cwd: &Path,
+    log: &Path,
+    timeout_ms: Option<u64>,
+) -> Result<(Option<i32>, Option<u64>), String> {
+    let log_file = fs::File::create(log)
+        .map_err(|error| format!("failed to create {}: {error}", log.display()))?;
+    let log_err = log_file
+        .try_clone()
+        .map_err(|error| format!("failed to open {}: {error}", log.display()))?;
+    let mut child = Command::new(program)
+        .args(args)
+        .current_dir(cwd)
+        .stdin(Stdio::null())
+        .stdout(log_file)
+        .stderr(log_err)
+        .spawn()
+        .map_err(|error| format!("failed to spawn {}: {error}", program.display()))?;
+    let deadline = timeout_ms.map(|ms| Instant::now() + Duration::from_millis(ms));
+    loop {
+        if let Some(status) = child
+            .try_wait()
+            .map_err(|error| format!("wait failed: {error}"))?
+        {
+            return Ok((status.code(), None));
+        }
+        if deadline.is_some_and(|deadline| Instant::now() >= deadline) {
+            let _ = child.kill();
+            let _ = child.wait();
+            return Err(format!(
+                "timed out after {} ms",
+                timeout_ms.unwrap_or_default()
+            ));
+        }
+        thread::sleep(Duration::from_millis(20));
+    }
+}
+
+#[cfg(unix)]
+const WNOHANG: c_int = 1;
+
+#[cfg(unix)]
+#[repr(C)]
+#[derive(Default)]
+struct RUsage {
+    ru_utime: [c_long; 2],
+    ru_stime: [c_long; 2],
+    ru_maxrss: c_long,
+    ru_rest: [c_long; 13],
+}
+
+#[cfg(unix)]
+extern "C" {
+    fn wait4(pid: c_int, status: *mut c_int, options: c_int, rusage: *mut RUsage) -> c_int;
+}
@@ -1,6 +1,7 @@
 use crate::ast::{
     AgentPolicy, Block, EnsureClause, EvidenceSpec, FailureAction, FailurePolicy, Item, LoopSpec,
-    OutputField, Program, RecordField, RecordGenericParam, StateRule, TypeRef, WorkflowCall,
+    OutputField, PriorityClass, Program, RecordField, RecordGenericParam, StateRule, StreamSpec,
+    TypeRef, WorkflowCall,
 };
 use crate::error::Span;
 
@@ -54,6 +55,7 @@ pub struct HirWorkflow {
     pub params: Vec<HirParam>,
     pub return_type: TypeRef,
     pub intent: Option<String>,
+    pub priority: Option<PriorityClass>,
     pub requires: Vec<TypeRef>,
     pub steps: Vec<HirWorkflowStep>,
     pub output: Vec<OutputField>,
@@ -65,6 +67,7 @@ pub struct HirWorkflow {
 pub struct HirWorkflowStep {
     pub id: String,
     pub call: WorkflowCall,
+    pub stream: Option<StreamSpec>,
     pub ensures: Vec<EnsureClause>,
     pub on_fail: Option<FailureAction>,
 }
@@ -166,6 +169,7 @@ pub fn lower_program(program: &Program) -> HirProgram {
                         .collect(),
                     return_type: workflow_decl.return_type.clone(),
                     intent: workflow_decl.intent.clone(),
+                    priority: workflow_decl.priority,
                     requires: workflow_decl.requires.clone(),
                     steps: workflow_decl
                         .steps
@@ -173,6 +177,7 @@ pub fn lower_program(program: &Program) -> HirProgram {
                         .map(|step| HirWorkflowStep {
                             id: step.id.clone(),
                             call: step.call.clone(),
+                            stream: step.stream.clone(),
                             ensures: step.ensures.clone(),
                             on_fail: step.on_fail.clone(),
                         })
@@ -1,12 +1,18 @@
+use std::cell::{Cell, RefCell};
 use std::collections::{HashMap, HashSet};
-use std::fs;
-use std::path::PathBuf;
-use std::sync::Arc;
+use std::sync::{Arc, OnceLock};
+use std::time::Instant;
 
-use crate::ast::{BinaryOp, Block, Expr, MatchArmBody, MatchPattern, Program, Statement, TypeRef};
+use crate::ast::{
+    BinaryOp, Block, EnsureClause, Expr, MatchArmBody, MatchPattern, PredicateOp, PredicateValue,
+    Program, Statement, TypeRef,
+};
 use crate::error::{Diagnostic, Span};
 use crate::hir::{lower_program, HirFunction};
 use crate::loader::load_source_map;
+use crate::mir::lower_hir;
+use crate::module_path;
+use crate::tier::{Tier, TierOptions, TierReport};
 
 #[derive(Debug, Clone, PartialEq, Eq)]
 pub enum Value {
@@ -110,7 +116,266 @@ impl Env {
     }
 }
 
+/// Sampling rate for runtime `ensures` checks, parsed from `KX_ENSURES_SAMPLE`.
+///
+/// `stride == 0` disables checking; otherwise every `stride`-th return of a function with
+/// `ensures` clauses is checked.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct EnsuresSampling {
+    pub stride: u64,
+}
+
+impl EnsuresSampling {
+    pub const ENV_VAR: &'static str = "KX_ENSURES_SAMPLE";
+
+    pub fn disabled() -> Self {
+        Self { stride: 0 }
+    }
+
+    pub fn every(stride: u64) -> Self {
+        Self { stride }
+    }
+
+    /// Accepts `N/M` (check N of every M returns), a bare `M` (same as `1/M`), or `off`.
+    pub fn parse(raw: &str) -> Result<Self, String> {
+        let raw = raw.trim();
+        if raw.is_empty() || raw.eq_ignore_ascii_case("off") {
+            return Ok(Self::disabled());
+        }
+
+        let invalid = || {
+            format!(
+                "invalid {} value '{raw}': expected N/M, M or off",
+                Self::ENV_VAR
+            )
+        };
+        let (hits, period) = match raw.split_once('/') {
+            Some((hits, period)) => (
+                hits.trim().parse::<u64>().map_err(|_| invalid())?,
+                period.trim().parse::<u64>().map_err(|_| invalid())?,
+            ),
+            None => (1, raw.parse::<u64>().map_err(|_| invalid())?),
+        };
+
+        if hits == 0 || period == 0 {
+            return Ok(Self::disabled());
+        }
+        Ok(Self::every((period / hits).max(1)))
+    }
+
+    pub fn from_env() -> Result<Self, String> {
+        match std::env::var(Self::ENV_VAR) {
+            Ok(raw) => Self::parse(&raw),
+            Err(_) => Ok(Self::disabled()),
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct EnsuresClauseStats {
+    pub function: String,
+    pub clause: String,
+    pub span: Span,
+    pub checked: u64,
+    pub violations: u64,
+    /// Samples where the clause could not be evaluated (unknown symbol, non-Int ordering, `in`).
+    pub skipped: u64,
+}
+
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct EnsuresReport {
+    pub samples: u64,
+    pub clauses: Vec<EnsuresClauseStats>,
+}
+
+impl EnsuresReport {
+    pub fn violations(&self) -> impl Iterator<Item = &EnsuresClauseStats> {
+        self.clauses.iter().filter(|stats| stats.violations > 0)
+    }
+}
+
+struct EnsuresSampler {
+    stride: u64,
+    countdown: Cell<u64>,
+    samples: Cell<u64>,
+    clause_base: HashMap<String, usize>,
+    stats: RefCell<Vec<EnsuresClauseStats>>,
+}
+
+impl EnsuresSampler {
+    fn new(sampling: EnsuresSampling, functions: &[HirFunction]) -> Self {
+        let mut clause_base = HashMap::new();
+        let mut stats = Vec::new();
+        if sampling.stride != 0 {
+            for function in functions.iter().filter(|f| !f.ensures.is_empty()) {
+                clause_base.insert(function.name.clone(), stats.len());
+                for ensure in &function.ensures {
+                    stats.push(EnsuresClauseStats {
+                        function: function.name.clone(),
+                        clause: format_ensure_clause(ensure),
+                        span: function.span,
+                        checked: 0,
+                        violations: 0,
+                        skipped: 0,
+                    });
+                }
+            }
+        }
+
+        Self {
+            stride: sampling.stride,
+            countdown: Cell::new(sampling.stride),
+            samples: Cell::new(0),
+            clause_base,
+            stats: RefCell::new(stats),
+        }
+    }
+
+    /// Fast path: a single countdown decrement per return when not sampling.
+    #[inline]
+    fn should_sample(&self) -> bool {
+        if self.stride == 0 {
+            return false;
+        }
+        let remaining = self.countdown.get() - 1;
+        if remaining != 0 {
+            self.countdown.set(remaining);
+            return false;
+        }
+        self.countdown.set(self.stride);
+        true
+    }
+
+    fn check(&self, function: &HirFunction, args: &[Value], output: &Value) {
+        let Some(base) = self.clause_base.get(&function.name).copied() else {
+            return;
+        };
+        self.samples.set(self.samples.get() + 1);
+
+        let mut stats = self.stats.borrow_mut();
+        for (index, ensure) in function.ensures.iter().enumerate() {
+            let entry = &mut stats[base + index];
+            match eval_ensure_clause(ensure, function, args, output) {
+                Some(true) => entry.checked += 1,
+                Some(false) => {
+                    entry.checked += 1;
+                    entry.violations += 1;
+                }
+                None => entry.skipped += 1,
+            }
+        }
+    }
+
+    fn into_report(self) -> EnsuresReport {
+        EnsuresReport {
+            samples: self.samples.get(),
+            clauses: self.stats.into_inner(),
+        }
+    }
+}
+
+fn eval_ensure_clause(
+    ensure: &EnsureClause,
+    function: &HirFunction,
+    args: &[Value],
+    output: &Value,
+) -> Option<bool> {
+    let left = eval_predicate_value(&ensure.left, function, args, output)?;
+    let right = eval_predicate_value(&ensure.right, function, args, output)?;
+    match ensure.op {
+        PredicateOp::Eq => Some(left == right),
+        PredicateOp::NotEq => Some(left != right),
+        PredicateOp::Lt | PredicateOp::Lte | PredicateOp::Gt | PredicateOp::Gte => {
+            let (Value::Int(left), Value::Int(right)) = (left, right) else {
+                return None;
+            };
+            Some(match ensure.op {
+                PredicateOp::Lt => left < right,
+                PredicateOp::Lte => left <= right,
+                PredicateOp::Gt => left > right,
+                _ => left >= right,
+            })
+        }
+        PredicateOp::In => None,
+    }
+}
+
+fn eval_predicate_value(
+    value: &PredicateValue,
+    function: &HirFunction,
+    args: &[Value],
+    output: &Value,
+) -> Option<Value> {
+    match value {
+        PredicateValue::String(text) => Some(Value::Text(text.clone())),
+        PredicateValue::Number(number) => number.parse::<i64>().ok().map(Value::Int),
+        PredicateValue::Path(segments) => {
+            let (root, fields) = segments.split_first()?;
+            let mut current = if root == "output" {
+                output.clone()
+            } else {
+                let index = function
+                    .params
+                    .iter()
+                    .position(|param| param.name == *root)?;
+                args.get(index)?.clone()
+            };
+            for field in fields {
+                let Value::Record { fields, .. } = &current else {
+                    return None;
+                };
+                let (_, next) = fields.iter().find(|(name, _)| name == field)?;
+                current = next.as_ref().clone();
+            }
+            Some(current)
+        }
+    }
+}
+
+fn format_ensure_clause(ensure: &EnsureClause) -> String {
+    let value = |value: &PredicateValue| match value {
+        PredicateValue::Path(segments) => segments.join("."),
+        PredicateValue::String(text) => format!("\"{text}\""),
+        PredicateValue::Number(number) => number.clone(),
+    };
+    let op = match ensure.op {
+        PredicateOp::Eq => "==",
+        PredicateOp::NotEq => "!=",
+        PredicateOp::Lt => "<",
+        PredicateOp::Lte => "<=",
+        PredicateOp::Gt => ">",
+        PredicateOp::Gte => ">=",
+        PredicateOp::In => "in",
+    };
+    format!("{} {} {}", value(&ensure.left), op, value(&ensure.right))
+}
+
 pub fn run_program(program: &Program) -> Result<Value, Diagnostic> {
+    run_program_with_ensures(program, EnsuresSampling::disabled()).map(|(value, _)| value)
+}
+
+pub fn run_program_with_ensures(
+    program: &Program,
+    sampling: EnsuresSampling,
+) -> Result<(Value, EnsuresReport), Diagnostic> {
+    run_program_with_engine(program, sampling, None).map(|(value, ensures, _)| (value, ensures))
+}
+
+/// Interprets `program`, tiering hot scalar functions up to native code (see [`crate::tier`]).
+pub fn run_program_tiered(
+    program: &Program,
+    sampling: EnsuresSampling,
+    options: TierOptions,
+) -> Result<(Value, EnsuresReport, TierReport), Diagnostic> {
+    run_program_with_engine(program, sampling, Some(options))
+        .map(|(value, ensures, tier)| (value, ensures, tier.unwrap_or_default()))
+}
+
+fn run_program_with_engine(
+    program: &Program,
+    sampling: EnsuresSampling,
+    tier: Option<TierOptions>,
+) -> Result<(Value, EnsuresReport, Option<TierReport>), Diagnostic> {
     let hir = lower_program(program);
     let mut functions: HashMap<String, HirFunction> = HashMap::new();
     for function in &hir.functions {
@@ -163,17 +428,51 @@ pub fn run_program(program: &Program) -> Result<Value, Diagnostic> {
         ));
     }
 
-    eval_function(main, &functions, &variants, &[], 0)
+    let contracts = EnsuresSampler::new(sampling, &hir.functions);
+    let mut tier_failure = None;
+    if let Some(options) = tier {
+        // Programs outside the MIR subset still run, just without tier-up.
+        match lower_hir(&hir) {
+            Ok(mir) => {
+                let pinned: HashSet<String> = contracts.clause_base.keys().cloned().collect();
+                TIER.with(|slot| *slot.borrow_mut() = Some(Tier::new(&mir, &pinned, options)));
+            }
+            Err(errors) => {
+                tier_failure = Some(format!(
+                    "tiering disabled: {}",
+                    errors
+                        .first()
+                        .map(|error| error.message.as_str())
+                        .unwrap_or("MIR lowering failed")
+                ));
+            }
+        }
+    }
+
+    let value = eval_function(main, &functions, &variants, &contracts, &[], 0);
+    let tier_report = tier.map(|_| {
+        let mut report = TIER
+            .with(|slot| slot.borrow_mut().take())
+            .map(Tier::into_report)
+            .unwrap_or_default();
+        report.failures.extend(tier_failure);
+        report
+    });
+    Ok((value?, contracts.into_report(), tier_report))
 }
 
+/// Deepest call the interpreter evaluates before reporting a stack overflow (tiered native code
+/// enforces the same limit).
+pub(crate) const MAX_CALL_DEPTH: usize = 1024;
+
 fn eval_function(
     function: &HirFunction,
     functions: &HashMap<String, HirFunction>,
     variants: &VariantRegistry,
+    contracts: &EnsuresSampler,
     args: &[Value],
     depth: usize,
 ) -> Result<Value, Diagnostic> {
-    const MAX_CALL_DEPTH: usize = 1024;
     if depth > MAX_CALL_DEPTH {
         return Err(Diagnostic::error(
             format!(
@@ -184,6 +483,14 @@ fn eval_function(
         ));
     }
 
+    if let Some(value) = TIER.with(|slot| {
+        slot.borrow_mut()
+            .as_mut()?
+            .call(&function.name, args, depth)
+    }) {
+        return Ok(value);
+    }
+
     if !function.effects.is_empty() {
         return Err(Diagnostic::error(
             format!(
@@ -248,11 +555,27 @@ fn eval_function(
                     ));
                 }
 
-                let value = eval_expr(&stmt.value, function, functions, variants, &mut env, depth)?;
+                let value = eval_expr(
+                    &stmt.value,
+                    function,
+                    functions,
+                    variants,
+                    contracts,
+                    &mut env,
+                    depth,
+                )?;
                 env.insert(stmt.name.clone(), value);
             }
             Statement::Assign(stmt) => {
-                let value = eval_expr(&stmt.value, function, functions, variants, &mut env, depth)?;
+                let value = eval_expr(
+                    &stmt.value,
+                    function,
+                    functions,
+                    variants,
+                    contracts,
+                    &mut env,
+                    depth,
+                )?;
                 if !env.assign(&stmt.name, value) {
                     return Err(Diagnostic::error(
                         format!(
@@ -265,13 +588,17 @@ fn eval_function(
             }
             Statement::Return(stmt) => {
                 returned = Some(match &stmt.value {
-                    Some(expr) => eval_expr(expr, function, functions, variants, &mut env, depth)?,
+                    Some(expr) => eval_expr(
+                        expr, function, functions, variants, contracts, &mut env, depth,
+                    )?,
                     None => Value::Unit,
                 });
                 break;
             }
             Statement::Expr(expr) => {
-                let _ = eval_expr(expr, function, functions, variants, &mut env, depth)?;
+                let _ = eval_expr(
+                    expr, function, functions, variants, contracts, &mut env, depth,
+                )?;
             }
         }
     }
@@ -279,12 +606,17 @@ fn eval_function(
     let value = if let Some(value) = returned {
         value
     } else if let Some(expr) = &body.tail {
-        eval_expr(expr, function, functions, variants, &mut env, depth)?
+        eval_expr(
+            expr, function, functions, variants, contracts, &mut env, depth,
+        )?
     } else {
         Value::Unit
     };
 
     if function.return_type.head() == "Unit" {
+        if !function.ensures.is_empty() && contracts.should_sample() {
+            contracts.check(function, args, &Value::Unit);
+        }
         return Ok(Value::Unit);
     }
 
@@ -300,6 +632,10 @@ fn eval_function(
         ));
     }
 
+    if !function.ensures.is_empty() && contracts.should_sample() {
+        contracts.check(function, args, &value);
+    }
+
     Ok(value)
 }
 
@@ -355,6 +691,173 @@ fn eval_intrinsic_function(
             }
             Ok(option_some(Value::Text(s[start..end].to_string())))
         }
+        "text_byte" => {
+            let [Value::Text(s), Value::Int(index)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "text_byte expects (Text, Int)",
+                    function.span,
+                )));
+            };
+            let byte = usize::try_from(*index)
+                .ok()
+                .and_then(|idx| s.as_bytes().get(idx).copied())
+                .unwrap_or(0);
+            Ok(Value::Int(byte as i64))
+        }
+        "text_sub" => {
+            let [Value::Text(s), Value::Int(start), Value::Int(end)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "text_sub expects (Text, Int, Int)",
+                    function.span,
+                )));
+            };
+            let sub = match (usize::try_from(*start), usize::try_from(*end)) {
+                (Ok(start), Ok(end)) => s.get(start..end).unwrap_or(""),
+                _ => "",
+            };
+            Ok(Value::Text(sub.to_string()))
+        }
+        "text_scan_ident" => {
+            let [Value::Text(s), Value::Int(start)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "text_scan_ident expects (Text, Int)",
+                    function.span,
+                )));
+            };
+            let bytes = s.as_bytes();
+            let mut pos = usize::try_from(*start).unwrap_or(0).min(bytes.len());
+            while pos < bytes.len() && is_ascii_ident_continue(bytes[pos] as i64) {
+                pos += 1;
+            }
+            Ok(Value::Int(pos as i64))
+        }
+        "text_skip_trivia" => {
+            let [Value::Text(s), Value::Int(start)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "text_skip_trivia expects (Text, Int)",
+                    function.span,
+                )));
+            };
+            let pos = usize::try_from(*start).unwrap_or(0).min(s.len());
+            Ok(Value::Int(skip_trivia(s.as_bytes(), pos) as i64))
+        }
+        "int_buf_new" => {
+            let [] = args else {
+                return Some(Err(Diagnostic::error(
+                    "int_buf_new expects ()",
+                    function.span,
+                )));
+            };
+            Ok(Value::Int(INT_BUFFERS.with(|buffers| {
+                let mut buffers = buffers.borrow_mut();
+                buffers.push(Vec::new());
+                buffers.len() as i64
+            })))
+        }
+        "int_buf_push" => {
+            let [Value::Int(handle), Value::Int(value)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "int_buf_push expects (Int, Int)",
+                    function.span,
+                )));
+            };
+            let len = INT_BUFFERS.with(|buffers| {
+                let mut buffers = buffers.borrow_mut();
+                let buffer = int_buffer_index(*handle).and_then(|idx| buffers.get_mut(idx))?;
+                buffer.push(*value);
+                Some(buffer.len() as i64)
+            });
+            match len {
+                Some(len) => Ok(Value::Int(len)),
+                None => Err(Diagnostic::error(
+                    format!("int_buf_push: invalid buffer handle {handle}"),
+                    function.span,
+                )),
+            }
+        }
+        "int_buf_get" => {
+            let [Value::Int(handle), Value::Int(index)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "int_buf_get expects (Int, Int)",
+                    function.span,
+                )));
+            };
+            let value = INT_BUFFERS.with(|buffers| {
+                let buffers = buffers.borrow();
+                let buffer = int_buffer_index(*handle).and_then(|idx| buffers.get(idx));
+                let index = usize::try_from(*index).ok();
+                buffer
+                    .zip(index)
+                    .and_then(|(buffer, index)| buffer.get(index).copied())
+                    .unwrap_or(0)
+            });
+            Ok(Value::Int(value))
+        }
+        "int_buf_pop" => {
+            let [Value::Int(handle)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "int_buf_pop expects (Int)",
+                    function.span,
+                )));
+            };
+            let value = INT_BUFFERS.with(|buffers| {
+                let mut buffers = buffers.borrow_mut();
+                int_buffer_index(*handle)
+                    .and_then(|idx| buffers.get_mut(idx))
+                    .and_then(|buffer| buffer.pop())
+                    .unwrap_or(0)
+            });
+            Ok(Value::Int(value))
+        }
+        "int_buf_len" => {
+            let [Value::Int(handle)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "int_buf_len expects (Int)",
+                    function.span,
+                )));
+            };
+            let len = INT_BUFFERS.with(|buffers| {
+                let buffers = buffers.borrow();
+                int_buffer_index(*handle)
+                    .and_then(|idx| buffers.get(idx))
+                    .map_or(0, |buffer| buffer.len() as i64)
+            });
+            Ok(Value::Int(len))
+        }
+        "text_intern_new" => {
+            let [] = args else {
+                return Some(Err(Diagnostic::error(
+                    "text_intern_new expects ()",
+                    function.span,
+                )));
+            };
+            Ok(Value::Int(INTERN_TABLES.with(|tables| {
+                let mut tables = tables.borrow_mut();
+                tables.push(HashMap::new());
+                tables.len() as i64
+            })))
+        }
+        "text_intern" => {
+            let [Value::Int(handle), Value::Text(key)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "text_intern expects (Int, Text)",
+                    function.span,
+                )));
+            };
+            let id = INTERN_TABLES.with(|tables| {
+                let mut tables = tables.borrow_mut();
+                let table = int_buffer_index(*handle).and_then(|idx| tables.get_mut(idx))?;
+                let next = table.len() as i64 + 1;
+                Some(*table.entry(key.clone()).or_insert(next))
+            });
+            match id {
+                Some(id) => Ok(Value::Int(id)),
+                None => Err(Diagnostic::error(
+                    format!("text_intern: invalid table handle {handle}"),
+                    function.span,
+                )),
+            }
+        }
         "text_starts_with" => {
             let [Value::Text(s), Value::Text(prefix)] = args else {
                 return Some(Err(Diagnostic::error(
@@ -444,24 +947,9 @@ fn eval_intrinsic_function(
                 )));
             };
 
-            let mut entry = PathBuf::from(path);
-            if entry.extension().is_none() {
-                entry.set_extension("kooix");
-            }
-
-            if fs::metadata(&entry).is_err() {
-                // Tests (and some tooling) execute with cwd = `crates/kooixc`, while most CLI usage
-                // runs from repo root. Make this intrinsic resilient by searching parent dirs.
-                let mut prefix = PathBuf::new();
-                for _ in 0..8 {
-                    prefix.push("..");
-                    let candidate = prefix.join(&entry);
-                    if fs::metadata(&candidate).is_ok() {
-                        entry = candidate;
-                        break;
-                    }
-                }
-            }
+            // Tests (and some tooling) execute with cwd = `crates/kooixc`, while most CLI usage
+            // runs from repo root; the module search roots cover both.
+            let entry = module_path::resolve_module(path);
 
             match load_source_map(&entry) {
                 Ok(map) => Ok(result_ok(Value::Text(map.combined))),
@@ -507,23 +995,7 @@ fn eval_intrinsic_function(
                 )));
             };
 
-            let mut entry = PathBuf::from(path);
-            if entry.extension().is_none() {
-                entry.set_extension("kooix");
-            }
-
-            if fs::metadata(&entry).is_err() {
-                // Mirror host_load_source_map behavior for tests: search parent dirs.
-                let mut prefix = PathBuf::new();
-                for _ in 0..8 {
-                    prefix.push("..");
-                    let candidate = prefix.join(&entry);
-                    if fs::metadata(&candidate).is_ok() {
-                        entry = candidate;
-                        break;
-                    }
-                }
-            }
+            let entry = module_path::resolve_module(path);
 
             match std::fs::read_to_string(&entry) {
                 Ok(content) => Ok(result_ok(Value::Text(content))),
@@ -533,6 +1005,16 @@ fn eval_intrinsic_function(
                 )))),
             }
         }
+        "host_resolve_import" => {
+            let [Value::Text(base_dir), Value::Text(raw)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "host_resolve_import expects (Text, Text)",
+                    function.span,
+                )));
+            };
+            let resolved = module_path::resolve_import(std::path::Path::new(base_dir), raw);
+            Ok(Value::Text(resolved.to_string_lossy().into_owned()))
+        }
         "host_link_llvm_ir_file" => {
             let [Value::Text(ir_path), Value::Text(out_path)] = args else {
                 return Some(Err(Diagnostic::error(
@@ -560,6 +1042,58 @@ fn eval_intrinsic_function(
                 )))),
             }
         }
+        "host_fork" => {
+            let [] = args else {
+                return Some(Err(Diagnostic::error(
+                    "host_fork expects ()",
+                    function.span,
+                )));
+            };
+            // No process isolation in the interpreter: report "unsupported" so callers run inline.
+            Ok(Value::Int(-1))
+        }
+        "host_wait" => {
+            let [Value::Int(_pid)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "host_wait expects (Int)",
+                    function.span,
+                )));
+            };
+            Ok(Value::Int(-1))
+        }
+        "host_exit" => {
+            let [Value::Int(code)] = args else {
+                return Some(Err(Diagnostic::error(
+                    "host_exit expects (Int)",
+                    function.span,
+                )));
+            };
+            Err(Diagnostic::error(
+                format!("host_exit({code}) is only supported by native builds"),
+                function.span,
+            ))
+        }
+        "host_now_ns" => {
+            let [] = args else {
+                return Some(Err(Diagnostic::error(
+                    "host_now_ns expects ()",
+                    function.span,
+                )));
+            };
+            static ORIGIN: OnceLock<Instant> = OnceLock::new();
+            let elapsed = ORIGIN.get_or_init(Instant::now).elapsed();
+            Ok(Value::Int(elapsed.as_nanos() as i64))
+        }
+        "host_heap_bytes" => {
+            let [] = args else {
+                return Some(Err(Diagnostic::error(
+                    "host_heap_bytes expects ()",
+                    function.span,
+                )));
+            };
+            // Interpreter values live on the Rust heap, which is not attributed to the program.
+            Ok(Value::Int(0))
+        }
         "host_argc" => {
             if !args.is_empty() {
                 return Some(Err(Diagnostic::error(
@@ -649,6 +1183,34 @@ fn is_ascii_ident_continue(b: i64) -> bool {
     is_ascii_alnum(b) || matches!(normalize_byte(b), Some(b'_'))
 }
 
+/// Skips ASCII whitespace and `//` line comments (same trivia as the Stage1 lexer).
+fn skip_trivia(bytes: &[u8], mut pos: usize) -> usize {
+    loop {
+        match bytes.get(pos) {
+            Some(b) if is_ascii_whitespace(*b as i64) => pos += 1,
+            Some(b'/') if bytes.get(pos + 1) == Some(&b'/') => {
+                while pos < bytes.len() && bytes[pos] != b'\n' {
+                    pos += 1;
+                }
+            }
+            _ => return pos,
+        }
+    }
+}
+
+thread_local! {
+    // Host-side storage behind the `int_buf_*` intrinsics; handle = index + 1.
+    static INT_BUFFERS: RefCell<Vec<Vec<i64>>> = const { RefCell::new(Vec::new()) };
+    // Host-side storage behind the `text_intern*` intrinsics; same handle scheme.
+    static INTERN_TABLES: RefCell<Vec<HashMap<String, i64>>> = const { RefCell::new(Vec::new()) };
+    // Tier-up state for `run_program_tiered`; `None` for plain interpretation.
+    static TIER: RefCell<Option<Tier>> = const { RefCell::new(None) };
+}
+
+fn int_buffer_index(handle: i64) -> Option<usize> {
+    usize::try_from(handle).ok()?.checked_sub(1)
+}
+
 fn value_conforms_to_type_in_function(value: &Value, ty: &TypeRef, function: &HirFunction) -> bool {
     if ty.args.is_empty()
         && function
@@ -667,6 +1229,7 @@ fn eval_expr(
     function: &HirFunction,
     functions: &HashMap<String, HirFunction>,
     variants: &VariantRegistry,
+    contracts: &EnsuresSampler,
     env: &mut Env,
     depth: usize,
 ) -> Result<Value, Diagnostic> {
@@ -682,7 +1245,15 @@ fn eval_expr(
         Expr::RecordLit { ty, fields } => {
             let mut values: Vec<(String, Arc<Value>)> = Vec::new();
             for field in fields {
-                let value = eval_expr(&field.value, function, functions, variants, env, depth)?;
+                let value = eval_expr(
+                    &field.value,
+                    function,
+                    functions,
+                    variants,
+                    contracts,
+                    env,
+                    depth,
+                )?;
                 if let Some((_, slot)) = values.iter_mut().find(|(name, _)| name == &field.name) {
                     *slot = Arc::new(value);
                 } else {
@@ -808,10 +1379,19 @@ fn eval_expr(
                 if let Some(callee) = functions.get(name) {
                     let mut values = Vec::new();
                     for arg in args {
-                        values.push(eval_expr(arg, function, functions, variants, env, depth)?);
+                        values.push(eval_expr(
+                            arg, function, functions, variants, contracts, env, depth,
+                        )?);
                     }
 
-                    return eval_function(callee, functions, variants, &values, depth + 1);
+                    return eval_function(
+                        callee,
+                        functions,
+                        variants,
+                        contracts,
+                        &values,
+                        depth + 1,
+                    );
                 }
             }
 
@@ -876,7 +1456,7 @@ fn eval_expr(
                 }
 
                 Some(Arc::new(eval_expr(
-                    &args[0], function, functions, variants, env, depth,
+                    &args[0], function, functions, variants, contracts, env, depth,
                 )?))
             } else {
                 if !args.is_empty() {
@@ -903,7 +1483,7 @@ fn eval_expr(
             then_block,
             else_block,
         } => {
-            let cond_value = eval_expr(cond, function, functions, variants, env, depth)?;
+            let cond_value = eval_expr(cond, function, functions, variants, contracts, env, depth)?;
             let Value::Bool(flag) = cond_value else {
                 return Err(Diagnostic::error(
                     format!(
@@ -920,11 +1500,20 @@ fn eval_expr(
                     function,
                     functions,
                     variants,
+                    contracts,
                     env,
                     depth,
                 )
             } else if let Some(block) = else_block {
-                eval_block_expr(block.as_ref(), function, functions, variants, env, depth)
+                eval_block_expr(
+                    block.as_ref(),
+                    function,
+                    functions,
+                    variants,
+                    contracts,
+                    env,
+                    depth,
+                )
             } else {
                 Ok(Value::Unit)
             }
@@ -934,8 +1523,15 @@ fn eval_expr(
             let mut iterations = 0usize;
 
             loop {
-                let cond_value =
-                    eval_expr(cond.as_ref(), function, functions, variants, env, depth)?;
+                let cond_value = eval_expr(
+                    cond.as_ref(),
+                    function,
+                    functions,
+                    variants,
+                    contracts,
+                    env,
+                    depth,
+                )?;
                 let Value::Bool(flag) = cond_value else {
                     return Err(Diagnostic::error(
                         format!(
@@ -961,13 +1557,29 @@ fn eval_expr(
                     ));
                 }
 
-                let _ = eval_block_expr(body.as_ref(), function, functions, variants, env, depth)?;
+                let _ = eval_block_expr(
+                    body.as_ref(),
+                    function,
+                    functions,
+                    variants,
+                    contracts,
+                    env,
+                    depth,
+                )?;
             }
 
             Ok(Value::Unit)
         }
         Expr::Match { value, arms } => {
-            let scrutinee = eval_expr(value.as_ref(), function, functions, variants, env, depth)?;
+            let scrutinee = eval_expr(
+                value.as_ref(),
+                function,
+                functions,
+                variants,
+                contracts,
+                env,
+                depth,
+            )?;
 
             for arm in arms {
                 let is_match = match &arm.pattern {
@@ -1107,10 +1719,10 @@ fn eval_expr(
 
                 let result = match &arm.body {
                     MatchArmBody::Expr(expr) => {
-                        eval_expr(expr, function, functions, variants, env, depth)
+                        eval_expr(expr, function, functions, variants, contracts, env, depth)
                     }
                     MatchArmBody::Block(block) => {
-                        eval_block_expr(block, function, functions, variants, env, depth)
+                        eval_block_expr(block, function, functions, variants, contracts, env, depth)
                     }
                 };
 
@@ -1124,8 +1736,9 @@ fn eval_expr(
             ))
         }
         Expr::Binary { op, left, right } => {
-            let left_value = eval_expr(left, function, functions, variants, env, depth)?;
-            let right_value = eval_expr(right, function, functions, variants, env, depth)?;
+            let left_value = eval_expr(left, function, functions, variants, contracts, env, depth)?;
+            let right_value =
+                eval_expr(right, function, functions, variants, contracts, env, depth)?;
 
             match op {
                 BinaryOp::Add => match (left_value, right_value) {
@@ -1161,6 +1774,7 @@ fn eval_block_expr(
     function: &HirFunction,
     functions: &HashMap<String, HirFunction>,
     variants: &VariantRegistry,
+    contracts: &EnsuresSampler,
     env: &mut Env,
     depth: usize,
 ) -> Result<Value, Diagnostic> {
@@ -1180,11 +1794,27 @@ fn eval_block_expr(
                         ));
                     }
 
-                    let value = eval_expr(&stmt.value, function, functions, variants, env, depth)?;
+                    let value = eval_expr(
+                        &stmt.value,
+                        function,
+                        functions,
+                        variants,
+                        contracts,
+                        env,
+                        depth,
+                    )?;
                     env.insert(stmt.name.clone(), value);
                 }
                 Statement::Assign(stmt) => {
-                    let value = eval_expr(&stmt.value, function, functions, variants, env, depth)?;
+                    let value = eval_expr(
+                        &stmt.value,
+                        function,
+                        functions,
+                        variants,
+                        contracts,
+                        env,
+                        depth,
+                    )?;
                     if !env.assign(&stmt.name, value) {
                         return Err(Diagnostic::error(
                             format!(
@@ -1202,13 +1832,13 @@ fn eval_block_expr(
                     ));
                 }
                 Statement::Expr(expr) => {
-                    let _ = eval_expr(expr, function, functions, variants, env, depth)?;
+                    let _ = eval_expr(expr, function, functions, variants, contracts, env, depth)?;
                 }
             }
         }
 
         if let Some(expr) = &block.tail {
-            eval_expr(expr, function, functions, variants, env, depth)
+            eval_expr(expr, function, functions, variants, contracts, env, depth)
         } else {
             Ok(Value::Unit)
         }
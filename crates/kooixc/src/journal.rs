@@ -0,0 +1,333 @@
+//! Checkpoint journal for the workflow runtime.
+//!
+//! Every completed step appends one record keyed by its instance (`<workflow>#<invocation>`, plus
+//! `/<step>` per nested workflow level) and step id. Re-running an instance with the same key, in
+//! the same process or after a restart, replays journaled steps instead of calling their targets
+//! again, so `on_fail -> retry` of a nested workflow and a rerun after a crash resume where the
+//! last attempt stopped.
+//!
+//! Layout: a 16-byte header (`KXJRNL01` magic, committed length as little-endian `u64`) followed
+//! by records `[payload_len: u32][fnv1a64(payload): u64][payload]`, where the payload is
+//! `[instance_len: u32][instance][step_len: u32][step][value]`. A record is written into the
+//! mapping before the header's committed length is bumped past it, so a torn append is simply not
+//! committed. Opening scans the committed range and stops at the first record whose checksum does
+//! not match; later appends overwrite from there.
+
+use std::collections::HashMap;
+use std::fs::{File, OpenOptions};
+use std::io::Read;
+use std::path::{Path, PathBuf};
+
+use crate::util::Fnv1a64;
+
+const MAGIC: &[u8; 8] = b"KXJRNL01";
+const HEADER_LEN: usize = 16;
+const RECORD_HEADER_LEN: usize = 12;
+const INITIAL_CAPACITY: usize = 64 * 1024;
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct JournalStats {
+    /// Records found intact when the journal was opened.
+    pub recovered: u64,
+    /// Committed bytes dropped at open because a record failed its checksum.
+    pub discarded_bytes: u64,
+    /// Steps appended during this run.
+    pub recorded: u64,
+    /// Steps served from the journal instead of being executed.
+    pub replayed: u64,
+    /// Appends dropped because the journal file could not grow; those steps rerun next time.
+    pub failed_appends: u64,
+}
+
+pub struct Journal {
+    path: PathBuf,
+    file: File,
+    map: map::Mapping,
+    committed: usize,
+    entries: HashMap<(String, String), String>,
+    stats: JournalStats,
+}
+
+impl Journal {
+    pub fn open(path: impl AsRef<Path>) -> Result<Self, String> {
+        let path = path.as_ref().to_path_buf();
+        let error = |action: &str, error: std::io::Error| {
+            format!("failed to {action} journal {}: {error}", path.display())
+        };
+        let file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(false)
+            .open(&path)
+            .map_err(|e| error("open", e))?;
+        let len = file.metadata().map_err(|e| error("stat", e))?.len() as usize;
+        // Only a new file, or one already carrying the magic (or the zeroed header of an open
+        // that stopped before writing it), may be resized and mapped.
+        let mut head = vec![0; len.min(MAGIC.len())];
+        (&file)
+            .read_exact(&mut head)
+            .map_err(|e| error("read", e))?;
+        if !(head.is_empty() || head == MAGIC || head == [0; 8]) {
+            return Err(format!(
+                "{} is not a kooix workflow journal",
+                path.display()
+            ));
+        }
+        // Mapping past the end of the file would fault, so size the file first.
+        let capacity = len.max(INITIAL_CAPACITY);
+        if len < capacity {
+            file.set_len(capacity as u64)
+                .map_err(|e| error("size", e))?;
+        }
+        let mut map = map::Mapping::new(&file, capacity).map_err(|e| error("map", e))?;
+
+        let bytes = map.bytes_mut();
+        if bytes[..8] != *MAGIC {
+            bytes[..8].copy_from_slice(MAGIC);
+            bytes[8..HEADER_LEN].copy_from_slice(&(HEADER_LEN as u64).to_le_bytes());
+        }
+
+        let claimed = (u64_at(bytes, 8) as usize).clamp(HEADER_LEN, capacity);
+        let mut entries = HashMap::new();
+        let mut offset = HEADER_LEN;
+        while let Some((next, instance, step, value)) = decode_record(&bytes[..claimed], offset) {
+            entries.insert((instance, step), value);
+            offset = next;
+        }
+        let stats = JournalStats {
+            recovered: entries.len() as u64,
+            discarded_bytes: (claimed - offset) as u64,
+            ..JournalStats::default()
+        };
+        bytes[8..HEADER_LEN].copy_from_slice(&(offset as u64).to_le_bytes());
+
+        Ok(Self {
+            path,
+            file,
+            map,
+            committed: offset,
+            entries,
+            stats,
+        })
+    }
+
+    pub fn get(&self, instance: &str, step: &str) -> Option<&str> {
+        self.entries
+            .get(&(instance.to_string(), step.to_string()))
+            .map(String::as_str)
+    }
+
+    /// `get` that counts a hit as a replay.
+    pub fn replay(&mut self, instance: &str, step: &str) -> Option<String> {
+        let value = self.get(instance, step)?.to_string();
+        self.stats.replayed += 1;
+        Some(value)
+    }
+
+    /// Journal write failures never fail the step itself; they are counted in `failed_appends`.
+    pub fn append(&mut self, instance: &str, step: &str, value: &str) {
+        let record = encode_record(instance, step, value);
+        let end = self.committed + record.len();
+        if end > self.map.len() {
+            let capacity = end.max(self.map.len() * 2);
+            let grown = self
+                .file
+                .set_len(capacity as u64)
+                .and_then(|_| self.map.remap(&self.file, capacity));
+            if grown.is_err() {
+                self.stats.failed_appends += 1;
+                return;
+            }
+        }
+        let bytes = self.map.bytes_mut();
+        bytes[self.committed..end].copy_from_slice(&record);
+        bytes[8..HEADER_LEN].copy_from_slice(&(end as u64).to_le_bytes());
+        self.committed = end;
+        self.entries
+            .insert((instance.to_string(), step.to_string()), value.to_string());
+        self.stats.recorded += 1;
+    }
+
+    /// Flushes the mapping to disk. Appends already survive a process crash without it.
+    pub fn sync(&self) -> Result<(), String> {
+        self.map
+            .sync(&self.file)
+            .map_err(|error| format!("failed to sync journal {}: {error}", self.path.display()))
+    }
+
+    pub fn stats(&self) -> JournalStats {
+        self.stats
+    }
+}
+
+impl Drop for Journal {
+    fn drop(&mut self) {
+        let _ = self.sync();
+    }
+}
+
+fn encode_record(instance: &str, step: &str, value: &str) -> Vec<u8> {
+    let mut payload = Vec::with_capacity(8 + instance.len() + step.len() + value.len());
+    payload.extend_from_slice(&(instance.len() as u32).to_le_bytes());
+    payload.extend_from_slice(instance.as_bytes());
+    payload.extend_from_slice(&(step.len() as u32).to_le_bytes());
+    payload.extend_from_slice(step.as_bytes());
+    payload.extend_from_slice(value.as_bytes());
+
+    let mut record = Vec::with_capacity(RECORD_HEADER_LEN + payload.len());
+    record.extend_from_slice(&(payload.len() as u32).to_le_bytes());
+    record.extend_from_slice(&checksum(&payload).to_le_bytes());
+    record.extend_from_slice(&payload);
+    record
+}
+
+/// The record at `offset` and the offset after it, or `None` at the end or at a corrupt record.
+fn decode_record(bytes: &[u8], offset: usize) -> Option<(usize, String, String, String)> {
+    let header = bytes.get(offset..offset + RECORD_HEADER_LEN)?;
+    let len = u32::from_le_bytes(header[..4].try_into().ok()?) as usize;
+    let payload = bytes.get(offset + RECORD_HEADER_LEN..offset + RECORD_HEADER_LEN + len)?;
+    if checksum(payload) != u64_at(header, 4) {
+        return None;
+    }
+    let (instance, rest) = take_field(payload)?;
+    let (step, value) = take_field(rest)?;
+    Some((
+        offset + RECORD_HEADER_LEN + len,
+        String::from_utf8(instance.to_vec()).ok()?,
+        String::from_utf8(step.to_vec()).ok()?,
+        String::from_utf8(value.to_vec()).ok()?,
+    ))
+}
+
+fn take_field(bytes: &[u8]) -> Option<(&[u8], &[u8])> {
+    let len = u32::from_le_bytes(bytes.get(..4)?.try_into().ok()?) as usize;
+    let field = bytes.get(4..4 + len)?;
+    Some((field, &bytes[4 + len..]))
+}
+
+fn checksum(payload: &[u8]) -> u64 {
+    let mut hash = Fnv1a64::new();
+    hash.write(payload);
+    hash.finish()
+}
+
+fn u64_at(bytes: &[u8], offset: usize) -> u64 {
+    u64::from_le_bytes(bytes[offset..offset + 8].try_into().unwrap())
+}
+
+#[cfg(unix)]
+mod map {
+    use std::fs::File;
+    use std::io;
+    use std::os::raw::c_int;
+    use std::os::unix::io::AsRawFd;
+    use std::ptr;
+
+    use crate::util::mman::{mmap, msync, munmap, MAP_FAILED, MAP_SHARED, PROT_READ, PROT_WRITE};
+
+    #[cfg(target_os = "linux")]
+    const MS_SYNC: c_int = 4;
+    #[cfg(not(target_os = "linux"))]
+    const MS_SYNC: c_int = 0x10;
+
+    /// Shared read-write mapping of the whole journal file.
+    pub struct Mapping {
+        ptr: *mut u8,
+        len: usize,
+    }
+
+    // The mapping is only touched through `&mut Journal` (the runtime keeps it behind a mutex).
+    unsafe impl Send for Mapping {}
+
+    impl Mapping {
+        pub fn new(file: &File, len: usize) -> io::Result<Self> {
+            let ptr = unsafe {
+                mmap(
+                    ptr::null_mut(),
+                    len,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED,
+                    file.as_raw_fd(),
+                    0,
+                )
+            };
+            if ptr == MAP_FAILED {
+                return Err(io::Error::last_os_error());
+            }
+            Ok(Self {
+                ptr: ptr.cast(),
+                len,
+            })
+        }
+
+        pub fn remap(&mut self, file: &File, len: usize) -> io::Result<()> {
+            let grown = Self::new(file, len)?;
+            *self = grown;
+            Ok(())
+        }
+
+        pub fn len(&self) -> usize {
+            self.len
+        }
+
+        pub fn bytes_mut(&mut self) -> &mut [u8] {
+            unsafe { std::slice::from_raw_parts_mut(self.ptr, self.len) }
+        }
+
+        pub fn sync(&self, _file: &File) -> io::Result<()> {
+            if unsafe { msync(self.ptr.cast(), self.len, MS_SYNC) } != 0 {
+                return Err(io::Error::last_os_error());
+            }
+            Ok(())
+        }
+    }
+
+    impl Drop for Mapping {
+        fn drop(&mut self) {
+            unsafe {
+                munmap(self.ptr.cast(), self.len);
+            }
+        }
+    }
+}
+
+/// Without `mmap`, the journal is an in-memory image written back by `sync` (and on drop).
+#[cfg(not(unix))]
+mod map {
+    use std::fs::File;
+    use std::io::{self, Read, Seek, SeekFrom, Write};
+
+    pub struct Mapping {
+        bytes: Vec<u8>,
+    }
+
+    impl Mapping {
+        pub fn new(file: &File, len: usize) -> io::Result<Self> {
+            let mut bytes = Vec::with_capacity(len);
+            (&*file).seek(SeekFrom::Start(0))?;
+            (&*file).read_to_end(&mut bytes)?;
+            bytes.resize(len, 0);
+            Ok(Self { bytes })
+        }
+
+        pub fn remap(&mut self, _file: &File, len: usize) -> io::Result<()> {
+            self.bytes.resize(len, 0);
+            Ok(())
+        }
+
+        pub fn len(&self) -> usize {
+            self.bytes.len()
+        }
+
+        pub fn bytes_mut(&mut self) -> &mut [u8] {
+            &mut self.bytes
+        }
+
+        pub fn sync(&self, file: &File) -> io::Result<()> {
+            (&*file).seek(SeekFrom::Start(0))?;
+            (&*file).write_all(&self.bytes)?;
+            file.sync_data()
+        }
+    }
+}
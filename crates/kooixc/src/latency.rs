@@ -0,0 +1,302 @@
+use std::collections::{HashMap, HashSet};
+use std::fmt;
+
+use crate::ast::{FailureAction, FailureValue, TypeArg, TypeRef, WorkflowCallArg};
+use crate::error::{Diagnostic, Span};
+use crate::hir::{HirAgent, HirFunction, HirProgram, HirWorkflow};
+
+/// Latency charged to a step whose target has no effects.
+pub const PURE_STEP_LATENCY_MS: u64 = 1;
+
+/// Conservative per-call latency annotation for each capability kind.
+pub fn capability_latency_ms(capability_head: &str) -> u64 {
+    match capability_head {
+        "Model" => 800,
+        "Net" => 120,
+        "Tool" => 60,
+        "Io" => 5,
+        _ => 0,
+    }
+}
+
+/// Per-call cost of a capability instance (the `budget` argument of `Model<provider, model, budget>`).
+pub fn capability_budget(capability: &TypeRef) -> u64 {
+    if capability.head() != "Model" {
+        return 0;
+    }
+    match capability.args.get(2) {
+        Some(TypeArg::Number(value)) => value.parse::<u64>().unwrap_or(0),
+        _ => 0,
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct StepLatency {
+    pub id: String,
+    pub target: String,
+    pub depends_on: Vec<String>,
+    /// Worst-case attempts (1 + `retry(..., max=N)`).
+    pub attempts: u64,
+    pub call_latency_ms: u64,
+    pub call_budget: u64,
+    pub start_ms: u64,
+    pub finish_ms: u64,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct WorkflowLatencyReport {
+    pub workflow: String,
+    pub steps: Vec<StepLatency>,
+    pub critical_path: Vec<String>,
+    pub critical_path_ms: u64,
+    pub max_parallelism: usize,
+    pub worst_case_budget: u64,
+    pub span: Span,
+}
+
+impl fmt::Display for WorkflowLatencyReport {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        writeln!(
+            f,
+            "workflow '{}': critical_path_ms={} max_parallelism={} worst_case_budget={}",
+            self.workflow, self.critical_path_ms, self.max_parallelism, self.worst_case_budget
+        )?;
+        writeln!(f, "  critical_path: {}", self.critical_path.join(" -> "))?;
+        for step in &self.steps {
+            let deps = if step.depends_on.is_empty() {
+                "-".to_string()
+            } else {
+                step.depends_on.join(",")
+            };
+            writeln!(
+                f,
+                "  step {} -> {}: start_ms={} finish_ms={} attempts={} budget={} deps={}",
+                step.id,
+                step.target,
+                step.start_ms,
+                step.finish_ms,
+                step.attempts,
+                step.call_budget * step.attempts,
+                deps
+            )?;
+        }
+        Ok(())
+    }
+}
+
+struct LatencyContext<'a> {
+    functions: HashMap<&'a str, &'a HirFunction>,
+    workflows: HashMap<&'a str, &'a HirWorkflow>,
+    agents: HashMap<&'a str, &'a HirAgent>,
+    memo: HashMap<String, (u64, u64)>,
+    in_progress: HashSet<String>,
+}
+
+pub fn analyze_program(program: &HirProgram) -> Vec<WorkflowLatencyReport> {
+    let mut context = LatencyContext {
+        functions: program
+            .functions
+            .iter()
+            .map(|function| (function.name.as_str(), function))
+            .collect(),
+        workflows: program
+            .workflows
+            .iter()
+            .map(|workflow| (workflow.name.as_str(), workflow))
+            .collect(),
+        agents: program
+            .agents
+            .iter()
+            .map(|agent| (agent.name.as_str(), agent))
+            .collect(),
+        memo: HashMap::new(),
+        in_progress: HashSet::new(),
+    };
+
+    program
+        .workflows
+        .iter()
+        .map(|workflow| analyze_workflow(workflow, &mut context))
+        .collect()
+}
+
+/// Warn for every workflow whose critical path exceeds `max_latency_ms`.
+pub fn check_latency_budget(
+    reports: &[WorkflowLatencyReport],
+    max_latency_ms: u64,
+) -> Vec<Diagnostic> {
+    reports
+        .iter()
+        .filter(|report| report.critical_path_ms > max_latency_ms)
+        .map(|report| {
+            Diagnostic::warning(
+                format!(
+                    "workflow '{}' critical path takes {}ms (> {}ms): {}",
+                    report.workflow,
+                    report.critical_path_ms,
+                    max_latency_ms,
+                    report.critical_path.join(" -> ")
+                ),
+                report.span,
+            )
+        })
+        .collect()
+}
+
+fn analyze_workflow(
+    workflow: &HirWorkflow,
+    context: &mut LatencyContext<'_>,
+) -> WorkflowLatencyReport {
+    context.in_progress.insert(workflow.name.clone());
+
+    let mut steps: Vec<StepLatency> = Vec::new();
+    let mut index_by_id: HashMap<&str, usize> = HashMap::new();
+    for step in &workflow.steps {
+        let mut depends_on: Vec<String> = Vec::new();
+        for arg in &step.call.args {
+            let WorkflowCallArg::Path(segments) = arg else {
+                continue;
+            };
+            let Some(root) = segments.first() else {
+                continue;
+            };
+            if index_by_id.contains_key(root.as_str()) && !depends_on.contains(root) {
+                depends_on.push(root.clone());
+            }
+        }
+
+        let (call_latency_ms, call_budget) = target_cost(&step.call.target, context);
+        let attempts = 1 + step.on_fail.as_ref().map(retry_limit).unwrap_or(0);
+        let start_ms = depends_on
+            .iter()
+            .map(|dep| steps[index_by_id[dep.as_str()]].finish_ms)
+            .max()
+            .unwrap_or(0);
+        let finish_ms = start_ms + call_latency_ms * attempts;
+
+        index_by_id.insert(step.id.as_str(), steps.len());
+        steps.push(StepLatency {
+            id: step.id.clone(),
+            target: step.call.target.clone(),
+            depends_on,
+            attempts,
+            call_latency_ms,
+            call_budget,
+            start_ms,
+            finish_ms,
+        });
+    }
+
+    let mut critical_path = Vec::new();
+    let mut cursor = steps
+        .iter()
+        .enumerate()
+        .max_by_key(|(index, step)| (step.finish_ms, usize::MAX - index))
+        .map(|(index, _)| index);
+    while let Some(index) = cursor {
+        let step = &steps[index];
+        critical_path.push(step.id.clone());
+        cursor = step
+            .depends_on
+            .iter()
+            .map(|dep| index_by_id[dep.as_str()])
+            .find(|dep| steps[*dep].finish_ms == step.start_ms);
+    }
+    critical_path.reverse();
+
+    let critical_path_ms = steps.iter().map(|step| step.finish_ms).max().unwrap_or(0);
+    let worst_case_budget = steps
+        .iter()
+        .map(|step| step.call_budget * step.attempts)
+        .sum();
+
+    context.in_progress.remove(&workflow.name);
+    context
+        .memo
+        .insert(workflow.name.clone(), (critical_path_ms, worst_case_budget));
+
+    WorkflowLatencyReport {
+        workflow: workflow.name.clone(),
+        max_parallelism: max_parallelism(&steps),
+        steps,
+        critical_path,
+        critical_path_ms,
+        worst_case_budget,
+        span: workflow.span,
+    }
+}
+
+fn target_cost(target: &str, context: &mut LatencyContext<'_>) -> (u64, u64) {
+    if let Some(function) = context.functions.get(target) {
+        if function.effects.is_empty() {
+            return (PURE_STEP_LATENCY_MS, 0);
+        }
+        return capabilities_cost(&function.requires, 1);
+    }
+
+    if let Some(agent) = context.agents.get(target) {
+        let iterations = agent
+            .policy
+            .max_iterations
+            .as_deref()
+            .and_then(|raw| raw.parse::<u64>().ok())
+            .unwrap_or(1);
+        return capabilities_cost(&agent.requires, iterations);
+    }
+
+    if let Some(cost) = context.memo.get(target) {
+        return *cost;
+    }
+    if context.in_progress.contains(target) {
+        return (0, 0);
+    }
+    if let Some(workflow) = context.workflows.get(target).copied() {
+        let report = analyze_workflow(workflow, context);
+        return (report.critical_path_ms, report.worst_case_budget);
+    }
+
+    (0, 0)
+}
+
+fn capabilities_cost(requires: &[TypeRef], repeat: u64) -> (u64, u64) {
+    let latency: u64 = requires
+        .iter()
+        .map(|capability| capability_latency_ms(capability.head()))
+        .sum();
+    let budget: u64 = requires.iter().map(capability_budget).sum();
+    (latency.max(PURE_STEP_LATENCY_MS) * repeat, budget * repeat)
+}
+
+/// `max=` of an `on_fail -> retry(...)` action; 0 for any other action.
+pub(crate) fn retry_limit(action: &FailureAction) -> u64 {
+    if action.name != "retry" {
+        return 0;
+    }
+    action
+        .args
+        .iter()
+        .find(|arg| arg.key.as_deref() == Some("max"))
+        .and_then(|arg| match &arg.value {
+            FailureValue::Number(value) => value.parse::<u64>().ok(),
+            _ => None,
+        })
+        .unwrap_or(0)
+}
+
+fn max_parallelism(steps: &[StepLatency]) -> usize {
+    let mut events: Vec<(u64, i32)> = Vec::new();
+    for step in steps.iter().filter(|step| step.finish_ms > step.start_ms) {
+        events.push((step.start_ms, 1));
+        events.push((step.finish_ms, -1));
+    }
+    // Ends sort before starts at the same instant: back-to-back steps do not overlap.
+    events.sort();
+
+    let mut running = 0i32;
+    let mut peak = 0i32;
+    for (_, delta) in events {
+        running += delta;
+        peak = peak.max(running);
+    }
+    peak as usize
+}
@@ -1,17 +1,30 @@
+pub mod agent;
 pub mod ast;
+pub mod batch_read;
+pub mod bench;
+pub mod bootstrap;
 pub mod error;
 pub mod hir;
 pub mod interp;
+pub mod journal;
+pub mod latency;
 pub mod lexer;
 pub mod llvm;
 pub mod loader;
+pub mod loadtest;
 pub mod mir;
 pub mod module_check;
+pub mod module_path;
 pub mod native;
+pub mod net_pool;
 pub mod normalize;
 pub mod parser;
+pub mod scheduler;
 pub mod sema;
+pub mod tier;
 pub mod token;
+pub mod util;
+pub mod workflow_runtime;
 
 use crate::error::Severity;
 use ast::Program;
@@ -55,11 +68,68 @@ pub fn check_entry_modules(entry: &Path) -> Result<Vec<ModuleCheckResult>, Vec<D
     Ok(out)
 }
 
+/// Checks only `module` (a file in `entry`'s import graph). Other modules are skimmed: their
+/// signatures feed the import stubs, their function bodies are never parsed.
+pub fn check_entry_module(
+    entry: &Path,
+    module: &Path,
+) -> Result<ModuleCheckResult, Vec<Diagnostic>> {
+    let target = std::fs::canonicalize(module).unwrap_or_else(|_| module.to_path_buf());
+    let is_target =
+        |path: &Path| std::fs::canonicalize(path).is_ok_and(|canonical| canonical == target);
+    let (graph, mut modules) = loader::load_module_programs_skimmed(entry, is_target)?;
+    let exports = module_check::build_export_index(&modules);
+
+    let Some(index) = modules.iter().position(|loaded| is_target(&loaded.path)) else {
+        return Err(vec![Diagnostic::error(
+            format!(
+                "module '{}' is not imported by '{}'",
+                module.display(),
+                entry.display()
+            ),
+            error::Span::new(0, 0),
+        )]);
+    };
+    let loaded = modules.swap_remove(index);
+    let (program, mut diagnostics) =
+        module_check::prepare_program_for_module_check(&loaded, &graph, &exports);
+    diagnostics.extend(sema::check_program(&program));
+    Ok(ModuleCheckResult {
+        path: loaded.path,
+        diagnostics,
+    })
+}
+
 pub fn lower_source(source: &str) -> Result<HirProgram, Vec<Diagnostic>> {
     let program = parse_source(source)?;
     Ok(hir::lower_program(&program))
 }
 
+pub fn analyze_latency_source(
+    source: &str,
+) -> Result<Vec<latency::WorkflowLatencyReport>, Vec<Diagnostic>> {
+    let hir_program = lower_source(source)?;
+    Ok(latency::analyze_program(&hir_program))
+}
+
+pub fn loadtest_source(
+    source: &str,
+    options: &loadtest::LoadTestOptions,
+) -> Result<loadtest::LoadTestReport, Vec<Diagnostic>> {
+    let program = parse_source(source)?;
+    let diagnostics = sema::check_program(&program);
+    if diagnostics
+        .iter()
+        .any(|diagnostic| diagnostic.severity == Severity::Error)
+    {
+        return Err(diagnostics);
+    }
+
+    let hir_program = hir::lower_program(&program);
+    loadtest::run_loadtest(&hir_program, options)
+        .map_err(|message| vec![Diagnostic::error(message, crate::error::Span::new(0, 0))])
+}
+
 pub fn lower_to_mir_source(source: &str) -> Result<MirProgram, Vec<Diagnostic>> {
     let program = parse_source(source)?;
     let mut diagnostics = sema::check_program(&program);
@@ -80,6 +150,26 @@ pub fn lower_to_mir_source(source: &str) -> Result<MirProgram, Vec<Diagnostic>>
     }
 }
 
+pub fn compile_agents_source(source: &str) -> Result<agent::AgentProgram, Vec<Diagnostic>> {
+    let program = parse_source(source)?;
+    let mut diagnostics = sema::check_program(&program);
+    if diagnostics
+        .iter()
+        .any(|diagnostic| diagnostic.severity == Severity::Error)
+    {
+        return Err(diagnostics);
+    }
+
+    let hir_program = hir::lower_program(&program);
+    match agent::compile_agents(&hir_program) {
+        Ok(agents) => Ok(agents),
+        Err(mut compile_errors) => {
+            diagnostics.append(&mut compile_errors);
+            Err(diagnostics)
+        }
+    }
+}
+
 pub fn emit_llvm_ir_source(source: &str) -> Result<String, Vec<Diagnostic>> {
     let mir_program = lower_to_mir_source(source)?;
     Ok(llvm::emit_program(&mir_program))
@@ -89,11 +179,41 @@ pub fn emit_llvm_ir_source(source: &str) -> Result<String, Vec<Diagnostic>> {
 pub struct RunResult {
     pub value: interp::Value,
     pub diagnostics: Vec<Diagnostic>,
+    pub ensures: interp::EnsuresReport,
+    /// Present for `--engine=auto` runs.
+    pub tier: Option<tier::TierReport>,
 }
 
 pub fn run_source(source: &str) -> Result<RunResult, Vec<Diagnostic>> {
+    let sampling = interp::EnsuresSampling::from_env()
+        .map_err(|message| vec![Diagnostic::error(message, crate::error::Span::new(0, 0))])?;
+    run_source_with_ensures(source, sampling)
+}
+
+pub fn run_source_with_ensures(
+    source: &str,
+    sampling: interp::EnsuresSampling,
+) -> Result<RunResult, Vec<Diagnostic>> {
+    run_source_with_engine(source, sampling, None)
+}
+
+/// `run --engine=auto`: interprets, compiling hot scalar functions to native code on the side.
+pub fn run_source_tiered(
+    source: &str,
+    options: tier::TierOptions,
+) -> Result<RunResult, Vec<Diagnostic>> {
+    let sampling = interp::EnsuresSampling::from_env()
+        .map_err(|message| vec![Diagnostic::error(message, crate::error::Span::new(0, 0))])?;
+    run_source_with_engine(source, sampling, Some(options))
+}
+
+fn run_source_with_engine(
+    source: &str,
+    sampling: interp::EnsuresSampling,
+    tier: Option<tier::TierOptions>,
+) -> Result<RunResult, Vec<Diagnostic>> {
     let program = parse_source(source)?;
-    let diagnostics = sema::check_program(&program);
+    let mut diagnostics = sema::check_program(&program);
     if diagnostics
         .iter()
         .any(|diagnostic| diagnostic.severity == Severity::Error)
@@ -103,10 +223,15 @@ pub fn run_source(source: &str) -> Result<RunResult, Vec<Diagnostic>> {
 
     // Stage1 compiler (and future self-hosted tooling) can be deeply recursive when executed under
     // the Stage0 interpreter. Run it on a larger stack to avoid host-side stack overflows.
-    let value = std::thread::Builder::new()
+    let (value, ensures, tier) = std::thread::Builder::new()
         .name("kooix-interp".to_string())
         .stack_size(64 * 1024 * 1024)
-        .spawn(move || interp::run_program(&program))
+        .spawn(move || match tier {
+            Some(options) => interp::run_program_tiered(&program, sampling, options)
+                .map(|(value, ensures, tier)| (value, ensures, Some(tier))),
+            None => interp::run_program_with_ensures(&program, sampling)
+                .map(|(value, ensures)| (value, ensures, None)),
+        })
         .map_err(|error| {
             vec![Diagnostic::error(
                 format!("failed to spawn interpreter thread: {error}"),
@@ -121,7 +246,22 @@ pub fn run_source(source: &str) -> Result<RunResult, Vec<Diagnostic>> {
             )]
         })?
         .map_err(|error| vec![error])?;
-    Ok(RunResult { value, diagnostics })
+
+    for stats in ensures.violations() {
+        diagnostics.push(Diagnostic::warning(
+            format!(
+                "function '{}' ensures '{}' violated in {} of {} sampled checks",
+                stats.function, stats.clause, stats.violations, stats.checked
+            ),
+            stats.span,
+        ));
+    }
+    Ok(RunResult {
+        value,
+        diagnostics,
+        ensures,
+        tier,
+    })
 }
 
 pub fn compile_native_source(source: &str, output_path: &Path) -> Result<(), native::NativeError> {
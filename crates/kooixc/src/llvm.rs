@@ -1,6 +1,5 @@
 use std::collections::{BTreeMap, HashMap};
 use std::fmt::Write;
-use std::path::PathBuf;
 
 use crate::ast::{BinaryOp, TypeRef};
 use crate::loader::load_source_map;
@@ -8,8 +7,26 @@ use crate::mir::{
     MirBlock, MirEnum, MirFunction, MirOperand, MirProgram, MirRecord, MirRvalue, MirStatement,
     MirTerminator,
 };
+use crate::module_path;
+
+/// Globals through which a tier-up module (see [`emit_tier_program`]) talks to its caller.
+pub const TIER_TRAP_SYMBOL: &str = "kx_tier_trap";
+pub const TIER_DEPTH_SYMBOL: &str = "kx_tier_depth";
 
 pub fn emit_program(program: &MirProgram) -> String {
+    emit_program_with(program, None)
+}
+
+/// `emit_program` for `run --engine=auto` tier-up modules, keeping the interpreter's semantics:
+/// `+` checks for signed overflow and every function checks the call depth (seeded by the caller
+/// through `@kx_tier_depth`) against `max_depth`. Either failure sets `@kx_tier_trap` and unwinds
+/// by returning, with every caller returning as soon as it sees the flag, so the interpreter can
+/// re-run the (pure) call and report the error itself.
+pub fn emit_tier_program(program: &MirProgram, max_depth: usize) -> String {
+    emit_program_with(program, Some(max_depth))
+}
+
+fn emit_program_with(program: &MirProgram, tier_guard: Option<usize>) -> String {
     let mut output = String::new();
     output.push_str("; ModuleID = 'kooix_mvp'\n");
     output.push_str("source_filename = \"kooix\"\n\n");
@@ -41,7 +58,20 @@ pub fn emit_program(program: &MirProgram) -> String {
     output.push_str("declare i64 @kx_host_argc()\n");
     output.push_str("declare i8* @kx_host_argv(i64)\n\n");
     output.push_str("declare i8* @kx_text_concat(i8*, i8*)\n");
-    output.push_str("declare i8* @kx_int_to_text(i64)\n\n");
+    output.push_str("declare i8* @kx_int_to_text(i64)\n");
+    for (_, (symbol, ret_ty, param_tys)) in NATIVE_RUNTIME_INTRINSICS {
+        let params: Vec<&str> = param_tys
+            .iter()
+            .map(|ty| if *ty == "Text" { "i8*" } else { "i64" })
+            .collect();
+        let _ = writeln!(output, "declare {ret_ty} @{symbol}({})", params.join(", "));
+    }
+    output.push('\n');
+    if tier_guard.is_some() {
+        let _ = writeln!(output, "@{TIER_TRAP_SYMBOL} = global i64 0");
+        let _ = writeln!(output, "@{TIER_DEPTH_SYMBOL} = global i64 0");
+        output.push_str("declare { i64, i1 } @llvm.sadd.with.overflow.i64(i64, i64)\n\n");
+    }
 
     // String constants.
     let text_consts = collect_text_constants(program);
@@ -96,6 +126,7 @@ pub fn emit_program(program: &MirProgram) -> String {
             &enums,
             &signatures,
             &text_const_ptrs,
+            tier_guard,
             &mut output,
         );
         output.push('\n');
@@ -116,6 +147,7 @@ fn emit_function(
     enums: &HashMap<&str, &MirEnum>,
     signatures: &HashMap<&str, (&TypeRef, Vec<&TypeRef>)>,
     text_consts: &HashMap<String, TextConstRef>,
+    tier_guard: Option<usize>,
     output: &mut String,
 ) {
     let return_type = llvm_type(&function.return_type, records, enums);
@@ -172,15 +204,28 @@ fn emit_function(
         text_consts,
         local_ptrs,
         next_tmp: 0,
+        tier_guard,
     };
 
     for (index, block) in function.blocks.iter().enumerate() {
         emitter.emit_block(block, index == 0, output);
     }
+    if tier_guard.is_some() {
+        let _ = writeln!(output, "{TIER_TRAP_LABEL}:");
+        let _ = writeln!(output, "  store i64 1, i64* @{TIER_TRAP_SYMBOL}");
+        let _ = writeln!(output, "  store i64 %kx_depth, i64* @{TIER_DEPTH_SYMBOL}");
+        let _ = writeln!(
+            output,
+            "  {}",
+            return_default_instruction(&function.return_type, records, enums)
+        );
+    }
 
     let _ = writeln!(output, "}}");
 }
 
+const TIER_TRAP_LABEL: &str = "kx_tier_trap";
+
 struct FunctionEmitter<'a> {
     function: &'a MirFunction,
     records: &'a HashMap<&'a str, &'a MirRecord>,
@@ -189,6 +234,8 @@ struct FunctionEmitter<'a> {
     text_consts: &'a HashMap<String, TextConstRef>,
     local_ptrs: Vec<Option<String>>,
     next_tmp: usize,
+    /// Call-depth limit of a tier-up module; `None` for ordinary native code.
+    tier_guard: Option<usize>,
 }
 
 impl<'a> FunctionEmitter<'a> {
@@ -200,6 +247,19 @@ impl<'a> FunctionEmitter<'a> {
             if !self.function.effects.is_empty() {
                 let _ = writeln!(output, "  ; effects: {}", self.function.effects.join(", "));
             }
+            if let Some(max_depth) = self.tier_guard {
+                let _ = writeln!(output, "  %kx_depth = load i64, i64* @{TIER_DEPTH_SYMBOL}");
+                let _ = writeln!(output, "  %kx_depth_in = add i64 %kx_depth, 1");
+                let _ = writeln!(
+                    output,
+                    "  store i64 %kx_depth_in, i64* @{TIER_DEPTH_SYMBOL}"
+                );
+                let _ = writeln!(
+                    output,
+                    "  %kx_too_deep = icmp sgt i64 %kx_depth_in, {max_depth}"
+                );
+                self.emit_tier_branch("%kx_too_deep", output);
+            }
         }
 
         for statement in &block.statements {
@@ -255,7 +315,25 @@ impl<'a> FunctionEmitter<'a> {
         }
     }
 
+    /// Leaves to the trap block when `cond` holds, continuing in a fresh block otherwise.
+    fn emit_tier_branch(&mut self, cond: &str, output: &mut String) {
+        let ok_bb = self.fresh_tmp_label("kx_tier_ok");
+        let _ = writeln!(
+            output,
+            "  br i1 {cond}, label %{TIER_TRAP_LABEL}, label %{ok_bb}"
+        );
+        let _ = writeln!(output, "{ok_bb}:");
+    }
+
     fn emit_terminator(&mut self, terminator: &MirTerminator, output: &mut String) {
+        if self.tier_guard.is_some()
+            && matches!(
+                terminator,
+                MirTerminator::Return { .. } | MirTerminator::ReturnDefault(_)
+            )
+        {
+            let _ = writeln!(output, "  store i64 %kx_depth, i64* @{TIER_DEPTH_SYMBOL}");
+        }
         match terminator {
             MirTerminator::Return { value } => match value {
                 None => {
@@ -319,6 +397,19 @@ impl<'a> FunctionEmitter<'a> {
 
                 let tmp = self.fresh_tmp();
                 match op {
+                    BinaryOp::Add if self.tier_guard.is_some() => {
+                        let sum = self.fresh_tmp();
+                        let overflow = self.fresh_tmp();
+                        let _ = writeln!(
+                            output,
+                            "  {sum} = call {{ i64, i1 }} @llvm.sadd.with.overflow.i64(i64 {left_value}, i64 {right_value})"
+                        );
+                        let _ = writeln!(output, "  {tmp} = extractvalue {{ i64, i1 }} {sum}, 0");
+                        let _ =
+                            writeln!(output, "  {overflow} = extractvalue {{ i64, i1 }} {sum}, 1");
+                        self.emit_tier_branch(&overflow, output);
+                        tmp
+                    }
                     BinaryOp::Add => {
                         let _ = writeln!(output, "  {tmp} = add i64 {left_value}, {right_value}");
                         tmp
@@ -508,7 +599,7 @@ impl<'a> FunctionEmitter<'a> {
         };
         let fn_name = sanitize_symbol(callee_llvm);
         let ret_llvm_ty = llvm_type(return_ty, self.records, self.enums);
-        if ret_llvm_ty == "void" {
+        let value = if ret_llvm_ty == "void" {
             let _ = writeln!(output, "  call void @{fn_name}({call_args})");
             "0".to_string()
         } else {
@@ -518,7 +609,15 @@ impl<'a> FunctionEmitter<'a> {
                 "  {tmp} = call {ret_llvm_ty} @{fn_name}({call_args})"
             );
             tmp
+        };
+        if self.tier_guard.is_some() {
+            let flag = self.fresh_tmp();
+            let trapped = self.fresh_tmp();
+            let _ = writeln!(output, "  {flag} = load i64, i64* @{TIER_TRAP_SYMBOL}");
+            let _ = writeln!(output, "  {trapped} = icmp ne i64 {flag}, 0");
+            self.emit_tier_branch(&trapped, output);
         }
+        value
     }
 
     fn emit_intrinsic_call(
@@ -527,6 +626,30 @@ impl<'a> FunctionEmitter<'a> {
         args: &[MirOperand],
         output: &mut String,
     ) -> Option<String> {
+        if let Some((symbol, ret_ty, param_tys)) = native_runtime_intrinsic(callee) {
+            if args.len() != param_tys.len() {
+                return Some("0".to_string());
+            }
+            let mut call_args = Vec::with_capacity(args.len());
+            for (arg, param_ty) in args.iter().zip(param_tys) {
+                let ty = TypeRef {
+                    name: param_ty.to_string(),
+                    args: Vec::new(),
+                };
+                let value = self.emit_operand_value(arg, &ty, output);
+                call_args.push(format!(
+                    "{} {value}",
+                    llvm_type(&ty, self.records, self.enums)
+                ));
+            }
+            let tmp = self.fresh_tmp();
+            let _ = writeln!(
+                output,
+                "  {tmp} = call {ret_ty} @{symbol}({})",
+                call_args.join(", ")
+            );
+            return Some(tmp);
+        }
         match callee {
             "text_len" => {
                 let [s] = args else {
@@ -1579,7 +1702,7 @@ fn return_default_instruction(
     }
 }
 
-fn sanitize_symbol(raw: &str) -> String {
+pub(crate) fn sanitize_symbol(raw: &str) -> String {
     raw.chars()
         .map(|ch| {
             if ch.is_ascii_alphanumeric() || ch == '_' {
@@ -1745,24 +1868,51 @@ fn collect_text_bytes_in_operand(op: &MirOperand, out: &mut Vec<Vec<u8>>) {
     }
 }
 
-fn native_load_source_map(raw: &str) -> Result<String, String> {
-    let mut entry = PathBuf::from(raw);
-    if entry.extension().is_none() {
-        entry.set_extension("kooix");
-    }
+/// (runtime symbol, LLVM return type, Kooix parameter types).
+type RuntimeCall = (&'static str, &'static str, &'static [&'static str]);
+
+/// Intrinsics lowered to a plain call into the native runtime, by name.
+const NATIVE_RUNTIME_INTRINSICS: [(&str, RuntimeCall); 17] = [
+    ("text_byte", ("kx_text_byte", "i64", &["Text", "Int"])),
+    ("text_sub", ("kx_text_sub", "i8*", &["Text", "Int", "Int"])),
+    (
+        "text_scan_ident",
+        ("kx_text_scan_ident", "i64", &["Text", "Int"]),
+    ),
+    (
+        "text_skip_trivia",
+        ("kx_text_skip_trivia", "i64", &["Text", "Int"]),
+    ),
+    ("int_buf_new", ("kx_int_buf_new", "i64", &[])),
+    ("int_buf_push", ("kx_int_buf_push", "i64", &["Int", "Int"])),
+    ("int_buf_get", ("kx_int_buf_get", "i64", &["Int", "Int"])),
+    ("int_buf_pop", ("kx_int_buf_pop", "i64", &["Int"])),
+    ("int_buf_len", ("kx_int_buf_len", "i64", &["Int"])),
+    ("text_intern_new", ("kx_text_intern_new", "i64", &[])),
+    ("text_intern", ("kx_text_intern", "i64", &["Int", "Text"])),
+    ("host_fork", ("kx_host_fork", "i64", &[])),
+    ("host_wait", ("kx_host_wait", "i64", &["Int"])),
+    ("host_exit", ("kx_host_exit", "i64", &["Int"])),
+    ("host_now_ns", ("kx_host_now_ns", "i64", &[])),
+    ("host_heap_bytes", ("kx_host_heap_bytes", "i64", &[])),
+    (
+        "host_resolve_import",
+        ("kx_host_resolve_import", "i8*", &["Text", "Text"]),
+    ),
+];
+
+fn native_runtime_intrinsic(
+    name: &str,
+) -> Option<(&'static str, &'static str, &'static [&'static str])> {
+    NATIVE_RUNTIME_INTRINSICS
+        .iter()
+        .find(|(intrinsic, _)| *intrinsic == name)
+        .map(|(_, signature)| *signature)
+}
 
-    if std::fs::metadata(&entry).is_err() {
-        // Mirror the interpreter's resilience: tests may run with cwd = crates/kooixc.
-        let mut prefix = PathBuf::new();
-        for _ in 0..8 {
-            prefix.push("..");
-            let candidate = prefix.join(&entry);
-            if std::fs::metadata(&candidate).is_ok() {
-                entry = candidate;
-                break;
-            }
-        }
-    }
+fn native_load_source_map(raw: &str) -> Result<String, String> {
+    // Mirror the interpreter's resilience: tests may run with cwd = crates/kooixc.
+    let entry = module_path::resolve_module(raw);
 
     match load_source_map(&entry) {
         Ok(map) => Ok(map.combined),
@@ -1774,23 +1924,8 @@ fn native_load_source_map(raw: &str) -> Result<String, String> {
 }
 
 fn native_read_file(raw: &str) -> Result<String, String> {
-    let mut entry = PathBuf::from(raw);
-    if entry.extension().is_none() {
-        entry.set_extension("kooix");
-    }
-
-    if std::fs::metadata(&entry).is_err() {
-        // Mirror the interpreter's resilience: tests may run with cwd = crates/kooixc.
-        let mut prefix = PathBuf::new();
-        for _ in 0..8 {
-            prefix.push("..");
-            let candidate = prefix.join(&entry);
-            if std::fs::metadata(&candidate).is_ok() {
-                entry = candidate;
-                break;
-            }
-        }
-    }
+    // Mirror the interpreter's resilience: tests may run with cwd = crates/kooixc.
+    let entry = module_path::resolve_module(raw);
 
     std::fs::read_to_string(&entry)
         .map_err(|error| format!("failed to read file '{}': {error}", entry.display()))
@@ -1,11 +1,13 @@
-use std::collections::HashSet;
+use std::collections::{HashMap, HashSet};
 use std::fs;
 use std::path::{Path, PathBuf};
 
-use crate::ast::Program;
+use crate::ast::{Item, Program};
+use crate::batch_read::{self, ReadBackend};
 use crate::error::{Diagnostic, Span};
 use crate::lexer;
-use crate::parser;
+use crate::module_path;
+use crate::parser::{self, LazyBody};
 use crate::token::{Token, TokenKind};
 
 #[derive(Debug, Clone, PartialEq, Eq)]
@@ -39,6 +41,37 @@ pub struct ModuleGraph {
 pub struct LoadedModule {
     pub path: PathBuf,
     pub program: Program,
+    /// Function bodies skipped by [`load_module_programs_skimmed`]; `None` once all are parsed.
+    pub lazy: Option<LazyBodies>,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct LazyBodies {
+    source: String,
+    tokens: Vec<Token>,
+    bodies: Vec<LazyBody>,
+}
+
+impl LoadedModule {
+    /// Parses the bodies a skimmed load left as token ranges. A no-op for fully parsed modules.
+    pub fn force_bodies(&mut self) -> Result<(), Vec<Diagnostic>> {
+        let Some(lazy) = &self.lazy else {
+            return Ok(());
+        };
+        let mut blocks = Vec::with_capacity(lazy.bodies.len());
+        for body in &lazy.bodies {
+            let block = parser::parse_lazy_body(&lazy.tokens, body)
+                .map_err(|error| vec![qualify_diagnostic(&self.path, &lazy.source, error)])?;
+            blocks.push((body.item, block));
+        }
+        for (item, block) in blocks {
+            if let Some(Item::Function(function)) = self.program.items.get_mut(item) {
+                function.body = Some(block);
+            }
+        }
+        self.lazy = None;
+        Ok(())
+    }
 }
 
 #[derive(Debug, Clone, PartialEq, Eq)]
@@ -60,14 +93,47 @@ pub fn load_source_map(entry: &Path) -> Result<SourceMap, Vec<Diagnostic>> {
     Ok(map)
 }
 
+/// How the import graph is read. `Batched` first reads the whole graph frontier by frontier
+/// (`batch_read`), then assembles it exactly as `Serial` would; files the batch could not read
+/// are re-read serially so errors are reported in the usual order.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum LoadMode {
+    Serial,
+    Batched(ReadBackend),
+}
+
+impl LoadMode {
+    /// `KOOIX_LOADER=serial|threads|uring` (default: batched, io_uring when available).
+    pub fn from_env() -> Self {
+        match std::env::var("KOOIX_LOADER").as_deref() {
+            Ok("serial") => LoadMode::Serial,
+            Ok("threads") => LoadMode::Batched(ReadBackend::Threads),
+            Ok("uring") => LoadMode::Batched(ReadBackend::IoUring),
+            _ => LoadMode::Batched(ReadBackend::Auto),
+        }
+    }
+}
+
 pub fn load_source_map_with_module_graph(
     entry: &Path,
 ) -> Result<(SourceMap, ModuleGraph), Vec<Diagnostic>> {
+    load_source_map_with_mode(entry, LoadMode::from_env())
+}
+
+pub fn load_source_map_with_mode(
+    entry: &Path,
+    mode: LoadMode,
+) -> Result<(SourceMap, ModuleGraph), Vec<Diagnostic>> {
+    let prefetched = match mode {
+        LoadMode::Serial => HashMap::new(),
+        LoadMode::Batched(backend) => prefetch_import_graph(entry, backend),
+    };
     let mut loader = Loader {
         combined: String::new(),
         files: Vec::new(),
         modules: Vec::new(),
         visited: HashSet::new(),
+        prefetched,
     };
 
     loader.load_file(entry)?;
@@ -94,20 +160,90 @@ pub fn load_module_programs_with_source_map(
     entry: &Path,
 ) -> Result<(SourceMap, ModuleGraph, Vec<LoadedModule>), Vec<Diagnostic>> {
     let (map, graph) = load_source_map_with_module_graph(entry)?;
+    let modules = parse_modules(&map, |_| true)?;
+    Ok((map, graph, modules))
+}
+
+/// Like [`load_module_programs`], but only files for which `parse_bodies` holds get their
+/// function bodies parsed; the rest keep signatures plus `lazy` token ranges until
+/// [`LoadedModule::force_bodies`]. Body syntax errors in skimmed files are not reported here.
+pub fn load_module_programs_skimmed(
+    entry: &Path,
+    parse_bodies: impl Fn(&Path) -> bool,
+) -> Result<(ModuleGraph, Vec<LoadedModule>), Vec<Diagnostic>> {
+    let (map, graph) = load_source_map_with_module_graph(entry)?;
+    let modules = parse_modules(&map, parse_bodies)?;
+    Ok((graph, modules))
+}
 
+fn parse_modules(
+    map: &SourceMap,
+    parse_bodies: impl Fn(&Path) -> bool,
+) -> Result<Vec<LoadedModule>, Vec<Diagnostic>> {
     let mut modules = Vec::new();
     for file in &map.files {
-        let tokens = lexer::lex(&file.source)
-            .map_err(|error| vec![qualify_diagnostic(&file.path, &file.source, error)])?;
-        let program = parser::parse(&tokens)
-            .map_err(|error| vec![qualify_diagnostic(&file.path, &file.source, error)])?;
-        modules.push(LoadedModule {
-            path: file.path.clone(),
-            program,
-        });
+        let qualify = |error| vec![qualify_diagnostic(&file.path, &file.source, error)];
+        let tokens = lexer::lex(&file.source).map_err(qualify)?;
+        let module = if parse_bodies(&file.path) {
+            LoadedModule {
+                path: file.path.clone(),
+                program: parser::parse(&tokens).map_err(qualify)?,
+                lazy: None,
+            }
+        } else {
+            let skimmed = parser::parse_skim(&tokens).map_err(qualify)?;
+            let lazy = (!skimmed.lazy_bodies.is_empty()).then(|| LazyBodies {
+                source: file.source.clone(),
+                tokens,
+                bodies: skimmed.lazy_bodies,
+            });
+            LoadedModule {
+                path: file.path.clone(),
+                program: skimmed.program,
+                lazy,
+            }
+        };
+        modules.push(module);
     }
+    Ok(modules)
+}
 
-    Ok((map, graph, modules))
+/// A file read ahead of the ordered walk, with its imports already scanned.
+struct Prefetched {
+    source: String,
+    imports: Result<Vec<ImportSpec>, Diagnostic>,
+}
+
+fn scan_imports(source: &str) -> Result<Vec<ImportSpec>, Diagnostic> {
+    collect_import_specs(&lexer::lex(source)?)
+}
+
+/// Reads every file reachable from `entry`, scanning each for imports as it arrives so the next
+/// reads join the batch while the rest are still in flight. Keys match what `Loader::load_file`
+/// later asks for.
+fn prefetch_import_graph(entry: &Path, backend: ReadBackend) -> HashMap<PathBuf, Prefetched> {
+    let mut out = HashMap::new();
+    let entry = module_path::resolve(entry);
+    let mut requested: HashSet<PathBuf> = HashSet::from([entry.clone()]);
+    batch_read::read_streaming(backend, vec![entry], |path, result| {
+        let Ok(source) = result else {
+            return Vec::new();
+        };
+        let imports = scan_imports(&source);
+        let mut next = Vec::new();
+        if let Ok(specs) = &imports {
+            let base_dir = path.parent().unwrap_or_else(|| Path::new("."));
+            for spec in specs {
+                let import_path = module_path::resolve_import(base_dir, &spec.path);
+                if requested.insert(import_path.clone()) {
+                    next.push(import_path);
+                }
+            }
+        }
+        out.insert(path.to_path_buf(), Prefetched { source, imports });
+        next
+    });
+    out
 }
 
 struct Loader {
@@ -115,32 +251,37 @@ struct Loader {
     files: Vec<SourceFile>,
     modules: Vec<ModuleNode>,
     visited: HashSet<PathBuf>,
+    prefetched: HashMap<PathBuf, Prefetched>,
 }
 
 impl Loader {
     fn load_file(&mut self, path: &Path) -> Result<(), Vec<Diagnostic>> {
+        let path = &module_path::resolve(path);
         let canonical = fs::canonicalize(path).unwrap_or_else(|_| path.to_path_buf());
         if self.visited.contains(&canonical) {
             return Ok(());
         }
         self.visited.insert(canonical.clone());
 
-        let source = fs::read_to_string(path).map_err(|error| {
-            vec![Diagnostic::error(
-                format!("failed to read file '{}': {error}", path.display()),
-                Span::new(0, 0),
-            )]
-        })?;
-
-        let tokens =
-            lexer::lex(&source).map_err(|error| vec![qualify_diagnostic(path, &source, error)])?;
-        let imports = collect_import_specs(&tokens)
-            .map_err(|error| vec![qualify_diagnostic(path, &source, error)])?;
+        let (source, imports) = match self.prefetched.remove(path) {
+            Some(prefetched) => (prefetched.source, prefetched.imports),
+            None => {
+                let source = fs::read_to_string(path).map_err(|error| {
+                    vec![Diagnostic::error(
+                        format!("failed to read file '{}': {error}", path.display()),
+                        Span::new(0, 0),
+                    )]
+                })?;
+                let imports = scan_imports(&source);
+                (source, imports)
+            }
+        };
+        let imports = imports.map_err(|error| vec![qualify_diagnostic(path, &source, error)])?;
 
         let base_dir = path.parent().unwrap_or_else(|| Path::new("."));
         let mut edges = Vec::new();
         for import in imports {
-            let import_path = resolve_import_path(base_dir, &import.path);
+            let import_path = module_path::resolve_import(base_dir, &import.path);
             edges.push(ImportEdge {
                 raw: import.path,
                 resolved: import_path.clone(),
@@ -277,21 +418,6 @@ fn collect_import_specs(tokens: &[Token]) -> Result<Vec<ImportSpec>, Diagnostic>
     Ok(imports)
 }
 
-fn resolve_import_path(base_dir: &Path, raw: &str) -> PathBuf {
-    let candidate = Path::new(raw);
-    let mut resolved = if candidate.is_absolute() {
-        candidate.to_path_buf()
-    } else {
-        base_dir.join(candidate)
-    };
-
-    if resolved.extension().is_none() {
-        resolved.set_extension("kooix");
-    }
-
-    resolved
-}
-
 fn token_kind_name(kind: &TokenKind) -> &'static str {
     match kind {
         TokenKind::KwCap => "'cap'",
@@ -0,0 +1,780 @@
+use std::collections::{BTreeMap, BTreeSet};
+use std::fmt;
+use std::net::SocketAddr;
+use std::path::PathBuf;
+use std::sync::Mutex;
+use std::thread;
+use std::time::{Duration, Instant};
+
+use crate::ast::PriorityClass;
+use crate::hir::HirProgram;
+use crate::journal::{Journal, JournalStats};
+use crate::latency::{analyze_program, capability_latency_ms};
+use crate::net_pool::{NetPool, NetPoolOptions, NetPoolStats, StandInServer};
+use crate::scheduler::{AdmissionPolicy, Scheduler, SchedulerOptions};
+use crate::util::escape_json;
+use crate::workflow_runtime::{RuntimeOptions, StreamStats, WorkflowRuntime};
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct LoadTestOptions {
+    /// Workflow or agent to instantiate when no `tenants` are given.
+    pub target: String,
+    /// Tenants sharing the runtime; empty = one tenant submitting `target`.
+    pub tenants: Vec<TenantSpec>,
+    pub requests: u64,
+    /// Worker threads executing instances (in-flight instance limit).
+    pub concurrency: usize,
+    /// Arrival rate (requests/second) for the first request; `0` = closed loop, no pacing.
+    pub rate_start: f64,
+    /// Arrival rate for the last request; the rate ramps linearly in between.
+    pub rate_end: f64,
+    pub runtime: RuntimeOptions,
+    /// Checkpoint journal; steps already in it are replayed instead of executed.
+    pub journal: Option<PathBuf>,
+    /// Admission control target for the estimated queue wait (`None` = admit everything).
+    pub queue_target_ms: Option<f64>,
+    pub admission: AdmissionPolicy,
+    /// Where `Net<"host">` calls go (`None` = simulated latency only).
+    pub net: Option<NetProvider>,
+}
+
+/// `--net <stand-in|addr>`: HTTP/1.1 server that `Net` capability calls are sent to, through a
+/// keep-alive pool keyed by the capability host.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum NetProvider {
+    /// Local keep-alive server answering after the annotated `Net` latency (scaled).
+    StandIn,
+    Endpoint(SocketAddr),
+}
+
+impl LoadTestOptions {
+    pub fn new(target: impl Into<String>) -> Self {
+        Self {
+            target: target.into(),
+            requests: 100,
+            concurrency: 8,
+            rate_start: 0.0,
+            rate_end: 0.0,
+            runtime: RuntimeOptions::default(),
+            journal: None,
+            tenants: Vec::new(),
+            queue_target_ms: None,
+            admission: AdmissionPolicy::default(),
+            net: None,
+        }
+    }
+}
+
+/// `--tenant <name>:<target>[:<weight>[:<share>]]`.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct TenantSpec {
+    pub name: String,
+    pub target: String,
+    /// Fair-queuing weight against other tenants of the same priority class.
+    pub weight: u32,
+    /// Relative share of the generated arrivals.
+    pub share: u32,
+}
+
+impl TenantSpec {
+    pub fn parse(spec: &str) -> Result<Self, String> {
+        let invalid =
+            || format!("invalid tenant '{spec}', expected <name>:<target>[:<weight>[:<share>]]");
+        let parts: Vec<&str> = spec.split(':').collect();
+        if !(2..=4).contains(&parts.len()) || parts[0].is_empty() || parts[1].is_empty() {
+            return Err(invalid());
+        }
+        let number = |index: usize| match parts.get(index) {
+            Some(value) => value
+                .parse::<u32>()
+                .ok()
+                .filter(|value| *value > 0)
+                .ok_or_else(invalid),
+            None => Ok(1),
+        };
+        Ok(Self {
+            name: parts[0].to_string(),
+            target: parts[1].to_string(),
+            weight: number(2)?,
+            share: number(3)?,
+        })
+    }
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct LatencySummary {
+    pub p50_ms: f64,
+    pub p95_ms: f64,
+    pub p99_ms: f64,
+    pub max_ms: f64,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct CapabilityLoad {
+    pub capability: String,
+    pub calls: u64,
+    pub failures: u64,
+    pub queue_avg_ms: f64,
+    pub queue_p95_ms: f64,
+    pub queue_max_ms: f64,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct TenantLoad {
+    pub tenant: String,
+    pub target: String,
+    pub class: PriorityClass,
+    pub weight: u32,
+    pub requests: u64,
+    /// Admitted on arrival; `deferred` ones were admitted later.
+    pub admitted: u64,
+    pub deferred: u64,
+    pub rejected: u64,
+    pub succeeded: u64,
+    pub failed: u64,
+    pub latency: LatencySummary,
+    pub queue_p95_ms: f64,
+}
+
+/// Scheduler metrics a workflow's `evidence { metrics [...] }` asks for, under its trace id.
+#[derive(Debug, Clone, PartialEq)]
+pub struct EvidenceExport {
+    pub target: String,
+    pub trace: Option<String>,
+    /// Declared metric -> value; `None` for metrics the scheduler does not measure.
+    pub metrics: Vec<(String, Option<f64>)>,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct LoadTestReport {
+    pub target: String,
+    pub requests: u64,
+    pub succeeded: u64,
+    pub failed: u64,
+    /// Turned away by admission control (never run).
+    pub rejected: u64,
+    pub concurrency: usize,
+    pub duration_ms: f64,
+    pub throughput_rps: f64,
+    /// End-to-end latency measured from the scheduled arrival, so pool queueing is included.
+    pub latency: LatencySummary,
+    pub capabilities: Vec<CapabilityLoad>,
+    /// `on_fail` action name -> activation count.
+    pub failure_policies: BTreeMap<String, u64>,
+    /// Chunk traffic of `stream` steps (all zero when none stream).
+    pub streams: StreamStats,
+    pub journal: Option<JournalStats>,
+    /// Connection pool counters when `Net` calls went to a real server.
+    pub net: Option<NetPoolStats>,
+    pub tenants: Vec<TenantLoad>,
+    pub evidence: Vec<EvidenceExport>,
+    /// First few distinct instance errors, for triage.
+    pub errors: Vec<String>,
+}
+
+const MAX_REPORTED_ERRORS: usize = 5;
+
+pub fn run_loadtest(
+    program: &HirProgram,
+    options: &LoadTestOptions,
+) -> Result<LoadTestReport, String> {
+    let mut runtime = WorkflowRuntime::new(program, options.runtime)?;
+    if let Some(path) = &options.journal {
+        runtime.attach_journal(Journal::open(path)?);
+    }
+    // Kept alive until the report is built; dropping it stops the server.
+    let mut _stand_in = None;
+    if let Some(provider) = options.net {
+        let endpoint = match provider {
+            NetProvider::Endpoint(address) => address,
+            NetProvider::StandIn => {
+                let latency_ms = capability_latency_ms("Net") as f64 * options.runtime.time_scale;
+                let server =
+                    StandInServer::start(Duration::from_secs_f64(latency_ms.max(0.0) / 1000.0))
+                        .map_err(|error| format!("failed to start net stand-in: {error}"))?;
+                let address = server.address();
+                _stand_in = Some(server);
+                address
+            }
+        };
+        runtime.attach_net_pool(NetPool::new(NetPoolOptions {
+            max_per_host: options.runtime.capability_limit,
+            connect_to: Some(endpoint),
+            ..NetPoolOptions::default()
+        }));
+    }
+    let tenants = if options.tenants.is_empty() {
+        vec![TenantSpec {
+            name: "default".to_string(),
+            target: options.target.clone(),
+            weight: 1,
+            share: 1,
+        }]
+    } else {
+        options.tenants.clone()
+    };
+    let mut names = BTreeSet::new();
+    let mut params = Vec::with_capacity(tenants.len());
+    for tenant in &tenants {
+        // Scheduler stats are keyed by tenant name.
+        if !names.insert(tenant.name.as_str()) {
+            return Err(format!("duplicate tenant '{}'", tenant.name));
+        }
+        if !runtime.has_workflow(&tenant.target) && !runtime.has_agent(&tenant.target) {
+            return Err(format!(
+                "loadtest target '{}' is not a workflow or agent",
+                tenant.target
+            ));
+        }
+        params.push(
+            program
+                .workflows
+                .iter()
+                .find(|workflow| workflow.name == tenant.target)
+                .map(|workflow| workflow.params.clone())
+                .unwrap_or_default(),
+        );
+    }
+
+    // Static critical path at the configured time scale: the scheduler's service-time prior.
+    let expected: Vec<Duration> = {
+        let critical_paths: BTreeMap<String, u64> = analyze_program(program)
+            .into_iter()
+            .map(|report| (report.workflow, report.critical_path_ms))
+            .collect();
+        tenants
+            .iter()
+            .map(|tenant| {
+                let ms = critical_paths.get(&tenant.target).copied().unwrap_or(0) as f64
+                    * options.runtime.time_scale;
+                Duration::from_secs_f64(ms.max(0.0) / 1000.0)
+            })
+            .collect()
+    };
+
+    let arrivals = arrival_offsets(options.requests, options.rate_start, options.rate_end);
+    let owners = assign_tenants(&tenants, arrivals.len());
+    let scheduler: Scheduler<(u64, usize, Instant)> = Scheduler::new(SchedulerOptions {
+        workers: options.concurrency.max(1),
+        queue_target: options
+            .queue_target_ms
+            .map(|ms| Duration::from_secs_f64(ms.max(0.0) / 1000.0)),
+        admission: options.admission,
+    });
+    let results: Mutex<Vec<(usize, f64, Option<String>)>> =
+        Mutex::new(Vec::with_capacity(options.requests as usize));
+
+    let started = Instant::now();
+    thread::scope(|scope| {
+        for _ in 0..options.concurrency.max(1) {
+            let scheduler = &scheduler;
+            let results = &results;
+            let runtime = &runtime;
+            let tenants = &tenants;
+            let params = &params;
+            scope.spawn(move || {
+                while let Some(dispatch) = scheduler.next() {
+                    let (invocation, tenant, arrival) = dispatch.item;
+                    let args: Vec<String> = params[tenant]
+                        .iter()
+                        .map(|param| format!("{}#{invocation}", param.name))
+                        .collect();
+                    let service_started = Instant::now();
+                    let error =
+                        match runtime.run_instance(&tenants[tenant].target, invocation, &args) {
+                            Ok(outcome) => outcome.error,
+                            Err(error) => Some(error),
+                        };
+                    scheduler.complete(dispatch.expected, service_started.elapsed());
+                    let latency_ms = arrival.elapsed().as_secs_f64() * 1000.0;
+                    results.lock().unwrap().push((tenant, latency_ms, error));
+                }
+            });
+        }
+
+        for ((invocation, offset), tenant) in arrivals.into_iter().enumerate().zip(owners) {
+            let arrival = started + offset;
+            let now = Instant::now();
+            if arrival > now {
+                thread::sleep(arrival - now);
+            }
+            let spec = &tenants[tenant];
+            let class = runtime.priority(&spec.target);
+            // Rejections are counted in the scheduler's tenant stats.
+            scheduler.submit(
+                &spec.name,
+                spec.weight,
+                class,
+                expected[tenant],
+                (invocation as u64, tenant, arrival),
+            );
+        }
+        scheduler.close();
+    });
+    let elapsed = started.elapsed();
+
+    let results = results.into_inner().unwrap();
+    let mut latencies: Vec<f64> = results.iter().map(|(_, latency, _)| *latency).collect();
+    latencies.sort_by(f64::total_cmp);
+    let mut errors: Vec<String> = Vec::new();
+    for error in results.iter().filter_map(|(_, _, error)| error.as_ref()) {
+        if errors.len() < MAX_REPORTED_ERRORS && !errors.contains(error) {
+            errors.push(error.clone());
+        }
+    }
+    let failed = results
+        .iter()
+        .filter(|(_, _, error)| error.is_some())
+        .count() as u64;
+
+    let schedule = scheduler.tenant_stats();
+    let tenant_loads: Vec<TenantLoad> = tenants
+        .iter()
+        .enumerate()
+        .map(|(index, spec)| {
+            let mut latencies: Vec<f64> = results
+                .iter()
+                .filter(|(tenant, _, _)| *tenant == index)
+                .map(|(_, latency, _)| *latency)
+                .collect();
+            latencies.sort_by(f64::total_cmp);
+            let failed = results
+                .iter()
+                .filter(|(tenant, _, error)| *tenant == index && error.is_some())
+                .count() as u64;
+            let stats = schedule.get(&spec.name).cloned().unwrap_or_default();
+            let mut waits: Vec<f64> = stats
+                .queue_wait_us
+                .iter()
+                .map(|wait| *wait as f64 / 1000.0)
+                .collect();
+            waits.sort_by(f64::total_cmp);
+            TenantLoad {
+                tenant: spec.name.clone(),
+                target: spec.target.clone(),
+                class: runtime.priority(&spec.target),
+                weight: spec.weight,
+                requests: stats.submitted,
+                admitted: stats.admitted,
+                deferred: stats.deferred,
+                rejected: stats.rejected,
+                succeeded: latencies.len() as u64 - failed,
+                failed,
+                latency: summarize(&latencies),
+                queue_p95_ms: percentile(&waits, 95.0),
+            }
+        })
+        .collect();
+    let evidence = export_evidence(program, &tenant_loads);
+
+    let capabilities = runtime
+        .capability_stats()
+        .into_iter()
+        .map(|stats| {
+            let mut waits: Vec<f64> = stats
+                .queue_wait_us
+                .iter()
+                .map(|wait| *wait as f64 / 1000.0)
+                .collect();
+            waits.sort_by(f64::total_cmp);
+            let avg = if waits.is_empty() {
+                0.0
+            } else {
+                waits.iter().sum::<f64>() / waits.len() as f64
+            };
+            CapabilityLoad {
+                capability: stats.capability,
+                calls: stats.calls,
+                failures: stats.failures,
+                queue_avg_ms: avg,
+                queue_p95_ms: percentile(&waits, 95.0),
+                queue_max_ms: waits.last().copied().unwrap_or(0.0),
+            }
+        })
+        .collect();
+
+    let duration_ms = elapsed.as_secs_f64() * 1000.0;
+    let rejected = tenant_loads.iter().map(|tenant| tenant.rejected).sum();
+    let target = if options.tenants.is_empty() {
+        options.target.clone()
+    } else {
+        let targets: BTreeSet<&str> = tenants
+            .iter()
+            .map(|tenant| tenant.target.as_str())
+            .collect();
+        targets.into_iter().collect::<Vec<_>>().join(",")
+    };
+    Ok(LoadTestReport {
+        target,
+        requests: results.len() as u64 + rejected,
+        succeeded: results.len() as u64 - failed,
+        failed,
+        rejected,
+        concurrency: options.concurrency.max(1),
+        duration_ms,
+        throughput_rps: if duration_ms > 0.0 {
+            results.len() as f64 * 1000.0 / duration_ms
+        } else {
+            0.0
+        },
+        latency: summarize(&latencies),
+        capabilities,
+        failure_policies: runtime.failure_policy_activations(),
+        streams: runtime.stream_stats(),
+        journal: runtime.journal_stats(),
+        net: runtime.net_stats(),
+        tenants: tenant_loads,
+        evidence,
+        errors,
+    })
+}
+
+fn summarize(sorted: &[f64]) -> LatencySummary {
+    LatencySummary {
+        p50_ms: percentile(sorted, 50.0),
+        p95_ms: percentile(sorted, 95.0),
+        p99_ms: percentile(sorted, 99.0),
+        max_ms: sorted.last().copied().unwrap_or(0.0),
+    }
+}
+
+/// Owner tenant of each arrival: smooth weighted round-robin over the tenants' shares.
+fn assign_tenants(tenants: &[TenantSpec], arrivals: usize) -> Vec<usize> {
+    let total: i64 = tenants.iter().map(|tenant| i64::from(tenant.share)).sum();
+    let mut credit = vec![0i64; tenants.len()];
+    (0..arrivals)
+        .map(|_| {
+            for (credit, tenant) in credit.iter_mut().zip(tenants) {
+                *credit += i64::from(tenant.share);
+            }
+            let (owner, _) = credit
+                .iter()
+                .enumerate()
+                .max_by_key(|(index, credit)| (**credit, std::cmp::Reverse(*index)))
+                .unwrap();
+            credit[owner] -= total;
+            owner
+        })
+        .collect()
+}
+
+/// Scheduler metrics for every loaded workflow that declares an `evidence` block.
+fn export_evidence(program: &HirProgram, tenants: &[TenantLoad]) -> Vec<EvidenceExport> {
+    let mut exports = Vec::new();
+    for workflow in &program.workflows {
+        let Some(evidence) = &workflow.evidence else {
+            continue;
+        };
+        let loads: Vec<&TenantLoad> = tenants
+            .iter()
+            .filter(|tenant| tenant.target == workflow.name)
+            .collect();
+        if loads.is_empty() {
+            continue;
+        }
+        let sum = |field: fn(&TenantLoad) -> u64| {
+            loads.iter().map(|load| field(load)).sum::<u64>() as f64
+        };
+        let worst = |field: fn(&TenantLoad) -> f64| {
+            loads.iter().map(|load| field(load)).fold(0.0, f64::max)
+        };
+        let metrics = evidence
+            .metrics
+            .iter()
+            .map(|metric| {
+                let value = match metric.as_str() {
+                    "requests" => Some(sum(|load| load.requests)),
+                    "admitted" => Some(sum(|load| load.admitted)),
+                    "deferred" => Some(sum(|load| load.deferred)),
+                    "rejected" => Some(sum(|load| load.rejected)),
+                    "succeeded" => Some(sum(|load| load.succeeded)),
+                    "failed" => Some(sum(|load| load.failed)),
+                    "latency_p50_ms" => Some(worst(|load| load.latency.p50_ms)),
+                    "latency_p95_ms" => Some(worst(|load| load.latency.p95_ms)),
+                    "latency_p99_ms" => Some(worst(|load| load.latency.p99_ms)),
+                    "queue_wait_p95_ms" => Some(worst(|load| load.queue_p95_ms)),
+                    _ => None,
+                };
+                (metric.clone(), value)
+            })
+            .collect();
+        exports.push(EvidenceExport {
+            target: workflow.name.clone(),
+            trace: evidence.trace.clone(),
+            metrics,
+        });
+    }
+    exports
+}
+
+/// Arrival offset of every request under a linear rate ramp (`0` rate = no pacing).
+fn arrival_offsets(requests: u64, rate_start: f64, rate_end: f64) -> Vec<Duration> {
+    let mut offsets = Vec::with_capacity(requests as usize);
+    let mut at = 0.0f64;
+    for index in 0..requests {
+        offsets.push(Duration::from_secs_f64(at));
+        let progress = if requests > 1 {
+            index as f64 / (requests - 1) as f64
+        } else {
+            0.0
+        };
+        let rate = rate_start + (rate_end - rate_start) * progress;
+        if rate > 0.0 {
+            at += 1.0 / rate;
+        }
+    }
+    offsets
+}
+
+/// Nearest-rank percentile over an ascending slice.
+fn percentile(sorted: &[f64], pct: f64) -> f64 {
+    if sorted.is_empty() {
+        return 0.0;
+    }
+    let rank = ((pct / 100.0) * sorted.len() as f64).ceil() as usize;
+    sorted[rank.clamp(1, sorted.len()) - 1]
+}
+
+impl LoadTestReport {
+    pub fn to_json(&self) -> String {
+        let capabilities = self
+            .capabilities
+            .iter()
+            .map(|capability| {
+                format!(
+                    "{{\"capability\":\"{}\",\"calls\":{},\"failures\":{},\"queue_avg_ms\":{:.3},\"queue_p95_ms\":{:.3},\"queue_max_ms\":{:.3}}}",
+                    escape_json(&capability.capability),
+                    capability.calls,
+                    capability.failures,
+                    capability.queue_avg_ms,
+                    capability.queue_p95_ms,
+                    capability.queue_max_ms
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(",");
+        let policies = self
+            .failure_policies
+            .iter()
+            .map(|(action, count)| format!("\"{}\":{count}", escape_json(action)))
+            .collect::<Vec<_>>()
+            .join(",");
+        let journal = match &self.journal {
+            Some(journal) => format!(
+                "{{\"recovered\":{},\"discarded_bytes\":{},\"recorded\":{},\"replayed\":{},\"failed_appends\":{}}}",
+                journal.recovered,
+                journal.discarded_bytes,
+                journal.recorded,
+                journal.replayed,
+                journal.failed_appends
+            ),
+            None => "null".to_string(),
+        };
+        let net = match &self.net {
+            Some(net) => format!(
+                "{{\"requests\":{},\"connections_opened\":{},\"reused\":{},\"pipelined\":{},\"evicted_idle\":{},\"closed\":{},\"stale_retries\":{}}}",
+                net.requests,
+                net.connections_opened,
+                net.reused,
+                net.pipelined,
+                net.evicted_idle,
+                net.closed,
+                net.stale_retries
+            ),
+            None => "null".to_string(),
+        };
+        let tenants = self
+            .tenants
+            .iter()
+            .map(|tenant| {
+                format!(
+                    "{{\"tenant\":\"{}\",\"target\":\"{}\",\"class\":\"{}\",\"weight\":{},\"requests\":{},\"admitted\":{},\"deferred\":{},\"rejected\":{},\"succeeded\":{},\"failed\":{},\"latency_ms\":{{\"p50\":{:.3},\"p95\":{:.3},\"p99\":{:.3},\"max\":{:.3}}},\"queue_p95_ms\":{:.3}}}",
+                    escape_json(&tenant.tenant),
+                    escape_json(&tenant.target),
+                    tenant.class.as_str(),
+                    tenant.weight,
+                    tenant.requests,
+                    tenant.admitted,
+                    tenant.deferred,
+                    tenant.rejected,
+                    tenant.succeeded,
+                    tenant.failed,
+                    tenant.latency.p50_ms,
+                    tenant.latency.p95_ms,
+                    tenant.latency.p99_ms,
+                    tenant.latency.max_ms,
+                    tenant.queue_p95_ms
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(",");
+        let evidence = self
+            .evidence
+            .iter()
+            .map(|export| {
+                let metrics = export
+                    .metrics
+                    .iter()
+                    .map(|(metric, value)| match value {
+                        Some(value) => format!("\"{}\":{value:.3}", escape_json(metric)),
+                        None => format!("\"{}\":null", escape_json(metric)),
+                    })
+                    .collect::<Vec<_>>()
+                    .join(",");
+                let trace = match &export.trace {
+                    Some(trace) => format!("\"{}\"", escape_json(trace)),
+                    None => "null".to_string(),
+                };
+                format!(
+                    "{{\"target\":\"{}\",\"trace\":{trace},\"metrics\":{{{metrics}}}}}",
+                    escape_json(&export.target)
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(",");
+        let errors = self
+            .errors
+            .iter()
+            .map(|error| format!("\"{}\"", escape_json(error)))
+            .collect::<Vec<_>>()
+            .join(",");
+        format!(
+            "{{\"target\":\"{}\",\"requests\":{},\"succeeded\":{},\"failed\":{},\"rejected\":{},\"concurrency\":{},\"duration_ms\":{:.3},\"throughput_rps\":{:.3},\"latency_ms\":{{\"p50\":{:.3},\"p95\":{:.3},\"p99\":{:.3},\"max\":{:.3}}},\"capabilities\":[{}],\"failure_policies\":{{{}}},\"streams\":{{\"chunks\":{},\"stalled_sends\":{},\"restarts\":{}}},\"journal\":{},\"net\":{},\"tenants\":[{}],\"evidence\":[{}],\"errors\":[{}]}}",
+            escape_json(&self.target),
+            self.requests,
+            self.succeeded,
+            self.failed,
+            self.rejected,
+            self.concurrency,
+            self.duration_ms,
+            self.throughput_rps,
+            self.latency.p50_ms,
+            self.latency.p95_ms,
+            self.latency.p99_ms,
+            self.latency.max_ms,
+            capabilities,
+            policies,
+            self.streams.chunks,
+            self.streams.stalled_sends,
+            self.streams.restarts,
+            journal,
+            net,
+            tenants,
+            evidence,
+            errors
+        )
+    }
+}
+
+impl fmt::Display for LoadTestReport {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        writeln!(
+            f,
+            "loadtest '{}': requests={} ok={} failed={} rejected={} concurrency={} duration_ms={:.1} throughput_rps={:.2}",
+            self.target,
+            self.requests,
+            self.succeeded,
+            self.failed,
+            self.rejected,
+            self.concurrency,
+            self.duration_ms,
+            self.throughput_rps
+        )?;
+        writeln!(
+            f,
+            "  latency_ms: p50={:.2} p95={:.2} p99={:.2} max={:.2}",
+            self.latency.p50_ms, self.latency.p95_ms, self.latency.p99_ms, self.latency.max_ms
+        )?;
+        for capability in &self.capabilities {
+            writeln!(
+                f,
+                "  capability {}: calls={} failures={} queue_ms avg={:.2} p95={:.2} max={:.2}",
+                capability.capability,
+                capability.calls,
+                capability.failures,
+                capability.queue_avg_ms,
+                capability.queue_p95_ms,
+                capability.queue_max_ms
+            )?;
+        }
+        for (action, count) in &self.failure_policies {
+            writeln!(f, "  on_fail {action}: activations={count}")?;
+        }
+        if self.streams.chunks > 0 {
+            writeln!(
+                f,
+                "  streams: chunks={} stalled_sends={} restarts={}",
+                self.streams.chunks, self.streams.stalled_sends, self.streams.restarts
+            )?;
+        }
+        if let Some(journal) = &self.journal {
+            writeln!(
+                f,
+                "  journal: recovered={} discarded_bytes={} recorded={} replayed={} failed_appends={}",
+                journal.recovered,
+                journal.discarded_bytes,
+                journal.recorded,
+                journal.replayed,
+                journal.failed_appends
+            )?;
+        }
+        if let Some(net) = &self.net {
+            writeln!(
+                f,
+                "  net: requests={} connections_opened={} reused={} pipelined={} evicted_idle={} closed={} stale_retries={}",
+                net.requests,
+                net.connections_opened,
+                net.reused,
+                net.pipelined,
+                net.evicted_idle,
+                net.closed,
+                net.stale_retries
+            )?;
+        }
+        let scheduled = self.tenants.len() > 1
+            || self
+                .tenants
+                .iter()
+                .any(|tenant| tenant.deferred + tenant.rejected > 0);
+        for tenant in self.tenants.iter().filter(|_| scheduled) {
+            writeln!(
+                f,
+                "  tenant {} ({}, {}, weight={}): requests={} admitted={} deferred={} rejected={} ok={} failed={} latency_ms p50={:.2} p95={:.2} queue_ms p95={:.2}",
+                tenant.tenant,
+                tenant.target,
+                tenant.class.as_str(),
+                tenant.weight,
+                tenant.requests,
+                tenant.admitted,
+                tenant.deferred,
+                tenant.rejected,
+                tenant.succeeded,
+                tenant.failed,
+                tenant.latency.p50_ms,
+                tenant.latency.p95_ms,
+                tenant.queue_p95_ms
+            )?;
+        }
+        for export in &self.evidence {
+            let metrics = export
+                .metrics
+                .iter()
+                .map(|(metric, value)| match value {
+                    Some(value) => format!("{metric}={value:.2}"),
+                    None => format!("{metric}=n/a"),
+                })
+                .collect::<Vec<_>>()
+                .join(" ");
+            writeln!(
+                f,
+                "  evidence {} ({}): {metrics}",
+                export.trace.as_deref().unwrap_or("-"),
+                export.target
+            )?;
+        }
+        for error in &self.errors {
+            writeln!(f, "  error: {error}")?;
+        }
+        Ok(())
+    }
+}
@@ -1,18 +1,49 @@
 use std::io::Read;
-use std::path::Path;
+use std::net::ToSocketAddrs;
+use std::path::{Path, PathBuf};
 use std::{env, fs, process};
 
+use kooixc::bench::{BenchSet, CompareOptions};
+use kooixc::bootstrap::{BootstrapOptions, NodeStatus};
 use kooixc::error::{Diagnostic, Severity};
 use kooixc::loader::{load_source_map, SourceMap};
+use kooixc::loadtest::{LoadTestOptions, NetProvider, TenantSpec};
 use kooixc::native::NativeError;
+use kooixc::scheduler::AdmissionPolicy;
+use kooixc::tier::TierOptions;
+use kooixc::util::escape_json;
 use kooixc::{
-    check_entry_modules, check_source, compile_and_run_native_source_with_args_stdin_and_timeout,
-    compile_native_source, emit_llvm_ir_source, lower_source, lower_to_mir_source, parse_source,
-    run_source, ModuleCheckResult,
+    analyze_latency_source, check_entry_module, check_entry_modules, check_source,
+    compile_agents_source, compile_and_run_native_source_with_args_stdin_and_timeout,
+    compile_native_source, emit_llvm_ir_source, loadtest_source, lower_source, lower_to_mir_source,
+    parse_source, run_source, run_source_tiered, ModuleCheckResult,
 };
 
 fn main() {
     let args: Vec<String> = env::args().collect();
+    let args = match extract_module_path(&args) {
+        Ok((args, dirs)) => {
+            apply_module_path(&dirs);
+            args
+        }
+        Err(message) => {
+            eprintln!("{message}");
+            print_usage();
+            process::exit(2);
+        }
+    };
+    if args.get(1).map(String::as_str) == Some("bootstrap") {
+        run_bootstrap(&args[2..]);
+        return;
+    }
+    if args.get(1).map(String::as_str) == Some("bench-compare") {
+        run_bench_compare(&args[2..]);
+        return;
+    }
+    if args.get(1).map(String::as_str) == Some("bench-record") {
+        run_bench_record(&args[2..]);
+        return;
+    }
     if args.len() < 3 {
         print_usage();
         process::exit(2);
@@ -111,7 +142,11 @@ fn main() {
             }
         };
 
-        match check_entry_modules(entry_path) {
+        let checked = match &options.module {
+            Some(module) => check_entry_module(entry_path, Path::new(module)).map(|r| vec![r]),
+            None => check_entry_modules(entry_path),
+        };
+        match checked {
             Ok(results) => {
                 let has_errors = results.iter().any(|result| {
                     result
@@ -170,7 +205,37 @@ fn main() {
 
     match command {
         "check" => {
-            let diagnostics = check_source(&source);
+            let options = match parse_check_options(&args[3..]) {
+                Ok(options) => options,
+                Err(message) => {
+                    eprintln!("{message}");
+                    print_usage();
+                    process::exit(2);
+                }
+            };
+
+            let mut diagnostics = check_source(source);
+            if options.analyze_latency
+                && !diagnostics
+                    .iter()
+                    .any(|diagnostic| diagnostic.severity == Severity::Error)
+            {
+                match analyze_latency_source(source) {
+                    Ok(reports) => {
+                        for report in &reports {
+                            print!("{report}");
+                        }
+                        if let Some(max_latency_ms) = options.max_latency_ms {
+                            diagnostics.extend(kooixc::latency::check_latency_budget(
+                                &reports,
+                                max_latency_ms,
+                            ));
+                        }
+                    }
+                    Err(errors) => diagnostics.extend(errors),
+                }
+            }
+
             if diagnostics.is_empty() {
                 println!("ok: semantic checks passed");
             } else {
@@ -178,7 +243,7 @@ fn main() {
                 process::exit(1);
             }
         }
-        "ast" => match parse_source(&source) {
+        "ast" => match parse_source(source) {
             Ok(program) => {
                 println!("{program:#?}");
             }
@@ -187,7 +252,7 @@ fn main() {
                 process::exit(1);
             }
         },
-        "hir" => match lower_source(&source) {
+        "hir" => match lower_source(source) {
             Ok(program) => {
                 println!("{program:#?}");
             }
@@ -196,7 +261,7 @@ fn main() {
                 process::exit(1);
             }
         },
-        "mir" => match lower_to_mir_source(&source) {
+        "agents" => match compile_agents_source(source) {
             Ok(program) => {
                 println!("{program:#?}");
             }
@@ -205,27 +270,96 @@ fn main() {
                 process::exit(1);
             }
         },
-        "llvm" => match emit_llvm_ir_source(&source) {
-            Ok(ir) => {
-                println!("{ir}");
+        "mir" => match lower_to_mir_source(source) {
+            Ok(program) => {
+                println!("{program:#?}");
             }
             Err(errors) => {
                 print_diagnostics(&errors, &source_map);
                 process::exit(1);
             }
         },
-        "run" => match run_source(&source) {
-            Ok(result) => {
-                if !result.diagnostics.is_empty() {
-                    print_diagnostics(&result.diagnostics, &source_map);
-                }
-                println!("ok: run result: {}", result.value);
+        "llvm" => match emit_llvm_ir_source(source) {
+            Ok(ir) => {
+                println!("{ir}");
             }
             Err(errors) => {
                 print_diagnostics(&errors, &source_map);
                 process::exit(1);
             }
         },
+        "run" => {
+            let options = match parse_run_options(&args[3..]) {
+                Ok(options) => options,
+                Err(message) => {
+                    eprintln!("{message}");
+                    print_usage();
+                    process::exit(2);
+                }
+            };
+            let result = match options.engine {
+                RunEngine::Interp => run_source(source),
+                RunEngine::Auto => match TierOptions::from_env() {
+                    Ok(tier_options) => run_source_tiered(source, tier_options),
+                    Err(message) => {
+                        eprintln!("{message}");
+                        process::exit(2);
+                    }
+                },
+            };
+            match result {
+                Ok(result) => {
+                    if !result.diagnostics.is_empty() {
+                        print_diagnostics(&result.diagnostics, &source_map);
+                    }
+                    if let Some(tier) = &result.tier {
+                        for failure in &tier.failures {
+                            eprintln!("warning: {failure}");
+                        }
+                        eprintln!(
+                            "tier: {} function(s) native, {} native call(s), {} bailout(s){}",
+                            tier.compiled.len(),
+                            tier.native_calls,
+                            tier.bailouts,
+                            if tier.compiled.is_empty() {
+                                String::new()
+                            } else {
+                                format!(" [{}]", tier.compiled.join(", "))
+                            }
+                        );
+                    }
+                    println!("ok: run result: {}", result.value);
+                }
+                Err(errors) => {
+                    print_diagnostics(&errors, &source_map);
+                    process::exit(1);
+                }
+            }
+        }
+        "loadtest" => {
+            let options = match parse_loadtest_options(&args[3..]) {
+                Ok(options) => options,
+                Err(message) => {
+                    eprintln!("{message}");
+                    print_usage();
+                    process::exit(2);
+                }
+            };
+
+            match loadtest_source(source, &options.loadtest) {
+                Ok(report) => {
+                    if options.json {
+                        emit_json_output(report.to_json(), options.pretty);
+                    } else {
+                        print!("{report}");
+                    }
+                }
+                Err(errors) => {
+                    print_diagnostics(&errors, &source_map);
+                    process::exit(1);
+                }
+            }
+        }
         "native" => {
             let options = match parse_native_options(&args[3..]) {
                 Ok(options) => options,
@@ -258,7 +392,7 @@ fn main() {
                 };
 
                 match compile_and_run_native_source_with_args_stdin_and_timeout(
-                    &source,
+                    source,
                     output_path,
                     &options.run_args,
                     stdin_data.as_deref(),
@@ -284,7 +418,7 @@ fn main() {
                     }
                 }
             } else {
-                match compile_native_source(&source, output_path) {
+                match compile_native_source(source, output_path) {
                     Ok(_) => {
                         println!("ok: native binary generated at {}", options.output);
                     }
@@ -359,7 +493,7 @@ fn print_module_diagnostics_json(results: &[ModuleCheckResult], pretty: bool, ok
         }
 
         out.push_str("{\"path\":\"");
-        out.push_str(&escape_json_string(&result.path.display().to_string()));
+        out.push_str(&escape_json(&result.path.display().to_string()));
         out.push_str("\",\"diagnostics\":[");
         for (diagnostic_index, diagnostic) in result.diagnostics.iter().enumerate() {
             if diagnostic_index > 0 {
@@ -369,7 +503,7 @@ fn print_module_diagnostics_json(results: &[ModuleCheckResult], pretty: bool, ok
             out.push_str("{\"severity\":\"");
             out.push_str(diagnostic_severity_label(diagnostic.severity));
             out.push_str("\",\"message\":\"");
-            out.push_str(&escape_json_string(&diagnostic.message));
+            out.push_str(&escape_json(&diagnostic.message));
             out.push_str("\",\"span\":{\"start\":");
             out.push_str(&diagnostic.span.start.to_string());
             out.push_str(",\"end\":");
@@ -394,7 +528,7 @@ fn print_loader_diagnostics_json(errors: &[Diagnostic], pretty: bool) {
         out.push_str("{\"severity\":\"");
         out.push_str(diagnostic_severity_label(error.severity));
         out.push_str("\",\"message\":\"");
-        out.push_str(&escape_json_string(&error.message));
+        out.push_str(&escape_json(&error.message));
         out.push_str("\",\"span\":{\"start\":");
         out.push_str(&error.span.start.to_string());
         out.push_str(",\"end\":");
@@ -482,21 +616,6 @@ fn diagnostic_severity_label(severity: Severity) -> &'static str {
     }
 }
 
-fn escape_json_string(value: &str) -> String {
-    let mut escaped = String::with_capacity(value.len());
-    for ch in value.chars() {
-        match ch {
-            '"' => escaped.push_str("\\\""),
-            '\\' => escaped.push_str("\\\\"),
-            '\n' => escaped.push_str("\\n"),
-            '\r' => escaped.push_str("\\r"),
-            '\t' => escaped.push_str("\\t"),
-            _ => escaped.push(ch),
-        }
-    }
-    escaped
-}
-
 fn byte_to_line_col(source: &str, byte_index: usize) -> (usize, usize) {
     let mut line = 1;
     let mut col = 1;
@@ -514,12 +633,188 @@ fn byte_to_line_col(source: &str, byte_index: usize) -> (usize, usize) {
     (line, col)
 }
 
+/// Splits `--module-path <dirs>` (repeatable, `:`-separated like `KOOIX_PATH`) out of the
+/// command line. Anything after `--` belongs to the program being run and is left alone.
+fn extract_module_path(args: &[String]) -> Result<(Vec<String>, Vec<String>), String> {
+    let mut rest = Vec::with_capacity(args.len());
+    let mut dirs = Vec::new();
+    let mut index = 0;
+    while index < args.len() {
+        let arg = &args[index];
+        if arg == "--" {
+            rest.extend_from_slice(&args[index..]);
+            break;
+        }
+        if arg == "--module-path" {
+            let Some(value) = args.get(index + 1) else {
+                return Err("missing value for --module-path".to_string());
+            };
+            dirs.extend(
+                env::split_paths(value)
+                    .filter(|dir| !dir.as_os_str().is_empty())
+                    .map(|dir| dir.to_string_lossy().to_string()),
+            );
+            index += 2;
+            continue;
+        }
+        rest.push(arg.clone());
+        index += 1;
+    }
+    Ok((rest, dirs))
+}
+
+/// Puts `--module-path` entries ahead of the inherited `KOOIX_PATH`, so the search roots (and any
+/// native binary run from here) see them.
+fn apply_module_path(dirs: &[String]) {
+    if dirs.is_empty() {
+        return;
+    }
+    let mut paths: Vec<PathBuf> = dirs.iter().map(PathBuf::from).collect();
+    if let Some(inherited) = env::var_os(kooixc::module_path::KOOIX_PATH_ENV) {
+        paths.extend(env::split_paths(&inherited));
+    }
+    if let Ok(joined) = env::join_paths(paths) {
+        env::set_var(kooixc::module_path::KOOIX_PATH_ENV, joined);
+    }
+}
+
 fn print_usage() {
     eprintln!(
-        "usage: kooixc <check|ast|hir|mir|llvm|run|native> <file.kooix> [output] [--run] [--stdin <file|-] [--timeout <ms>] [-- <args...>]\n       kooixc check-modules <file.kooix> [--json] [--pretty] [--strict-warnings]\n       kooixc native-llvm <file.ll> [output] [--run] [--stdin <file|-] [--timeout <ms>] [-- <args...>]"
+        "usage: kooixc [--module-path <dir[:dir...]>] <check|ast|hir|mir|agents|llvm|run|native> <file.kooix> [output] [--run] [--stdin <file|-] [--timeout <ms>] [-- <args...>]\n       kooixc check <file.kooix> [--analyze-latency] [--max-latency-ms <ms>]\n       kooixc loadtest <file.kooix> --target <workflow|agent> [--requests <n>] [--concurrency <n>] [--rate-start <rps>] [--rate-end <rps>] [--time-scale <f>] [--failure-rate <p>] [--capability-limit <n>] [--seed <n>] [--journal <file>] [--tenant <name>:<target>[:<weight>[:<share>]]]... [--queue-target-ms <ms>] [--admission <reject|defer>] [--net <stand-in|host:port>] [--json] [--pretty]\n       kooixc run <file.kooix> [--engine <interp|auto>]\n       kooixc check-modules <file.kooix> [--module <file.kooix>] [--json] [--pretty] [--strict-warnings]\n       kooixc native-llvm <file.ll> [output] [--run] [--stdin <file|-] [--timeout <ms>] [-- <args...>]\n       kooixc bootstrap [out_dir] [--root <dir>] [--cache-dir <dir>] [--jobs <n>] [--mem-budget-mb <mb>] [--smoke <list>] [--stage-timeout <s>] [--smoke-timeout <s>] [--json] [--pretty]\n       kooixc bench-record <store.json> <run>...\n       kooixc bench-compare <baseline> <current> [--time-threshold <pct>] [--memory-threshold <pct>] [--threshold <metric-glob>=<pct>] [--alpha <p>] [--json] [--pretty]"
     );
 }
 
+fn run_bootstrap(args: &[String]) {
+    let root = env::current_dir().unwrap_or_else(|_| ".".into());
+    let compiler = env::current_exe().unwrap_or_else(|_| "kooixc".into());
+    let options = match parse_bootstrap_options(args, BootstrapOptions::new(root, compiler)) {
+        Ok(options) => options,
+        Err(message) => {
+            eprintln!("{message}");
+            print_usage();
+            process::exit(2);
+        }
+    };
+
+    let plan = match kooixc::bootstrap::plan_v0_13(&options.bootstrap) {
+        Ok(plan) => plan,
+        Err(message) => {
+            eprintln!("error: {message}");
+            process::exit(2);
+        }
+    };
+    let report = kooixc::bootstrap::run_plan(
+        &plan,
+        &options.bootstrap.cache_dir,
+        options.bootstrap.jobs,
+        options.bootstrap.mem_budget_kb,
+    );
+
+    if options.json {
+        emit_json_output(report.to_json(), options.pretty);
+    } else {
+        for node in &report.nodes {
+            let rss = node
+                .maxrss_kb
+                .map(|kb| format!(" maxrss_kb={kb}"))
+                .unwrap_or_default();
+            println!(
+                "[{}] {} {:.3}s{rss}",
+                node.status.label(),
+                node.id,
+                node.seconds
+            );
+            if node.status == NodeStatus::Failed {
+                if let Some(error) = &node.error {
+                    eprintln!("error: {}: {error}", node.id);
+                }
+            }
+        }
+    }
+
+    if !report.ok() {
+        process::exit(1);
+    }
+    if let Err(message) = kooixc::bootstrap::publish_v0_13(&report, &options.bootstrap.out_dir) {
+        eprintln!("error: {message}");
+        process::exit(1);
+    }
+    if !options.json {
+        println!(
+            "ok: {}",
+            options.bootstrap.out_dir.join("kooixc1").display()
+        );
+    }
+}
+
+fn read_bench_input(path: &str) -> BenchSet {
+    let text = match fs::read_to_string(path) {
+        Ok(text) => text,
+        Err(error) => {
+            eprintln!("failed to read bench input {path}: {error}");
+            process::exit(2);
+        }
+    };
+    match kooixc::bench::parse_bench_input(&text) {
+        Ok(set) => set,
+        Err(message) => {
+            eprintln!("error: {path}: {message}");
+            process::exit(2);
+        }
+    }
+}
+
+fn run_bench_record(args: &[String]) {
+    let [store_path, runs @ ..] = args else {
+        print_usage();
+        process::exit(2);
+    };
+    if runs.is_empty() {
+        print_usage();
+        process::exit(2);
+    }
+
+    let mut store = if Path::new(store_path).exists() {
+        read_bench_input(store_path)
+    } else {
+        BenchSet::default()
+    };
+    for run in runs {
+        store.merge(&read_bench_input(run));
+    }
+    if let Err(error) = fs::write(store_path, store.to_json() + "\n") {
+        eprintln!("failed to write bench store {store_path}: {error}");
+        process::exit(2);
+    }
+    println!(
+        "ok: {} metric(s) recorded in {store_path}",
+        store.metrics.len()
+    );
+}
+
+fn run_bench_compare(args: &[String]) {
+    let options = match parse_bench_compare_options(args) {
+        Ok(options) => options,
+        Err(message) => {
+            eprintln!("{message}");
+            print_usage();
+            process::exit(2);
+        }
+    };
+
+    let baseline = read_bench_input(&options.baseline);
+    let current = read_bench_input(&options.current);
+    let report = kooixc::bench::compare(&baseline, &current, &options.compare);
+    if options.json {
+        emit_json_output(report.to_json(), options.pretty);
+    } else {
+        print!("{report}");
+    }
+    if report.regressions().next().is_some() {
+        process::exit(1);
+    }
+}
+
 fn report_native_error(error: NativeError, source_map: &SourceMap) {
     match error {
         NativeError::Diagnostics(diagnostics) => {
@@ -540,19 +835,420 @@ struct NativeOptions {
     timeout_ms: Option<u64>,
 }
 
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum RunEngine {
+    Interp,
+    Auto,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct RunOptions {
+    engine: RunEngine,
+}
+
+fn parse_run_options(args: &[String]) -> Result<RunOptions, String> {
+    let mut engine = RunEngine::Interp;
+    let mut args = args.iter();
+    while let Some(arg) = args.next() {
+        let value = if arg == "--engine" {
+            let Some(value) = args.next() else {
+                return Err("missing value for --engine".to_string());
+            };
+            value.as_str()
+        } else if let Some(value) = arg.strip_prefix("--engine=") {
+            value
+        } else if arg.starts_with("--") {
+            return Err(format!("unknown run option '{arg}'"));
+        } else {
+            return Err(format!("unexpected run argument '{arg}'"));
+        };
+        engine = match value {
+            "interp" => RunEngine::Interp,
+            "auto" => RunEngine::Auto,
+            other => {
+                return Err(format!(
+                    "invalid --engine value '{other}': expected interp or auto"
+                ))
+            }
+        };
+    }
+    Ok(RunOptions { engine })
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct CheckOptions {
+    analyze_latency: bool,
+    max_latency_ms: Option<u64>,
+}
+
+fn parse_check_options(args: &[String]) -> Result<CheckOptions, String> {
+    let mut analyze_latency = false;
+    let mut max_latency_ms: Option<u64> = None;
+
+    let mut index = 0;
+    while index < args.len() {
+        let arg = &args[index];
+        if arg == "--analyze-latency" {
+            analyze_latency = true;
+            index += 1;
+            continue;
+        }
+
+        if arg == "--max-latency-ms" {
+            let Some(value) = args.get(index + 1) else {
+                return Err("missing value for --max-latency-ms".to_string());
+            };
+            let parsed = value
+                .parse::<u64>()
+                .map_err(|_| format!("invalid --max-latency-ms value '{value}'"))?;
+            max_latency_ms = Some(parsed);
+            index += 2;
+            continue;
+        }
+
+        if arg.starts_with("--") {
+            return Err(format!("unknown check option '{arg}'"));
+        }
+
+        return Err(format!("unexpected check argument '{arg}'"));
+    }
+
+    if max_latency_ms.is_some() && !analyze_latency {
+        return Err("--max-latency-ms requires --analyze-latency".to_string());
+    }
+
+    Ok(CheckOptions {
+        analyze_latency,
+        max_latency_ms,
+    })
+}
+
+#[derive(Debug, Clone, PartialEq)]
+struct LoadtestCliOptions {
+    loadtest: LoadTestOptions,
+    json: bool,
+    pretty: bool,
+}
+
+fn parse_loadtest_options(args: &[String]) -> Result<LoadtestCliOptions, String> {
+    let mut target: Option<String> = None;
+    let mut loadtest = LoadTestOptions::new("");
+    let mut json = false;
+    let mut pretty = false;
+
+    let mut index = 0;
+    while index < args.len() {
+        let arg = args[index].as_str();
+        match arg {
+            "--json" => {
+                json = true;
+                index += 1;
+                continue;
+            }
+            "--pretty" => {
+                pretty = true;
+                index += 1;
+                continue;
+            }
+            _ => {}
+        }
+
+        if !arg.starts_with("--") {
+            return Err(format!("unexpected loadtest argument '{arg}'"));
+        }
+        let Some(value) = args.get(index + 1) else {
+            return Err(format!("missing value for {arg}"));
+        };
+        let invalid = || format!("invalid {arg} value '{value}'");
+        match arg {
+            "--target" => target = Some(value.clone()),
+            "--requests" => loadtest.requests = value.parse().map_err(|_| invalid())?,
+            "--concurrency" => {
+                loadtest.concurrency = value.parse().map_err(|_| invalid())?;
+                if loadtest.concurrency == 0 {
+                    return Err(invalid());
+                }
+            }
+            "--rate-start" => {
+                loadtest.rate_start = parse_non_negative(value).ok_or_else(invalid)?
+            }
+            "--rate-end" => loadtest.rate_end = parse_non_negative(value).ok_or_else(invalid)?,
+            "--time-scale" => {
+                loadtest.runtime.time_scale = parse_non_negative(value).ok_or_else(invalid)?
+            }
+            "--failure-rate" => {
+                loadtest.runtime.failure_rate = parse_non_negative(value)
+                    .filter(|rate| *rate <= 1.0)
+                    .ok_or_else(invalid)?
+            }
+            "--capability-limit" => {
+                loadtest.runtime.capability_limit = value.parse().map_err(|_| invalid())?;
+                if loadtest.runtime.capability_limit == 0 {
+                    return Err(invalid());
+                }
+            }
+            "--seed" => loadtest.runtime.seed = value.parse().map_err(|_| invalid())?,
+            "--journal" => loadtest.journal = Some(PathBuf::from(value)),
+            "--tenant" => {
+                let tenant = TenantSpec::parse(value)?;
+                if loadtest
+                    .tenants
+                    .iter()
+                    .any(|other| other.name == tenant.name)
+                {
+                    return Err(format!("duplicate tenant '{}'", tenant.name));
+                }
+                loadtest.tenants.push(tenant)
+            }
+            "--queue-target-ms" => {
+                loadtest.queue_target_ms = Some(parse_non_negative(value).ok_or_else(invalid)?)
+            }
+            "--admission" => {
+                loadtest.admission = match value.as_str() {
+                    "reject" => AdmissionPolicy::Reject,
+                    "defer" => AdmissionPolicy::Defer,
+                    _ => return Err(invalid()),
+                }
+            }
+            "--net" => {
+                loadtest.net = Some(match value.as_str() {
+                    "stand-in" => NetProvider::StandIn,
+                    _ => NetProvider::Endpoint(
+                        value
+                            .to_socket_addrs()
+                            .ok()
+                            .and_then(|mut addresses| addresses.next())
+                            .ok_or_else(invalid)?,
+                    ),
+                })
+            }
+            _ => return Err(format!("unknown loadtest option '{arg}'")),
+        }
+        index += 2;
+    }
+
+    match target {
+        Some(target) => loadtest.target = target,
+        None if !loadtest.tenants.is_empty() => {}
+        None => {
+            return Err(
+                "loadtest requires --target <workflow|agent> or --tenant <name>:<target>"
+                    .to_string(),
+            )
+        }
+    }
+    if !loadtest.tenants.is_empty() && !loadtest.target.is_empty() {
+        return Err("--target and --tenant are mutually exclusive".to_string());
+    }
+    if pretty && !json {
+        return Err("--pretty requires --json".to_string());
+    }
+
+    Ok(LoadtestCliOptions {
+        loadtest,
+        json,
+        pretty,
+    })
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct BootstrapCliOptions {
+    bootstrap: BootstrapOptions,
+    json: bool,
+    pretty: bool,
+}
+
+fn parse_bootstrap_options(
+    args: &[String],
+    defaults: BootstrapOptions,
+) -> Result<BootstrapCliOptions, String> {
+    let mut bootstrap = defaults;
+    let mut out_dir: Option<PathBuf> = None;
+    let mut cache_dir: Option<PathBuf> = None;
+    let mut smokes: Option<Vec<String>> = None;
+    let mut json = false;
+    let mut pretty = false;
+
+    let mut index = 0;
+    while index < args.len() {
+        let arg = args[index].as_str();
+        match arg {
+            "--json" => {
+                json = true;
+                index += 1;
+                continue;
+            }
+            "--pretty" => {
+                pretty = true;
+                index += 1;
+                continue;
+            }
+            _ => {}
+        }
+
+        if !arg.starts_with("--") {
+            if out_dir.is_some() {
+                return Err("multiple bootstrap output directories provided".to_string());
+            }
+            out_dir = Some(PathBuf::from(arg));
+            index += 1;
+            continue;
+        }
+        let Some(value) = args.get(index + 1) else {
+            return Err(format!("missing value for {arg}"));
+        };
+        let invalid = || format!("invalid {arg} value '{value}'");
+        match arg {
+            "--root" => bootstrap.root = PathBuf::from(value),
+            "--cache-dir" => cache_dir = Some(PathBuf::from(value)),
+            "--jobs" => {
+                bootstrap.jobs = value.parse().map_err(|_| invalid())?;
+                if bootstrap.jobs == 0 {
+                    return Err(invalid());
+                }
+            }
+            "--mem-budget-mb" => {
+                let mb: u64 = value.parse().map_err(|_| invalid())?;
+                bootstrap.mem_budget_kb = mb * 1024;
+            }
+            "--smoke" => smokes
+                .get_or_insert_with(Vec::new)
+                .extend(value.split(',').map(|name| name.trim().to_string())),
+            "--stage-timeout" => {
+                let seconds: u64 = value.parse().map_err(|_| invalid())?;
+                bootstrap.stage_timeout_ms = (seconds > 0).then_some(seconds * 1000);
+            }
+            "--smoke-timeout" => {
+                let seconds: u64 = value.parse().map_err(|_| invalid())?;
+                bootstrap.smoke_timeout_ms = (seconds > 0).then_some(seconds * 1000);
+            }
+            _ => return Err(format!("unknown bootstrap option '{arg}'")),
+        }
+        index += 2;
+    }
+
+    if let Some(smokes) = smokes {
+        kooixc::bootstrap::expand_smokes(&smokes)?;
+        bootstrap.smokes = smokes;
+    }
+    bootstrap.out_dir = match out_dir {
+        Some(dir) if dir.is_relative() => bootstrap.root.join(dir),
+        Some(dir) => dir,
+        None => bootstrap.root.join("dist"),
+    };
+    bootstrap.cache_dir = cache_dir.unwrap_or_else(|| bootstrap.out_dir.join(".bootstrap-cache"));
+    if pretty && !json {
+        return Err("--pretty requires --json".to_string());
+    }
+
+    Ok(BootstrapCliOptions {
+        bootstrap,
+        json,
+        pretty,
+    })
+}
+
+#[derive(Debug, Clone, PartialEq)]
+struct BenchCompareCliOptions {
+    baseline: String,
+    current: String,
+    compare: CompareOptions,
+    json: bool,
+    pretty: bool,
+}
+
+fn parse_bench_compare_options(args: &[String]) -> Result<BenchCompareCliOptions, String> {
+    let mut inputs: Vec<String> = Vec::new();
+    let mut compare = CompareOptions::default();
+    let mut json = false;
+    let mut pretty = false;
+
+    let mut index = 0;
+    while index < args.len() {
+        let arg = args[index].as_str();
+        match arg {
+            "--json" => {
+                json = true;
+                index += 1;
+                continue;
+            }
+            "--pretty" => {
+                pretty = true;
+                index += 1;
+                continue;
+            }
+            _ => {}
+        }
+
+        if !arg.starts_with("--") {
+            inputs.push(arg.to_string());
+            index += 1;
+            continue;
+        }
+        let Some(value) = args.get(index + 1) else {
+            return Err(format!("missing value for {arg}"));
+        };
+        let invalid = || format!("invalid {arg} value '{value}'");
+        match arg {
+            "--time-threshold" => {
+                compare.time_threshold_pct = parse_non_negative(value).ok_or_else(invalid)?
+            }
+            "--memory-threshold" => {
+                compare.memory_threshold_pct = parse_non_negative(value).ok_or_else(invalid)?
+            }
+            "--threshold" => {
+                let (pattern, pct) = value.rsplit_once('=').ok_or_else(invalid)?;
+                let pct = parse_non_negative(pct).ok_or_else(invalid)?;
+                compare.thresholds.push((pattern.to_string(), pct));
+            }
+            "--alpha" => {
+                compare.alpha = parse_non_negative(value)
+                    .filter(|alpha| *alpha > 0.0 && *alpha < 1.0)
+                    .ok_or_else(invalid)?
+            }
+            _ => return Err(format!("unknown bench-compare option '{arg}'")),
+        }
+        index += 2;
+    }
+
+    let [baseline, current] = <[String; 2]>::try_from(inputs)
+        .map_err(|_| "bench-compare requires <baseline> and <current>".to_string())?;
+    if pretty && !json {
+        return Err("--pretty requires --json".to_string());
+    }
+
+    Ok(BenchCompareCliOptions {
+        baseline,
+        current,
+        compare,
+        json,
+        pretty,
+    })
+}
+
+fn parse_non_negative(value: &str) -> Option<f64> {
+    value
+        .parse::<f64>()
+        .ok()
+        .filter(|parsed| parsed.is_finite() && *parsed >= 0.0)
+}
+
 #[derive(Debug, Clone, PartialEq, Eq)]
 struct CheckModulesOptions {
     json: bool,
     pretty: bool,
     strict_warnings: bool,
+    module: Option<String>,
 }
 
 fn parse_check_modules_options(args: &[String]) -> Result<CheckModulesOptions, String> {
     let mut json = false;
     let mut pretty = false;
     let mut strict_warnings = false;
+    let mut module = None;
 
-    for arg in args {
+    let mut args = args.iter();
+    while let Some(arg) = args.next() {
         if arg == "--json" {
             json = true;
             continue;
@@ -568,6 +1264,14 @@ fn parse_check_modules_options(args: &[String]) -> Result<CheckModulesOptions, S
             continue;
         }
 
+        if arg == "--module" {
+            let Some(value) = args.next() else {
+                return Err("missing value for --module".to_string());
+            };
+            module = Some(value.clone());
+            continue;
+        }
+
         if arg.starts_with("--") {
             return Err(format!("unknown check-modules option '{arg}'"));
         }
@@ -583,6 +1287,7 @@ fn parse_check_modules_options(args: &[String]) -> Result<CheckModulesOptions, S
         json,
         pretty,
         strict_warnings,
+        module,
     })
 }
 
@@ -676,8 +1381,286 @@ fn parse_native_options(args: &[String]) -> Result<NativeOptions, String> {
 #[cfg(test)]
 mod tests {
     use super::{
-        parse_check_modules_options, parse_native_options, CheckModulesOptions, NativeOptions,
+        extract_module_path, parse_bench_compare_options, parse_bootstrap_options,
+        parse_check_modules_options, parse_check_options, parse_loadtest_options,
+        parse_native_options, parse_run_options, CheckModulesOptions, CheckOptions, NativeOptions,
+        RunEngine,
     };
+    use kooixc::bootstrap::BootstrapOptions;
+    use kooixc::loadtest::NetProvider;
+    use kooixc::scheduler::AdmissionPolicy;
+
+    #[test]
+    fn parses_check_latency_options() {
+        let args: Vec<String> = vec![];
+        assert_eq!(
+            parse_check_options(&args).expect("should parse"),
+            CheckOptions {
+                analyze_latency: false,
+                max_latency_ms: None,
+            }
+        );
+
+        let args = vec![
+            "--analyze-latency".to_string(),
+            "--max-latency-ms".to_string(),
+            "1500".to_string(),
+        ];
+        assert_eq!(
+            parse_check_options(&args).expect("should parse"),
+            CheckOptions {
+                analyze_latency: true,
+                max_latency_ms: Some(1500),
+            }
+        );
+    }
+
+    #[test]
+    fn rejects_max_latency_without_analyze_latency() {
+        let args = vec!["--max-latency-ms".to_string(), "10".to_string()];
+        let error = parse_check_options(&args).expect_err("should reject");
+        assert!(error.contains("requires --analyze-latency"));
+    }
+
+    #[test]
+    fn parses_loadtest_options() {
+        let args = vec![
+            "--target".to_string(),
+            "Main".to_string(),
+            "--requests".to_string(),
+            "50".to_string(),
+            "--rate-start".to_string(),
+            "10".to_string(),
+            "--rate-end".to_string(),
+            "200".to_string(),
+            "--failure-rate".to_string(),
+            "0.25".to_string(),
+            "--journal".to_string(),
+            "run.kxj".to_string(),
+            "--json".to_string(),
+            "--pretty".to_string(),
+        ];
+        let options = parse_loadtest_options(&args).expect("should parse");
+        assert_eq!(options.loadtest.target, "Main");
+        assert_eq!(options.loadtest.requests, 50);
+        assert_eq!(options.loadtest.concurrency, 8);
+        assert_eq!(options.loadtest.rate_start, 10.0);
+        assert_eq!(options.loadtest.rate_end, 200.0);
+        assert_eq!(options.loadtest.runtime.failure_rate, 0.25);
+        assert_eq!(
+            options.loadtest.journal,
+            Some(std::path::PathBuf::from("run.kxj"))
+        );
+        assert!(options.json);
+        assert!(options.pretty);
+    }
+
+    #[test]
+    fn parses_loadtest_tenant_and_admission_options() {
+        let args: Vec<String> = [
+            "--tenant",
+            "nightly:report:1:4",
+            "--tenant",
+            "ui:answer:3",
+            "--queue-target-ms",
+            "50",
+            "--admission",
+            "defer",
+        ]
+        .iter()
+        .map(|arg| arg.to_string())
+        .collect();
+        let options = parse_loadtest_options(&args).expect("should parse");
+        assert_eq!(options.loadtest.tenants.len(), 2);
+        assert_eq!(options.loadtest.tenants[0].share, 4);
+        assert_eq!(options.loadtest.tenants[1].weight, 3);
+        assert_eq!(options.loadtest.tenants[1].share, 1);
+        assert_eq!(options.loadtest.queue_target_ms, Some(50.0));
+        assert_eq!(options.loadtest.admission, AdmissionPolicy::Defer);
+
+        let mut both = args.clone();
+        both.extend(["--target".to_string(), "answer".to_string()]);
+        let error = parse_loadtest_options(&both).expect_err("should reject");
+        assert!(error.contains("mutually exclusive"));
+
+        let error = parse_loadtest_options(&["--admission".to_string(), "drop".to_string()])
+            .expect_err("should reject");
+        assert!(error.contains("invalid --admission"));
+
+        let mut twice = args.clone();
+        twice.extend(["--tenant".to_string(), "ui:report".to_string()]);
+        let error = parse_loadtest_options(&twice).expect_err("should reject");
+        assert_eq!(error, "duplicate tenant 'ui'");
+    }
+
+    #[test]
+    fn parses_loadtest_net_provider() {
+        let args = |net: &str| {
+            ["--target", "answer", "--net", net]
+                .iter()
+                .map(|arg| arg.to_string())
+                .collect::<Vec<_>>()
+        };
+        let options = parse_loadtest_options(&args("stand-in")).expect("should parse");
+        assert_eq!(options.loadtest.net, Some(NetProvider::StandIn));
+
+        let options = parse_loadtest_options(&args("127.0.0.1:8080")).expect("should parse");
+        assert_eq!(
+            options.loadtest.net,
+            Some(NetProvider::Endpoint("127.0.0.1:8080".parse().unwrap()))
+        );
+
+        let options = parse_loadtest_options(&args("localhost:8080")).expect("should parse");
+        let Some(NetProvider::Endpoint(address)) = options.loadtest.net else {
+            panic!("expected an endpoint, got {:?}", options.loadtest.net);
+        };
+        assert!(address.ip().is_loopback());
+        assert_eq!(address.port(), 8080);
+
+        let error = parse_loadtest_options(&args("localhost")).expect_err("should reject");
+        assert!(error.contains("invalid --net"));
+    }
+
+    #[test]
+    fn rejects_invalid_loadtest_options() {
+        let error = parse_loadtest_options(&[]).expect_err("should reject");
+        assert!(error.contains("--target"));
+
+        let args = vec![
+            "--target".to_string(),
+            "Main".to_string(),
+            "--failure-rate".to_string(),
+            "1.5".to_string(),
+        ];
+        let error = parse_loadtest_options(&args).expect_err("should reject");
+        assert!(error.contains("invalid --failure-rate"));
+
+        let args = vec![
+            "--target".to_string(),
+            "Main".to_string(),
+            "--burst".to_string(),
+            "3".to_string(),
+        ];
+        let error = parse_loadtest_options(&args).expect_err("should reject");
+        assert!(error.contains("unknown loadtest option"));
+    }
+
+    #[test]
+    fn parses_bootstrap_options() {
+        let defaults = BootstrapOptions::new("/repo", "/bin/kooixc");
+        let options = parse_bootstrap_options(&[], defaults.clone()).expect("should parse");
+        assert_eq!(
+            options.bootstrap.out_dir,
+            std::path::Path::new("/repo/dist")
+        );
+        assert_eq!(
+            options.bootstrap.cache_dir,
+            std::path::Path::new("/repo/dist/.bootstrap-cache")
+        );
+        assert_eq!(options.bootstrap.smokes, vec!["stage2-min".to_string()]);
+
+        let args = vec![
+            "out".to_string(),
+            "--jobs".to_string(),
+            "3".to_string(),
+            "--mem-budget-mb".to_string(),
+            "512".to_string(),
+            "--smoke".to_string(),
+            "core,stdlib".to_string(),
+            "--stage-timeout".to_string(),
+            "0".to_string(),
+            "--json".to_string(),
+        ];
+        let options = parse_bootstrap_options(&args, defaults.clone()).expect("should parse");
+        assert_eq!(options.bootstrap.out_dir, std::path::Path::new("/repo/out"));
+        assert_eq!(options.bootstrap.jobs, 3);
+        assert_eq!(options.bootstrap.mem_budget_kb, 512 * 1024);
+        assert_eq!(options.bootstrap.smokes, vec!["core", "stdlib"]);
+        assert_eq!(options.bootstrap.stage_timeout_ms, None);
+        assert!(options.json);
+
+        let args = vec!["--smoke".to_string(), "s1-linker".to_string()];
+        let error = parse_bootstrap_options(&args, defaults.clone()).expect_err("should reject");
+        assert!(error.contains("unknown smoke"));
+
+        let args = vec!["--jobs".to_string(), "0".to_string()];
+        let error = parse_bootstrap_options(&args, defaults).expect_err("should reject");
+        assert!(error.contains("invalid --jobs"));
+    }
+
+    #[test]
+    fn parses_bench_compare_options() {
+        let args = vec![
+            "base.json".to_string(),
+            "--threshold".to_string(),
+            "bootstrap.stage*.seconds=10".to_string(),
+            "cur.json".to_string(),
+            "--alpha".to_string(),
+            "0.01".to_string(),
+            "--json".to_string(),
+        ];
+        let options = parse_bench_compare_options(&args).expect("should parse");
+        assert_eq!(options.baseline, "base.json");
+        assert_eq!(options.current, "cur.json");
+        assert_eq!(
+            options.compare.thresholds,
+            vec![("bootstrap.stage*.seconds".to_string(), 10.0)]
+        );
+        assert_eq!(options.compare.alpha, 0.01);
+        assert_eq!(options.compare.time_threshold_pct, 5.0);
+        assert!(options.json);
+
+        let error =
+            parse_bench_compare_options(&["base.json".to_string()]).expect_err("should reject");
+        assert!(error.contains("<baseline> and <current>"));
+
+        let args = vec![
+            "a".to_string(),
+            "b".to_string(),
+            "--alpha".to_string(),
+            "1".to_string(),
+        ];
+        let error = parse_bench_compare_options(&args).expect_err("should reject");
+        assert!(error.contains("invalid --alpha"));
+    }
+
+    #[test]
+    fn extracts_module_path_option() {
+        let args: Vec<String> = [
+            "kooixc",
+            "--module-path",
+            "/opt/kx/lib:vendor",
+            "native",
+            "main.kooix",
+            "--module-path",
+            "extra",
+            "--run",
+            "--",
+            "--module-path",
+            "arg",
+        ]
+        .iter()
+        .map(|arg| arg.to_string())
+        .collect();
+        let (rest, dirs) = extract_module_path(&args).expect("should parse");
+        assert_eq!(dirs, vec!["/opt/kx/lib", "vendor", "extra"]);
+        assert_eq!(
+            rest,
+            vec![
+                "kooixc",
+                "native",
+                "main.kooix",
+                "--run",
+                "--",
+                "--module-path",
+                "arg"
+            ]
+        );
+
+        let error = extract_module_path(&["kooixc".to_string(), "--module-path".to_string()])
+            .expect_err("should reject");
+        assert!(error.contains("missing value for --module-path"));
+    }
 
     #[test]
     fn parses_check_modules_defaults() {
@@ -689,6 +1672,7 @@ mod tests {
                 json: false,
                 pretty: false,
                 strict_warnings: false,
+                module: None,
             }
         );
     }
@@ -703,6 +1687,7 @@ mod tests {
                 json: true,
                 pretty: false,
                 strict_warnings: false,
+                module: None,
             }
         );
     }
@@ -717,6 +1702,7 @@ mod tests {
                 json: true,
                 pretty: true,
                 strict_warnings: false,
+                module: None,
             }
         );
     }
@@ -731,10 +1717,22 @@ mod tests {
                 json: false,
                 pretty: false,
                 strict_warnings: true,
+                module: None,
             }
         );
     }
 
+    #[test]
+    fn parses_check_modules_module_option() {
+        let args = vec!["--module".to_string(), "stage1/lexer.kooix".to_string()];
+        let options = parse_check_modules_options(&args).expect("should parse");
+        assert_eq!(options.module.as_deref(), Some("stage1/lexer.kooix"));
+
+        let error =
+            parse_check_modules_options(&["--module".to_string()]).expect_err("should fail");
+        assert!(error.contains("missing value for --module"));
+    }
+
     #[test]
     fn rejects_unknown_check_modules_option() {
         let args = vec!["--bad".to_string()];
@@ -756,6 +1754,26 @@ mod tests {
         assert!(error.contains("--pretty requires --json"));
     }
 
+    #[test]
+    fn parses_run_engine_option() {
+        let options = parse_run_options(&[]).expect("should parse");
+        assert_eq!(options.engine, RunEngine::Interp);
+
+        let options = parse_run_options(&["--engine=auto".to_string()]).expect("should parse");
+        assert_eq!(options.engine, RunEngine::Auto);
+
+        let args = vec!["--engine".to_string(), "interp".to_string()];
+        let options = parse_run_options(&args).expect("should parse");
+        assert_eq!(options.engine, RunEngine::Interp);
+
+        let error = parse_run_options(&["--engine=jit".to_string()]).expect_err("should fail");
+        assert!(error.contains("invalid --engine value 'jit'"));
+        let error = parse_run_options(&["--engine".to_string()]).expect_err("should fail");
+        assert!(error.contains("missing value for --engine"));
+        let error = parse_run_options(&["extra".to_string()]).expect_err("should fail");
+        assert!(error.contains("unexpected run argument"));
+    }
+
     #[test]
     fn parses_native_defaults() {
         let args: Vec<String> = vec![];
@@ -0,0 +1,114 @@
+//! Module search paths shared by the source loader and the host file intrinsics.
+//!
+//! A relative entry path is tried as given and an import next to its importer; failing that, both
+//! are looked up under each `KOOIX_PATH` entry (`:` separated; `kooixc --module-path` prepends to
+//! it), then under the stdlib root: the nearest of the working directory and its ancestors (up to
+//! 8 levels) that holds `stdlib/prelude.kooix`, falling back to the checkout this compiler was
+//! built from. The roots are discovered once per process and every hit is cached by the requested
+//! path, so a module costs one successful `open` after its first resolution instead of a `../`
+//! probe per read.
+
+use std::collections::HashMap;
+use std::env;
+use std::path::{Path, PathBuf};
+use std::sync::{Mutex, OnceLock};
+
+pub const KOOIX_PATH_ENV: &str = "KOOIX_PATH";
+
+const STDLIB_MARKER: &str = "stdlib/prelude.kooix";
+const MAX_ANCESTOR_LEVELS: usize = 8;
+
+/// Search roots after the path itself, in lookup order.
+pub fn search_roots() -> &'static [PathBuf] {
+    static ROOTS: OnceLock<Vec<PathBuf>> = OnceLock::new();
+    ROOTS.get_or_init(|| {
+        let mut roots = Vec::new();
+        if let Some(value) = env::var_os(KOOIX_PATH_ENV) {
+            for dir in env::split_paths(&value) {
+                if !dir.as_os_str().is_empty() && !roots.contains(&dir) {
+                    roots.push(dir);
+                }
+            }
+        }
+        if let Some(stdlib_root) = discover_stdlib_root() {
+            // The working directory itself is already covered by trying the path as given.
+            if stdlib_root != Path::new(".") && !roots.contains(&stdlib_root) {
+                roots.push(stdlib_root);
+            }
+        }
+        roots
+    })
+}
+
+/// Where `path` actually lives, or `path` unchanged when no root has it (so the caller's read
+/// reports the path the user wrote).
+pub fn resolve(path: &Path) -> PathBuf {
+    if path.is_absolute() {
+        return path.to_path_buf();
+    }
+    let candidates = std::iter::once(path.to_path_buf())
+        .chain(search_roots().iter().map(|root| root.join(path)));
+    find_cached(path, candidates).unwrap_or_else(|| path.to_path_buf())
+}
+
+/// Target of `import "<raw>"` in a file under `base_dir`: next to the importer, else under the
+/// search roots. Unresolvable imports keep the importer-relative path for the error message.
+pub fn resolve_import(base_dir: &Path, raw: &str) -> PathBuf {
+    let mut relative = PathBuf::from(raw);
+    if relative.extension().is_none() {
+        relative.set_extension("kooix");
+    }
+    let joined = base_dir.join(&relative);
+    if relative.is_absolute() {
+        return joined;
+    }
+    let candidates = std::iter::once(joined.clone())
+        .chain(search_roots().iter().map(|root| root.join(&relative)));
+    find_cached(&joined, candidates).unwrap_or(joined)
+}
+
+fn find_cached(key: &Path, candidates: impl Iterator<Item = PathBuf>) -> Option<PathBuf> {
+    static CACHE: OnceLock<Mutex<HashMap<PathBuf, PathBuf>>> = OnceLock::new();
+    let cache = CACHE.get_or_init(|| Mutex::new(HashMap::new()));
+    if let Some(hit) = cache.lock().ok().and_then(|map| map.get(key).cloned()) {
+        return Some(hit);
+    }
+
+    // Misses are not cached: a long-lived process may create the file later.
+    let found = candidates
+        .into_iter()
+        .find(|candidate| candidate.is_file())?;
+    if let Ok(mut map) = cache.lock() {
+        map.insert(key.to_path_buf(), found.clone());
+    }
+    Some(found)
+}
+
+/// `resolve` for host intrinsics, which take module paths with an optional `.kooix` extension.
+pub fn resolve_module(raw: &str) -> PathBuf {
+    let mut entry = PathBuf::from(raw);
+    if entry.extension().is_none() {
+        entry.set_extension("kooix");
+    }
+    resolve(&entry)
+}
+
+fn discover_stdlib_root() -> Option<PathBuf> {
+    let mut prefix = PathBuf::new();
+    for _ in 0..=MAX_ANCESTOR_LEVELS {
+        if prefix.join(STDLIB_MARKER).is_file() {
+            return Some(if prefix.as_os_str().is_empty() {
+                PathBuf::from(".")
+            } else {
+                prefix
+            });
+        }
+        prefix.push("..");
+    }
+
+    let checkout = Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+    if checkout.join(STDLIB_MARKER).is_file() {
+        return Some(checkout);
+    }
+    None
+}
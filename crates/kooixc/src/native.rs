@@ -12,17 +12,19 @@ use std::time::{Duration, Instant};
 use std::time::{SystemTime, UNIX_EPOCH};
 
 use crate::error::Diagnostic;
+use crate::util::Fnv1a64;
 
 #[cfg(unix)]
 extern "C" {
     fn kill(pid: c_int, sig: c_int) -> c_int;
+    fn getuid() -> u32;
 }
 
 #[cfg(unix)]
 const SIGKILL: c_int = 9;
 
 #[cfg(unix)]
-fn kill_process_group(pid: u32) -> std::io::Result<()> {
+pub(crate) fn kill_process_group(pid: u32) -> std::io::Result<()> {
     let pid = pid as c_int;
     let result = unsafe { kill(-pid, SIGKILL) };
     if result == 0 {
@@ -220,7 +222,6 @@ pub fn compile_llvm_ir_to_executable_with_tools(
     let temp_dir = create_temp_workdir()?;
     let ll_path = temp_dir.join("module.ll");
     let obj_path = temp_dir.join("module.o");
-    let runtime_obj_path = temp_dir.join("runtime.o");
 
     fs::write(&ll_path, ir)?;
 
@@ -233,39 +234,28 @@ pub fn compile_llvm_ir_to_executable_with_tools(
             // Many modern toolchains default to linking PIE binaries. Ensure generated objects are
             // position-independent so linking works without additional flags.
             "-relocation-model=pic",
+            // Frame pointers stay in every function so the `KX_PROFILE` sampler can walk stacks.
+            "-frame-pointer=all",
             ll_path_string.as_str(),
             "-o",
             obj_path_string.as_str(),
         ],
     )?;
 
-    // Compile native runtime helpers (libc-only C).
-    let runtime_c_path = PathBuf::from(env!("CARGO_MANIFEST_DIR"))
-        .join("native_runtime")
-        .join("runtime.c");
-    let runtime_c_string = runtime_c_path.to_string_lossy().to_string();
-    let runtime_obj_string = runtime_obj_path.to_string_lossy().to_string();
-    run_command(
-        clang_tool,
-        &[
-            "-c",
-            runtime_c_string.as_str(),
-            "-o",
-            runtime_obj_string.as_str(),
-            "-std=c99",
-            "-O2",
-            "-fPIC",
-        ],
-    )?;
+    // Native runtime helpers (libc-only C), linked as an archive so the linker can drop every
+    // helper section the program never reaches.
+    let runtime_archive = native_runtime_archive(clang_tool, &temp_dir)?;
+    let runtime_archive_string = runtime_archive.to_string_lossy().to_string();
 
     let output_path_string = output_path.to_string_lossy().to_string();
     run_command(
         clang_tool,
         &[
             obj_path_string.as_str(),
-            runtime_obj_string.as_str(),
+            runtime_archive_string.as_str(),
             "-o",
             output_path_string.as_str(),
+            GC_SECTIONS_FLAG,
         ],
     )?;
 
@@ -273,6 +263,177 @@ pub fn compile_llvm_ir_to_executable_with_tools(
     Ok(())
 }
 
+/// Builds a module that needs nothing from the native runtime (no host intrinsics, no `main`)
+/// into a shared object for `dlopen`.
+pub fn compile_llvm_ir_to_shared_object(ir: &str, output_path: &Path) -> Result<(), NativeError> {
+    let temp_dir = create_temp_workdir()?;
+    let ll_path = temp_dir.join("module.ll");
+    let obj_path = temp_dir.join("module.o");
+    fs::write(&ll_path, ir)?;
+
+    let ll_path_string = ll_path.to_string_lossy().to_string();
+    let obj_path_string = obj_path.to_string_lossy().to_string();
+    let result = run_command(
+        "llc",
+        &[
+            "-filetype=obj",
+            "-relocation-model=pic",
+            "-frame-pointer=all",
+            ll_path_string.as_str(),
+            "-o",
+            obj_path_string.as_str(),
+        ],
+    )
+    .and_then(|()| {
+        if let Some(parent) = output_path.parent() {
+            fs::create_dir_all(parent)?;
+        }
+        let output_path_string = output_path.to_string_lossy().to_string();
+        let mut args = vec!["-shared", obj_path_string.as_str()];
+        args.extend_from_slice(SHARED_OBJECT_FLAGS);
+        args.extend(["-o", output_path_string.as_str()]);
+        run_command("clang", &args)
+    });
+
+    let _ = fs::remove_dir_all(&temp_dir);
+    result
+}
+
+// Calls between functions of one shared object bind inside it, not to same-named symbols that an
+// earlier tier-up or the host already exported.
+#[cfg(target_os = "macos")]
+const SHARED_OBJECT_FLAGS: &[&str] = &[];
+#[cfg(not(target_os = "macos"))]
+const SHARED_OBJECT_FLAGS: &[&str] = &["-Wl,-Bsymbolic"];
+
+#[cfg(target_os = "macos")]
+const GC_SECTIONS_FLAG: &str = "-Wl,-dead_strip";
+#[cfg(not(target_os = "macos"))]
+const GC_SECTIONS_FLAG: &str = "-Wl,--gc-sections";
+
+const RUNTIME_CFLAGS: &[&str] = &[
+    "-std=c99",
+    "-O2",
+    "-fPIC",
+    "-fno-omit-frame-pointer",
+    "-ffunction-sections",
+    "-fdata-sections",
+];
+
+/// `libkooixrt.a` for the current `runtime.c`, built once per runtime source, C compiler and flags
+/// and shared by later builds through the per-user [`runtime_cache_dir`]. Falls back to the bare
+/// object in `work_dir` when `ar` is unavailable, and to an uncached archive in `work_dir` when no
+/// trustworthy cache directory exists.
+fn native_runtime_archive(
+    clang_tool: &'static str,
+    work_dir: &Path,
+) -> Result<PathBuf, NativeError> {
+    let runtime_c_path = PathBuf::from(env!("CARGO_MANIFEST_DIR"))
+        .join("native_runtime")
+        .join("runtime.c");
+    let mut key = Fnv1a64::new();
+    key.write(&fs::read(&runtime_c_path)?);
+    key.write(clang_tool.as_bytes());
+    key.write(command_stdout(clang_tool, &["--version"])?.as_bytes());
+    for flag in RUNTIME_CFLAGS {
+        key.write(flag.as_bytes());
+    }
+    let cache_dir = runtime_cache_dir(key.finish());
+    let cached = cache_dir.as_ref().map(|dir| dir.join("libkooixrt.a"));
+    if let Some(cached) = cached.as_ref().filter(|cached| cached.is_file()) {
+        return Ok(cached.clone());
+    }
+
+    let runtime_c_string = runtime_c_path.to_string_lossy().to_string();
+    let runtime_obj_path = work_dir.join("runtime.o");
+    let runtime_obj_string = runtime_obj_path.to_string_lossy().to_string();
+    let mut args = vec![
+        "-c",
+        runtime_c_string.as_str(),
+        "-o",
+        runtime_obj_string.as_str(),
+    ];
+    args.extend_from_slice(RUNTIME_CFLAGS);
+    run_command(clang_tool, &args)?;
+
+    let archive_path = work_dir.join("libkooixrt.a");
+    let archive_string = archive_path.to_string_lossy().to_string();
+    match run_command(
+        "ar",
+        &["rcs", archive_string.as_str(), runtime_obj_string.as_str()],
+    ) {
+        Ok(()) => {}
+        Err(NativeError::ToolNotFound(_)) => return Ok(runtime_obj_path),
+        Err(error) => return Err(error),
+    }
+
+    let Some(cached) = cached else {
+        return Ok(archive_path);
+    };
+    // Publish by rename so concurrent builds never link a half-written archive; losing the race
+    // to another build is fine since both archives are identical.
+    if fs::rename(&archive_path, &cached).is_err() && !cached.is_file() {
+        return Ok(archive_path);
+    }
+    Ok(cached)
+}
+
+/// `$XDG_CACHE_HOME/kooixc/runtime-<key>` (or `~/.cache/...`), created private to the current
+/// user. `None` when neither variable names an absolute directory or when the directory is not
+/// owned by us with mode 0700, so a shared or planted directory is never linked from.
+fn runtime_cache_dir(key: u64) -> Option<PathBuf> {
+    let base = std::env::var_os("XDG_CACHE_HOME")
+        .map(PathBuf::from)
+        .filter(|path| path.is_absolute())
+        .or_else(|| {
+            std::env::var_os("HOME")
+                .map(|home| PathBuf::from(home).join(".cache"))
+                .filter(|path| path.is_absolute())
+        })?;
+    let dir = base.join("kooixc").join(format!("runtime-{key:016x}"));
+    create_private_dir(&dir).ok()?;
+    Some(dir)
+}
+
+#[cfg(unix)]
+fn create_private_dir(dir: &Path) -> std::io::Result<()> {
+    use std::os::unix::fs::{DirBuilderExt, MetadataExt};
+
+    match fs::DirBuilder::new()
+        .recursive(true)
+        .mode(0o700)
+        .create(dir)
+    {
+        Ok(()) => {}
+        Err(error) if error.kind() == std::io::ErrorKind::AlreadyExists => {}
+        Err(error) => return Err(error),
+    }
+    let metadata = fs::symlink_metadata(dir)?;
+    let uid = unsafe { getuid() };
+    if !metadata.is_dir() || metadata.uid() != uid || metadata.mode() & 0o077 != 0 {
+        return Err(std::io::Error::new(
+            std::io::ErrorKind::PermissionDenied,
+            format!("{} is not a private directory", dir.display()),
+        ));
+    }
+    Ok(())
+}
+
+#[cfg(not(unix))]
+fn create_private_dir(dir: &Path) -> std::io::Result<()> {
+    fs::create_dir_all(dir)
+}
+
+fn command_stdout(tool: &'static str, args: &[&str]) -> Result<String, NativeError> {
+    match Command::new(tool).args(args).output() {
+        Ok(output) => Ok(String::from_utf8_lossy(&output.stdout).to_string()),
+        Err(error) if error.kind() == std::io::ErrorKind::NotFound => {
+            Err(NativeError::ToolNotFound(tool))
+        }
+        Err(error) => Err(NativeError::Io(error)),
+    }
+}
+
 fn run_command(tool: &'static str, args: &[&str]) -> Result<(), NativeError> {
     let output = match Command::new(tool).args(args).output() {
         Ok(output) => output,
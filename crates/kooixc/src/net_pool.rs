@@ -0,0 +1,671 @@
+//! HTTP/1.1 keep-alive client pool for `Net<"host">` capability providers.
+//!
+//! Connections are pooled per capability host. A request takes an idle connection when one is
+//! available, opens a new one while the host is under `max_per_host`, and otherwise waits for a
+//! connection to come back. A connection is returned after a response only if the response is
+//! framed (`Content-Length` or chunked) and neither side asked to close. Idle connections older
+//! than `idle_timeout` are closed on the next acquire or by `evict_idle`.
+//!
+//! `pipeline` writes runs of idempotent, bodiless requests (`GET`/`HEAD`) back to back on one
+//! connection (up to `pipeline_depth`) and reads the responses in order. Other requests go one at
+//! a time. When a reused connection turns out to have been closed by the peer before any response
+//! bytes arrive, an idempotent batch is retried once on a fresh connection. That is the usual
+//! keep-alive race with the server's idle timeout. Pipelining is only reachable through
+//! `pipeline`: `WorkflowRuntime` sends each capability call as its own `request`.
+//!
+//! Response bodies, whether sized by `Content-Length`, chunks or close, are capped at
+//! `MAX_BODY_BYTES`; a larger body fails the request instead of being buffered.
+//!
+//! Plain `http` only: TLS would wrap the stream in `connect` and change nothing else here.
+//! `StandInServer` is a local keep-alive server for tests and `loadtest --net stand-in`.
+
+use std::collections::HashMap;
+use std::io::{self, BufRead, BufReader, Read, Write};
+use std::net::{Shutdown, SocketAddr, TcpListener, TcpStream, ToSocketAddrs};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+/// Largest response body a request will buffer.
+pub const MAX_BODY_BYTES: usize = 64 << 20;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct NetPoolOptions {
+    pub max_per_host: usize,
+    pub idle_timeout: Duration,
+    /// Requests written ahead of their responses on one connection; `1` disables pipelining.
+    pub pipeline_depth: usize,
+    /// Connect every host here instead of resolving it (stand-in servers, proxies).
+    pub connect_to: Option<SocketAddr>,
+    pub io_timeout: Duration,
+}
+
+impl Default for NetPoolOptions {
+    fn default() -> Self {
+        Self {
+            max_per_host: 8,
+            idle_timeout: Duration::from_secs(30),
+            pipeline_depth: 8,
+            connect_to: None,
+            io_timeout: Duration::from_secs(30),
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct HttpRequest {
+    pub method: String,
+    pub path: String,
+    pub headers: Vec<(String, String)>,
+    pub body: Vec<u8>,
+}
+
+impl HttpRequest {
+    pub fn get(path: impl Into<String>) -> Self {
+        Self {
+            method: "GET".to_string(),
+            path: path.into(),
+            headers: Vec::new(),
+            body: Vec::new(),
+        }
+    }
+
+    pub fn post(path: impl Into<String>, body: impl Into<Vec<u8>>) -> Self {
+        Self {
+            method: "POST".to_string(),
+            path: path.into(),
+            headers: Vec::new(),
+            body: body.into(),
+        }
+    }
+
+    /// Safe to pipeline and to resend after a stale connection.
+    fn idempotent(&self) -> bool {
+        matches!(self.method.as_str(), "GET" | "HEAD") && self.body.is_empty()
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct HttpResponse {
+    pub status: u16,
+    pub headers: Vec<(String, String)>,
+    pub body: Vec<u8>,
+    /// The connection may carry another request after this response.
+    pub keep_alive: bool,
+}
+
+impl HttpResponse {
+    pub fn header(&self, name: &str) -> Option<&str> {
+        header(&self.headers, name)
+    }
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct NetPoolStats {
+    pub requests: u64,
+    pub connections_opened: u64,
+    /// Requests sent on a connection that had already served one.
+    pub reused: u64,
+    /// Requests written while an earlier response on the same connection was still pending.
+    pub pipelined: u64,
+    pub evicted_idle: u64,
+    /// Connections dropped after a response because it was unframed or asked to close.
+    pub closed: u64,
+    pub stale_retries: u64,
+}
+
+struct Connection {
+    reader: BufReader<TcpStream>,
+    writer: TcpStream,
+    served: u64,
+}
+
+struct HostState {
+    idle: Vec<(Connection, Instant)>,
+    open: usize,
+}
+
+struct HostPool {
+    state: Mutex<HostState>,
+    released: Condvar,
+}
+
+pub struct NetPool {
+    options: NetPoolOptions,
+    hosts: Mutex<HashMap<String, Arc<HostPool>>>,
+    stats: Mutex<NetPoolStats>,
+}
+
+impl NetPool {
+    pub fn new(options: NetPoolOptions) -> Self {
+        Self {
+            options: NetPoolOptions {
+                max_per_host: options.max_per_host.max(1),
+                pipeline_depth: options.pipeline_depth.max(1),
+                ..options
+            },
+            hosts: Mutex::new(HashMap::new()),
+            stats: Mutex::new(NetPoolStats::default()),
+        }
+    }
+
+    pub fn request(&self, host: &str, request: HttpRequest) -> Result<HttpResponse, String> {
+        self.pipeline(host, vec![request]).pop().unwrap()
+    }
+
+    /// Sends `requests` to `host`, pipelining where safe; responses come back in request order.
+    pub fn pipeline(
+        &self,
+        host: &str,
+        requests: Vec<HttpRequest>,
+    ) -> Vec<Result<HttpResponse, String>> {
+        let mut responses = Vec::with_capacity(requests.len());
+        let mut batch: Vec<HttpRequest> = Vec::new();
+        for request in requests {
+            if !request.idempotent() || batch.len() == self.options.pipeline_depth {
+                responses.extend(self.send_batch(host, std::mem::take(&mut batch)));
+            }
+            if request.idempotent() {
+                batch.push(request);
+            } else {
+                responses.extend(self.send_batch(host, vec![request]));
+            }
+        }
+        responses.extend(self.send_batch(host, batch));
+        responses
+    }
+
+    /// Closes idle connections past `idle_timeout`; returns how many.
+    pub fn evict_idle(&self) -> usize {
+        let pools: Vec<Arc<HostPool>> = self.hosts.lock().unwrap().values().cloned().collect();
+        let mut evicted = 0;
+        for pool in pools {
+            let mut state = pool.state.lock().unwrap();
+            evicted += self.evict_expired(&mut state);
+        }
+        evicted
+    }
+
+    pub fn stats(&self) -> NetPoolStats {
+        *self.stats.lock().unwrap()
+    }
+
+    fn send_batch(&self, host: &str, batch: Vec<HttpRequest>) -> Vec<Result<HttpResponse, String>> {
+        if batch.is_empty() {
+            return Vec::new();
+        }
+        let pool = self.host_pool(host);
+        let retriable = batch.iter().all(HttpRequest::idempotent);
+        let mut attempt = 0;
+        loop {
+            let mut connection = match self.acquire(host, &pool) {
+                Ok(connection) => connection,
+                Err(error) => return batch.iter().map(|_| Err(error.clone())).collect(),
+            };
+            let reused = connection.served > 0;
+            // A stale retry resends the same requests; count them once.
+            if attempt == 0 {
+                self.stats.lock().unwrap().requests += batch.len() as u64;
+            }
+            match self.exchange(host, &mut connection, &batch) {
+                Exchange::Done(responses) => {
+                    let reusable = responses.last().is_some_and(|response| response.keep_alive);
+                    self.release(&pool, connection, reusable);
+                    return responses.into_iter().map(Ok).collect();
+                }
+                Exchange::Stale if reused && retriable && attempt == 0 => {
+                    self.release(&pool, connection, false);
+                    self.stats.lock().unwrap().stale_retries += 1;
+                    attempt += 1;
+                }
+                Exchange::Stale => {
+                    self.release(&pool, connection, false);
+                    let error = format!("{host}: connection closed before response");
+                    return batch.iter().map(|_| Err(error.clone())).collect();
+                }
+                Exchange::Failed(done, error) => {
+                    self.release(&pool, connection, false);
+                    let mut results: Vec<Result<HttpResponse, String>> =
+                        done.into_iter().map(Ok).collect();
+                    results.resize(batch.len(), Err(format!("{host}: {error}")));
+                    return results;
+                }
+            }
+        }
+    }
+
+    fn exchange(&self, host: &str, connection: &mut Connection, batch: &[HttpRequest]) -> Exchange {
+        let mut wire = Vec::new();
+        for request in batch {
+            encode_request(host, request, &mut wire);
+        }
+        {
+            let mut stats = self.stats.lock().unwrap();
+            stats.pipelined += batch.len() as u64 - 1;
+            stats.reused += if connection.served > 0 {
+                batch.len() as u64
+            } else {
+                batch.len() as u64 - 1
+            };
+        }
+        if let Err(error) = connection.writer.write_all(&wire) {
+            return if connection.served > 0 {
+                Exchange::Stale
+            } else {
+                Exchange::Failed(Vec::new(), error.to_string())
+            };
+        }
+
+        let mut responses = Vec::with_capacity(batch.len());
+        for request in batch {
+            match read_response(&mut connection.reader, request.method == "HEAD") {
+                Ok(response) => {
+                    connection.served += 1;
+                    let keep_alive = response.keep_alive;
+                    responses.push(response);
+                    if !keep_alive && responses.len() < batch.len() {
+                        return Exchange::Failed(
+                            responses,
+                            "server closed a pipelined connection".to_string(),
+                        );
+                    }
+                }
+                Err(ReadError::Eof) if responses.is_empty() => return Exchange::Stale,
+                Err(ReadError::Eof) => {
+                    return Exchange::Failed(
+                        responses,
+                        "connection closed mid-pipeline".to_string(),
+                    )
+                }
+                Err(ReadError::Io(error)) => return Exchange::Failed(responses, error),
+            }
+        }
+        Exchange::Done(responses)
+    }
+
+    fn host_pool(&self, host: &str) -> Arc<HostPool> {
+        self.hosts
+            .lock()
+            .unwrap()
+            .entry(host.to_string())
+            .or_insert_with(|| {
+                Arc::new(HostPool {
+                    state: Mutex::new(HostState {
+                        idle: Vec::new(),
+                        open: 0,
+                    }),
+                    released: Condvar::new(),
+                })
+            })
+            .clone()
+    }
+
+    fn acquire(&self, host: &str, pool: &HostPool) -> Result<Connection, String> {
+        let mut state = pool.state.lock().unwrap();
+        loop {
+            self.evict_expired(&mut state);
+            // Most recently used first: the least likely to have hit the server's idle timeout.
+            if let Some((connection, _)) = state.idle.pop() {
+                return Ok(connection);
+            }
+            if state.open < self.options.max_per_host {
+                state.open += 1;
+                break;
+            }
+            state = pool.released.wait(state).unwrap();
+        }
+        drop(state);
+
+        match self.connect(host) {
+            Ok(connection) => {
+                self.stats.lock().unwrap().connections_opened += 1;
+                Ok(connection)
+            }
+            Err(error) => {
+                pool.state.lock().unwrap().open -= 1;
+                pool.released.notify_one();
+                Err(format!("{host}: {error}"))
+            }
+        }
+    }
+
+    fn release(&self, pool: &HostPool, connection: Connection, reusable: bool) {
+        let mut state = pool.state.lock().unwrap();
+        if reusable {
+            state.idle.push((connection, Instant::now()));
+        } else {
+            state.open -= 1;
+            let _ = connection.writer.shutdown(Shutdown::Both);
+            self.stats.lock().unwrap().closed += 1;
+        }
+        drop(state);
+        pool.released.notify_one();
+    }
+
+    fn evict_expired(&self, state: &mut HostState) -> usize {
+        let before = state.idle.len();
+        let timeout = self.options.idle_timeout;
+        state.idle.retain(|(_, since)| since.elapsed() < timeout);
+        let evicted = before - state.idle.len();
+        if evicted > 0 {
+            state.open -= evicted;
+            self.stats.lock().unwrap().evicted_idle += evicted as u64;
+        }
+        evicted
+    }
+
+    fn connect(&self, host: &str) -> io::Result<Connection> {
+        let address = match self.options.connect_to {
+            Some(address) => address,
+            None => {
+                let authority = if host.contains(':') {
+                    host.to_string()
+                } else {
+                    format!("{host}:80")
+                };
+                authority.to_socket_addrs()?.next().ok_or_else(|| {
+                    io::Error::new(io::ErrorKind::NotFound, "host did not resolve")
+                })?
+            }
+        };
+        let stream = TcpStream::connect_timeout(&address, self.options.io_timeout)?;
+        stream.set_nodelay(true)?;
+        stream.set_read_timeout(Some(self.options.io_timeout))?;
+        stream.set_write_timeout(Some(self.options.io_timeout))?;
+        Ok(Connection {
+            writer: stream.try_clone()?,
+            reader: BufReader::new(stream),
+            served: 0,
+        })
+    }
+}
+
+enum Exchange {
+    Done(Vec<HttpResponse>),
+    /// The peer had closed the connection before sending anything back.
+    Stale,
+    /// Responses received before the failure, and the error.
+    Failed(Vec<HttpResponse>, String),
+}
+
+enum ReadError {
+    Eof,
+    Io(String),
+}
+
+fn encode_request(host: &str, request: &HttpRequest, wire: &mut Vec<u8>) {
+    wire.extend_from_slice(
+        format!(
+            "{} {} HTTP/1.1\r\nHost: {host}\r\n",
+            request.method, request.path
+        )
+        .as_bytes(),
+    );
+    for (name, value) in &request.headers {
+        wire.extend_from_slice(format!("{name}: {value}\r\n").as_bytes());
+    }
+    if !request.body.is_empty() || request.method == "POST" || request.method == "PUT" {
+        wire.extend_from_slice(format!("Content-Length: {}\r\n", request.body.len()).as_bytes());
+    }
+    wire.extend_from_slice(b"\r\n");
+    wire.extend_from_slice(&request.body);
+}
+
+fn read_response(reader: &mut BufReader<TcpStream>, head: bool) -> Result<HttpResponse, ReadError> {
+    let io_error = |error: io::Error| ReadError::Io(error.to_string());
+    let mut line = String::new();
+    // A reset before any response byte is the peer closing an idle connection, same as EOF.
+    match reader.read_line(&mut line) {
+        Ok(0) => return Err(ReadError::Eof),
+        Ok(_) => {}
+        Err(error)
+            if matches!(
+                error.kind(),
+                io::ErrorKind::ConnectionReset | io::ErrorKind::ConnectionAborted
+            ) =>
+        {
+            return Err(ReadError::Eof)
+        }
+        Err(error) => return Err(io_error(error)),
+    }
+    let mut parts = line.trim_end().splitn(3, ' ');
+    let version = parts.next().unwrap_or_default().to_string();
+    let status: u16 = parts
+        .next()
+        .and_then(|code| code.parse().ok())
+        .ok_or_else(|| ReadError::Io(format!("malformed status line '{}'", line.trim_end())))?;
+    let headers = read_headers(reader).map_err(io_error)?;
+
+    let connection = header(&headers, "connection").map(str::to_ascii_lowercase);
+    let mut keep_alive = match version.as_str() {
+        "HTTP/1.1" => connection.as_deref() != Some("close"),
+        _ => connection.as_deref() == Some("keep-alive"),
+    };
+    let body = if head || status / 100 == 1 || status == 204 || status == 304 {
+        Vec::new()
+    } else if header(&headers, "transfer-encoding")
+        .is_some_and(|encoding| encoding.eq_ignore_ascii_case("chunked"))
+    {
+        read_chunked(reader).map_err(io_error)?
+    } else if let Some(length) = header(&headers, "content-length") {
+        let length: usize = length
+            .trim()
+            .parse()
+            .map_err(|_| ReadError::Io(format!("invalid Content-Length '{length}'")))?;
+        if length > MAX_BODY_BYTES {
+            return Err(ReadError::Io(body_too_large().to_string()));
+        }
+        let mut body = vec![0; length];
+        reader.read_exact(&mut body).map_err(io_error)?;
+        body
+    } else {
+        // Delimited by close: the connection cannot carry anything else.
+        keep_alive = false;
+        let mut body = Vec::new();
+        reader
+            .take(MAX_BODY_BYTES as u64 + 1)
+            .read_to_end(&mut body)
+            .map_err(io_error)?;
+        if body.len() > MAX_BODY_BYTES {
+            return Err(ReadError::Io(body_too_large().to_string()));
+        }
+        body
+    };
+    Ok(HttpResponse {
+        status,
+        headers,
+        body,
+        keep_alive,
+    })
+}
+
+fn read_headers(reader: &mut impl BufRead) -> io::Result<Vec<(String, String)>> {
+    let mut headers = Vec::new();
+    loop {
+        let mut line = String::new();
+        if reader.read_line(&mut line)? == 0 {
+            return Err(io::ErrorKind::UnexpectedEof.into());
+        }
+        let line = line.trim_end();
+        if line.is_empty() {
+            return Ok(headers);
+        }
+        if let Some((name, value)) = line.split_once(':') {
+            headers.push((name.trim().to_string(), value.trim().to_string()));
+        }
+    }
+}
+
+fn read_chunked(reader: &mut impl BufRead) -> io::Result<Vec<u8>> {
+    let mut body = Vec::new();
+    loop {
+        let mut line = String::new();
+        reader.read_line(&mut line)?;
+        let size = line.trim().split(';').next().unwrap_or_default();
+        let size = usize::from_str_radix(size, 16)
+            .map_err(|_| io::Error::new(io::ErrorKind::InvalidData, "invalid chunk size"))?;
+        if size == 0 {
+            // Trailers, then the blank line.
+            read_headers(reader)?;
+            return Ok(body);
+        }
+        if size > MAX_BODY_BYTES - body.len() {
+            return Err(body_too_large());
+        }
+        let start = body.len();
+        body.resize(start + size, 0);
+        reader.read_exact(&mut body[start..])?;
+        let mut crlf = [0; 2];
+        reader.read_exact(&mut crlf)?;
+    }
+}
+
+fn body_too_large() -> io::Error {
+    io::Error::new(
+        io::ErrorKind::InvalidData,
+        format!("response body exceeds {MAX_BODY_BYTES} bytes"),
+    )
+}
+
+fn header<'a>(headers: &'a [(String, String)], name: &str) -> Option<&'a str> {
+    headers
+        .iter()
+        .find(|(key, _)| key.eq_ignore_ascii_case(name))
+        .map(|(_, value)| value.as_str())
+}
+
+/// Local HTTP/1.1 keep-alive server standing in for a `Net` provider. Every request gets
+/// `200 OK` echoing `<method> <path>`, after `delay`. Two paths behave differently:
+/// `/close` answers with `Connection: close`, and `/chunked` answers with a chunked body.
+pub struct StandInServer {
+    address: SocketAddr,
+    counters: Arc<StandInCounters>,
+    shutdown: Arc<AtomicBool>,
+    acceptor: Option<JoinHandle<()>>,
+}
+
+#[derive(Default)]
+struct StandInCounters {
+    connections: AtomicU64,
+    requests: AtomicU64,
+    /// Requests that were already buffered behind another one when it was read.
+    pipelined: AtomicU64,
+}
+
+impl StandInServer {
+    pub fn start(delay: Duration) -> io::Result<Self> {
+        let listener = TcpListener::bind("127.0.0.1:0")?;
+        let address = listener.local_addr()?;
+        let counters = Arc::new(StandInCounters::default());
+        let shutdown = Arc::new(AtomicBool::new(false));
+        let acceptor = {
+            let counters = counters.clone();
+            let shutdown = shutdown.clone();
+            thread::spawn(move || {
+                for stream in listener.incoming() {
+                    if shutdown.load(Ordering::SeqCst) {
+                        return;
+                    }
+                    let Ok(stream) = stream else {
+                        continue;
+                    };
+                    counters.connections.fetch_add(1, Ordering::SeqCst);
+                    let counters = counters.clone();
+                    thread::spawn(move || {
+                        let _ = serve_connection(stream, &counters, delay);
+                    });
+                }
+            })
+        };
+        Ok(Self {
+            address,
+            counters,
+            shutdown,
+            acceptor: Some(acceptor),
+        })
+    }
+
+    pub fn address(&self) -> SocketAddr {
+        self.address
+    }
+
+    /// TCP connections accepted so far.
+    pub fn connections(&self) -> u64 {
+        self.counters.connections.load(Ordering::SeqCst)
+    }
+
+    pub fn requests(&self) -> u64 {
+        self.counters.requests.load(Ordering::SeqCst)
+    }
+
+    pub fn pipelined(&self) -> u64 {
+        self.counters.pipelined.load(Ordering::SeqCst)
+    }
+}
+
+impl Drop for StandInServer {
+    fn drop(&mut self) {
+        self.shutdown.store(true, Ordering::SeqCst);
+        // Wake the blocking accept so the acceptor sees the flag.
+        let _ = TcpStream::connect(self.address);
+        if let Some(acceptor) = self.acceptor.take() {
+            let _ = acceptor.join();
+        }
+    }
+}
+
+fn serve_connection(
+    stream: TcpStream,
+    counters: &StandInCounters,
+    delay: Duration,
+) -> io::Result<()> {
+    // Idle keep-alive connections are closed server-side, like a real provider would.
+    stream.set_read_timeout(Some(Duration::from_secs(5)))?;
+    let mut writer = stream.try_clone()?;
+    let mut reader = BufReader::new(stream);
+    loop {
+        let mut line = String::new();
+        if reader.read_line(&mut line)? == 0 {
+            return Ok(());
+        }
+        let mut parts = line.split_whitespace();
+        let method = parts.next().unwrap_or_default().to_string();
+        let path = parts.next().unwrap_or_default().to_string();
+        let headers = read_headers(&mut reader)?;
+        if let Some(length) = header(&headers, "content-length") {
+            let mut body = vec![0; length.trim().parse().unwrap_or(0)];
+            reader.read_exact(&mut body)?;
+        }
+        counters.requests.fetch_add(1, Ordering::SeqCst);
+        if !reader.buffer().is_empty() {
+            counters.pipelined.fetch_add(1, Ordering::SeqCst);
+        }
+        if !delay.is_zero() {
+            thread::sleep(delay);
+        }
+
+        let body = format!("{method} {path}");
+        let close = path == "/close"
+            || header(&headers, "connection")
+                .is_some_and(|value| value.eq_ignore_ascii_case("close"));
+        let response = if path == "/chunked" {
+            let (first, second) = body.split_at(body.len() / 2);
+            format!(
+                "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n{:x}\r\n{first}\r\n{:x}\r\n{second}\r\n0\r\n\r\n",
+                first.len(),
+                second.len()
+            )
+        } else {
+            format!(
+                "HTTP/1.1 200 OK\r\nContent-Length: {}\r\n{}\r\n{body}",
+                body.len(),
+                if close { "Connection: close\r\n" } else { "" }
+            )
+        };
+        writer.write_all(response.as_bytes())?;
+        if close {
+            return Ok(());
+        }
+    }
+}
@@ -2,36 +2,93 @@ use crate::ast::{
     AgentDecl, AgentPolicy, AssignStmt, BinaryOp, Block, CapabilityDecl, EffectSpec, EnsureClause,
     EnumDecl, EnumVariant, EvidenceSpec, Expr, FailureAction, FailureActionArg, FailurePolicy,
     FailureRule, FailureValue, FunctionDecl, ImportDecl, Item, LetStmt, LoopSpec, MatchArm,
-    MatchArmBody, MatchPattern, OutputField, Param, PredicateOp, PredicateValue, Program,
-    RecordDecl, RecordField, RecordGenericParam, RecordLitField, ReturnStmt, StateRule, Statement,
-    TypeArg, TypeRef, WorkflowCall, WorkflowCallArg, WorkflowDecl, WorkflowStep,
+    MatchArmBody, MatchPattern, OutputField, Param, PredicateOp, PredicateValue, PriorityClass,
+    Program, RecordDecl, RecordField, RecordGenericParam, RecordLitField, ReturnStmt, StateRule,
+    Statement, StreamSpec, TypeArg, TypeRef, WorkflowCall, WorkflowCallArg, WorkflowDecl,
+    WorkflowStep,
 };
 use crate::error::{Diagnostic, Span};
 use crate::token::{Token, TokenKind};
+use std::ops::Range;
 
 pub fn parse(tokens: &[Token]) -> Result<Program, Diagnostic> {
-    Parser::new(tokens).parse_program()
+    Parser::new(tokens)
+        .parse_program()
+        .map(|skimmed| skimmed.program)
+}
+
+/// A function body left unparsed by [`parse_skim`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct LazyBody {
+    /// Index of the function in `Program::items`.
+    pub item: usize,
+    /// Token range from the body's `{` through its matching `}`.
+    pub tokens: Range<usize>,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct SkimmedProgram {
+    /// Declarations with full signatures; functions listed in `lazy_bodies` have `body: None`.
+    pub program: Program,
+    pub lazy_bodies: Vec<LazyBody>,
+}
+
+/// Parses declarations but records each function body as a balanced-brace token range instead
+/// of parsing it. Syntax errors inside a skipped body surface only when it is parsed.
+pub fn parse_skim(tokens: &[Token]) -> Result<SkimmedProgram, Diagnostic> {
+    let mut parser = Parser::new(tokens);
+    parser.skim = true;
+    parser.parse_program()
+}
+
+/// Parses a body recorded by [`parse_skim`] from the same token stream.
+pub fn parse_lazy_body(tokens: &[Token], body: &LazyBody) -> Result<Block, Diagnostic> {
+    let mut parser = Parser::new(tokens);
+    parser.index = body.tokens.start;
+    let block = parser.parse_block()?;
+    if parser.index != body.tokens.end {
+        return Err(Diagnostic::error(
+            "function body ended before its closing '}'",
+            parser.current().span,
+        ));
+    }
+    Ok(block)
 }
 
 struct Parser<'a> {
     tokens: &'a [Token],
     index: usize,
+    skim: bool,
+    skipped_body: Option<Range<usize>>,
 }
 
 impl<'a> Parser<'a> {
     fn new(tokens: &'a [Token]) -> Self {
-        Self { tokens, index: 0 }
+        Self {
+            tokens,
+            index: 0,
+            skim: false,
+            skipped_body: None,
+        }
     }
 
-    fn parse_program(mut self) -> Result<Program, Diagnostic> {
+    fn parse_program(mut self) -> Result<SkimmedProgram, Diagnostic> {
         let mut items = Vec::new();
+        let mut lazy_bodies = Vec::new();
         while !self.at_eof() {
             let item = if self.at_kw_cap() {
                 Item::Capability(self.parse_capability_decl()?)
             } else if self.at_kw_import() {
                 Item::Import(self.parse_import_decl()?)
             } else if self.at_kw_fn() {
-                Item::Function(self.parse_function_decl()?)
+                let function = self.parse_function_decl()?;
+                if let Some(tokens) = self.skipped_body.take() {
+                    lazy_bodies.push(LazyBody {
+                        item: items.len(),
+                        tokens,
+                    });
+                }
+                Item::Function(function)
             } else if self.at_kw_workflow() {
                 Item::Workflow(self.parse_workflow_decl()?)
             } else if self.at_kw_agent() {
@@ -52,7 +109,10 @@ impl<'a> Parser<'a> {
             items.push(item);
         }
 
-        Ok(Program { items })
+        Ok(SkimmedProgram {
+            program: Program { items },
+            lazy_bodies,
+        })
     }
 
     fn parse_capability_decl(&mut self) -> Result<CapabilityDecl, Diagnostic> {
@@ -396,7 +456,10 @@ impl<'a> Parser<'a> {
             None
         };
 
-        let body = if self.at_lbrace() {
+        let body = if self.at_lbrace() && self.skim {
+            self.skipped_body = Some(self.skip_balanced_braces()?);
+            None
+        } else if self.at_lbrace() {
             Some(self.parse_block()?)
         } else {
             None
@@ -447,6 +510,12 @@ impl<'a> Parser<'a> {
             None
         };
 
+        let priority = if self.at_ident_named("priority") {
+            Some(self.parse_priority_class()?)
+        } else {
+            None
+        };
+
         let requires = if self.at_kw_requires() {
             self.parse_requires()?
         } else {
@@ -474,6 +543,7 @@ impl<'a> Parser<'a> {
             params,
             return_type,
             intent,
+            priority,
             requires,
             steps,
             output,
@@ -482,6 +552,19 @@ impl<'a> Parser<'a> {
         })
     }
 
+    fn parse_priority_class(&mut self) -> Result<PriorityClass, Diagnostic> {
+        self.advance();
+        let (name, span) = self.expect_ident()?;
+        PriorityClass::parse(&name).ok_or_else(|| {
+            Diagnostic::error(
+                format!(
+                    "unknown priority class '{name}', expected 'interactive', 'standard' or 'batch'"
+                ),
+                span,
+            )
+        })
+    }
+
     fn parse_agent_decl(&mut self) -> Result<AgentDecl, Diagnostic> {
         let start = self.expect_kw_agent()?.start;
         let (name, _) = self.expect_ident()?;
@@ -782,6 +865,12 @@ impl<'a> Parser<'a> {
         self.expect_colon()?;
         let call = self.parse_workflow_call()?;
 
+        let stream = if self.at_ident_named("stream") {
+            Some(self.parse_stream_spec()?)
+        } else {
+            None
+        };
+
         let ensures = if self.at_kw_ensures() {
             self.parse_ensures()?
         } else {
@@ -800,11 +889,39 @@ impl<'a> Parser<'a> {
         Ok(WorkflowStep {
             id,
             call,
+            stream,
             ensures,
             on_fail,
         })
     }
 
+    fn parse_stream_spec(&mut self) -> Result<StreamSpec, Diagnostic> {
+        self.advance();
+        if !self.at_lparen() {
+            return Ok(StreamSpec { buffer: None });
+        }
+
+        self.expect_lparen()?;
+        let (key, key_span) = self.expect_ident()?;
+        if key != "buffer" {
+            return Err(Diagnostic::error(
+                format!("unknown stream option '{key}', expected 'buffer'"),
+                key_span,
+            ));
+        }
+        self.expect_eq()?;
+        let span = self.current().span;
+        let buffer = self
+            .take_number()
+            .and_then(|value| value.parse::<u64>().ok())
+            .filter(|buffer| *buffer > 0)
+            .ok_or_else(|| Diagnostic::error("stream buffer must be a positive integer", span))?;
+        self.expect_rparen()?;
+        Ok(StreamSpec {
+            buffer: Some(buffer),
+        })
+    }
+
     fn parse_workflow_call(&mut self) -> Result<WorkflowCall, Diagnostic> {
         let (target, _) = self.expect_ident()?;
         self.expect_lparen()?;
@@ -1156,6 +1273,25 @@ impl<'a> Parser<'a> {
         ))
     }
 
+    /// Steps over `{ ... }` by brace depth alone, returning the token range it covered.
+    fn skip_balanced_braces(&mut self) -> Result<Range<usize>, Diagnostic> {
+        let start = self.index;
+        let open = self.expect_lbrace()?;
+        let mut depth = 1usize;
+        while depth > 0 {
+            match &self.current().kind {
+                TokenKind::LBrace => depth += 1,
+                TokenKind::RBrace => depth -= 1,
+                TokenKind::Eof => {
+                    return Err(Diagnostic::error("unterminated function body", open));
+                }
+                _ => {}
+            }
+            self.advance();
+        }
+        Ok(start..self.index)
+    }
+
     fn parse_block(&mut self) -> Result<Block, Diagnostic> {
         self.expect_lbrace()?;
         let mut statements = Vec::new();
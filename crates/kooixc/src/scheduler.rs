@@ -0,0 +1,308 @@
+//! Multi-tenant admission and dispatch for workflow/agent instances sharing one runtime.
+//!
+//! Queued instances are dispatched by strict priority class (`interactive` before `standard`
+//! before `batch`, from the workflow's `priority` clause) and, within a class, by weighted fair
+//! queuing across tenants: each instance gets the virtual finish tag
+//! `max(class virtual time, tenant's last tag) + 1 / weight`, and the smallest tag runs next, so a
+//! tenant's share of dispatches follows its weight no matter how much it has queued.
+//!
+//! Admission control: with a queue target set, an arriving instance whose estimated queue wait
+//! exceeds the target is rejected, or deferred and re-admitted in arrival order once the estimate
+//! drops back under the target. The estimate is the expected service time of everything queued at
+//! its class or above, spread over the workers. Callers pass each instance's expected service time
+//! (the loadtest uses the static critical path), corrected by the smoothed ratio of observed to
+//! expected time; instances submitted without one count at the smoothed observed service time.
+
+use std::collections::{BTreeMap, VecDeque};
+use std::sync::{Condvar, Mutex};
+use std::time::{Duration, Instant};
+
+use crate::ast::PriorityClass;
+
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub enum AdmissionPolicy {
+    #[default]
+    Reject,
+    Defer,
+}
+
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct SchedulerOptions {
+    /// Instances that may run at once.
+    pub workers: usize,
+    /// Estimated queue wait above which new instances are not admitted (`None` = admit all).
+    pub queue_target: Option<Duration>,
+    pub admission: AdmissionPolicy,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Admission {
+    Queued,
+    Deferred,
+    Rejected,
+}
+
+/// One admitted instance handed to a worker.
+pub struct Dispatch<T> {
+    pub tenant: String,
+    pub class: PriorityClass,
+    /// Pass back to `complete`.
+    pub expected: Duration,
+    pub item: T,
+    /// Time from submission to dispatch, including any deferral.
+    pub queue_wait: Duration,
+}
+
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct TenantSchedule {
+    pub submitted: u64,
+    pub admitted: u64,
+    pub deferred: u64,
+    pub rejected: u64,
+    /// Queue wait of every dispatched instance, in microseconds.
+    pub queue_wait_us: Vec<u64>,
+}
+
+struct Pending<T> {
+    tenant: String,
+    weight: f64,
+    class: PriorityClass,
+    expected: Duration,
+    item: T,
+    submitted_at: Instant,
+}
+
+struct TenantQueue<T> {
+    last_tag: f64,
+    items: VecDeque<(f64, Pending<T>)>,
+}
+
+struct ClassQueue<T> {
+    virtual_time: f64,
+    tenants: BTreeMap<String, TenantQueue<T>>,
+    len: usize,
+    /// Summed expected service time of the queued instances that have one.
+    expected_secs: f64,
+    /// Queued instances submitted without an expected service time.
+    unestimated: usize,
+}
+
+struct State<T> {
+    classes: Vec<ClassQueue<T>>,
+    deferred: VecDeque<Pending<T>>,
+    running: usize,
+    closed: bool,
+    /// Exponentially smoothed instance service time, in seconds.
+    service_secs: f64,
+    /// Exponentially smoothed observed / expected service time.
+    accuracy: f64,
+    tenants: BTreeMap<String, TenantSchedule>,
+}
+
+pub struct Scheduler<T> {
+    options: SchedulerOptions,
+    state: Mutex<State<T>>,
+    ready: Condvar,
+}
+
+const SERVICE_SMOOTHING: f64 = 0.2;
+
+impl<T> Scheduler<T> {
+    pub fn new(options: SchedulerOptions) -> Self {
+        Self {
+            options: SchedulerOptions {
+                workers: options.workers.max(1),
+                ..options
+            },
+            state: Mutex::new(State {
+                classes: PriorityClass::ALL
+                    .iter()
+                    .map(|_| ClassQueue {
+                        virtual_time: 0.0,
+                        tenants: BTreeMap::new(),
+                        len: 0,
+                        expected_secs: 0.0,
+                        unestimated: 0,
+                    })
+                    .collect(),
+                deferred: VecDeque::new(),
+                running: 0,
+                closed: false,
+                service_secs: 0.0,
+                accuracy: 1.0,
+                tenants: BTreeMap::new(),
+            }),
+            ready: Condvar::new(),
+        }
+    }
+
+    /// `expected` is the instance's expected service time (`Duration::ZERO` if unknown).
+    pub fn submit(
+        &self,
+        tenant: &str,
+        weight: u32,
+        class: PriorityClass,
+        expected: Duration,
+        item: T,
+    ) -> Admission {
+        let mut state = self.state.lock().unwrap();
+        let stats = state.tenants.entry(tenant.to_string()).or_default();
+        stats.submitted += 1;
+        let pending = Pending {
+            tenant: tenant.to_string(),
+            weight: f64::from(weight.max(1)),
+            class,
+            expected,
+            item,
+            submitted_at: Instant::now(),
+        };
+        if self.within_target(&state, class) {
+            state.tenants.get_mut(tenant).unwrap().admitted += 1;
+            state.enqueue(pending);
+            drop(state);
+            self.ready.notify_one();
+            return Admission::Queued;
+        }
+        let stats = state.tenants.get_mut(tenant).unwrap();
+        match self.options.admission {
+            AdmissionPolicy::Reject => {
+                stats.rejected += 1;
+                Admission::Rejected
+            }
+            AdmissionPolicy::Defer => {
+                stats.deferred += 1;
+                state.deferred.push_back(pending);
+                Admission::Deferred
+            }
+        }
+    }
+
+    /// Blocks until an instance is ready to run; `None` once closed and drained.
+    pub fn next(&self) -> Option<Dispatch<T>> {
+        let mut state = self.state.lock().unwrap();
+        loop {
+            if let Some(pending) = state.dequeue() {
+                state.running += 1;
+                let queue_wait = pending.submitted_at.elapsed();
+                state
+                    .tenants
+                    .get_mut(&pending.tenant)
+                    .unwrap()
+                    .queue_wait_us
+                    .push(queue_wait.as_micros() as u64);
+                return Some(Dispatch {
+                    tenant: pending.tenant,
+                    class: pending.class,
+                    expected: pending.expected,
+                    item: pending.item,
+                    queue_wait,
+                });
+            }
+            // Deferred instances re-enter the queue only when a running one completes.
+            if state.closed && state.deferred.is_empty() {
+                return None;
+            }
+            state = self.ready.wait(state).unwrap();
+        }
+    }
+
+    /// Reports a dispatched instance finished after running for `service`.
+    pub fn complete(&self, expected: Duration, service: Duration) {
+        let mut state = self.state.lock().unwrap();
+        state.running -= 1;
+        state.service_secs = smooth(state.service_secs, service.as_secs_f64());
+        if !expected.is_zero() {
+            let ratio = service.as_secs_f64() / expected.as_secs_f64();
+            state.accuracy = smooth(state.accuracy, ratio);
+        }
+        // Re-admit deferred instances, in arrival order, wherever the estimate now allows. An idle
+        // scheduler admits regardless so deferred work always drains.
+        let mut still_deferred = VecDeque::new();
+        while let Some(pending) = state.deferred.pop_front() {
+            let idle = state.running == 0 && state.classes.iter().all(|queue| queue.len == 0);
+            if idle || self.within_target(&state, pending.class) {
+                state.enqueue(pending);
+            } else {
+                still_deferred.push_back(pending);
+            }
+        }
+        state.deferred = still_deferred;
+        drop(state);
+        self.ready.notify_all();
+    }
+
+    /// No more submissions; `next` returns `None` once everything admitted has run.
+    pub fn close(&self) {
+        self.state.lock().unwrap().closed = true;
+        self.ready.notify_all();
+    }
+
+    pub fn tenant_stats(&self) -> BTreeMap<String, TenantSchedule> {
+        self.state.lock().unwrap().tenants.clone()
+    }
+
+    fn within_target(&self, state: &State<T>, class: PriorityClass) -> bool {
+        let Some(target) = self.options.queue_target else {
+            return true;
+        };
+        let ahead = &state.classes[..=class as usize];
+        let queued: usize = ahead.iter().map(|queue| queue.len).sum();
+        if queued + state.running < self.options.workers {
+            return true;
+        }
+        let work: f64 = ahead
+            .iter()
+            .map(|queue| {
+                queue.expected_secs * state.accuracy + queue.unestimated as f64 * state.service_secs
+            })
+            .sum();
+        work / self.options.workers as f64 <= target.as_secs_f64()
+    }
+}
+
+fn smooth(average: f64, sample: f64) -> f64 {
+    if average == 0.0 {
+        return sample;
+    }
+    average * (1.0 - SERVICE_SMOOTHING) + sample * SERVICE_SMOOTHING
+}
+
+impl<T> State<T> {
+    fn enqueue(&mut self, pending: Pending<T>) {
+        let queue = &mut self.classes[pending.class as usize];
+        let tenant = queue
+            .tenants
+            .entry(pending.tenant.clone())
+            .or_insert(TenantQueue {
+                last_tag: 0.0,
+                items: VecDeque::new(),
+            });
+        let tag = queue.virtual_time.max(tenant.last_tag) + 1.0 / pending.weight;
+        tenant.last_tag = tag;
+        if pending.expected.is_zero() {
+            queue.unestimated += 1;
+        } else {
+            queue.expected_secs += pending.expected.as_secs_f64();
+        }
+        tenant.items.push_back((tag, pending));
+        queue.len += 1;
+    }
+
+    fn dequeue(&mut self) -> Option<Pending<T>> {
+        let queue = self.classes.iter_mut().find(|queue| queue.len > 0)?;
+        let tenant = queue
+            .tenants
+            .values_mut()
+            .filter(|tenant| !tenant.items.is_empty())
+            .min_by(|a, b| a.items[0].0.total_cmp(&b.items[0].0))?;
+        let (tag, pending) = tenant.items.pop_front()?;
+        queue.virtual_time = tag;
+        queue.len -= 1;
+        if pending.expected.is_zero() {
+            queue.unestimated -= 1;
+        } else {
+            queue.expected_secs = (queue.expected_secs - pending.expected.as_secs_f64()).max(0.0);
+        }
+        Some(pending)
+    }
+}
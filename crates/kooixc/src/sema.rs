@@ -1230,7 +1230,7 @@ fn collect_agent_state_symbols(agent: &HirAgent) -> HashSet<String> {
     symbols
 }
 
-fn extract_state_equality_target(predicate: &EnsureClause) -> Option<String> {
+pub(crate) fn extract_state_equality_target(predicate: &EnsureClause) -> Option<String> {
     if predicate.op != crate::ast::PredicateOp::Eq {
         return None;
     }
@@ -1588,6 +1588,16 @@ fn validate_workflow(
                     diagnostics,
                 );
 
+                if step.stream.is_some() && signature.return_type.head() != "Text" {
+                    diagnostics.push(Diagnostic::error(
+                        format!(
+                            "workflow '{}' step '{}' streams output of type '{}', only Text can be streamed",
+                            workflow.name, step.id, signature.return_type
+                        ),
+                        workflow.span,
+                    ));
+                }
+
                 available_symbols.insert(step.id.clone(), signature.return_type.clone());
             }
         }
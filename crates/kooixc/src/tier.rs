@@ -0,0 +1,511 @@
+//! Tiered execution for `kooixc run --engine=auto`.
+//!
+//! The interpreter counts calls per function. Once a function reaches the threshold it is
+//! compiled, together with its callees, through the regular MIR→LLVM path into a shared object
+//! that is `dlopen`ed; later calls dispatch to the native symbol. Only the scalar subset is
+//! eligible: `Int`/`Bool` parameters, locals and return values, no effects or `ensures`, and
+//! calls only to other eligible functions. Such a module needs nothing from the native runtime,
+//! and values cross the boundary as plain `i64`. Unlike `kooixc native`, the module is emitted
+//! with the interpreter's guards (`llvm::emit_tier_program`): on `+` overflow or past the
+//! interpreter's call-depth limit the native call bails out and, since eligible functions are
+//! pure, the interpreter re-runs it and reports the error exactly as it would have.
+
+use std::collections::{HashMap, HashSet};
+use std::path::Path;
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::thread;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+use crate::interp::{Value, MAX_CALL_DEPTH};
+use crate::llvm;
+use crate::mir::{MirFunction, MirOperand, MirProgram, MirRvalue, MirStatement};
+use crate::native;
+
+const MAX_NATIVE_PARAMS: usize = 6;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct TierOptions {
+    /// Interpreted calls before a function is queued for native compilation.
+    pub threshold: u64,
+    /// Compile on the interpreter thread instead of in the background (deterministic tests).
+    pub synchronous: bool,
+}
+
+impl TierOptions {
+    pub const THRESHOLD_ENV_VAR: &'static str = "KX_TIER_THRESHOLD";
+    pub const SYNC_ENV_VAR: &'static str = "KX_TIER_SYNC";
+    pub const DEFAULT_THRESHOLD: u64 = 1000;
+
+    pub fn from_env() -> Result<Self, String> {
+        let threshold = match std::env::var(Self::THRESHOLD_ENV_VAR) {
+            Ok(raw) => raw
+                .trim()
+                .parse::<u64>()
+                .ok()
+                .filter(|threshold| *threshold > 0)
+                .ok_or_else(|| {
+                    format!(
+                        "invalid {} value '{raw}': expected a positive integer",
+                        Self::THRESHOLD_ENV_VAR
+                    )
+                })?,
+            Err(_) => Self::DEFAULT_THRESHOLD,
+        };
+        let synchronous = std::env::var(Self::SYNC_ENV_VAR).is_ok_and(|raw| raw == "1");
+        Ok(Self {
+            threshold,
+            synchronous,
+        })
+    }
+}
+
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct TierReport {
+    /// Functions dispatched to native code by the end of the run, in tier-up order.
+    pub compiled: Vec<String>,
+    pub native_calls: u64,
+    /// Native calls that hit an overflow or depth guard and were re-run by the interpreter.
+    pub bailouts: u64,
+    /// Compile or load failures; the affected functions kept running interpreted.
+    pub failures: Vec<String>,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum SlotState {
+    Interpreted,
+    Pending,
+    Native(NativeFn),
+    Failed,
+}
+
+/// Entry point of a tiered function plus the guard globals of the module it was loaded from.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct NativeFn {
+    entry: usize,
+    trap: usize,
+    depth: usize,
+}
+
+#[derive(Debug)]
+struct Slot {
+    calls: u64,
+    state: SlotState,
+    bool_params: Vec<bool>,
+    returns_bool: bool,
+    /// The function and every function it can reach.
+    closure: Vec<String>,
+}
+
+type CompileResult = Result<Vec<(String, NativeFn)>, (Vec<String>, String)>;
+
+pub(crate) struct Tier {
+    options: TierOptions,
+    slots: HashMap<String, Slot>,
+    program: MirProgram,
+    jobs: Option<Sender<Vec<String>>>,
+    results: Option<Receiver<CompileResult>>,
+    in_flight: usize,
+    report: TierReport,
+}
+
+impl Tier {
+    /// `pinned` functions always stay interpreted (e.g. sampled `ensures`), and so do their
+    /// callers.
+    pub(crate) fn new(
+        program: &MirProgram,
+        pinned: &HashSet<String>,
+        options: TierOptions,
+    ) -> Self {
+        let eligible = eligible_functions(program, pinned);
+        let by_name: HashMap<&str, &MirFunction> = program
+            .functions
+            .iter()
+            .map(|function| (function.name.as_str(), function))
+            .collect();
+
+        let mut slots = HashMap::new();
+        for name in &eligible {
+            let function = by_name[name.as_str()];
+            slots.insert(
+                name.clone(),
+                Slot {
+                    calls: 0,
+                    state: SlotState::Interpreted,
+                    bool_params: function
+                        .params
+                        .iter()
+                        .map(|param| param.ty.head() == "Bool")
+                        .collect(),
+                    returns_bool: function.return_type.head() == "Bool",
+                    closure: callee_closure(name, &by_name),
+                },
+            );
+        }
+
+        let program = MirProgram {
+            records: Vec::new(),
+            enums: Vec::new(),
+            functions: program
+                .functions
+                .iter()
+                .filter(|function| eligible.contains(&function.name))
+                .cloned()
+                .collect(),
+        };
+        Self {
+            options,
+            slots,
+            program,
+            jobs: None,
+            results: None,
+            in_flight: 0,
+            report: TierReport::default(),
+        }
+    }
+
+    /// Runs `name` (entered at interpreter call depth `depth`) natively when it has tiered up;
+    /// otherwise counts the call and returns `None` so the interpreter evaluates it. A native
+    /// call that trips a guard also returns `None`.
+    pub(crate) fn call(&mut self, name: &str, args: &[Value], depth: usize) -> Option<Value> {
+        if self.in_flight > 0 {
+            self.poll();
+        }
+        let slot = self.slots.get_mut(name)?;
+        if slot.state == SlotState::Interpreted {
+            slot.calls += 1;
+            if slot.calls >= self.options.threshold {
+                self.request(name);
+            }
+        }
+
+        let slot = &self.slots[name];
+        let SlotState::Native(native) = slot.state else {
+            return None;
+        };
+        let mut raw = [0i64; MAX_NATIVE_PARAMS];
+        if args.len() != slot.bool_params.len() {
+            return None;
+        }
+        for ((value, is_bool), raw) in args.iter().zip(&slot.bool_params).zip(raw.iter_mut()) {
+            *raw = match (value, is_bool) {
+                (Value::Int(value), false) => *value,
+                (Value::Bool(value), true) => i64::from(*value),
+                _ => return None,
+            };
+        }
+        let trap = native.trap as *mut i64;
+        let result = unsafe {
+            trap.write(0);
+            (native.depth as *mut i64).write(depth as i64 - 1);
+            invoke(native.entry, &raw[..args.len()])
+        };
+        if unsafe { trap.read() } != 0 {
+            self.report.bailouts += 1;
+            return None;
+        }
+        self.report.native_calls += 1;
+        Some(if slot.returns_bool {
+            Value::Bool(result & 1 != 0)
+        } else {
+            Value::Int(result)
+        })
+    }
+
+    pub(crate) fn into_report(mut self) -> TierReport {
+        if self.in_flight > 0 {
+            self.poll();
+        }
+        self.report
+    }
+
+    fn request(&mut self, name: &str) {
+        let closure = self.slots[name].closure.clone();
+        for member in &closure {
+            if let Some(slot) = self.slots.get_mut(member) {
+                if slot.state == SlotState::Interpreted {
+                    slot.state = SlotState::Pending;
+                }
+            }
+        }
+
+        if self.options.synchronous {
+            let result = compile_and_load(&self.program, closure);
+            self.apply(result);
+            return;
+        }
+
+        if self.jobs.is_none() {
+            let (job_tx, job_rx) = mpsc::channel::<Vec<String>>();
+            let (result_tx, result_rx) = mpsc::channel();
+            let program = self.program.clone();
+            let spawned = thread::Builder::new()
+                .name("kooix-tier".to_string())
+                .spawn(move || {
+                    for functions in job_rx {
+                        if result_tx
+                            .send(compile_and_load(&program, functions))
+                            .is_err()
+                        {
+                            break;
+                        }
+                    }
+                });
+            if let Err(error) = spawned {
+                self.apply(Err((
+                    closure,
+                    format!("failed to spawn compile thread: {error}"),
+                )));
+                return;
+            }
+            self.jobs = Some(job_tx);
+            self.results = Some(result_rx);
+        }
+        if let Some(jobs) = &self.jobs {
+            if jobs.send(closure.clone()).is_ok() {
+                self.in_flight += 1;
+                return;
+            }
+        }
+        self.apply(Err((closure, "compile thread exited".to_string())));
+    }
+
+    /// Applies finished background compiles without waiting for the rest.
+    fn poll(&mut self) {
+        while self.in_flight > 0 {
+            let Some(result) = self
+                .results
+                .as_ref()
+                .and_then(|results| results.try_recv().ok())
+            else {
+                return;
+            };
+            self.in_flight -= 1;
+            self.apply(result);
+        }
+    }
+
+    fn apply(&mut self, result: CompileResult) {
+        match result {
+            Ok(symbols) => {
+                for (name, native) in symbols {
+                    if let Some(slot) = self.slots.get_mut(&name) {
+                        if !matches!(slot.state, SlotState::Native(_)) {
+                            slot.state = SlotState::Native(native);
+                            self.report.compiled.push(name);
+                        }
+                    }
+                }
+            }
+            Err((functions, message)) => {
+                for name in &functions {
+                    if let Some(slot) = self.slots.get_mut(name) {
+                        if slot.state == SlotState::Pending {
+                            slot.state = SlotState::Failed;
+                        }
+                    }
+                }
+                self.report.failures.push(message);
+            }
+        }
+    }
+}
+
+/// Functions the tier can compile without the native runtime, as the greatest set whose members
+/// only call each other.
+fn eligible_functions(program: &MirProgram, pinned: &HashSet<String>) -> HashSet<String> {
+    let mut eligible: HashSet<String> = program
+        .functions
+        .iter()
+        .filter(|function| !pinned.contains(&function.name) && is_scalar_function(function))
+        .map(|function| function.name.clone())
+        .collect();
+    loop {
+        let before = eligible.len();
+        let snapshot = eligible.clone();
+        eligible.retain(|name| {
+            let Some(function) = program.functions.iter().find(|f| &f.name == name) else {
+                return false;
+            };
+            direct_callees(function).all(|callee| snapshot.contains(callee))
+        });
+        if eligible.len() == before {
+            return eligible;
+        }
+    }
+}
+
+fn is_scalar_function(function: &MirFunction) -> bool {
+    let scalar = |head: &str| head == "Int" || head == "Bool";
+    function.name != "main"
+        && function.effects.is_empty()
+        && !function.blocks.is_empty()
+        && function.params.len() <= MAX_NATIVE_PARAMS
+        && scalar(function.return_type.head())
+        && function.locals.iter().all(|local| scalar(local.ty.head()))
+        && function.blocks.iter().all(|block| {
+            block.statements.iter().all(|statement| {
+                let rvalue = match statement {
+                    MirStatement::Assign { rvalue, .. } | MirStatement::Eval(rvalue) => rvalue,
+                };
+                let operands: Vec<&MirOperand> = match rvalue {
+                    MirRvalue::Use(operand) => vec![operand],
+                    MirRvalue::Binary { left, right, .. } => vec![left, right],
+                    MirRvalue::Call { args, .. } => args.iter().collect(),
+                    _ => return false,
+                };
+                operands
+                    .iter()
+                    .all(|operand| !matches!(operand, MirOperand::ConstText(_)))
+            })
+        })
+}
+
+fn direct_callees(function: &MirFunction) -> impl Iterator<Item = &str> {
+    function
+        .blocks
+        .iter()
+        .flat_map(|block| &block.statements)
+        .filter_map(|statement| match statement {
+            MirStatement::Assign {
+                rvalue: MirRvalue::Call { callee, .. },
+                ..
+            }
+            | MirStatement::Eval(MirRvalue::Call { callee, .. }) => Some(callee.as_str()),
+            _ => None,
+        })
+}
+
+fn callee_closure(root: &str, functions: &HashMap<&str, &MirFunction>) -> Vec<String> {
+    let mut seen = vec![root.to_string()];
+    let mut index = 0;
+    while index < seen.len() {
+        if let Some(function) = functions.get(seen[index].as_str()) {
+            for callee in direct_callees(function) {
+                if !seen.iter().any(|name| name == callee) {
+                    seen.push(callee.to_string());
+                }
+            }
+        }
+        index += 1;
+    }
+    seen
+}
+
+fn compile_and_load(program: &MirProgram, functions: Vec<String>) -> CompileResult {
+    let module = MirProgram {
+        records: Vec::new(),
+        enums: Vec::new(),
+        functions: program
+            .functions
+            .iter()
+            .filter(|function| functions.contains(&function.name))
+            .cloned()
+            .collect(),
+    };
+    let ir = llvm::emit_tier_program(&module, MAX_CALL_DEPTH);
+
+    let nanos = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|duration| duration.as_nanos())
+        .unwrap_or_default();
+    let dir = std::env::temp_dir().join(format!("kooixc-tier-{}-{nanos}", std::process::id()));
+    let library = dir.join("tier.so");
+    let loaded = native::compile_llvm_ir_to_shared_object(&ir, &library)
+        .map_err(|error| error.to_string())
+        .and_then(|()| load_symbols(&library, &functions));
+    // The mapping outlives the file.
+    let _ = std::fs::remove_dir_all(&dir);
+    loaded.map_err(|message| {
+        (
+            functions.clone(),
+            format!("tier-up of '{}' failed: {message}", functions[0]),
+        )
+    })
+}
+
+#[cfg(unix)]
+mod dl {
+    use std::os::raw::{c_char, c_int, c_void};
+
+    #[cfg_attr(target_os = "linux", link(name = "dl"))]
+    extern "C" {
+        pub fn dlopen(filename: *const c_char, flag: c_int) -> *mut c_void;
+        pub fn dlsym(handle: *mut c_void, symbol: *const c_char) -> *mut c_void;
+        pub fn dlerror() -> *const c_char;
+    }
+
+    pub const RTLD_NOW: c_int = 2;
+    #[cfg(target_os = "macos")]
+    pub const RTLD_LOCAL: c_int = 4;
+    #[cfg(not(target_os = "macos"))]
+    pub const RTLD_LOCAL: c_int = 0;
+
+    pub fn last_error() -> String {
+        let message = unsafe { dlerror() };
+        if message.is_null() {
+            return "unknown dlopen error".to_string();
+        }
+        unsafe { std::ffi::CStr::from_ptr(message) }
+            .to_string_lossy()
+            .into_owned()
+    }
+}
+
+/// Loads `library` for the rest of the process (native frames may still be live, so it is never
+/// closed) and resolves every function in `functions` and the module's guard globals.
+#[cfg(unix)]
+fn load_symbols(library: &Path, functions: &[String]) -> Result<Vec<(String, NativeFn)>, String> {
+    use std::ffi::CString;
+    use std::os::unix::ffi::OsStrExt;
+
+    let path = CString::new(library.as_os_str().as_bytes()).map_err(|error| error.to_string())?;
+    let handle = unsafe { dl::dlopen(path.as_ptr(), dl::RTLD_NOW | dl::RTLD_LOCAL) };
+    if handle.is_null() {
+        return Err(dl::last_error());
+    }
+    let resolve = |name: &str| {
+        let symbol = CString::new(name).map_err(|error| error.to_string())?;
+        let address = unsafe { dl::dlsym(handle, symbol.as_ptr()) };
+        if address.is_null() {
+            return Err(dl::last_error());
+        }
+        Ok(address as usize)
+    };
+    let trap = resolve(llvm::TIER_TRAP_SYMBOL)?;
+    let depth = resolve(llvm::TIER_DEPTH_SYMBOL)?;
+    let mut symbols = Vec::new();
+    for name in functions {
+        let entry = resolve(&llvm::sanitize_symbol(name))?;
+        symbols.push((name.clone(), NativeFn { entry, trap, depth }));
+    }
+    Ok(symbols)
+}
+
+#[cfg(not(unix))]
+fn load_symbols(_library: &Path, _functions: &[String]) -> Result<Vec<(String, NativeFn)>, String> {
+    Err("tiered execution requires dlopen".to_string())
+}
+
+/// Calls a tiered function. `i1` parameters are passed as 0/1 in a full register and an `i1`
+/// result is read from the low bit, which matches the C calling convention on every supported
+/// target.
+unsafe fn invoke(address: usize, args: &[i64]) -> i64 {
+    type F0 = extern "C" fn() -> i64;
+    type F1 = extern "C" fn(i64) -> i64;
+    type F2 = extern "C" fn(i64, i64) -> i64;
+    type F3 = extern "C" fn(i64, i64, i64) -> i64;
+    type F4 = extern "C" fn(i64, i64, i64, i64) -> i64;
+    type F5 = extern "C" fn(i64, i64, i64, i64, i64) -> i64;
+    type F6 = extern "C" fn(i64, i64, i64, i64, i64, i64) -> i64;
+    let pointer = address as *const ();
+    match *args {
+        [] => std::mem::transmute::<*const (), F0>(pointer)(),
+        [a] => std::mem::transmute::<*const (), F1>(pointer)(a),
+        [a, b] => std::mem::transmute::<*const (), F2>(pointer)(a, b),
+        [a, b, c] => std::mem::transmute::<*const (), F3>(pointer)(a, b, c),
+        [a, b, c, d] => std::mem::transmute::<*const (), F4>(pointer)(a, b, c, d),
+        [a, b, c, d, e] => std::mem::transmute::<*const (), F5>(pointer)(a, b, c, d, e),
+        [a, b, c, d, e, f] => std::mem::transmute::<*const (), F6>(pointer)(a, b, c, d, e, f),
+        _ => unreachable!("tier eligibility caps parameters at {MAX_NATIVE_PARAMS}"),
+    }
+}
@@ -0,0 +1,67 @@
+//! Small helpers shared across the compiler, CLI and tooling modules.
+
+/// Escapes `value` for use inside a JSON string literal (without the surrounding quotes).
+pub fn escape_json(value: &str) -> String {
+    let mut escaped = String::with_capacity(value.len());
+    for ch in value.chars() {
+        match ch {
+            '"' => escaped.push_str("\\\""),
+            '\\' => escaped.push_str("\\\\"),
+            '\n' => escaped.push_str("\\n"),
+            '\r' => escaped.push_str("\\r"),
+            '\t' => escaped.push_str("\\t"),
+            _ => escaped.push(ch),
+        }
+    }
+    escaped
+}
+
+/// FNV-1a 64-bit hasher used for content keys and checksums; each `write` hashes one
+/// length-prefixed field.
+pub(crate) struct Fnv1a64(u64);
+
+impl Fnv1a64 {
+    pub(crate) fn new() -> Self {
+        Self(0xcbf29ce484222325)
+    }
+
+    pub(crate) fn write(&mut self, bytes: &[u8]) {
+        self.bytes(&(bytes.len() as u64).to_le_bytes());
+        self.bytes(bytes);
+    }
+
+    fn bytes(&mut self, bytes: &[u8]) {
+        for byte in bytes {
+            self.0 ^= u64::from(*byte);
+            self.0 = self.0.wrapping_mul(0x100000001b3);
+        }
+    }
+
+    pub(crate) fn finish(&self) -> u64 {
+        self.0
+    }
+}
+
+/// `mmap`/`munmap`/`msync` bindings shared by the memory-mapped journal and the io_uring rings.
+#[cfg(unix)]
+pub(crate) mod mman {
+    use std::os::raw::{c_int, c_void};
+
+    extern "C" {
+        pub(crate) fn mmap(
+            addr: *mut c_void,
+            len: usize,
+            prot: c_int,
+            flags: c_int,
+            fd: c_int,
+            offset: i64,
+        ) -> *mut c_void;
+        pub(crate) fn munmap(addr: *mut c_void, len: usize) -> c_int;
+        pub(crate) fn msync(addr: *mut c_void, len: usize, flags: c_int) -> c_int;
+    }
+
+    pub(crate) const PROT_READ: c_int = 1;
+    pub(crate) const PROT_WRITE: c_int = 2;
+    pub(crate) const MAP_SHARED: c_int = 1;
+    pub(crate) const MAP_FAILED: *mut c_void = !0usize as *mut c_void;
+}
@@ -0,0 +1,1005 @@
+use std::collections::{BTreeMap, HashMap};
+use std::sync::mpsc::{self, Receiver, SyncSender, TrySendError};
+use std::sync::{Condvar, Mutex};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use crate::agent::{compile_agent, AgentMachine, AgentOutcome, ToolTable};
+use crate::ast::{FailureAction, FailureValue, PriorityClass, TypeArg, TypeRef, WorkflowCallArg};
+use crate::hir::{HirProgram, HirWorkflow};
+use crate::journal::{Journal, JournalStats};
+use crate::latency::{capability_latency_ms, retry_limit};
+use crate::net_pool::{HttpRequest, NetPool, NetPoolStats};
+
+/// Nested workflow/agent calls deeper than this fail the step instead of recursing forever.
+const MAX_NESTING_DEPTH: usize = 32;
+
+/// Iteration cap for agents without `max_iterations`. Sema only warns when such an agent may not
+/// terminate, so the runtime bounds the loop itself and reports hitting the cap as a failure.
+pub const DEFAULT_AGENT_ITERATIONS: u64 = 1024;
+
+/// Execution knobs for capability stand-ins.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct RuntimeOptions {
+    /// Multiplier applied to the static latency annotations (`1.0` = annotated latency).
+    pub time_scale: f64,
+    /// Probability that a single capability call fails.
+    pub failure_rate: f64,
+    /// Concurrent in-flight calls allowed per capability instance.
+    pub capability_limit: usize,
+    pub seed: u64,
+    /// Chunks a `stream` step splits its output into.
+    pub stream_chunks: usize,
+    /// Chunk buffer per consumer for `stream` steps without `buffer=`.
+    pub stream_buffer: usize,
+}
+
+impl Default for RuntimeOptions {
+    fn default() -> Self {
+        Self {
+            time_scale: 1.0,
+            failure_rate: 0.0,
+            capability_limit: 8,
+            seed: 0,
+            stream_chunks: 8,
+            stream_buffer: 4,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct CapabilityStats {
+    pub capability: String,
+    pub calls: u64,
+    pub failures: u64,
+    /// Time spent waiting for a free slot, one sample per call (microseconds).
+    pub queue_wait_us: Vec<u64>,
+}
+
+/// Local stand-in for a capability instance: a counting semaphore plus simulated latency.
+struct CapabilitySlot {
+    key: String,
+    /// `Net<"host">`: the host requests go to once a `NetPool` is attached.
+    net_host: Option<String>,
+    latency: Duration,
+    limit: usize,
+    in_flight: Mutex<usize>,
+    released: Condvar,
+    stats: Mutex<CapabilityStats>,
+}
+
+impl CapabilitySlot {
+    fn call(&self, fails: bool) -> Result<(), String> {
+        let waited = self.acquire();
+        if !self.latency.is_zero() {
+            thread::sleep(self.latency);
+        }
+        self.release();
+        self.record(waited, fails)
+    }
+
+    /// Blocks for a free slot; returns the time spent queued.
+    fn acquire(&self) -> Duration {
+        let queued_at = Instant::now();
+        let mut in_flight = self.in_flight.lock().unwrap();
+        while *in_flight >= self.limit {
+            in_flight = self.released.wait(in_flight).unwrap();
+        }
+        *in_flight += 1;
+        queued_at.elapsed()
+    }
+
+    fn release(&self) {
+        {
+            let mut in_flight = self.in_flight.lock().unwrap();
+            *in_flight -= 1;
+        }
+        self.released.notify_one();
+    }
+
+    fn record(&self, waited: Duration, fails: bool) -> Result<(), String> {
+        let mut stats = self.stats.lock().unwrap();
+        stats.calls += 1;
+        stats.queue_wait_us.push(waited.as_micros() as u64);
+        if fails {
+            stats.failures += 1;
+            return Err(format!("capability '{}' call failed", self.key));
+        }
+        Ok(())
+    }
+}
+
+#[derive(Debug, Clone)]
+enum StepTarget {
+    Capabilities(Vec<usize>),
+    Workflow(String),
+    Agent(String),
+}
+
+#[derive(Debug, Clone)]
+enum StepArg {
+    Param(usize),
+    Step(usize),
+    Literal(String),
+}
+
+#[derive(Debug, Clone)]
+struct StepPlan {
+    id: String,
+    target_name: String,
+    target: StepTarget,
+    args: Vec<StepArg>,
+    deps: Vec<usize>,
+    /// Chunk buffer per consumer when the step streams its output.
+    stream: Option<usize>,
+    /// Streamed deps this step consumes chunk by chunk instead of waiting for completion.
+    stream_inputs: Vec<usize>,
+    on_fail: Option<FailureAction>,
+}
+
+#[derive(Debug, Clone)]
+struct WorkflowPlan {
+    priority: PriorityClass,
+    steps: Vec<StepPlan>,
+}
+
+struct AgentPlan {
+    machine: AgentMachine,
+    capabilities: Vec<usize>,
+    /// No `max_iterations` was declared; `machine` carries `DEFAULT_AGENT_ITERATIONS`.
+    default_cap: bool,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct InstanceOutcome {
+    pub ok: bool,
+    /// Step id -> produced value, in step declaration order (completed steps only).
+    pub outputs: Vec<(String, String)>,
+    pub error: Option<String>,
+}
+
+/// Totals across every streamed step output.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct StreamStats {
+    pub chunks: u64,
+    /// Chunk sends that found a consumer's buffer full and had to wait (backpressure).
+    pub stalled_sends: u64,
+    /// Streams discarded mid-way because the producing step retried or fell back.
+    pub restarts: u64,
+}
+
+enum StreamEvent {
+    Chunk(String),
+    /// Discard what was received so far; the producer is starting over.
+    Restart,
+}
+
+/// One step's streamed output and inputs. Consumers learn the stream has ended when the
+/// producer drops its senders, which happens only after its `StepCell` holds the final state.
+struct StepStreams {
+    outlet: Vec<SyncSender<StreamEvent>>,
+    inlet: Vec<(usize, Receiver<StreamEvent>)>,
+    /// Set when a streamed input failed; the step is skipped rather than retried.
+    skipped: Option<String>,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+enum StepState {
+    Pending,
+    Done(String),
+    Failed(String),
+}
+
+struct StepCell {
+    state: Mutex<StepState>,
+    ready: Condvar,
+}
+
+impl StepCell {
+    fn new() -> Self {
+        Self {
+            state: Mutex::new(StepState::Pending),
+            ready: Condvar::new(),
+        }
+    }
+
+    fn wait(&self) -> StepState {
+        let mut state = self.state.lock().unwrap();
+        while *state == StepState::Pending {
+            state = self.ready.wait(state).unwrap();
+        }
+        state.clone()
+    }
+
+    fn finish(&self, result: StepState) {
+        *self.state.lock().unwrap() = result;
+        self.ready.notify_all();
+    }
+}
+
+/// Executes workflows and agents against local capability stand-ins.
+///
+/// Steps of one instance run as soon as the steps they reference have completed (one scoped
+/// thread per step); capability calls queue on per-instance semaphores so concurrent instances
+/// contend the same way deployed providers would.
+pub struct WorkflowRuntime {
+    options: RuntimeOptions,
+    workflows: HashMap<String, WorkflowPlan>,
+    agents: HashMap<String, AgentPlan>,
+    capabilities: Vec<CapabilitySlot>,
+    activations: Mutex<BTreeMap<String, u64>>,
+    streams: Mutex<StreamStats>,
+    journal: Option<Mutex<Journal>>,
+    net: Option<NetPool>,
+}
+
+impl WorkflowRuntime {
+    pub fn new(program: &HirProgram, options: RuntimeOptions) -> Result<Self, String> {
+        let mut capabilities: Vec<CapabilitySlot> = Vec::new();
+        let mut capability_index: HashMap<String, usize> = HashMap::new();
+        let mut intern_capability = |capability: &TypeRef| -> usize {
+            let key = capability.to_string();
+            if let Some(index) = capability_index.get(&key) {
+                return *index;
+            }
+            let latency_ms = capability_latency_ms(capability.head()) as f64 * options.time_scale;
+            let net_host = match capability.args.first() {
+                Some(TypeArg::String(host)) if capability.head() == "Net" => Some(host.clone()),
+                _ => None,
+            };
+            let index = capabilities.len();
+            capabilities.push(CapabilitySlot {
+                key: key.clone(),
+                net_host,
+                latency: Duration::from_secs_f64(latency_ms.max(0.0) / 1000.0),
+                limit: options.capability_limit.max(1),
+                in_flight: Mutex::new(0),
+                released: Condvar::new(),
+                stats: Mutex::new(CapabilityStats {
+                    capability: key.clone(),
+                    ..CapabilityStats::default()
+                }),
+            });
+            capability_index.insert(key, index);
+            index
+        };
+
+        let function_capabilities: HashMap<&str, Vec<usize>> = program
+            .functions
+            .iter()
+            .map(|function| {
+                let slots = if function.effects.is_empty() {
+                    Vec::new()
+                } else {
+                    function
+                        .requires
+                        .iter()
+                        .map(&mut intern_capability)
+                        .collect()
+                };
+                (function.name.as_str(), slots)
+            })
+            .collect();
+
+        let mut tools = ToolTable::default();
+        let mut agents = HashMap::new();
+        for agent in &program.agents {
+            let mut machine = compile_agent(agent, &mut tools).map_err(|error| error.message)?;
+            let default_cap = machine.max_iterations.is_none();
+            machine
+                .max_iterations
+                .get_or_insert(DEFAULT_AGENT_ITERATIONS);
+            let capabilities = agent.requires.iter().map(&mut intern_capability).collect();
+            agents.insert(
+                agent.name.clone(),
+                AgentPlan {
+                    machine,
+                    capabilities,
+                    default_cap,
+                },
+            );
+        }
+
+        let mut workflows = HashMap::new();
+        for workflow in &program.workflows {
+            let plan = plan_workflow(workflow, &function_capabilities, program, &options)?;
+            workflows.insert(workflow.name.clone(), plan);
+        }
+
+        Ok(Self {
+            options,
+            workflows,
+            agents,
+            capabilities,
+            activations: Mutex::new(BTreeMap::new()),
+            streams: Mutex::new(StreamStats::default()),
+            journal: None,
+            net: None,
+        })
+    }
+
+    pub fn has_workflow(&self, name: &str) -> bool {
+        self.workflows.contains_key(name)
+    }
+
+    pub fn has_agent(&self, name: &str) -> bool {
+        self.agents.contains_key(name)
+    }
+
+    /// Scheduling class of a target: the workflow's `priority` clause, else `standard`.
+    pub fn priority(&self, target: &str) -> PriorityClass {
+        self.workflows
+            .get(target)
+            .map(|plan| plan.priority)
+            .unwrap_or_default()
+    }
+
+    /// Run one workflow or agent instance. `invocation` seeds the deterministic failure draws.
+    pub fn run_instance(
+        &self,
+        target: &str,
+        invocation: u64,
+        args: &[String],
+    ) -> Result<InstanceOutcome, String> {
+        if self.workflows.contains_key(target) {
+            let instance = format!("{target}#{invocation}");
+            return Ok(self.run_workflow(target, invocation, &instance, args, 0));
+        }
+        if self.agents.contains_key(target) {
+            return Ok(self.run_agent(target, invocation));
+        }
+        Err(format!("unknown workflow or agent '{target}'"))
+    }
+
+    pub fn capability_stats(&self) -> Vec<CapabilityStats> {
+        self.capabilities
+            .iter()
+            .map(|slot| slot.stats.lock().unwrap().clone())
+            .collect()
+    }
+
+    pub fn stream_stats(&self) -> StreamStats {
+        *self.streams.lock().unwrap()
+    }
+
+    /// Checkpoint completed workflow steps to `journal` and replay them when an instance with
+    /// the same target and invocation id runs again.
+    pub fn attach_journal(&mut self, journal: Journal) {
+        self.journal = Some(Mutex::new(journal));
+    }
+
+    pub fn journal_stats(&self) -> Option<JournalStats> {
+        self.journal
+            .as_ref()
+            .map(|journal| journal.lock().unwrap().stats())
+    }
+
+    /// Send `Net<"host">` capability calls through `pool` as `GET /<target>` requests to that
+    /// host instead of sleeping the simulated latency. Streamed steps keep the stand-in latency.
+    /// Each call is one `request`; nothing here pipelines, so `pipelined` stays zero.
+    pub fn attach_net_pool(&mut self, pool: NetPool) {
+        self.net = Some(pool);
+    }
+
+    pub fn net_stats(&self) -> Option<NetPoolStats> {
+        self.net.as_ref().map(NetPool::stats)
+    }
+
+    /// `on_fail` action name -> number of times it was applied.
+    pub fn failure_policy_activations(&self) -> BTreeMap<String, u64> {
+        self.activations.lock().unwrap().clone()
+    }
+
+    /// `instance` keys the journal: `<workflow>#<invocation>`, plus `/<step>` per nesting level.
+    /// Unlike `invocation`, which seeds failure draws and changes per retry attempt, it is stable
+    /// across retries so a retried nested workflow replays its completed steps.
+    fn run_workflow(
+        &self,
+        name: &str,
+        invocation: u64,
+        instance: &str,
+        args: &[String],
+        depth: usize,
+    ) -> InstanceOutcome {
+        let plan = &self.workflows[name];
+        let cells: Vec<StepCell> = plan.steps.iter().map(|_| StepCell::new()).collect();
+
+        // One bounded chunk channel per (streamed step, consuming step) pair.
+        let mut streams: Vec<StepStreams> = plan
+            .steps
+            .iter()
+            .map(|_| StepStreams {
+                outlet: Vec::new(),
+                inlet: Vec::new(),
+                skipped: None,
+            })
+            .collect();
+        for (index, step) in plan.steps.iter().enumerate() {
+            for dep in &step.stream_inputs {
+                let buffer = plan.steps[*dep].stream.unwrap_or(1);
+                let (sender, receiver) = mpsc::sync_channel(buffer);
+                streams[*dep].outlet.push(sender);
+                streams[index].inlet.push((*dep, receiver));
+            }
+        }
+
+        thread::scope(|scope| {
+            for ((index, step), mut streams) in plan.steps.iter().enumerate().zip(streams) {
+                let cells = &cells;
+                scope.spawn(move || {
+                    if let Some(value) = self.replay(instance, &step.id) {
+                        self.emit_stream(&streams.outlet, &value);
+                        cells[index].finish(StepState::Done(value));
+                        return;
+                    }
+                    let mut inputs = Vec::with_capacity(step.args.len());
+                    for dep in &step.deps {
+                        if step.stream_inputs.contains(dep) {
+                            continue;
+                        }
+                        if let StepState::Failed(reason) = cells[*dep].wait() {
+                            cells[index].finish(StepState::Failed(format!(
+                                "step '{}' skipped: {reason}",
+                                step.id
+                            )));
+                            return;
+                        }
+                    }
+                    for arg in &step.args {
+                        inputs.push(match arg {
+                            StepArg::Param(param) => args.get(*param).cloned().unwrap_or_default(),
+                            // Filled in once the stream has been consumed.
+                            StepArg::Step(dep) if step.stream_inputs.contains(dep) => String::new(),
+                            StepArg::Step(dep) => match cells[*dep].wait() {
+                                StepState::Done(value) => value,
+                                _ => String::new(),
+                            },
+                            StepArg::Literal(value) => value.clone(),
+                        });
+                    }
+                    let result = self.run_step(
+                        step,
+                        index,
+                        invocation,
+                        instance,
+                        inputs,
+                        &mut streams,
+                        cells,
+                        depth,
+                    );
+                    if let StepState::Done(value) = &result {
+                        self.record(instance, &step.id, value);
+                    }
+                    cells[index].finish(result);
+                    drop(streams);
+                });
+            }
+        });
+
+        let mut outputs = Vec::new();
+        let mut error = None;
+        for (step, cell) in plan.steps.iter().zip(&cells) {
+            match cell.wait() {
+                StepState::Done(value) => outputs.push((step.id.clone(), value)),
+                StepState::Failed(reason) => {
+                    error.get_or_insert(reason);
+                }
+                StepState::Pending => {}
+            }
+        }
+        InstanceOutcome {
+            ok: error.is_none(),
+            outputs,
+            error,
+        }
+    }
+
+    #[allow(clippy::too_many_arguments)]
+    fn run_step(
+        &self,
+        step: &StepPlan,
+        index: usize,
+        invocation: u64,
+        instance: &str,
+        mut inputs: Vec<String>,
+        streams: &mut StepStreams,
+        cells: &[StepCell],
+        depth: usize,
+    ) -> StepState {
+        let max_retries = step.on_fail.as_ref().map(retry_limit).unwrap_or(0);
+        let mut attempt = 0u64;
+        loop {
+            if attempt > 0 {
+                self.restart_stream(&streams.outlet);
+            }
+            let salt = ((index as u64) << 32) | attempt;
+            match self.call_target(
+                step,
+                invocation,
+                instance,
+                salt,
+                &mut inputs,
+                streams,
+                cells,
+                depth,
+            ) {
+                Ok(value) => return StepState::Done(value),
+                Err(reason) => {
+                    if let Some(skipped) = streams.skipped.take() {
+                        return StepState::Failed(skipped);
+                    }
+                    let Some(action) = &step.on_fail else {
+                        return StepState::Failed(reason);
+                    };
+                    match action.name.as_str() {
+                        "retry" if attempt < max_retries => {
+                            self.record_activation("retry");
+                            attempt += 1;
+                        }
+                        // The last attempt failed too: no retry follows.
+                        "retry" => {
+                            self.record_activation("retry_exhausted");
+                            return StepState::Failed(reason);
+                        }
+                        "fallback" => {
+                            self.record_activation("fallback");
+                            let value = first_action_value(action);
+                            self.restart_stream(&streams.outlet);
+                            self.send_chunk(&streams.outlet, &value);
+                            return StepState::Done(value);
+                        }
+                        other => {
+                            self.record_activation(other);
+                            return StepState::Failed(reason);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    #[allow(clippy::too_many_arguments)]
+    fn call_target(
+        &self,
+        step: &StepPlan,
+        invocation: u64,
+        instance: &str,
+        salt: u64,
+        inputs: &mut [String],
+        streams: &mut StepStreams,
+        cells: &[StepCell],
+        depth: usize,
+    ) -> Result<String, String> {
+        if depth >= MAX_NESTING_DEPTH {
+            return Err(format!("step '{}' exceeds nesting depth", step.id));
+        }
+        // Streamed inputs are consumed by the first attempt; retries see the final values.
+        let inlet = std::mem::take(&mut streams.inlet);
+        let streaming = !inlet.is_empty() || !streams.outlet.is_empty();
+        let value = match &step.target {
+            StepTarget::Capabilities(slots) if streaming => {
+                return self.call_capabilities_streaming(
+                    step,
+                    slots,
+                    invocation,
+                    salt,
+                    inputs,
+                    inlet,
+                    &streams.outlet,
+                    &mut streams.skipped,
+                    cells,
+                );
+            }
+            StepTarget::Capabilities(slots) => {
+                for (call, slot) in slots.iter().enumerate() {
+                    let fails = self.draw_failure(invocation, salt ^ ((call as u64) << 48));
+                    self.call_capability(*slot, fails, &step.target_name)?;
+                }
+                format!("{}({})", step.target_name, inputs.join(", "))
+            }
+            StepTarget::Workflow(name) => {
+                let nested = format!("{instance}/{}", step.id);
+                let outcome =
+                    self.run_workflow(name, invocation ^ salt, &nested, inputs, depth + 1);
+                match outcome.error {
+                    Some(error) => return Err(error),
+                    None => outcome
+                        .outputs
+                        .last()
+                        .map(|(_, value)| value.clone())
+                        .unwrap_or_default(),
+                }
+            }
+            StepTarget::Agent(name) => {
+                let outcome = self.run_agent(name, invocation ^ salt);
+                match outcome.error {
+                    Some(error) => return Err(error),
+                    None => outcome
+                        .outputs
+                        .last()
+                        .map(|(_, value)| value.clone())
+                        .unwrap_or_default(),
+                }
+            }
+        };
+        // Workflow/agent targets have no partial output; they stream it all at once.
+        self.emit_stream(&streams.outlet, &value);
+        Ok(value)
+    }
+
+    /// A capability step that consumes and/or produces a stream. Its latency is spent per chunk,
+    /// first while draining each streamed input and then while emitting its own chunks, so a
+    /// downstream step runs alongside it instead of after it. Capability slots are held only
+    /// while a chunk is being worked on, never across a blocking send or receive: a producer
+    /// stalled on a full buffer must not starve the steps its consumer is still waiting for.
+    #[allow(clippy::too_many_arguments)]
+    fn call_capabilities_streaming(
+        &self,
+        step: &StepPlan,
+        slots: &[usize],
+        invocation: u64,
+        salt: u64,
+        inputs: &mut [String],
+        inlet: Vec<(usize, Receiver<StreamEvent>)>,
+        outlet: &[SyncSender<StreamEvent>],
+        skip: &mut Option<String>,
+        cells: &[StepCell],
+    ) -> Result<String, String> {
+        let mut waits = vec![Duration::ZERO; slots.len()];
+        let total: Duration = slots
+            .iter()
+            .map(|slot| self.capabilities[*slot].latency)
+            .sum();
+        let chunks = self.options.stream_chunks.max(1) as u32;
+        let per_chunk = total / (chunks * (inlet.len() as u32 + u32::from(!outlet.is_empty())));
+        let mut spent = Duration::ZERO;
+
+        let mut skipped = None;
+        for (dep, receiver) in inlet {
+            let mut received = String::new();
+            for event in receiver.iter() {
+                match event {
+                    StreamEvent::Chunk(chunk) => {
+                        received.push_str(&chunk);
+                        self.work_chunk(slots, &mut waits, per_chunk);
+                        spent += per_chunk;
+                    }
+                    StreamEvent::Restart => received.clear(),
+                }
+            }
+            match cells[dep].wait() {
+                StepState::Done(value) => {
+                    debug_assert_eq!(received, value, "stream of step {dep} diverged");
+                    for (input, arg) in inputs.iter_mut().zip(&step.args) {
+                        if matches!(arg, StepArg::Step(arg_dep) if *arg_dep == dep) {
+                            input.clone_from(&value);
+                        }
+                    }
+                }
+                StepState::Failed(reason) => {
+                    skipped.get_or_insert(format!("step '{}' skipped: {reason}", step.id));
+                }
+                StepState::Pending => {}
+            }
+        }
+        if let Some(reason) = skipped {
+            *skip = Some(reason.clone());
+            return Err(reason);
+        }
+
+        // Inputs that arrived in fewer chunks (e.g. a fallback value) leave work for the tail.
+        let remaining = total.saturating_sub(spent);
+        let value = format!("{}({})", step.target_name, inputs.join(", "));
+        if outlet.is_empty() {
+            self.work_chunk(slots, &mut waits, remaining);
+        } else {
+            for chunk in split_chunks(&value, chunks as usize) {
+                self.work_chunk(slots, &mut waits, remaining / chunks);
+                self.send_chunk(outlet, chunk);
+            }
+        }
+
+        let mut result = Ok(value);
+        for (call, slot) in slots.iter().enumerate() {
+            let fails = self.draw_failure(invocation, salt ^ ((call as u64) << 48));
+            if let Err(reason) = self.capabilities[*slot].record(waits[call], fails) {
+                result = result.and(Err(reason));
+            }
+        }
+        result
+    }
+
+    /// Holds every slot of a streaming step (acquired in index order) for one chunk of work.
+    fn work_chunk(&self, slots: &[usize], waits: &mut [Duration], duration: Duration) {
+        let mut order: Vec<usize> = (0..slots.len()).collect();
+        order.sort_by_key(|call| slots[*call]);
+        for call in &order {
+            waits[*call] += self.capabilities[slots[*call]].acquire();
+        }
+        sleep_nonzero(duration);
+        for call in &order {
+            self.capabilities[slots[*call]].release();
+        }
+    }
+
+    /// Sends a finished value to stream consumers in `stream_chunks` pieces.
+    fn emit_stream(&self, outlet: &[SyncSender<StreamEvent>], value: &str) {
+        if outlet.is_empty() {
+            return;
+        }
+        for chunk in split_chunks(value, self.options.stream_chunks.max(1)) {
+            self.send_chunk(outlet, chunk);
+        }
+    }
+
+    fn send_chunk(&self, outlet: &[SyncSender<StreamEvent>], chunk: &str) {
+        if outlet.is_empty() {
+            return;
+        }
+        let mut stalled = 0;
+        for sender in outlet {
+            match sender.try_send(StreamEvent::Chunk(chunk.to_string())) {
+                Ok(()) | Err(TrySendError::Disconnected(_)) => {}
+                Err(TrySendError::Full(event)) => {
+                    stalled += 1;
+                    // A consumer that gave up (e.g. skipped) disconnects; nothing to deliver.
+                    let _ = sender.send(event);
+                }
+            }
+        }
+        let mut stats = self.streams.lock().unwrap();
+        stats.chunks += 1;
+        stats.stalled_sends += stalled;
+    }
+
+    fn restart_stream(&self, outlet: &[SyncSender<StreamEvent>]) {
+        if outlet.is_empty() {
+            return;
+        }
+        for sender in outlet {
+            let _ = sender.send(StreamEvent::Restart);
+        }
+        self.streams.lock().unwrap().restarts += 1;
+    }
+
+    fn call_capability(&self, slot: usize, fails: bool, target: &str) -> Result<(), String> {
+        let slot = &self.capabilities[slot];
+        let (Some(pool), Some(host)) = (&self.net, &slot.net_host) else {
+            return slot.call(fails);
+        };
+        let waited = slot.acquire();
+        let response = pool.request(host, HttpRequest::get(format!("/{target}")));
+        slot.release();
+        let error = match response {
+            Ok(response) if response.status < 400 => None,
+            Ok(response) => Some(format!("{host} answered {}", response.status)),
+            Err(error) => Some(error),
+        };
+        slot.record(waited, fails || error.is_some())
+            .map_err(|reason| match error {
+                Some(error) => format!("{reason}: {error}"),
+                None => reason,
+            })
+    }
+
+    fn run_agent(&self, name: &str, invocation: u64) -> InstanceOutcome {
+        let plan = &self.agents[name];
+        let machine = &plan.machine;
+        let mut failure: Option<String> = None;
+
+        let run = machine.run(|state, iteration| {
+            for (call, slot) in plan.capabilities.iter().enumerate() {
+                let fails = self.draw_failure(invocation, (iteration << 16) | call as u64);
+                if let Err(reason) = self.call_capability(*slot, fails, name) {
+                    failure = Some(reason);
+                    return None;
+                }
+            }
+            // Prefer the stop state when it is one step away; otherwise pick a successor.
+            let successors: Vec<_> = machine.successors(state).collect();
+            if let Some(stop) = machine.stop_state.filter(|stop| successors.contains(stop)) {
+                if self.draw(invocation, iteration) < 0.5 {
+                    return Some(stop);
+                }
+            }
+            let pick = (self.draw(invocation, !iteration) * successors.len() as f64) as usize;
+            successors
+                .get(pick.min(successors.len().saturating_sub(1)))
+                .copied()
+        });
+
+        let final_state = machine.state_name(run.final_state).to_string();
+        let error = failure.or(match run.outcome {
+            AgentOutcome::InvalidTransition { from, to } => Some(format!(
+                "agent '{name}' attempted undeclared transition {} -> {}",
+                machine.state_name(from),
+                machine.state_name(to)
+            )),
+            AgentOutcome::IterationLimit if plan.default_cap => Some(format!(
+                "agent '{name}' did not stop within {DEFAULT_AGENT_ITERATIONS} iterations (no max_iterations declared)"
+            )),
+            _ => None,
+        });
+        InstanceOutcome {
+            ok: error.is_none(),
+            outputs: vec![("state".to_string(), final_state)],
+            error,
+        }
+    }
+
+    fn record_activation(&self, action: &str) {
+        *self
+            .activations
+            .lock()
+            .unwrap()
+            .entry(action.to_string())
+            .or_default() += 1;
+    }
+
+    fn replay(&self, instance: &str, step: &str) -> Option<String> {
+        self.journal
+            .as_ref()?
+            .lock()
+            .unwrap()
+            .replay(instance, step)
+    }
+
+    fn record(&self, instance: &str, step: &str, value: &str) {
+        if let Some(journal) = &self.journal {
+            journal.lock().unwrap().append(instance, step, value);
+        }
+    }
+
+    fn draw_failure(&self, invocation: u64, salt: u64) -> bool {
+        self.options.failure_rate > 0.0 && self.draw(invocation, salt) < self.options.failure_rate
+    }
+
+    /// Deterministic uniform draw in `[0, 1)` from (seed, invocation, salt).
+    fn draw(&self, invocation: u64, salt: u64) -> f64 {
+        let mixed = splitmix64(self.options.seed ^ splitmix64(invocation ^ splitmix64(salt)));
+        (mixed >> 11) as f64 / (1u64 << 53) as f64
+    }
+}
+
+fn plan_workflow(
+    workflow: &HirWorkflow,
+    function_capabilities: &HashMap<&str, Vec<usize>>,
+    program: &HirProgram,
+    options: &RuntimeOptions,
+) -> Result<WorkflowPlan, String> {
+    let params: Vec<String> = workflow
+        .params
+        .iter()
+        .map(|param| param.name.clone())
+        .collect();
+    let mut steps: Vec<StepPlan> = Vec::new();
+
+    for step in &workflow.steps {
+        let target_name = step.call.target.clone();
+        let target = if let Some(slots) = function_capabilities.get(target_name.as_str()) {
+            StepTarget::Capabilities(slots.clone())
+        } else if program.workflows.iter().any(|w| w.name == target_name) {
+            StepTarget::Workflow(target_name.clone())
+        } else if program.agents.iter().any(|a| a.name == target_name) {
+            StepTarget::Agent(target_name.clone())
+        } else {
+            return Err(format!(
+                "workflow '{}' step '{}' calls unknown target '{}'",
+                workflow.name, step.id, target_name
+            ));
+        };
+
+        let mut args = Vec::new();
+        let mut deps = Vec::new();
+        for arg in &step.call.args {
+            args.push(match arg {
+                WorkflowCallArg::Path(segments) => {
+                    let root = segments.first().map(String::as_str).unwrap_or("");
+                    if let Some(dep) = steps.iter().position(|s| s.id == root) {
+                        if !deps.contains(&dep) {
+                            deps.push(dep);
+                        }
+                        StepArg::Step(dep)
+                    } else if let Some(param) = params.iter().position(|p| p == root) {
+                        StepArg::Param(param)
+                    } else {
+                        StepArg::Literal(segments.join("."))
+                    }
+                }
+                WorkflowCallArg::String(value) | WorkflowCallArg::Number(value) => {
+                    StepArg::Literal(value.clone())
+                }
+            });
+        }
+
+        // Consume a streamed dep chunk by chunk only when no other dep of this step waits on
+        // it: otherwise this step would sit on a full buffer the producer is blocked on.
+        let stream_inputs = if matches!(target, StepTarget::Capabilities(_)) {
+            deps.iter()
+                .copied()
+                .filter(|dep| steps[*dep].stream.is_some())
+                .filter(|dep| {
+                    !deps
+                        .iter()
+                        .any(|other| other != dep && depends_on(&steps, *other, *dep))
+                })
+                .collect()
+        } else {
+            Vec::new()
+        };
+
+        steps.push(StepPlan {
+            id: step.id.clone(),
+            target_name,
+            target,
+            args,
+            deps,
+            stream: step.stream.as_ref().map(|spec| {
+                spec.buffer
+                    .map(|buffer| buffer as usize)
+                    .unwrap_or(options.stream_buffer)
+                    .max(1)
+            }),
+            stream_inputs,
+            on_fail: step.on_fail.clone(),
+        });
+    }
+
+    Ok(WorkflowPlan {
+        priority: workflow.priority.unwrap_or_default(),
+        steps,
+    })
+}
+
+/// Whether step `from` (transitively) reads step `target`.
+fn depends_on(steps: &[StepPlan], from: usize, target: usize) -> bool {
+    let mut stack = vec![from];
+    let mut seen = vec![false; steps.len()];
+    while let Some(index) = stack.pop() {
+        for dep in &steps[index].deps {
+            if *dep == target {
+                return true;
+            }
+            if !seen[*dep] {
+                seen[*dep] = true;
+                stack.push(*dep);
+            }
+        }
+    }
+    false
+}
+
+/// Splits `value` into at most `count` pieces of near-equal length on char boundaries.
+fn split_chunks(value: &str, count: usize) -> Vec<&str> {
+    let offsets: Vec<usize> = value
+        .char_indices()
+        .map(|(offset, _)| offset)
+        .chain([value.len()])
+        .collect();
+    let chars = offsets.len() - 1;
+    (0..count)
+        .map(|chunk| &value[offsets[chars * chunk / count]..offsets[chars * (chunk + 1) / count]])
+        .collect()
+}
+
+fn sleep_nonzero(duration: Duration) {
+    if !duration.is_zero() {
+        thread::sleep(duration);
+    }
+}
+
+fn first_action_value(action: &FailureAction) -> String {
+    match action.args.first().map(|arg| &arg.value) {
+        Some(FailureValue::String(value))
+        | Some(FailureValue::Ident(value))
+        | Some(FailureValue::Number(value)) => value.clone(),
+        None => String::new(),
+    }
+}
+
+fn splitmix64(mut value: u64) -> u64 {
+    value = value.wrapping_add(0x9e3779b97f4a7c15);
+    value = (value ^ (value >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+    value = (value ^ (value >> 27)).wrapping_mul(0x94d049bb133111eb);
+    value ^ (value >> 31)
+}
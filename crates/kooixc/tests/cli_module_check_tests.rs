@@ -324,3 +324,116 @@ fn check_modules_json_warning_fails_with_strict() {
 
     let _ = fs::remove_dir_all(&dir);
 }
+
+#[test]
+fn module_path_option_and_kooix_path_resolve_imports() {
+    let dir = make_temp_dir("module-path");
+    let vendor = dir.join("vendor");
+    let app = dir.join("app");
+    fs::create_dir_all(vendor.join("kxlib")).expect("create vendor dir");
+    fs::create_dir_all(&app).expect("create app dir");
+    fs::write(
+        vendor.join("kxlib/util.kooix"),
+        "fn helper() -> Int { 41 };",
+    )
+    .expect("write lib");
+    let main = app.join("main.kooix");
+    fs::write(
+        &main,
+        "import \"kxlib/util\";\n\nfn main() -> Int { helper() + 1 };",
+    )
+    .expect("write main");
+
+    let missing = Command::new(env!("CARGO_BIN_EXE_kooixc"))
+        .arg("check")
+        .arg(&main)
+        .env_remove("KOOIX_PATH")
+        .output()
+        .expect("run check");
+    assert!(
+        !missing.status.success(),
+        "import should not resolve without a module path"
+    );
+
+    let output = Command::new(env!("CARGO_BIN_EXE_kooixc"))
+        .arg("--module-path")
+        .arg(&vendor)
+        .arg("check")
+        .arg(&main)
+        .output()
+        .expect("run check --module-path");
+    assert!(
+        output.status.success(),
+        "check should pass, stderr: {}",
+        String::from_utf8_lossy(&output.stderr)
+    );
+
+    let output = Command::new(env!("CARGO_BIN_EXE_kooixc"))
+        .arg("check")
+        .arg(&main)
+        .env(
+            "KOOIX_PATH",
+            format!("/nonexistent-kooix-root:{}", vendor.display()),
+        )
+        .output()
+        .expect("run check with KOOIX_PATH");
+    assert!(
+        output.status.success(),
+        "check should pass, stderr: {}",
+        String::from_utf8_lossy(&output.stderr)
+    );
+
+    let _ = fs::remove_dir_all(&dir);
+}
+
+#[test]
+fn check_modules_module_option_checks_one_module() {
+    let dir = make_temp_dir("check-modules-one");
+    let lib = dir.join("lib.kooix");
+    let main = dir.join("main.kooix");
+
+    fs::write(
+        &lib,
+        "fn helper() -> Int { 41 };\nfn broken() -> Int { true };",
+    )
+    .expect("write lib");
+    fs::write(
+        &main,
+        "import \"lib\" as Lib;\n\nfn main() -> Int { Lib::helper() + 1 };",
+    )
+    .expect("write main");
+
+    let run = |module: &PathBuf| {
+        Command::new(env!("CARGO_BIN_EXE_kooixc"))
+            .arg("check-modules")
+            .arg(&main)
+            .arg("--module")
+            .arg(module)
+            .arg("--json")
+            .output()
+            .expect("run check-modules")
+    };
+
+    let output = run(&main);
+    let stdout = String::from_utf8_lossy(&output.stdout);
+    assert!(output.status.success(), "unexpected stdout: {stdout}");
+    assert!(
+        stdout.contains("\"ok\":true"),
+        "unexpected stdout: {stdout}"
+    );
+    assert!(!stdout.contains("lib.kooix"), "unexpected stdout: {stdout}");
+
+    let output = run(&lib);
+    assert_eq!(output.status.code(), Some(1));
+    let stdout = String::from_utf8_lossy(&output.stdout);
+    assert!(stdout.contains("broken"), "unexpected stdout: {stdout}");
+    assert!(
+        !stdout.contains("main.kooix"),
+        "unexpected stdout: {stdout}"
+    );
+
+    let output = run(&dir.join("other.kooix"));
+    assert_eq!(output.status.code(), Some(2));
+
+    let _ = fs::remove_dir_all(&dir);
+}
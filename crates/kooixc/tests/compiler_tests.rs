@@ -1,17 +1,20 @@
+use kooixc::agent::{compile_agents, AgentOutcome};
 use kooixc::ast::{Expr, FailureValue, Item, PredicateOp, PredicateValue, Statement};
 use kooixc::error::Severity;
-use kooixc::interp::Value;
+use kooixc::interp::{EnsuresSampling, Value};
 use kooixc::loader::load_source_map;
 use kooixc::native::{
     compile_llvm_ir_to_executable, compile_llvm_ir_to_executable_with_tools,
     run_executable_with_args_and_stdin, run_executable_with_args_and_stdin_and_timeout,
     NativeError,
 };
+use kooixc::tier::TierOptions;
 use kooixc::{
-    check_source, compile_and_run_native_source, compile_and_run_native_source_with_args,
-    compile_and_run_native_source_with_args_and_stdin,
-    compile_and_run_native_source_with_args_stdin_and_timeout, emit_llvm_ir_source, lower_source,
-    lower_to_mir_source, parse_source, run_source,
+    analyze_latency_source, check_source, compile_agents_source, compile_and_run_native_source,
+    compile_and_run_native_source_with_args, compile_and_run_native_source_with_args_and_stdin,
+    compile_and_run_native_source_with_args_stdin_and_timeout, emit_llvm_ir_source,
+    loadtest_source, lower_source, lower_to_mir_source, parse_source, run_source,
+    run_source_tiered, run_source_with_ensures,
 };
 
 #[test]
@@ -2686,6 +2689,24 @@ fn stage1_lexer_punctuation_smoke() {
     assert_eq!(result.value, Value::Int(0));
 }
 
+#[test]
+fn stage1_lexer_cursor_token_buffer_smoke() {
+    let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+    let entry = repo_root.join("stage1/stage2_lexer_cursor_smoke.kooix");
+    let source_map = load_source_map(&entry).expect("stage1 lexer cursor smoke should load");
+
+    let diagnostics = check_source(&source_map.combined);
+    assert!(
+        !diagnostics
+            .iter()
+            .any(|diagnostic| diagnostic.severity == Severity::Error),
+        "stage1 lexer cursor smoke should have no semantic errors"
+    );
+
+    let result = run_source(&source_map.combined).expect("stage1 lexer cursor smoke should run");
+    assert_eq!(result.value, Value::Int(0));
+}
+
 #[test]
 fn stage1_parser_fn_smoke() {
     let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
@@ -3118,6 +3139,403 @@ fn stage1_typecheck_smoke() {
     assert_eq!(result.value, Value::Int(0));
 }
 
+#[test]
+fn stage1_typecheck_type_table_smoke() {
+    let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+    let entry = repo_root.join("examples/stage1_typecheck_type_table_smoke.kooix");
+    let source_map = load_source_map(&entry).expect("stage1 type table smoke should load");
+
+    let diagnostics = check_source(&source_map.combined);
+    assert!(
+        !diagnostics
+            .iter()
+            .any(|diagnostic| diagnostic.severity == Severity::Error),
+        "stage1 type table smoke should have no semantic errors"
+    );
+
+    let result = run_source(&source_map.combined).expect("stage1 type table smoke should run");
+    assert_eq!(result.value, Value::Int(0));
+}
+
+#[test]
+fn stage1_batch_manifest_smoke() {
+    let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+    let entry = repo_root.join("examples/stage1_batch_manifest_smoke.kooix");
+    let source_map = load_source_map(&entry).expect("stage1 batch manifest smoke should load");
+
+    let diagnostics = check_source(&source_map.combined);
+    assert!(
+        !diagnostics
+            .iter()
+            .any(|diagnostic| diagnostic.severity == Severity::Error),
+        "stage1 batch manifest smoke should have no semantic errors"
+    );
+
+    let result = run_source(&source_map.combined).expect("stage1 batch manifest smoke should run");
+    assert_eq!(result.value, Value::Int(0));
+}
+
+#[test]
+fn stage1_timings_report_smoke() {
+    let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+    let entry = repo_root.join("examples/stage1_timings_smoke.kooix");
+    let source_map = load_source_map(&entry).expect("stage1 timings smoke should load");
+
+    let diagnostics = check_source(&source_map.combined);
+    assert!(
+        !diagnostics
+            .iter()
+            .any(|diagnostic| diagnostic.severity == Severity::Error),
+        "stage1 timings smoke should have no semantic errors"
+    );
+
+    let result = run_source(&source_map.combined).expect("stage1 timings smoke should run");
+    assert_eq!(result.value, Value::Int(0));
+}
+
+#[cfg(unix)]
+#[test]
+fn bootstrap_dag_caches_nodes_by_input_hash() {
+    use kooixc::bootstrap::{
+        run_plan, BootstrapNode, BootstrapPlan, NodeAction, NodeArg, NodeInput, NodeStatus,
+    };
+
+    let root = std::env::temp_dir().join(format!("kooixc-bootstrap-dag-{}", std::process::id()));
+    let _ = std::fs::remove_dir_all(&root);
+    std::fs::create_dir_all(&root).expect("should create bootstrap root");
+    let input = root.join("in.txt");
+    std::fs::write(&input, "v1").expect("should write input");
+
+    let sh = |id: &str,
+              deps: Vec<usize>,
+              inputs: Vec<NodeInput>,
+              script: &str,
+              args: Vec<NodeArg>,
+              outputs: Vec<&str>,
+              expect_exit: i32| {
+        let mut argv = vec![
+            NodeArg::Text("-c".to_string()),
+            NodeArg::Text(script.to_string()),
+            NodeArg::Text("sh".to_string()),
+        ];
+        argv.extend(args);
+        BootstrapNode {
+            id: id.to_string(),
+            deps,
+            inputs,
+            action: NodeAction::Command {
+                program: NodeArg::Text("sh".to_string()),
+                args: argv,
+                expect_exit,
+            },
+            outputs: outputs.into_iter().map(str::to_string).collect(),
+            mem_kb: 1024,
+            timeout_ms: Some(30_000),
+        }
+    };
+    let gen = NodeInput::Artifact { node: 0, output: 0 };
+    let plan = BootstrapPlan {
+        root: root.clone(),
+        nodes: vec![
+            sh(
+                "gen",
+                vec![],
+                vec![NodeInput::File(input.clone())],
+                "cat in.txt > \"$1\"",
+                vec![NodeArg::Output(0)],
+                vec!["gen.txt"],
+                0,
+            ),
+            sh(
+                "smoke-a",
+                vec![0],
+                vec![gen.clone()],
+                "grep -q v \"$1\"",
+                vec![NodeArg::Artifact { node: 0, output: 0 }],
+                vec![],
+                0,
+            ),
+            sh(
+                "smoke-b",
+                vec![0],
+                vec![gen.clone()],
+                "exit 3",
+                vec![],
+                vec![],
+                3,
+            ),
+            sh("broken", vec![0], vec![gen], "exit 1", vec![], vec![], 0),
+            sh("after-broken", vec![3], vec![], "true", vec![], vec![], 0),
+        ],
+    };
+    let cache = root.join("cache");
+    let statuses = |report: &kooixc::bootstrap::BootstrapReport| {
+        report
+            .nodes
+            .iter()
+            .map(|node| node.status)
+            .collect::<Vec<_>>()
+    };
+
+    let first = run_plan(&plan, &cache, 2, 0);
+    assert!(!first.ok());
+    assert_eq!(
+        statuses(&first),
+        vec![
+            NodeStatus::Built,
+            NodeStatus::Built,
+            NodeStatus::Built,
+            NodeStatus::Failed,
+            NodeStatus::Skipped
+        ]
+    );
+    assert_eq!(
+        first.node("broken").and_then(|node| node.exit_code),
+        Some(1)
+    );
+    assert!(first.node("gen").and_then(|node| node.maxrss_kb).is_some());
+
+    // Unchanged inputs: every successful node is reused, the failed one is retried.
+    let second = run_plan(&plan, &cache, 2, 0);
+    assert_eq!(
+        statuses(&second),
+        vec![
+            NodeStatus::Cached,
+            NodeStatus::Cached,
+            NodeStatus::Cached,
+            NodeStatus::Failed,
+            NodeStatus::Skipped
+        ]
+    );
+    assert_eq!(
+        second.node("gen").map(|node| node.key),
+        first.node("gen").map(|node| node.key)
+    );
+
+    // New input content changes the key of `gen` and, through its artifact, of its dependents.
+    std::fs::write(&input, "v2").expect("should rewrite input");
+    let third = run_plan(&plan, &cache, 1, 0);
+    assert_eq!(
+        third.node("gen").map(|node| node.status),
+        Some(NodeStatus::Built)
+    );
+    assert_eq!(
+        third.node("smoke-a").map(|node| node.status),
+        Some(NodeStatus::Built)
+    );
+    assert_ne!(
+        third.node("gen").map(|node| node.key),
+        first.node("gen").map(|node| node.key)
+    );
+
+    let json = third.to_json();
+    assert!(json.starts_with("{\"ok\":false,\"jobs\":1,"), "{json}");
+    assert!(
+        json.contains("\"id\":\"smoke-b\",\"status\":\"built\""),
+        "{json}"
+    );
+    assert!(
+        json.contains("\"id\":\"after-broken\",\"status\":\"skipped\""),
+        "{json}"
+    );
+
+    let _ = std::fs::remove_dir_all(&root);
+}
+
+#[test]
+#[cfg(unix)]
+fn bootstrap_batch_smoke_compiles_stage3_smokes_in_one_node() {
+    use kooixc::bootstrap::{
+        plan_v0_13, run_plan, BootstrapNode, BootstrapOptions, BootstrapPlan, NodeAction, NodeArg,
+        NodeInput, NodeStatus,
+    };
+
+    let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+    let compiler = std::env::current_exe().expect("test binary path");
+    let mut options = BootstrapOptions::new(&repo_root, &compiler);
+    options.smokes = vec!["core".to_string(), "batch".to_string()];
+    let plan = plan_v0_13(&options).expect("plan should build");
+    let ids: Vec<&str> = plan.nodes.iter().map(|node| node.id.as_str()).collect();
+    assert!(ids.contains(&"smoke:batch:compile"));
+    assert!(!ids
+        .iter()
+        .any(|id| id.starts_with("smoke:s1-") && id.ends_with(":compile")));
+    let batch = ids
+        .iter()
+        .position(|id| *id == "smoke:batch:compile")
+        .unwrap();
+    match &plan.nodes[batch].action {
+        NodeAction::Batch { entries, .. } => assert_eq!(entries.len(), 4),
+        other => panic!("unexpected batch action {other:?}"),
+    }
+    // Linking steps are keyed on the llc/clang versions; running a binary is not.
+    for node in &plan.nodes {
+        let links = node.id.starts_with("stage") || node.id.ends_with(":compile");
+        assert_eq!(
+            node.inputs.contains(&NodeInput::Toolchain),
+            links,
+            "{}",
+            node.id
+        );
+    }
+    let run = ids
+        .iter()
+        .position(|id| *id == "smoke:s1-lexer:run")
+        .unwrap();
+    assert_eq!(plan.nodes[run].deps, vec![batch]);
+
+    // The batch node writes the manifest and expects every listed output afterwards.
+    let root = std::env::temp_dir().join(format!("kooixc-bootstrap-batch-{}", std::process::id()));
+    let _ = std::fs::remove_dir_all(&root);
+    std::fs::create_dir_all(&root).expect("should create bootstrap root");
+    let fake = root.join("fake-kooixc1");
+    std::fs::write(
+        &fake,
+        "#!/bin/sh\n[ \"$1\" = --batch ] || exit 9\nwhile read entry ir bin; do echo \"$entry\" > \"$ir\"; cp \"$0\" \"$bin\"; done < \"$2\"\n",
+    )
+    .expect("should write fake compiler");
+    std::process::Command::new("chmod")
+        .arg("+x")
+        .arg(&fake)
+        .status()
+        .expect("chmod should run");
+    let plan = BootstrapPlan {
+        root: root.clone(),
+        nodes: vec![BootstrapNode {
+            id: "batch".to_string(),
+            deps: Vec::new(),
+            inputs: Vec::new(),
+            action: NodeAction::Batch {
+                program: NodeArg::Path(fake),
+                entries: vec![root.join("a.kooix"), root.join("b.kooix")],
+            },
+            outputs: ["a.ll", "a", "b.ll", "b"].map(str::to_string).to_vec(),
+            mem_kb: 1024,
+            timeout_ms: Some(30_000),
+        }],
+    };
+    let report = run_plan(&plan, &root.join("cache"), 1, 0);
+    assert_eq!(
+        report.node("batch").map(|node| node.status),
+        Some(NodeStatus::Built)
+    );
+    let outputs = &report.node("batch").unwrap().outputs;
+    let ir = std::fs::read_to_string(&outputs[2]).expect("batch should write b.ll");
+    assert!(ir.contains("b.kooix"));
+
+    let _ = std::fs::remove_dir_all(&root);
+}
+
+#[test]
+fn bench_compare_flags_regressed_stage_and_phase() {
+    use kooixc::bench::{compare, mann_whitney_p, parse_bench_input, CompareOptions, Verdict};
+
+    // Fully separated 5-vs-5 samples: exact two-sided p = 2 / C(10, 5).
+    let p = mann_whitney_p(&[1.0, 2.0, 3.0, 4.0, 5.0], &[6.0, 7.0, 8.0, 9.0, 10.0])
+        .expect("both sides have samples");
+    assert!((p - 2.0 / 252.0).abs() < 1e-12, "p={p}");
+    assert_eq!(mann_whitney_p(&[1.0], &[2.0, 3.0]), None);
+
+    let baseline = parse_bench_input(
+        r#"{"schema":"kooix-bench-v1","metrics":{
+            "bootstrap.stage2.seconds":[5.0,5.1,4.9,5.05,4.95],
+            "bootstrap.stage2.maxrss_kb":[200000],
+            "bootstrap.stage3.seconds":[5.0,5.1,4.9,5.05,4.95],
+            "timings.codegen.seconds":[0.24,0.25,0.23],
+            "timings.codegen.heap_kb":[120000]}}"#,
+    )
+    .expect("store should parse");
+
+    let mut current = parse_bench_input(
+        r#"{"ok":true,"jobs":1,"mem_budget_kb":0,"seconds":30.0,"nodes":[
+            {"id":"stage2","status":"built","key":"00","seconds":6.2,"maxrss_kb":230000,"exit_code":0,"error":null},
+            {"id":"stage3","status":"built","key":"01","seconds":5.02,"maxrss_kb":190000,"exit_code":0,"error":null},
+            {"id":"stage4","status":"cached","key":"02","seconds":0.05,"maxrss_kb":190000,"exit_code":null,"error":null}]}"#,
+    )
+    .expect("bootstrap report should parse");
+    assert!(!current.metrics.contains_key("bootstrap.stage4.seconds"));
+    for run in [
+        "timings: codegen   240.100 ms    heap +97.000 MB\n",
+        "timings: codegen   251.000 ms    heap +98.000 MB\n",
+        "timings: codegen   239.000 ms    heap +97.500 MB\n",
+    ] {
+        current.merge(&parse_bench_input(run).expect("timings should parse"));
+    }
+    for run in [
+        "stage2_seconds=6.3\n",
+        "stage2_seconds=6.1\n",
+        "stage2_seconds=6.25\n",
+        "stage2_seconds=6.4\n",
+    ] {
+        let resource = parse_bench_input(run).expect("resource log should parse");
+        assert!(resource.metrics.contains_key("resource.stage2.seconds"));
+        current.push(
+            "bootstrap.stage2.seconds",
+            resource.metrics["resource.stage2.seconds"][0],
+        );
+    }
+
+    let report = compare(&baseline, &current, &CompareOptions::default());
+    let verdict = |name: &str| {
+        report
+            .metrics
+            .iter()
+            .find(|metric| metric.name == name)
+            .map(|metric| metric.verdict)
+    };
+    assert_eq!(
+        verdict("bootstrap.stage2.seconds"),
+        Some(Verdict::Regressed)
+    );
+    assert_eq!(
+        verdict("bootstrap.stage2.maxrss_kb"),
+        Some(Verdict::Regressed)
+    );
+    assert_eq!(
+        verdict("bootstrap.stage3.seconds"),
+        Some(Verdict::Unchanged)
+    );
+    assert_eq!(verdict("bootstrap.stage3.maxrss_kb"), Some(Verdict::Added));
+    assert_eq!(verdict("timings.codegen.seconds"), Some(Verdict::Unchanged));
+    assert_eq!(verdict("timings.codegen.heap_kb"), Some(Verdict::Improved));
+    let stage2 = report
+        .metrics
+        .iter()
+        .find(|metric| metric.name == "bootstrap.stage2.seconds")
+        .expect("stage2 time compared");
+    assert!(stage2.p_value.is_some_and(|p| p < 0.05), "{stage2:?}");
+    let codegen = report
+        .metrics
+        .iter()
+        .find(|metric| metric.name == "timings.codegen.seconds")
+        .expect("codegen time compared");
+    assert_eq!(
+        codegen.p_value, None,
+        "3-vs-3 samples fall back to the threshold"
+    );
+    assert!(report
+        .to_json()
+        .contains("\"p_value\":null,\"test\":\"threshold-only\""));
+    assert!(report.to_string().contains(", n<4, threshold only)"));
+
+    let mut options = CompareOptions::default();
+    options
+        .thresholds
+        .push(("bootstrap.*.maxrss_kb".to_string(), 20.0));
+    let report = compare(&baseline, &current, &options);
+    let regressed = report
+        .regressions()
+        .map(|metric| metric.name.as_str())
+        .collect::<Vec<_>>();
+    assert_eq!(regressed, vec!["bootstrap.stage2.seconds"]);
+    assert!(report
+        .to_json()
+        .contains("\"regressed\":[\"bootstrap.stage2.seconds\"]"));
+    assert!(report
+        .to_string()
+        .ends_with("fail: regressed: bootstrap.stage2.seconds\n"));
+}
+
 #[test]
 fn stage1_typecheck_mismatch_smoke() {
     let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
@@ -3251,6 +3669,36 @@ fn compiles_native_binary_when_toolchain_available() {
     let _ = std::fs::remove_file(&output);
 }
 
+#[test]
+fn native_link_drops_unreferenced_runtime_helpers() {
+    if !cfg!(target_os = "linux") || !tool_exists("llc") || !tool_exists("clang") {
+        return;
+    }
+
+    let ir = concat!(
+        "declare i8* @kx_int_to_text(i64)\n",
+        "define i64 @kx_program_main() {\nentry:\n",
+        "  %t = call i8* @kx_int_to_text(i64 42)\n",
+        "  ret i64 0\n}\n"
+    );
+    let output = std::env::temp_dir().join("kooixc-native-gc-sections");
+    let _ = std::fs::remove_file(&output);
+
+    compile_llvm_ir_to_executable(ir, &output).expect("native compile should succeed");
+    let binary = std::fs::read(&output).expect("read binary");
+    let has_symbol = |name: &str| {
+        binary
+            .windows(name.len() + 1)
+            .any(|w| &w[..name.len()] == name.as_bytes() && w[name.len()] == 0)
+    };
+    assert!(has_symbol("kx_int_to_text"));
+    assert!(has_symbol("kx_runtime_init"));
+    assert!(!has_symbol("kx_host_link_llvm_ir_file"));
+    assert!(!has_symbol("kx_host_load_source_map"));
+
+    let _ = std::fs::remove_file(&output);
+}
+
 #[test]
 fn compiles_and_runs_native_binary() {
     if !tool_exists("llc") || !tool_exists("clang") {
@@ -3760,6 +4208,101 @@ fn stage1_self_host_v0_5_emits_and_runs_stage2_text_byte_at_smoke() {
     let _ = std::fs::remove_file("/tmp/kooixc_stage2_text_byte_at.ll");
 }
 
+#[test]
+fn stage1_self_host_v0_15_emits_and_runs_stage2_lexer_cursor_smoke() {
+    if !tool_exists("llc") || !tool_exists("clang") {
+        return;
+    }
+
+    // Stage1 emits the Stage1 lexer itself (text_byte/text_sub/int_buf_* runtime calls).
+    let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+    let entry = repo_root.join("stage1/self_host_lexer_cursor_main.kooix");
+    let source_map = load_source_map(&entry)
+        .expect("stage1 self_host_lexer_cursor_main should load via include-style imports");
+
+    let output = std::env::temp_dir().join("kooixc-stage1-self-host-v0-15-lexer-cursor");
+    let _ = std::fs::remove_file(&output);
+    let _ = std::fs::remove_file("/tmp/kooixc_stage2_lexer_cursor.ll");
+
+    let run_output = compile_and_run_native_source(&source_map.combined, &output)
+        .expect("stage1 self-host lexer cursor driver should run");
+    assert_eq!(run_output.status_code, Some(0));
+
+    let ir = std::fs::read_to_string("/tmp/kooixc_stage2_lexer_cursor.ll")
+        .expect("stage1 self-host driver should write /tmp/kooixc_stage2_lexer_cursor.ll");
+
+    let stage2 = std::env::temp_dir().join("kooixc-stage2-from-stage1-ll-lexer-cursor");
+    let _ = std::fs::remove_file(&stage2);
+    compile_llvm_ir_to_executable(&ir, &stage2).expect("native-llvm build should succeed");
+
+    let args: Vec<String> = vec![];
+    let stage2_out = run_executable_with_args_and_stdin(&stage2, &args, None)
+        .expect("stage2 lexer cursor binary should run");
+    assert_eq!(stage2_out.status_code, Some(0));
+
+    let _ = std::fs::remove_file(&output);
+    let _ = std::fs::remove_file(&stage2);
+    let _ = std::fs::remove_file("/tmp/kooixc_stage2_lexer_cursor.ll");
+}
+
+#[test]
+fn stage1_self_host_v0_16_emits_and_runs_stage2_match_switch_smoke() {
+    if !tool_exists("llc") || !tool_exists("clang") {
+        return;
+    }
+
+    // Multi-arm user-enum match lowers to one `switch i8`; unit variants are shared constants.
+    let repo_root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+    let entry = repo_root.join("stage1/self_host_match_switch_main.kooix");
+    let source_map = load_source_map(&entry)
+        .expect("stage1 self_host_match_switch_main should load via include-style imports");
+
+    let output = std::env::temp_dir().join("kooixc-stage1-self-host-v0-16-match-switch");
+    let _ = std::fs::remove_file(&output);
+    let _ = std::fs::remove_file("/tmp/kooixc_stage2_match_switch.ll");
+
+    let run_output = compile_and_run_native_source(&source_map.combined, &output)
+        .expect("stage1 self-host match switch driver should run");
+    assert_eq!(run_output.status_code, Some(0));
+
+    let ir = std::fs::read_to_string("/tmp/kooixc_stage2_match_switch.ll")
+        .expect("stage1 self-host driver should write /tmp/kooixc_stage2_match_switch.ll");
+    assert!(
+        ir.contains(", label %match_a3_2 [ i8 0, label %match_a0_2 i8 1, label %match_a1_2 i8 2, label %match_a2_2 ]"),
+        "4-arm match should lower to a single switch with the wildcard as default"
+    );
+    assert!(
+        ir.contains("bitcast %Option* @.unit.3 to i8*"),
+        "unit variants should reference the shared @.unit constants"
+    );
+    for func in ir.split("\ndefine ").skip(1) {
+        // Every alloca sits in `entry:`, before the first other block label.
+        let mut seen_labels = 0;
+        for line in func.lines().skip(1) {
+            if line.ends_with(':') && !line.starts_with(' ') {
+                seen_labels += 1;
+            }
+            assert!(
+                seen_labels <= 1 || !line.contains(" = alloca "),
+                "alloca outside the entry block: {line}"
+            );
+        }
+    }
+
+    let stage2 = std::env::temp_dir().join("kooixc-stage2-from-stage1-ll-match-switch");
+    let _ = std::fs::remove_file(&stage2);
+    compile_llvm_ir_to_executable(&ir, &stage2).expect("native-llvm build should succeed");
+
+    let args: Vec<String> = vec![];
+    let stage2_out = run_executable_with_args_and_stdin(&stage2, &args, None)
+        .expect("stage2 match switch binary should run");
+    assert_eq!(stage2_out.status_code, Some(0));
+
+    let _ = std::fs::remove_file(&output);
+    let _ = std::fs::remove_file(&stage2);
+    let _ = std::fs::remove_file("/tmp/kooixc_stage2_match_switch.ll");
+}
+
 #[test]
 fn stage1_self_host_v0_10_emits_and_runs_stage2_list_smoke() {
     if !tool_exists("llc") || !tool_exists("clang") {
@@ -4162,6 +4705,61 @@ fn main() -> Int {
     let _ = std::fs::remove_file(&output);
 }
 
+#[test]
+fn native_profile_writes_folded_stacks() {
+    if !(cfg!(target_os = "linux")
+        && (cfg!(target_arch = "x86_64") || cfg!(target_arch = "aarch64")))
+    {
+        return;
+    }
+    if !tool_exists("llc") || !tool_exists("clang") {
+        return;
+    }
+
+    let source = r#"
+fn spin(n: Int) -> Int {
+  let i: Int = 0;
+  while i != n { i = i + 1; 0 };
+  i
+};
+
+fn main() -> Int {
+  if spin(200000000) == 200000000 { 0 } else { 1 }
+};
+"#;
+
+    let output = std::env::temp_dir().join("kooixc-native-profile-smoke");
+    let profile = std::env::temp_dir().join("kooixc-native-profile-smoke.folded");
+    let _ = std::fs::remove_file(&output);
+    let _ = std::fs::remove_file(&profile);
+
+    let run_output =
+        compile_and_run_native_source(source, &output).expect("compile+run should work");
+    assert_eq!(run_output.status_code, Some(0));
+
+    let status = std::process::Command::new(&output)
+        .env("KX_PROFILE", &profile)
+        .status()
+        .expect("run profiled binary");
+    assert!(status.success());
+
+    let folded = std::fs::read_to_string(&profile).expect("profile should be written");
+    let mut total = 0u64;
+    for line in folded.lines() {
+        let (stack, count) = line.rsplit_once(' ').expect("folded line has a count");
+        assert!(stack.starts_with("main;kx_program_main"), "{line}");
+        total += count.parse::<u64>().expect("numeric count");
+    }
+    assert!(total > 0, "no samples recorded");
+    assert!(
+        folded.contains("main;kx_program_main;spin "),
+        "spin should be a sampled leaf:\n{folded}"
+    );
+
+    let _ = std::fs::remove_file(&output);
+    let _ = std::fs::remove_file(&profile);
+}
+
 #[test]
 fn native_host_read_file_works() {
     if cfg!(windows) {
@@ -4205,7 +4803,7 @@ fn main() -> Int {{
 }
 
 #[test]
-fn native_host_link_llvm_ir_file_works() {
+fn native_host_read_file_searches_kooix_path() {
     if cfg!(windows) {
         return;
     }
@@ -4213,34 +4811,177 @@ fn native_host_link_llvm_ir_file_works() {
         return;
     }
 
-    let ir = emit_llvm_ir_source("fn main() -> Int { 7 };").expect("emit llvm ir should work");
-    let ir_path = std::env::temp_dir().join("kooixc-host-link-in.ll");
-    let out_exe = std::env::temp_dir().join("kooixc-host-link-out");
-    let _ = std::fs::remove_file(&ir_path);
-    let _ = std::fs::remove_file(&out_exe);
-    std::fs::write(&ir_path, ir.as_bytes()).expect("write input llvm ir");
+    let root = std::env::temp_dir().join(format!("kooixc-kooix-path-{}", std::process::id()));
+    let _ = std::fs::remove_dir_all(&root);
+    std::fs::create_dir_all(root.join("vendor/kxdata")).expect("create vendor dir");
+    std::fs::write(root.join("vendor/kxdata/greeting.kooix"), b"hello").expect("write module");
 
-    let source = format!(
-        r#"
-enum Result<T, E> {{ Ok(T); Err(E); }};
+    let source = r#"
+enum Result<T, E> { Ok(T); Err(E); };
 
-fn host_link_llvm_ir_file(ir_path: Text, out_path: Text) -> Result<Int, Text>;
+fn host_read_file(path: Text) -> Result<Text, Text>;
+fn host_argv(index: Int) -> Text;
 fn host_eprintln(s: Text) -> Unit;
 
-fn main() -> Int {{
-  let r: Result<Int, Text> = host_link_llvm_ir_file("{ir_path}", "{out_exe}");
-  match r {{
-    Ok(_n) => 0;
-    Err(m) => {{ host_eprintln(m); 3 }};
-  }}
-}};
-"#,
-        ir_path = ir_path.to_string_lossy(),
-        out_exe = out_exe.to_string_lossy()
-    );
-
-    let output = std::env::temp_dir().join("kooixc-native-host-link-smoke");
-    let _ = std::fs::remove_file(&output);
+fn main() -> Int {
+  let r: Result<Text, Text> = host_read_file(host_argv(1));
+  match r {
+    Ok(s) => { if s == "hello" { 0 } else { 2 } };
+    Err(m) => { host_eprintln(m); 3 };
+  }
+};
+"#;
+
+    let output = root.join("reader");
+    compile_and_run_native_source_with_args(source, &output, &["kxdata/greeting".to_string()])
+        .expect("compile should work");
+
+    let run = |kooix_path: Option<String>| {
+        let mut command = std::process::Command::new(&output);
+        command.arg("kxdata/greeting").current_dir(&root);
+        match kooix_path {
+            Some(value) => command.env("KOOIX_PATH", value),
+            None => command.env_remove("KOOIX_PATH"),
+        };
+        command.status().expect("run reader").code()
+    };
+    assert_eq!(run(None), Some(3));
+    assert_eq!(
+        run(Some(format!(
+            "/nonexistent-kooix-root:{}",
+            root.join("vendor").display()
+        ))),
+        Some(0)
+    );
+
+    let _ = std::fs::remove_dir_all(&root);
+}
+
+#[test]
+fn native_host_load_source_map_keys_imports_on_resolved_location() {
+    if cfg!(windows) {
+        return;
+    }
+    if !tool_exists("llc") || !tool_exists("clang") {
+        return;
+    }
+
+    let root = std::env::temp_dir().join(format!("kooixc-kooix-path-sm-{}", std::process::id()));
+    let _ = std::fs::remove_dir_all(&root);
+    std::fs::create_dir_all(root.join("vendor/kxlib/pkg")).expect("create vendor dir");
+    std::fs::create_dir_all(root.join("app/sub")).expect("create app dir");
+    // `a` reaches its sibling `b` importer-relative, so its base must be where it was found.
+    std::fs::write(
+        root.join("vendor/kxlib/pkg/a.kooix"),
+        b"import \"b\";\nfn a() -> Int { b() };\n",
+    )
+    .expect("write a");
+    std::fs::write(
+        root.join("vendor/kxlib/pkg/b.kooix"),
+        b"fn b() -> Int { 1 };\n",
+    )
+    .expect("write b");
+    // Imported from two directories; both resolve to the same vendor file.
+    std::fs::write(
+        root.join("app/main.kooix"),
+        b"import \"kxlib/pkg/a\";\nimport \"sub/c\";\nfn main() -> Int { a() };\n",
+    )
+    .expect("write main");
+    std::fs::write(
+        root.join("app/sub/c.kooix"),
+        b"import \"kxlib/pkg/a\";\nfn c() -> Int { a() };\n",
+    )
+    .expect("write c");
+
+    let source = r#"
+enum Result<T, E> { Ok(T); Err(E); };
+
+fn host_load_source_map(entry_path: Text) -> Result<Text, Text>;
+fn host_write_file(path: Text, content: Text) -> Result<Int, Text>;
+fn host_argv(index: Int) -> Text;
+fn host_eprintln(s: Text) -> Unit;
+
+fn main() -> Int {
+  match host_load_source_map(host_argv(1)) {
+    Ok(src) => {
+      match host_write_file(host_argv(2), src) {
+        Ok(_n) => 0;
+        Err(m) => { host_eprintln(m); 3 };
+      }
+    };
+    Err(m) => { host_eprintln(m); 2 };
+  }
+};
+"#;
+
+    let output = root.join("loader");
+    let combined_path = root.join("combined.kooix");
+    let args = [
+        root.join("app/main.kooix").display().to_string(),
+        combined_path.display().to_string(),
+    ];
+    compile_and_run_native_source_with_args(source, &output, &[]).expect("compile should work");
+
+    let status = std::process::Command::new(&output)
+        .args(&args)
+        .env("KOOIX_PATH", root.join("vendor"))
+        .status()
+        .expect("run loader");
+    assert_eq!(status.code(), Some(0));
+
+    let combined = std::fs::read_to_string(&combined_path).expect("combined source written");
+    let vendor = root.join("vendor/");
+    let marker = |rel: &str| format!("// --- file: {}{rel} ---", vendor.display());
+    assert_eq!(
+        combined.matches(&marker("kxlib/pkg/a.kooix")).count(),
+        1,
+        "{combined}"
+    );
+    assert!(
+        combined.contains(&marker("kxlib/pkg/b.kooix")),
+        "{combined}"
+    );
+
+    let _ = std::fs::remove_dir_all(&root);
+}
+
+#[test]
+fn native_host_link_llvm_ir_file_works() {
+    if cfg!(windows) {
+        return;
+    }
+    if !tool_exists("llc") || !tool_exists("clang") {
+        return;
+    }
+
+    let ir = emit_llvm_ir_source("fn main() -> Int { 7 };").expect("emit llvm ir should work");
+    let ir_path = std::env::temp_dir().join("kooixc-host-link-in.ll");
+    let out_exe = std::env::temp_dir().join("kooixc-host-link-out");
+    let _ = std::fs::remove_file(&ir_path);
+    let _ = std::fs::remove_file(&out_exe);
+    std::fs::write(&ir_path, ir.as_bytes()).expect("write input llvm ir");
+
+    let source = format!(
+        r#"
+enum Result<T, E> {{ Ok(T); Err(E); }};
+
+fn host_link_llvm_ir_file(ir_path: Text, out_path: Text) -> Result<Int, Text>;
+fn host_eprintln(s: Text) -> Unit;
+
+fn main() -> Int {{
+  let r: Result<Int, Text> = host_link_llvm_ir_file("{ir_path}", "{out_exe}");
+  match r {{
+    Ok(_n) => 0;
+    Err(m) => {{ host_eprintln(m); 3 }};
+  }}
+}};
+"#,
+        ir_path = ir_path.to_string_lossy(),
+        out_exe = out_exe.to_string_lossy()
+    );
+
+    let output = std::env::temp_dir().join("kooixc-native-host-link-smoke");
+    let _ = std::fs::remove_file(&output);
     let run_output = compile_and_run_native_source_with_args_stdin_and_timeout(
         &source,
         &output,
@@ -4490,3 +5231,1069 @@ fn fnv1a64(bytes: &[u8]) -> u64 {
     }
     hash
 }
+
+#[test]
+fn compiles_agent_state_rules_to_dense_transition_table() {
+    let source = r#"
+agent a() -> Unit
+state {
+  INIT -> CLASSIFIED;
+  CLASSIFIED -> RESOLVED, INIT;
+  any -> ESCALATED;
+}
+policy { allow_tools ["kb"]; deny_tools ["payment"]; max_iterations = 8; }
+loop { perceive -> act; stop when state == RESOLVED; }
+;
+"#;
+
+    let program = compile_agents_source(source).expect("agent should compile");
+    assert_eq!(program.agents.len(), 1);
+    let machine = &program.agents[0];
+    assert_eq!(machine.state_name(machine.initial), "INIT");
+    assert_eq!(machine.stop_state, machine.state_id("RESOLVED"));
+    assert_eq!(machine.max_iterations, Some(8));
+
+    let id = |name: &str| machine.state_id(name).expect("state should be interned");
+    assert!(machine.can_transition(id("INIT"), id("CLASSIFIED")));
+    assert!(machine.can_transition(id("CLASSIFIED"), id("INIT")));
+    assert!(!machine.can_transition(id("INIT"), id("RESOLVED")));
+    // `any -> ESCALATED` expands into every row, including ESCALATED itself.
+    for state in 0..machine.state_count() as u32 {
+        assert!(machine.can_transition(state, id("ESCALATED")));
+    }
+    assert_eq!(
+        machine.successors(id("INIT")).collect::<Vec<_>>(),
+        vec![id("CLASSIFIED"), id("ESCALATED")]
+    );
+}
+
+#[test]
+fn runs_agent_loop_until_stop_state() {
+    let source = r#"
+agent a() -> Unit
+state { INIT -> WORKING; WORKING -> WORKING, DONE; }
+policy { allow_tools ["kb"]; deny_tools ["payment"]; }
+loop { perceive -> act; stop when state == DONE; }
+;
+"#;
+
+    let program = compile_agents_source(source).expect("agent should compile");
+    let machine = &program.agents[0];
+    let working = machine.state_id("WORKING").unwrap();
+    let done = machine.state_id("DONE").unwrap();
+
+    let run = machine.run(|state, iteration| {
+        if state == working && iteration >= 3 {
+            Some(done)
+        } else {
+            Some(working)
+        }
+    });
+    assert_eq!(run.outcome, AgentOutcome::Stopped);
+    assert_eq!(run.final_state, done);
+    assert_eq!(run.iterations, 4);
+}
+
+#[test]
+fn agent_loop_enforces_iteration_guard_and_transition_table() {
+    let source = r#"
+agent a() -> Unit
+state { INIT -> RUNNING; RUNNING -> RUNNING; }
+policy { allow_tools ["kb"]; deny_tools ["payment"]; max_iterations = 5; }
+loop { perceive -> act; stop when state == DONE; }
+;
+"#;
+
+    let program = compile_agents_source(source).expect("agent should compile");
+    let machine = &program.agents[0];
+    assert_eq!(machine.stop_state, None);
+    let running = machine.state_id("RUNNING").unwrap();
+    let init = machine.initial;
+
+    let run = machine.run(|_, _| Some(running));
+    assert_eq!(run.outcome, AgentOutcome::IterationLimit);
+    assert_eq!(run.iterations, 5);
+
+    let run = machine.run(|_, iteration| {
+        if iteration == 0 {
+            Some(running)
+        } else {
+            Some(init)
+        }
+    });
+    assert_eq!(
+        run.outcome,
+        AgentOutcome::InvalidTransition {
+            from: running,
+            to: init
+        }
+    );
+    assert_eq!(run.final_state, running);
+}
+
+#[test]
+fn compiles_agent_tool_policy_to_bitset_with_deny_precedence() {
+    let source = r#"
+agent a() -> Unit
+state { INIT -> DONE; }
+policy { allow_tools ["kb", "search", "payment"]; deny_tools ["payment", "shell"]; }
+loop { perceive -> act; stop when state == DONE; }
+;
+
+agent b() -> Unit
+state { INIT -> DONE; }
+policy { allow_tools ["shell"]; deny_tools ["kb"]; }
+loop { perceive -> act; stop when state == DONE; }
+;
+"#;
+
+    // sema rejects allow/deny overlap; compile straight from HIR to exercise deny precedence.
+    let hir = lower_source(source).expect("agents should lower");
+    let program = compile_agents(&hir).expect("agents should compile");
+    let tool = |name: &str| program.tools.id(name).expect("tool should be interned");
+    assert_eq!(program.tools.len(), 4);
+
+    let a = &program.agents[0];
+    assert!(a.permits_tool(tool("kb")));
+    assert!(a.permits_tool(tool("search")));
+    assert!(!a.permits_tool(tool("payment")));
+    assert!(!a.permits_tool(tool("shell")));
+
+    // Tool ids are shared across agents; anything outside allow_tools is denied.
+    let b = &program.agents[1];
+    assert!(b.permits_tool(tool("shell")));
+    assert!(!b.permits_tool(tool("kb")));
+    assert!(!b.permits_tool(tool("search")));
+    assert!(!b.permits_tool(1000));
+}
+
+#[test]
+fn samples_function_ensures_at_runtime_and_reports_violations() {
+    let source = r#"
+record Box { value: Int; };
+
+fn wrap(x: Int) -> Box ensures [output.value == x, output.value != 3] {
+  Box { value: x; }
+};
+
+fn main() -> Int {
+  let a: Box = wrap(1);
+  let b: Box = wrap(2);
+  let c: Box = wrap(3);
+  let d: Box = wrap(4);
+  a.value + b.value + c.value + d.value
+};
+"#;
+
+    let result =
+        run_source_with_ensures(source, EnsuresSampling::every(1)).expect("run should succeed");
+    assert_eq!(result.value, Value::Int(10));
+    assert_eq!(result.ensures.samples, 4);
+    assert_eq!(result.ensures.clauses.len(), 2);
+    assert_eq!(result.ensures.clauses[0].clause, "output.value == x");
+    assert_eq!(result.ensures.clauses[0].checked, 4);
+    assert_eq!(result.ensures.clauses[0].violations, 0);
+    assert_eq!(result.ensures.clauses[1].violations, 1);
+    assert!(result.diagnostics.iter().any(|diagnostic| {
+        diagnostic.severity == Severity::Warning
+            && diagnostic.message.contains(
+                "function 'wrap' ensures 'output.value != 3' violated in 1 of 4 sampled checks",
+            )
+    }));
+
+    let result =
+        run_source_with_ensures(source, EnsuresSampling::every(2)).expect("run should succeed");
+    assert_eq!(result.ensures.samples, 2);
+    assert_eq!(result.ensures.clauses[1].checked, 2);
+
+    let result =
+        run_source_with_ensures(source, EnsuresSampling::disabled()).expect("run should succeed");
+    assert_eq!(result.ensures.samples, 0);
+    assert!(result.diagnostics.is_empty());
+}
+
+#[test]
+fn parses_ensures_sampling_rates() {
+    assert_eq!(
+        EnsuresSampling::parse("1/1000"),
+        Ok(EnsuresSampling::every(1000))
+    );
+    assert_eq!(
+        EnsuresSampling::parse("4/16"),
+        Ok(EnsuresSampling::every(4))
+    );
+    assert_eq!(EnsuresSampling::parse("1"), Ok(EnsuresSampling::every(1)));
+    assert_eq!(
+        EnsuresSampling::parse("off"),
+        Ok(EnsuresSampling::disabled())
+    );
+    assert_eq!(
+        EnsuresSampling::parse("0/10"),
+        Ok(EnsuresSampling::disabled())
+    );
+    assert!(EnsuresSampling::parse("1/x").is_err());
+}
+
+#[test]
+fn analyzes_workflow_critical_path_parallelism_and_budget() {
+    let source = r#"
+cap Net<"api.openai.com">;
+cap Model<"openai", "gpt-4o-mini", 1000>;
+cap Tool<"web_search", "read-only">;
+
+fn summarize(doc: Text) -> Text !{model(openai), net} requires [Model<"openai", "gpt-4o-mini", 1000>, Net<"api.openai.com">];
+fn search(query: Text) -> Text !{tool(web_search), net} requires [Tool<"web_search", "read-only">, Net<"api.openai.com">];
+fn merge(a: Text, b: Text) -> Text;
+
+workflow answer(doc: Text, query: Text) -> Text
+steps {
+  s1: summarize(doc) on_fail -> retry(exp_backoff, max=2);
+  s2: search(query);
+  s3: merge(s1, s2.text);
+}
+;
+"#;
+
+    let reports = analyze_latency_source(source).expect("latency analysis should succeed");
+    assert_eq!(reports.len(), 1);
+    let report = &reports[0];
+    assert_eq!(report.steps[0].attempts, 3);
+    assert_eq!(report.steps[0].finish_ms, 3 * (800 + 120));
+    assert_eq!(report.steps[1].finish_ms, 60 + 120);
+    assert_eq!(report.steps[2].depends_on, vec!["s1", "s2"]);
+    assert_eq!(report.critical_path, vec!["s1", "s3"]);
+    assert_eq!(report.critical_path_ms, 3 * 920 + 1);
+    assert_eq!(report.max_parallelism, 2);
+    assert_eq!(report.worst_case_budget, 3000);
+
+    let warnings = kooixc::latency::check_latency_budget(&reports, 1000);
+    assert!(warnings.iter().any(|diagnostic| {
+        diagnostic.severity == Severity::Warning
+            && diagnostic
+                .message
+                .contains("workflow 'answer' critical path takes 2761ms (> 1000ms): s1 -> s3")
+    }));
+    assert!(kooixc::latency::check_latency_budget(&reports, 5000).is_empty());
+}
+
+#[test]
+fn loadtests_workflow_and_agent_against_capability_stand_ins() {
+    let source = r#"
+cap Net<"api.openai.com">;
+cap Model<"openai", "gpt-4o-mini", 1000>;
+cap Tool<"web_search", "read-only">;
+
+fn summarize(doc: Text) -> Text !{model(openai), net} requires [Model<"openai", "gpt-4o-mini", 1000>, Net<"api.openai.com">];
+fn search(query: Text) -> Text !{tool(web_search), net} requires [Tool<"web_search", "read-only">, Net<"api.openai.com">];
+fn merge(a: Text, b: Text) -> Text;
+
+workflow answer(doc: Text, query: Text) -> Text
+steps {
+  s1: summarize(doc) on_fail -> retry(exp_backoff, max=2);
+  s2: search(query) on_fail -> fallback("cached");
+  s3: merge(s1, s2);
+}
+;
+
+agent support_agent(input: Text) -> Text
+state {
+  INIT -> CLASSIFIED;
+  CLASSIFIED -> DONE, ESCALATED;
+}
+policy {
+  allow_tools ["web_search"];
+  max_iterations = 4;
+}
+requires [Tool<"web_search", "read-only">]
+loop { perceive -> act; stop when state == DONE; }
+;
+"#;
+
+    let mut options = kooixc::loadtest::LoadTestOptions::new("answer");
+    options.requests = 40;
+    options.concurrency = 4;
+    options.runtime.time_scale = 0.0;
+    options.runtime.failure_rate = 0.4;
+    options.runtime.seed = 7;
+    let report = loadtest_source(source, &options).expect("loadtest should run");
+    assert_eq!(report.requests, 40);
+    assert_eq!(report.succeeded + report.failed, 40);
+    assert!(report.failure_policies.get("retry").copied().unwrap_or(0) > 0);
+    assert!(
+        report
+            .failure_policies
+            .get("fallback")
+            .copied()
+            .unwrap_or(0)
+            > 0
+    );
+    let model = report
+        .capabilities
+        .iter()
+        .find(|capability| capability.capability.starts_with("Model"))
+        .expect("model stand-in should be reported");
+    assert!(model.calls >= 40);
+    assert!(model.failures > 0);
+    assert!(report.latency.p50_ms <= report.latency.p95_ms);
+    assert!(report.latency.p95_ms <= report.latency.p99_ms);
+    let json = report.to_json();
+    assert!(json.contains("\"target\":\"answer\""));
+    assert!(json.contains("\"latency_ms\":{\"p50\":"));
+    assert!(json.contains("\"failure_policies\":{"));
+
+    // Same seed, same failure draws.
+    let again = loadtest_source(source, &options).expect("loadtest should run");
+    assert_eq!(again.failed, report.failed);
+    assert_eq!(again.failure_policies, report.failure_policies);
+
+    // Every s1 attempt fails: two retries per instance, then the exhausted retry is no retry.
+    let mut failing = options.clone();
+    failing.requests = 5;
+    failing.runtime.failure_rate = 1.0;
+    let report = loadtest_source(source, &failing).expect("loadtest should run");
+    assert_eq!(report.failed, 5);
+    assert_eq!(report.failure_policies.get("retry"), Some(&10));
+    assert_eq!(report.failure_policies.get("retry_exhausted"), Some(&5));
+
+    let mut options = kooixc::loadtest::LoadTestOptions::new("answer");
+    options.requests = 8;
+    options.concurrency = 4;
+    options.rate_start = 2000.0;
+    options.rate_end = 4000.0;
+    options.runtime.time_scale = 0.005;
+    options.runtime.capability_limit = 1;
+    let report = loadtest_source(source, &options).expect("loadtest should run");
+    assert_eq!(report.failed, 0);
+    assert!(report
+        .capabilities
+        .iter()
+        .any(|capability| capability.queue_max_ms > 0.0));
+
+    let mut options = kooixc::loadtest::LoadTestOptions::new("support_agent");
+    options.requests = 10;
+    options.runtime.time_scale = 0.0;
+    let report = loadtest_source(source, &options).expect("agent loadtest should run");
+    assert_eq!(report.succeeded, 10);
+    let tool = report
+        .capabilities
+        .iter()
+        .find(|capability| capability.capability.starts_with("Tool"))
+        .expect("tool stand-in should be reported");
+    assert!(tool.calls >= 10);
+
+    // Without max_iterations and with an unreachable stop state the runtime's default cap ends
+    // the loop and fails the instance instead of spinning forever.
+    let unbounded = r#"
+cap Tool<"web_search", "read-only">;
+
+agent looping_agent(input: Text) -> Text
+state {
+  INIT -> WORKING;
+  WORKING -> INIT;
+}
+policy {
+  allow_tools ["web_search"];
+}
+requires [Tool<"web_search", "read-only">]
+loop { perceive -> act; stop when state == DONE; }
+;
+"#;
+    let mut options = kooixc::loadtest::LoadTestOptions::new("looping_agent");
+    options.requests = 2;
+    options.runtime.time_scale = 0.0;
+    let report = loadtest_source(unbounded, &options).expect("agent loadtest should run");
+    assert_eq!(report.failed, 2);
+    assert!(report.errors[0].contains(&format!(
+        "did not stop within {} iterations",
+        kooixc::workflow_runtime::DEFAULT_AGENT_ITERATIONS
+    )));
+
+    let options = kooixc::loadtest::LoadTestOptions::new("missing");
+    let errors = loadtest_source(source, &options).expect_err("unknown target should fail");
+    assert!(errors[0]
+        .message
+        .contains("loadtest target 'missing' is not a workflow or agent"));
+}
+
+#[test]
+fn run_engine_auto_tiers_hot_scalar_functions() {
+    if !cfg!(unix) || !tool_exists("llc") || !tool_exists("clang") {
+        return;
+    }
+
+    let source = r#"
+fn step(x: Int, flag: Bool) -> Int { if flag { x + 1 } else { x } };
+
+fn is_target(x: Int) -> Bool { x == 300 };
+
+fn count(n: Int) -> Int {
+  let i: Int = 0;
+  while i != n { i = step(i, true); 0 };
+  i
+};
+
+fn label(x: Int) -> Text { if is_target(x) { "hit" } else { "miss" } };
+
+fn main() -> Int {
+  let total: Int = 0;
+  let j: Int = 0;
+  while is_target(j) == false { total = total + count(10); j = j + 1; 0 };
+  if label(j) == "hit" { total } else { 0 }
+};
+"#;
+
+    let interpreted = run_source(source).expect("interpreted run should work");
+    assert_eq!(interpreted.value, Value::Int(3000));
+    assert_eq!(interpreted.tier, None);
+
+    let options = TierOptions {
+        threshold: 5,
+        synchronous: true,
+    };
+    let tiered = run_source_tiered(source, options).expect("tiered run should work");
+    assert_eq!(tiered.value, interpreted.value);
+    let report = tiered.tier.expect("tier report");
+    assert!(report.failures.is_empty(), "{:?}", report.failures);
+    for name in ["step", "count", "is_target"] {
+        assert!(
+            report.compiled.iter().any(|compiled| compiled == name),
+            "{report:?}"
+        );
+    }
+    // `label` returns Text and `main` reaches it, so both stay interpreted.
+    assert!(!report
+        .compiled
+        .iter()
+        .any(|name| name == "label" || name == "main"));
+    assert!(report.native_calls > 250, "{report:?}");
+}
+
+#[test]
+fn run_engine_auto_keeps_interpreter_overflow_and_depth_errors() {
+    if !cfg!(unix) || !tool_exists("llc") || !tool_exists("clang") {
+        return;
+    }
+
+    let options = TierOptions {
+        threshold: 5,
+        synchronous: true,
+    };
+    let overflow = r#"
+fn bump(x: Int, by: Int) -> Int { x + by };
+
+fn main() -> Int {
+  let i: Int = 0;
+  while i != 20 { i = bump(i, 1); 0 };
+  bump(9223372036854775807, i)
+};
+"#;
+    let deep = r#"
+fn climb(i: Int, n: Int) -> Int { if i == n { 0 } else { climb(i + 1, n) + 1 } };
+
+fn main() -> Int {
+  let j: Int = 0;
+  while j != 10 { j = j + 1; climb(0, 50); 0 };
+  climb(0, 2000)
+};
+"#;
+    for (source, needle) in [
+        (overflow, "integer overflow"),
+        (deep, "call stack overflow"),
+    ] {
+        let interpreted = run_source(source).expect_err("interpreter should fail");
+        let tiered = run_source_tiered(source, options).expect_err("tiered run should fail");
+        assert!(interpreted[0].message.contains(needle), "{interpreted:?}");
+        assert_eq!(tiered[0].message, interpreted[0].message);
+    }
+
+    // Within the limits the guarded module still answers natively.
+    let source = deep.replace("climb(0, 2000)", "climb(0, 1000)");
+    let tiered = run_source_tiered(&source, options).expect("tiered run should work");
+    assert_eq!(tiered.value, Value::Int(1000));
+    let report = tiered.tier.expect("tier report");
+    assert!(
+        report.compiled.iter().any(|name| name == "climb"),
+        "{report:?}"
+    );
+    assert_eq!(report.bailouts, 0, "{report:?}");
+}
+
+#[test]
+fn parses_and_checks_streamed_workflow_steps() {
+    let source = r#"
+fn draft(q: Text) -> Text;
+fn speak(t: Text) -> Text;
+fn score(q: Text) -> Int;
+
+workflow answer(q: Text) -> Text
+steps {
+  s1: draft(q) stream(buffer=2);
+  s2: speak(s1);
+}
+;
+"#;
+    let hir = lower_source(source).expect("streamed workflow should lower");
+    let step = &hir.workflows[0].steps[0];
+    assert_eq!(step.stream.as_ref().and_then(|spec| spec.buffer), Some(2));
+    assert!(hir.workflows[0].steps[1].stream.is_none());
+    assert!(check_source(source).is_empty());
+
+    let errors = parse_source(
+        "fn draft(q: Text) -> Text;\nworkflow w(q: Text) -> Text steps { s1: draft(q) stream(size=2); };",
+    )
+    .expect_err("unknown stream option should fail");
+    assert!(errors[0]
+        .message
+        .contains("unknown stream option 'size', expected 'buffer'"));
+
+    let diagnostics = check_source(
+        "fn score(q: Text) -> Int;\nworkflow w(q: Text) -> Int steps { s1: score(q) stream; };",
+    );
+    assert!(diagnostics
+        .iter()
+        .any(|diagnostic| diagnostic.message.contains(
+            "workflow 'w' step 's1' streams output of type 'Int', only Text can be streamed"
+        )));
+}
+
+#[test]
+fn loadtest_streams_step_output_into_consumers_with_backpressure() {
+    let source = r#"
+cap Net<"api.openai.com">;
+cap Model<"openai", "gpt-4o-mini", 1000>;
+cap Tool<"web_search", "read-only">;
+
+fn draft(q: Text) -> Text !{model(openai), net} requires [Model<"openai", "gpt-4o-mini", 1000>, Net<"api.openai.com">];
+fn speak(t: Text) -> Text !{model(openai)} requires [Model<"openai", "gpt-4o-mini", 1000>];
+fn search(q: Text) -> Text !{tool(web_search)} requires [Tool<"web_search", "read-only">];
+fn lookup(q: Text) -> Text !{net} requires [Net<"api.openai.com">];
+fn merge(a: Text, b: Text) -> Text;
+
+workflow batch(q: Text) -> Text
+steps {
+  s1: draft(q);
+  s2: speak(s1);
+}
+;
+
+workflow live(q: Text) -> Text
+steps {
+  s1: draft(q) stream;
+  s2: speak(s1);
+}
+;
+
+workflow flood(q: Text) -> Text
+steps {
+  s1: search(q) stream(buffer=1);
+  s2: speak(s1);
+}
+;
+
+workflow fan_in(q: Text) -> Text
+steps {
+  s1: draft(q) stream(buffer=1);
+  s2: lookup(q);
+  s3: merge(s1, s2);
+}
+;
+
+workflow flaky(q: Text) -> Text
+steps {
+  s1: draft(q) stream(buffer=1) on_fail -> retry(exp_backoff, max=3);
+  s2: speak(s1);
+}
+;
+"#;
+
+    let run = |target: &str, time_scale: f64, failure_rate: f64| {
+        let mut options = kooixc::loadtest::LoadTestOptions::new(target);
+        options.requests = 2;
+        options.concurrency = 1;
+        options.runtime.time_scale = time_scale;
+        options.runtime.failure_rate = failure_rate;
+        options.runtime.seed = 3;
+        loadtest_source(source, &options).expect("loadtest should run")
+    };
+
+    // 920ms producer then 800ms consumer, scaled: the streamed consumer overlaps the producer.
+    let batch = run("batch", 0.05, 0.0);
+    let live = run("live", 0.05, 0.0);
+    assert_eq!(batch.failed + live.failed, 0);
+    assert_eq!(batch.streams.chunks, 0);
+    assert_eq!(live.streams.chunks, 16);
+    assert!(
+        live.latency.p50_ms < batch.latency.p50_ms * 0.8,
+        "streaming should overlap: live {:.1}ms vs batch {:.1}ms",
+        live.latency.p50_ms,
+        batch.latency.p50_ms
+    );
+    assert!(live.to_json().contains("\"streams\":{\"chunks\":16,"));
+
+    // A fast producer into a one-chunk buffer waits on the slow consumer.
+    let flood = run("flood", 0.05, 0.0);
+    assert_eq!(flood.failed, 0);
+    assert!(flood.streams.stalled_sends > 0);
+
+    // Producers blocked on a full buffer hold no capability slot, so the consumer's other
+    // input (queued on the same single Net slot) still gets through.
+    let mut options = kooixc::loadtest::LoadTestOptions::new("fan_in");
+    options.requests = 8;
+    options.concurrency = 4;
+    options.runtime.time_scale = 0.01;
+    options.runtime.capability_limit = 1;
+    let fan_in = loadtest_source(source, &options).expect("loadtest should run");
+    assert_eq!(fan_in.succeeded, 8);
+
+    // Retried producers restart the stream; consumers still see the final value.
+    let flaky = run("flaky", 0.0, 0.5);
+    assert!(flaky.streams.restarts > 0);
+    assert_eq!(flaky.succeeded + flaky.failed, 2);
+}
+
+#[test]
+fn loadtest_journal_replays_completed_steps_on_retry_and_restart() {
+    let source = r#"
+cap Model<"openai", "gpt-4o-mini", 1000>;
+cap Tool<"web_search", "read-only">;
+
+fn summarize(q: Text) -> Text !{model(openai)} requires [Model<"openai", "gpt-4o-mini", 1000>];
+fn search(t: Text) -> Text !{tool(web_search)} requires [Tool<"web_search", "read-only">];
+
+workflow inner(q: Text) -> Text
+steps {
+  s1: summarize(q);
+  s2: search(s1);
+}
+;
+
+workflow outer(q: Text) -> Text
+steps {
+  s1: inner(q) on_fail -> retry(exp_backoff, max=3);
+}
+;
+"#;
+    let journal_path = std::env::temp_dir().join(format!(
+        "kooixc-workflow-journal-{}.kxj",
+        std::process::id()
+    ));
+    let _ = std::fs::remove_file(&journal_path);
+    let run = |journal: Option<&std::path::Path>| {
+        let mut options = kooixc::loadtest::LoadTestOptions::new("outer");
+        options.requests = 40;
+        options.concurrency = 4;
+        options.runtime.time_scale = 0.0;
+        options.runtime.failure_rate = 0.3;
+        options.runtime.seed = 11;
+        options.journal = journal.map(|path| path.to_path_buf());
+        loadtest_source(source, &options).expect("loadtest should run")
+    };
+    let model_successes = |report: &kooixc::loadtest::LoadTestReport| {
+        let model = report
+            .capabilities
+            .iter()
+            .find(|capability| capability.capability.starts_with("Model"))
+            .expect("model stand-in should be reported");
+        model.calls - model.failures
+    };
+
+    // Without a journal a retried `inner` re-summarizes even when only `search` failed.
+    let plain = run(None);
+    assert!(plain.journal.is_none());
+    assert!(model_successes(&plain) > 40);
+
+    // With it, each instance summarizes successfully at most once.
+    let first = run(Some(&journal_path));
+    let stats = first.journal.expect("journal stats");
+    assert!(model_successes(&first) <= 40);
+    assert!(stats.replayed > 0);
+    assert_eq!(stats.recovered, 0);
+    assert!(first.to_json().contains("\"journal\":{\"recovered\":0,"));
+
+    // A restart replays every completed instance and only runs what was left.
+    let second = run(Some(&journal_path));
+    let restarted = second.journal.expect("journal stats");
+    assert_eq!(restarted.recovered, stats.recorded);
+    assert_eq!(restarted.discarded_bytes, 0);
+    assert!(model_successes(&second) <= first.failed);
+    assert!(second.failed <= first.failed);
+
+    // A corrupted tail record is dropped at open instead of being replayed.
+    let mut bytes = std::fs::read(&journal_path).expect("journal should exist");
+    let committed = u64::from_le_bytes(bytes[8..16].try_into().unwrap()) as usize;
+    bytes[committed - 1] ^= 0xff;
+    std::fs::write(&journal_path, &bytes).expect("journal should be writable");
+    let journal = kooixc::journal::Journal::open(&journal_path).expect("journal should open");
+    let stats = journal.stats();
+    assert_eq!(
+        stats.recovered,
+        restarted.recovered + restarted.recorded - 1
+    );
+    assert!(stats.discarded_bytes > 0);
+    drop(journal);
+
+    // A foreign file, even one shorter than the magic, is rejected without being resized.
+    for foreign in [&b"not a journal, just some text"[..], b"KXJ"] {
+        std::fs::write(&journal_path, foreign).unwrap();
+        assert!(kooixc::journal::Journal::open(&journal_path)
+            .err()
+            .expect("foreign file should be rejected")
+            .contains("is not a kooix workflow journal"));
+        assert_eq!(std::fs::read(&journal_path).unwrap(), foreign);
+    }
+    let _ = std::fs::remove_file(&journal_path);
+}
+
+#[test]
+fn loadtest_schedules_tenants_by_priority_class_and_admission() {
+    let source = r#"
+cap Model<"openai", "gpt-4o-mini", 1000>;
+cap Tool<"web_search", "read-only">;
+
+fn summarize(q: Text) -> Text !{model(openai)} requires [Model<"openai", "gpt-4o-mini", 1000>];
+fn search(q: Text) -> Text !{tool(web_search)} requires [Tool<"web_search", "read-only">];
+
+workflow answer(q: Text) -> Text
+priority interactive
+steps {
+  s1: search(q);
+}
+evidence {
+  trace "workflow.answer.v1";
+  metrics [admitted, rejected, queue_wait_p95_ms, tokens_used];
+}
+;
+
+workflow report(q: Text) -> Text
+priority batch
+steps {
+  s1: summarize(q);
+}
+;
+
+workflow digest(q: Text) -> Text
+priority batch
+steps {
+  s1: summarize(q);
+}
+;
+"#;
+    let hir = lower_source(source).expect("prioritized workflows should lower");
+    assert_eq!(
+        hir.workflows[0].priority,
+        Some(kooixc::ast::PriorityClass::Interactive)
+    );
+    let errors = parse_source("workflow w() -> Unit priority urgent steps { s1: noop(); };")
+        .expect_err("unknown priority class should fail");
+    assert!(errors[0].message.contains(
+        "unknown priority class 'urgent', expected 'interactive', 'standard' or 'batch'"
+    ));
+
+    let tenant = |spec: &str| kooixc::loadtest::TenantSpec::parse(spec).expect("tenant spec");
+    let options = |tenants: Vec<kooixc::loadtest::TenantSpec>| {
+        let mut options = kooixc::loadtest::LoadTestOptions::new("");
+        options.tenants = tenants;
+        options.requests = 40;
+        options.concurrency = 2;
+        options.runtime.time_scale = 0.005;
+        options
+    };
+
+    // Tenants split the arrivals by share and report their workflow's class and evidence.
+    let report = loadtest_source(
+        source,
+        &options(vec![tenant("nightly:report:1:4"), tenant("ui:answer:1:1")]),
+    )
+    .expect("loadtest should run");
+    let nightly = &report.tenants[0];
+    let ui = &report.tenants[1];
+    assert_eq!((nightly.requests, ui.requests), (32, 8));
+    assert_eq!(ui.class, kooixc::ast::PriorityClass::Interactive);
+    assert_eq!(report.succeeded, 40);
+    assert_eq!(report.target, "answer,report");
+    let evidence = &report.evidence[0];
+    assert_eq!(evidence.trace.as_deref(), Some("workflow.answer.v1"));
+    assert_eq!(evidence.metrics[0], ("admitted".to_string(), Some(8.0)));
+    assert_eq!(evidence.metrics[3], ("tokens_used".to_string(), None));
+    let json = report.to_json();
+    assert!(json.contains("\"class\":\"interactive\""));
+    assert!(json.contains("\"trace\":\"workflow.answer.v1\",\"metrics\":{\"admitted\":8.000,"));
+    assert!(json.contains("\"tokens_used\":null"));
+
+    // Every arrival is admitted, deferred or rejected; deferred ones still run.
+    let mut admitting = options(vec![tenant("nightly:report:1:4"), tenant("ui:answer:1:1")]);
+    admitting.queue_target_ms = Some(3.0);
+    let report = loadtest_source(source, &admitting).expect("loadtest should run");
+    assert_eq!(report.requests, 40);
+    assert_eq!(report.succeeded + report.failed + report.rejected, 40);
+    for load in &report.tenants {
+        assert_eq!(load.admitted + load.rejected, load.requests);
+    }
+    admitting.admission = kooixc::scheduler::AdmissionPolicy::Defer;
+    let report = loadtest_source(source, &admitting).expect("loadtest should run");
+    assert_eq!(report.rejected, 0);
+    assert_eq!(report.succeeded, 40);
+
+    let error = loadtest_source(
+        source,
+        &options(vec![tenant("ui:answer"), tenant("ui:report")]),
+    )
+    .expect_err("duplicate tenant names should fail");
+    assert_eq!(error[0].message, "duplicate tenant 'ui'");
+
+    // Dispatch order, with everything queued before the single worker starts: the interactive
+    // instance first despite arriving last, then weight 3 takes three of every four batch slots.
+    use kooixc::ast::PriorityClass;
+    use kooixc::scheduler::{Admission, AdmissionPolicy, Scheduler, SchedulerOptions};
+    use std::time::Duration;
+    let scheduler = Scheduler::new(SchedulerOptions {
+        workers: 1,
+        ..SchedulerOptions::default()
+    });
+    for _ in 0..4 {
+        scheduler.submit("heavy", 3, PriorityClass::Batch, Duration::ZERO, "heavy");
+        scheduler.submit("light", 1, PriorityClass::Batch, Duration::ZERO, "light");
+    }
+    scheduler.submit("ui", 1, PriorityClass::Interactive, Duration::ZERO, "ui");
+    scheduler.close();
+    let order: Vec<&str> = std::iter::from_fn(|| scheduler.next())
+        .map(|dispatch| dispatch.item)
+        .collect();
+    assert_eq!(order.len(), 9);
+    assert_eq!(order[0], "ui");
+    assert_eq!(
+        order[1..5].iter().filter(|item| **item == "heavy").count(),
+        3
+    );
+    assert_eq!(order[5], "heavy");
+    assert_eq!(&order[6..], ["light"; 3]);
+
+    // Admission: three 4ms batch instances fill a 10ms target, the fourth is turned away, and an
+    // interactive arrival is still admitted because only its own class is ahead of it.
+    let admission = |admission| {
+        let scheduler = Scheduler::new(SchedulerOptions {
+            workers: 1,
+            queue_target: Some(Duration::from_millis(10)),
+            admission,
+        });
+        let expected = Duration::from_millis(4);
+        let outcomes: Vec<Admission> = (0..4)
+            .map(|_| scheduler.submit("nightly", 1, PriorityClass::Batch, expected, ()))
+            .collect();
+        let ui = scheduler.submit("ui", 1, PriorityClass::Interactive, expected, ());
+        (scheduler, outcomes, ui)
+    };
+    let (_, outcomes, ui) = admission(AdmissionPolicy::Reject);
+    assert_eq!(&outcomes[..3], [Admission::Queued; 3]);
+    assert_eq!(outcomes[3], Admission::Rejected);
+    assert_eq!(ui, Admission::Queued);
+
+    // ...or deferred, and re-admitted once completions bring the estimate back under the target.
+    let (scheduler, outcomes, _) = admission(AdmissionPolicy::Defer);
+    assert_eq!(outcomes[3], Admission::Deferred);
+    let expected = Duration::from_millis(4);
+    for class in [PriorityClass::Interactive, PriorityClass::Batch] {
+        let dispatch = scheduler.next().expect("queued instance");
+        assert_eq!(dispatch.class, class);
+        scheduler.complete(expected, expected);
+    }
+    scheduler.close();
+    assert_eq!(std::iter::from_fn(|| scheduler.next()).count(), 3);
+    let stats = scheduler.tenant_stats();
+    assert_eq!(
+        (stats["nightly"].admitted, stats["nightly"].deferred),
+        (3, 1)
+    );
+    assert_eq!(stats["nightly"].queue_wait_us.len(), 4);
+
+    assert!(kooixc::loadtest::TenantSpec::parse("ui").is_err());
+    assert!(kooixc::loadtest::TenantSpec::parse("ui:answer:0").is_err());
+}
+
+#[test]
+fn net_pool_keeps_connections_alive_per_host_and_pipelines_idempotent_requests() {
+    use kooixc::net_pool::{HttpRequest, NetPool, NetPoolOptions, StandInServer};
+    use std::time::Duration;
+
+    let server = StandInServer::start(Duration::ZERO).expect("stand-in should start");
+    let pool = NetPool::new(NetPoolOptions {
+        max_per_host: 2,
+        idle_timeout: Duration::from_millis(50),
+        connect_to: Some(server.address()),
+        ..NetPoolOptions::default()
+    });
+
+    // GETs share one connection and are written back to back; the POST waits its turn.
+    let responses = pool.pipeline(
+        "api.example.com",
+        vec![
+            HttpRequest::get("/a"),
+            HttpRequest::get("/b"),
+            HttpRequest::get("/chunked"),
+            HttpRequest::post("/submit", "{}"),
+            HttpRequest::get("/c"),
+        ],
+    );
+    let bodies: Vec<String> = responses
+        .into_iter()
+        .map(|response| String::from_utf8(response.expect("request should succeed").body).unwrap())
+        .collect();
+    assert_eq!(
+        bodies,
+        ["GET /a", "GET /b", "GET /chunked", "POST /submit", "GET /c"]
+    );
+    let stats = pool.stats();
+    assert_eq!(stats.connections_opened, 1);
+    assert_eq!(server.connections(), 1);
+    assert_eq!(stats.pipelined, 2);
+    assert_eq!(stats.reused, 4);
+
+    // `Connection: close` retires the connection; the next request opens a new one.
+    let response = pool
+        .request("api.example.com", HttpRequest::get("/close"))
+        .expect("request should succeed");
+    assert!(!response.keep_alive);
+    pool.request("api.example.com", HttpRequest::get("/d"))
+        .expect("request should succeed");
+    assert_eq!(pool.stats().closed, 1);
+    assert_eq!(server.connections(), 2);
+
+    // Idle connections past the timeout are evicted rather than reused.
+    std::thread::sleep(Duration::from_millis(80));
+    assert_eq!(pool.evict_idle(), 1);
+    pool.request("api.example.com", HttpRequest::get("/e"))
+        .expect("request should succeed");
+    assert_eq!(server.connections(), 3);
+
+    // Concurrent callers never hold more than `max_per_host` connections to one host.
+    let slow = StandInServer::start(Duration::from_millis(2)).expect("stand-in should start");
+    let pool = NetPool::new(NetPoolOptions {
+        max_per_host: 2,
+        connect_to: Some(slow.address()),
+        ..NetPoolOptions::default()
+    });
+    std::thread::scope(|scope| {
+        for worker in 0..6 {
+            let pool = &pool;
+            scope.spawn(move || {
+                for call in 0..5 {
+                    pool.request(
+                        "api.example.com",
+                        HttpRequest::get(format!("/{worker}/{call}")),
+                    )
+                    .expect("request should succeed");
+                }
+            });
+        }
+    });
+    assert_eq!(slow.requests(), 30);
+    assert!(
+        slow.connections() <= 2,
+        "{} connections",
+        slow.connections()
+    );
+    assert_eq!(pool.stats().reused, 30 - slow.connections());
+
+    // A server that silently drops keep-alive connections: the stale reuse is retried once.
+    let listener = std::net::TcpListener::bind("127.0.0.1:0").expect("listener should bind");
+    let address = listener.local_addr().unwrap();
+    let closer = std::thread::spawn(move || {
+        use std::io::{Read, Write};
+        for stream in listener.incoming().take(2) {
+            let mut stream = stream.expect("connection should be accepted");
+            let mut request = [0; 1024];
+            let _ = stream.read(&mut request);
+            stream
+                .write_all(b"HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok")
+                .expect("response should be written");
+        }
+    });
+    let pool = NetPool::new(NetPoolOptions {
+        connect_to: Some(address),
+        ..NetPoolOptions::default()
+    });
+    for _ in 0..2 {
+        let response = pool
+            .request("api.example.com", HttpRequest::get("/"))
+            .expect("request should succeed");
+        assert_eq!(response.body, b"ok");
+        std::thread::sleep(Duration::from_millis(20));
+    }
+    closer.join().unwrap();
+    assert_eq!(pool.stats().stale_retries, 1);
+    assert_eq!(pool.stats().connections_opened, 2);
+    // The retried request is still one request.
+    assert_eq!(pool.stats().requests, 2);
+
+    // Oversized bodies fail the request before anything that large is allocated.
+    let listener = std::net::TcpListener::bind("127.0.0.1:0").expect("listener should bind");
+    let address = listener.local_addr().unwrap();
+    let heads: [&[u8]; 2] = [
+        b"HTTP/1.1 200 OK\r\nContent-Length: 1099511627776\r\n\r\n",
+        b"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n10000000000\r\n",
+    ];
+    let oversized = std::thread::spawn(move || {
+        use std::io::{Read, Write};
+        for (head, stream) in heads.into_iter().zip(listener.incoming()) {
+            let mut stream = stream.expect("connection should be accepted");
+            let mut request = [0; 1024];
+            let _ = stream.read(&mut request);
+            stream.write_all(head).expect("response should be written");
+        }
+    });
+    let pool = NetPool::new(NetPoolOptions {
+        connect_to: Some(address),
+        ..NetPoolOptions::default()
+    });
+    for _ in 0..2 {
+        let error = pool
+            .request("api.example.com", HttpRequest::get("/"))
+            .expect_err("oversized body should fail");
+        assert!(
+            error.contains(&format!(
+                "exceeds {} bytes",
+                kooixc::net_pool::MAX_BODY_BYTES
+            )),
+            "{error}"
+        );
+    }
+    oversized.join().unwrap();
+}
+
+#[test]
+fn loadtest_sends_net_capability_calls_through_keep_alive_pool() {
+    let source = r#"
+cap Net<"api.openai.com">;
+cap Tool<"web_search", "read-only">;
+
+fn fetch(q: Text) -> Text !{net} requires [Net<"api.openai.com">];
+fn search(q: Text) -> Text !{tool(web_search), net} requires [Tool<"web_search", "read-only">, Net<"api.openai.com">];
+
+workflow answer(q: Text) -> Text
+steps {
+  s1: fetch(q);
+  s2: search(s1);
+}
+;
+"#;
+    let mut options = kooixc::loadtest::LoadTestOptions::new("answer");
+    options.requests = 40;
+    options.concurrency = 8;
+    options.runtime.capability_limit = 3;
+    options.runtime.time_scale = 0.01;
+    options.net = Some(kooixc::loadtest::NetProvider::StandIn);
+
+    let report = loadtest_source(source, &options).expect("loadtest should run");
+    assert_eq!(report.succeeded, 40);
+    let net = report.net.expect("net pool stats should be reported");
+    assert_eq!(net.requests, 80);
+    // Every Net<"api.openai.com"> call shares one host pool capped at the capability limit.
+    assert!(net.connections_opened <= 3, "{net:?}");
+    assert_eq!(net.reused, net.requests - net.connections_opened);
+    assert!(report.to_json().contains("\"net\":{\"requests\":80"));
+
+    options.net = None;
+    let report = loadtest_source(source, &options).expect("loadtest should run");
+    assert!(report.net.is_none());
+    assert!(report.to_json().contains("\"net\":null"));
+}
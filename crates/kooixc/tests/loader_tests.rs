@@ -2,9 +2,13 @@ use std::fs;
 use std::path::PathBuf;
 use std::time::{SystemTime, UNIX_EPOCH};
 
-use kooixc::check_entry_modules;
+use kooixc::batch_read::ReadBackend;
 use kooixc::error::Severity;
-use kooixc::loader::{load_module_programs, load_source_map, load_source_map_with_module_graph};
+use kooixc::loader::{
+    load_module_programs, load_module_programs_skimmed, load_source_map, load_source_map_with_mode,
+    load_source_map_with_module_graph, LoadMode,
+};
+use kooixc::{check_entry_module, check_entry_modules};
 
 fn make_temp_dir(suffix: &str) -> PathBuf {
     let nanos = SystemTime::now()
@@ -407,3 +411,110 @@ fn check_entry_modules_resolves_qualified_import_enum_variants() {
 
     let _ = fs::remove_dir_all(&dir);
 }
+
+#[test]
+fn batched_loading_matches_serial_order_and_errors() {
+    let dir = make_temp_dir("batched");
+    fs::create_dir_all(dir.join("lib")).expect("create lib dir");
+    fs::write(dir.join("lib/common.kooix"), "fn helper() -> Int { 1 };").expect("write common");
+    fs::write(
+        dir.join("lib/a.kooix"),
+        "import \"common\";\nfn a() -> Int { helper() };",
+    )
+    .expect("write a");
+    fs::write(
+        dir.join("b.kooix"),
+        "import \"lib/common\";\nimport \"lib/a\";\nfn b() -> Int { a() };",
+    )
+    .expect("write b");
+    let main = dir.join("main.kooix");
+    fs::write(
+        &main,
+        "import \"lib/a\";\nimport \"b\";\nfn main() -> Int { a() + b() };",
+    )
+    .expect("write main");
+
+    let modes = [
+        LoadMode::Batched(ReadBackend::Threads),
+        LoadMode::Batched(ReadBackend::IoUring),
+        LoadMode::Batched(ReadBackend::Auto),
+    ];
+    let (serial_map, serial_graph) =
+        load_source_map_with_mode(&main, LoadMode::Serial).expect("serial load should succeed");
+    assert_eq!(serial_map.files.len(), 4);
+    for mode in modes {
+        let (map, graph) = load_source_map_with_mode(&main, mode).expect("batched load");
+        assert_eq!(map, serial_map, "{mode:?}");
+        assert_eq!(graph, serial_graph, "{mode:?}");
+    }
+
+    fs::write(
+        dir.join("b.kooix"),
+        "import \"lib/missing\";\nfn b() -> Int { 0 };",
+    )
+    .expect("rewrite b");
+    let serial_errors =
+        load_source_map_with_mode(&main, LoadMode::Serial).expect_err("serial load should fail");
+    assert!(serial_errors[0].message.contains("missing.kooix"));
+    for mode in modes {
+        let errors = load_source_map_with_mode(&main, mode).expect_err("batched load should fail");
+        assert_eq!(errors, serial_errors, "{mode:?}");
+    }
+
+    let _ = fs::remove_dir_all(&dir);
+}
+
+#[test]
+fn skimmed_modules_parse_bodies_on_demand() {
+    let dir = make_temp_dir("skim");
+    let lib = dir.join("lib.kooix");
+    let main = dir.join("main.kooix");
+
+    fs::write(
+        &lib,
+        "record Pair { a: Int; b: Int; };\nfn make() -> Pair { Pair { a: 1; b: if true { 2 } else { 3 }; } };\nfn ext(x: Int) -> Int;\nfn helper() -> Int { if true { 41 } else { 0 } };",
+    )
+    .expect("write lib");
+    fs::write(
+        &main,
+        "import \"lib\" as Lib;\n\nfn main() -> Int { Lib::helper() + 1 };",
+    )
+    .expect("write main");
+
+    let (_graph, full) = load_module_programs(&main).expect("full load");
+    let (_graph, mut skimmed) =
+        load_module_programs_skimmed(&main, |path| path.ends_with("main.kooix"))
+            .expect("skimmed load");
+    assert_ne!(skimmed, full);
+    assert!(skimmed[1].lazy.is_none(), "main keeps its parsed bodies");
+    assert!(skimmed[0].lazy.is_some(), "lib bodies stay token ranges");
+
+    for module in &mut skimmed {
+        module.force_bodies().expect("bodies should parse");
+    }
+    assert_eq!(skimmed, full);
+
+    // A broken body in a module nobody checks is never parsed.
+    fs::write(
+        &lib,
+        "fn helper() -> Int { let = };\nfn other() -> Int { 1 };",
+    )
+    .expect("rewrite lib");
+    let result = check_entry_module(&main, &main).expect("skimmed check should load");
+    assert!(
+        result.diagnostics.is_empty(),
+        "unexpected diagnostics: {:?}",
+        result.diagnostics
+    );
+    let (_graph, mut skimmed) =
+        load_module_programs_skimmed(&main, |_| false).expect("skimmed load");
+    let errors = skimmed[0].force_bodies().expect_err("forcing should fail");
+    assert!(
+        errors[0].message.contains("lib.kooix:1:"),
+        "{}",
+        errors[0].message
+    );
+    assert!(check_entry_modules(&main).is_err());
+
+    let _ = fs::remove_dir_all(&dir);
+}
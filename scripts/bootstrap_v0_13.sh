@@ -216,6 +216,22 @@ parse_module_preflight_json() {
   ' "$json_file"
 }
 
+# Compiles one smoke target with the stage3 compiler, unless the `--batch` prepass already built it.
+smoke_compile() {
+  local key="$1"
+  local entry="$2"
+  local ir="$3"
+  local bin="$4"
+  local timeout="${5:-$TIMEOUT_SMOKE}"
+
+  if is_enabled "$SMOKE_BATCH" && [[ -s "$ir" && -x "$bin" ]]; then
+    echo "[batch] ${key}: reusing batch output"
+    return 0
+  fi
+  rm -f "$ir" "$bin"
+  run_limited "$key" "$timeout" "$STAGE3_BIN" "$entry" "$ir" "$bin" >/dev/null
+}
+
 SAFE_MODE="${KX_SAFE_MODE:-1}"
 DEFAULT_REUSE="${KX_DEFAULT_REUSE:-1}"
 SAFE_NICE="${KX_SAFE_NICE:-10}"
@@ -226,6 +242,7 @@ CMD_TIMEOUT="${KX_CMD_TIMEOUT:-900}"
 TIMEOUT_STAGE1_DRIVER="${KX_TIMEOUT_STAGE1_DRIVER:-$CMD_TIMEOUT}"
 TIMEOUT_STAGE_BUILD="${KX_TIMEOUT_STAGE_BUILD:-$CMD_TIMEOUT}"
 TIMEOUT_SMOKE="${KX_TIMEOUT_SMOKE:-300}"
+SMOKE_BATCH="${KX_SMOKE_BATCH:-0}"
 TIMEOUT_SELFHOST="${KX_TIMEOUT_SELFHOST:-$CMD_TIMEOUT}"
 TIMEOUT_BIN="$(resolve_timeout_bin)"
 RESOURCE_LOG="${KX_RESOURCE_LOG:-/tmp/kx-bootstrap-resource.log}"
@@ -246,6 +263,43 @@ fi
 OUT_DIR="${1:-$ROOT/dist}"
 mkdir -p "$OUT_DIR"
 
+# KX_BOOTSTRAP_DAG=1 hands the whole chain to `kooixc bootstrap`: stage builds and smokes become DAG
+# nodes keyed by input hashes (up-to-date nodes are skipped, so KX_REUSE_* is not consulted),
+# independent smokes run concurrently under a memory budget, and per-node time/RSS go to JSON.
+if is_enabled "${KX_BOOTSTRAP_DAG:-0}"; then
+  dag_smokes=()
+  is_enabled "${KX_SMOKE:-0}" && dag_smokes+=(stage2-min)
+  is_enabled "${KX_SMOKE_IMPORT:-0}" && dag_smokes+=(import)
+  is_enabled "${KX_SMOKE_STDLIB:-0}" && dag_smokes+=(stdlib)
+  is_enabled "${KX_SMOKE_HOST_READ:-0}" && dag_smokes+=(host-read)
+  is_enabled "${KX_SMOKE_S1_CORE:-0}" && dag_smokes+=(core)
+  is_enabled "${KX_SMOKE_S1_LEXER:-0}" && dag_smokes+=(s1-lexer)
+  is_enabled "${KX_SMOKE_S1_PARSER:-0}" && dag_smokes+=(s1-parser)
+  is_enabled "${KX_SMOKE_S1_TYPECHECK:-0}" && dag_smokes+=(s1-typecheck)
+  is_enabled "${KX_SMOKE_S1_RESOLVER:-0}" && dag_smokes+=(s1-resolver)
+  is_enabled "${KX_SMOKE_S1_COMPILER:-0}" && dag_smokes+=(s1-compiler)
+  is_enabled "${KX_SMOKE_COMPILER_MAIN:-0}" && dag_smokes+=(compiler-main)
+  # Not a smoke of its own: compiles the selected stage3 smokes in one `--batch` node.
+  is_enabled "$SMOKE_BATCH" && dag_smokes+=(batch)
+  if (( ${#dag_smokes[@]} == 0 )); then
+    dag_smokes=(none)
+  fi
+  dag_smoke_list="$(IFS=,; echo "${dag_smokes[*]}")"
+
+  dag_args=("$OUT_DIR" --smoke "$dag_smoke_list" --stage-timeout "${KX_TIMEOUT_STAGE_BUILD:-$CMD_TIMEOUT}" --smoke-timeout "$TIMEOUT_SMOKE" --json)
+  if [[ -n "${KX_BOOTSTRAP_JOBS:-}" ]]; then
+    dag_args+=(--jobs "$KX_BOOTSTRAP_JOBS")
+  fi
+  if [[ -n "${KX_BOOTSTRAP_MEM_BUDGET_MB:-}" ]]; then
+    dag_args+=(--mem-budget-mb "$KX_BOOTSTRAP_MEM_BUDGET_MB")
+  fi
+  DAG_REPORT="${KX_BOOTSTRAP_REPORT:-/tmp/kx-bootstrap-dag.json}"
+  echo "bootstrap-v0.13: dag driver smokes=$dag_smoke_list report=$DAG_REPORT"
+  cargo run -p kooixc -j "$JOBS" -- bootstrap "${dag_args[@]}" > "$DAG_REPORT"
+  echo "ok: ${OUT_DIR%/}/kooixc1"
+  exit 0
+fi
+
 if is_enabled "$SAFE_MODE"; then
   SAFE_MODE_LABEL="enabled"
   export CARGO_INCREMENTAL="${CARGO_INCREMENTAL:-0}"
@@ -435,13 +489,49 @@ if is_enabled "${KX_SMOKE_S1_CORE:-0}"; then
   KX_SMOKE_S1_RESOLVER=1
 fi
 
+if is_enabled "$SMOKE_BATCH"; then
+  # One stage3 process compiles every enabled smoke target below; shared modules (prelude, Stage1
+  # lexer/parser/typecheck) are loaded and parsed once instead of once per target.
+  SMOKE_BATCH_MANIFEST="/tmp/kooixc_stage3_smoke_batch.txt"
+  SMOKE_BATCH_COUNT=0
+  SMOKE_BATCH_TIMEOUT=0
+  : > "$SMOKE_BATCH_MANIFEST"
+
+  smoke_batch_add() {
+    local flag="$1"
+    local entry="$2"
+    local ir="$3"
+    local bin="$4"
+    local timeout="${5:-$TIMEOUT_SMOKE}"
+    if is_enabled "${!flag:-0}"; then
+      rm -f "$ir" "$bin"
+      printf '%s %s %s\n' "$entry" "$ir" "$bin" >> "$SMOKE_BATCH_MANIFEST"
+      SMOKE_BATCH_COUNT=$((SMOKE_BATCH_COUNT + 1))
+      SMOKE_BATCH_TIMEOUT=$((SMOKE_BATCH_TIMEOUT + timeout))
+    fi
+  }
+
+  smoke_batch_add KX_SMOKE stage1/stage2_min.kooix /tmp/kooixc_stage3_stage2_min.ll "${OUT_DIR%/}/kooixc-stage3-stage2-min"
+  smoke_batch_add KX_SMOKE_S1_LEXER stage1/stage2_s1_lexer_module_smoke.kooix /tmp/kooixc_stage3_stage2_s1_lexer_module_smoke.ll "${OUT_DIR%/}/kooixc-stage3-stage2-s1-lexer-module-smoke"
+  smoke_batch_add KX_SMOKE_S1_PARSER stage1/stage2_s1_parser_module_smoke.kooix /tmp/kooixc_stage3_stage2_s1_parser_module_smoke.ll "${OUT_DIR%/}/kooixc-stage3-stage2-s1-parser-module-smoke"
+  smoke_batch_add KX_SMOKE_S1_TYPECHECK stage1/stage2_s1_typecheck_module_smoke.kooix /tmp/kooixc_stage3_stage2_s1_typecheck_module_smoke.ll "${OUT_DIR%/}/kooixc-stage3-stage2-s1-typecheck-module-smoke"
+  smoke_batch_add KX_SMOKE_S1_RESOLVER stage1/stage2_s1_resolver_module_smoke.kooix /tmp/kooixc_stage3_stage2_s1_resolver_module_smoke.ll "${OUT_DIR%/}/kooixc-stage3-stage2-s1-resolver-module-smoke"
+  smoke_batch_add KX_SMOKE_S1_COMPILER stage1/stage2_s1_compiler_module_smoke.kooix /tmp/kooixc_stage3_stage2_s1_compiler_module_smoke.ll "${OUT_DIR%/}/kooixc-stage3-stage2-s1-compiler-module-smoke"
+  # First hop of the compiler_main two-hop smoke; the second hop runs the binary it produces.
+  smoke_batch_add KX_SMOKE_COMPILER_MAIN stage1/compiler_main.kooix /tmp/kooixc_stage3_stage1_compiler_main_smoke.ll "${OUT_DIR%/}/kooixc-stage3-stage1-compiler-main-smoke" "$TIMEOUT_SELFHOST"
+
+  if (( SMOKE_BATCH_COUNT > 0 )); then
+    echo "[smoke] stage3 compiler compiles ${SMOKE_BATCH_COUNT} smoke targets in one batch ($SMOKE_BATCH_MANIFEST)"
+    run_limited smoke_batch_compile "$SMOKE_BATCH_TIMEOUT" "$STAGE3_BIN" --batch "$SMOKE_BATCH_MANIFEST" >/dev/null
+  fi
+fi
+
 if is_enabled "${KX_SMOKE:-0}"; then
   echo "[smoke] stage3 compiler compiles stage2_min and runs it"
   SMOKE_IR="/tmp/kooixc_stage3_stage2_min.ll"
   SMOKE_BIN="${OUT_DIR%/}/kooixc-stage3-stage2-min"
-  rm -f "$SMOKE_IR" "$SMOKE_BIN"
 
-  run_limited smoke_stage2_min_compile "$TIMEOUT_SMOKE" "$STAGE3_BIN" stage1/stage2_min.kooix "$SMOKE_IR" "$SMOKE_BIN" >/dev/null
+  smoke_compile smoke_stage2_min_compile stage1/stage2_min.kooix "$SMOKE_IR" "$SMOKE_BIN"
   test -s "$SMOKE_IR"
   test -x "$SMOKE_BIN"
   run_limited smoke_stage2_min_run "$TIMEOUT_SMOKE" "$SMOKE_BIN" >/dev/null
@@ -578,9 +668,8 @@ if is_enabled "${KX_SMOKE_S1_LEXER:-0}"; then
   echo "[smoke] stage3 compiler compiles stage1/stage2_s1_lexer_module_smoke and runs it (imports stage1/lexer)"
   SMOKE_IR="/tmp/kooixc_stage3_stage2_s1_lexer_module_smoke.ll"
   SMOKE_BIN="${OUT_DIR%/}/kooixc-stage3-stage2-s1-lexer-module-smoke"
-  rm -f "$SMOKE_IR" "$SMOKE_BIN"
 
-  run_limited smoke_s1_lexer_compile "$TIMEOUT_SMOKE" "$STAGE3_BIN" stage1/stage2_s1_lexer_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN" >/dev/null
+  smoke_compile smoke_s1_lexer_compile stage1/stage2_s1_lexer_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN"
   test -s "$SMOKE_IR"
   test -x "$SMOKE_BIN"
   run_limited smoke_s1_lexer_run "$TIMEOUT_SMOKE" "$SMOKE_BIN" >/dev/null
@@ -592,9 +681,8 @@ if is_enabled "${KX_SMOKE_S1_PARSER:-0}"; then
   echo "[smoke] stage3 compiler compiles stage1/stage2_s1_parser_module_smoke and runs it (imports stage1/parser)"
   SMOKE_IR="/tmp/kooixc_stage3_stage2_s1_parser_module_smoke.ll"
   SMOKE_BIN="${OUT_DIR%/}/kooixc-stage3-stage2-s1-parser-module-smoke"
-  rm -f "$SMOKE_IR" "$SMOKE_BIN"
 
-  run_limited smoke_s1_parser_compile "$TIMEOUT_SMOKE" "$STAGE3_BIN" stage1/stage2_s1_parser_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN" >/dev/null
+  smoke_compile smoke_s1_parser_compile stage1/stage2_s1_parser_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN"
   test -s "$SMOKE_IR"
   test -x "$SMOKE_BIN"
   run_limited smoke_s1_parser_run "$TIMEOUT_SMOKE" "$SMOKE_BIN" >/dev/null
@@ -606,9 +694,8 @@ if is_enabled "${KX_SMOKE_S1_TYPECHECK:-0}"; then
   echo "[smoke] stage3 compiler compiles stage1/stage2_s1_typecheck_module_smoke and runs it (imports stage1/typecheck)"
   SMOKE_IR="/tmp/kooixc_stage3_stage2_s1_typecheck_module_smoke.ll"
   SMOKE_BIN="${OUT_DIR%/}/kooixc-stage3-stage2-s1-typecheck-module-smoke"
-  rm -f "$SMOKE_IR" "$SMOKE_BIN"
 
-  run_limited smoke_s1_typecheck_compile "$TIMEOUT_SMOKE" "$STAGE3_BIN" stage1/stage2_s1_typecheck_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN" >/dev/null
+  smoke_compile smoke_s1_typecheck_compile stage1/stage2_s1_typecheck_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN"
   test -s "$SMOKE_IR"
   test -x "$SMOKE_BIN"
   run_limited smoke_s1_typecheck_run "$TIMEOUT_SMOKE" "$SMOKE_BIN" >/dev/null
@@ -620,9 +707,8 @@ if is_enabled "${KX_SMOKE_S1_RESOLVER:-0}"; then
   echo "[smoke] stage3 compiler compiles stage1/stage2_s1_resolver_module_smoke and runs it (imports stage1/resolver)"
   SMOKE_IR="/tmp/kooixc_stage3_stage2_s1_resolver_module_smoke.ll"
   SMOKE_BIN="${OUT_DIR%/}/kooixc-stage3-stage2-s1-resolver-module-smoke"
-  rm -f "$SMOKE_IR" "$SMOKE_BIN"
 
-  run_limited smoke_s1_resolver_compile "$TIMEOUT_SMOKE" "$STAGE3_BIN" stage1/stage2_s1_resolver_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN" >/dev/null
+  smoke_compile smoke_s1_resolver_compile stage1/stage2_s1_resolver_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN"
   test -s "$SMOKE_IR"
   test -x "$SMOKE_BIN"
   run_limited smoke_s1_resolver_run "$TIMEOUT_SMOKE" "$SMOKE_BIN" >/dev/null
@@ -634,9 +720,8 @@ if is_enabled "${KX_SMOKE_S1_COMPILER:-0}"; then
   echo "[smoke] stage3 compiler compiles stage1/stage2_s1_compiler_module_smoke and runs it (imports stage1/compiler)"
   SMOKE_IR="/tmp/kooixc_stage3_stage2_s1_compiler_module_smoke.ll"
   SMOKE_BIN="${OUT_DIR%/}/kooixc-stage3-stage2-s1-compiler-module-smoke"
-  rm -f "$SMOKE_IR" "$SMOKE_BIN"
 
-  run_limited smoke_s1_compiler_compile "$TIMEOUT_SMOKE" "$STAGE3_BIN" stage1/stage2_s1_compiler_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN" >/dev/null
+  smoke_compile smoke_s1_compiler_compile stage1/stage2_s1_compiler_module_smoke.kooix "$SMOKE_IR" "$SMOKE_BIN"
   test -s "$SMOKE_IR"
   test -x "$SMOKE_BIN"
   run_limited smoke_s1_compiler_run "$TIMEOUT_SMOKE" "$SMOKE_BIN" >/dev/null
@@ -669,9 +754,9 @@ if is_enabled "${KX_SMOKE_COMPILER_MAIN:-0}"; then
   SMOKE_COMPILER_MAIN_BIN="${OUT_DIR%/}/kooixc-stage3-stage1-compiler-main-smoke"
   SMOKE_STAGE4_MIN_IR="/tmp/kooixc_stage4_stage2_min_smoke.ll"
   SMOKE_STAGE4_MIN_BIN="${OUT_DIR%/}/kooixc-stage4-stage2-min-smoke"
-  rm -f "$SMOKE_COMPILER_MAIN_IR" "$SMOKE_COMPILER_MAIN_BIN" "$SMOKE_STAGE4_MIN_IR" "$SMOKE_STAGE4_MIN_BIN"
+  rm -f "$SMOKE_STAGE4_MIN_IR" "$SMOKE_STAGE4_MIN_BIN"
 
-  run_limited smoke_compiler_main_stage3_compile "$TIMEOUT_SELFHOST" "$STAGE3_BIN" stage1/compiler_main.kooix "$SMOKE_COMPILER_MAIN_IR" "$SMOKE_COMPILER_MAIN_BIN" >/dev/null
+  smoke_compile smoke_compiler_main_stage3_compile stage1/compiler_main.kooix "$SMOKE_COMPILER_MAIN_IR" "$SMOKE_COMPILER_MAIN_BIN" "$TIMEOUT_SELFHOST"
   test -s "$SMOKE_COMPILER_MAIN_IR"
   test -x "$SMOKE_COMPILER_MAIN_BIN"
 